@@ -0,0 +1,250 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include <ome/files/ChunkIterator.h>
+#include <ome/files/Executor.h>
+#include <ome/files/FormatReader.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class ChunkIterator::Impl
+    {
+    public:
+      /// Pending read type.
+      typedef std::future<std::shared_ptr<VariantPixelBuffer>> future_type;
+
+      /// The reader.
+      const FormatReader& reader;
+      /// Series.
+      dimension_size_type series;
+      /// Resolution.
+      dimension_size_type resolution;
+      /// Plane (single plane only).
+      dimension_size_type plane;
+      /// Reading a block of planes.
+      bool block;
+      /// Block Z range.
+      DimensionRange zRange;
+      /// Block T range.
+      DimensionRange tRange;
+      /// Block C range.
+      DimensionRange cRange;
+      /// Read the next chunk in the background.
+      bool readAhead;
+      /// Chunk regions.
+      std::vector<PlaneRegion> regions;
+      /// Index of the next chunk to return.
+      dimension_size_type index;
+      /// Chunk being read ahead.
+      future_type pending;
+      /// Buffer released by the caller, for reuse.
+      std::shared_ptr<VariantPixelBuffer> spare;
+
+      Impl(const FormatReader& reader,
+           bool                readAhead):
+        reader(reader),
+        series(reader.getSeries()),
+        resolution(reader.getResolution()),
+        plane(0U),
+        block(false),
+        zRange(),
+        tRange(),
+        cRange(),
+        readAhead(readAhead),
+        regions(),
+        index(0U),
+        pending(),
+        spare()
+      {
+      }
+
+      ~Impl()
+      {
+        if (pending.valid())
+          pending.wait();
+      }
+
+      void
+      makeRegions(dimension_size_type tileWidth,
+                  dimension_size_type tileHeight)
+      {
+        const dimension_size_type sizeX = reader.getSizeX();
+        const dimension_size_type sizeY = reader.getSizeY();
+        tileWidth = std::max(tileWidth, dimension_size_type(1U));
+        tileHeight = std::max(tileHeight, dimension_size_type(1U));
+
+        regions.reserve(((sizeX + tileWidth - 1U) / tileWidth) *
+                        ((sizeY + tileHeight - 1U) / tileHeight));
+        for (dimension_size_type y = 0; y < sizeY; y += tileHeight)
+          for (dimension_size_type x = 0; x < sizeX; x += tileWidth)
+            regions.push_back(PlaneRegion(x, y,
+                                          std::min(tileWidth, sizeX - x),
+                                          std::min(tileHeight, sizeY - y)));
+      }
+
+      std::shared_ptr<VariantPixelBuffer>
+      take()
+      {
+        std::shared_ptr<VariantPixelBuffer> buf(spare ? spare : std::make_shared<VariantPixelBuffer>());
+        spare.reset();
+        return buf;
+      }
+
+      void
+      read(const PlaneRegion&  region,
+           VariantPixelBuffer& buf) const
+      {
+        if (block)
+          reader.openBytes(series, resolution, zRange, tRange, cRange, region, buf);
+        else
+          reader.openBytes(series, resolution, plane, region, buf);
+      }
+
+      future_type
+      start(dimension_size_type chunk)
+      {
+        typedef std::packaged_task<std::shared_ptr<VariantPixelBuffer> ()> task_type;
+
+        const PlaneRegion region(regions.at(chunk));
+        std::shared_ptr<VariantPixelBuffer> dest(take());
+        std::shared_ptr<task_type> task
+          (std::make_shared<task_type>([this, region, dest]()
+                                       {
+                                         read(region, *dest);
+                                         return dest;
+                                       }));
+
+        future_type result(task->get_future());
+        reader.getExecutor()->execute([task]() { (*task)(); });
+        return result;
+      }
+    };
+
+    ChunkIterator::ChunkIterator(const FormatReader& reader,
+                                 dimension_size_type plane,
+                                 bool                readAhead):
+      impl(std::make_shared<Impl>(reader, readAhead))
+    {
+      if (plane >= reader.getImageCount())
+        {
+          boost::format fmt("Invalid plane: %1%");
+          fmt % plane;
+          throw std::logic_error(fmt.str());
+        }
+
+      impl->plane = plane;
+      const dimension_size_type channel = reader.getZCTCoords(plane)[1];
+      impl->makeRegions(reader.getOptimalTileWidth(channel),
+                        reader.getOptimalTileHeight(channel));
+    }
+
+    ChunkIterator::ChunkIterator(const FormatReader&   reader,
+                                 const DimensionRange& zRange,
+                                 const DimensionRange& tRange,
+                                 const DimensionRange& cRange,
+                                 bool                  readAhead):
+      impl(std::make_shared<Impl>(reader, readAhead))
+    {
+      impl->block = true;
+      impl->zRange = zRange;
+      impl->tRange = tRange;
+      impl->cRange = cRange;
+      impl->makeRegions(reader.getOptimalTileWidth(),
+                        reader.getOptimalTileHeight());
+    }
+
+    ChunkIterator::~ChunkIterator()
+    {
+    }
+
+    const std::vector<PlaneRegion>&
+    ChunkIterator::getRegions() const
+    {
+      return impl->regions;
+    }
+
+    bool
+    ChunkIterator::next(PlaneRegion&                         region,
+                        std::shared_ptr<VariantPixelBuffer>& buf)
+    {
+      // Reuse the previous buffer if the caller has released it.
+      if (buf && buf.use_count() == 1)
+        impl->spare = buf;
+      buf.reset();
+
+      if (impl->index >= impl->regions.size())
+        return false;
+
+      std::shared_ptr<VariantPixelBuffer> result;
+      if (impl->pending.valid())
+        {
+          result = impl->pending.get();
+        }
+      else
+        {
+          result = impl->take();
+          impl->read(impl->regions.at(impl->index), *result);
+        }
+
+      region = impl->regions.at(impl->index);
+      ++impl->index;
+
+      if (impl->readAhead && impl->index < impl->regions.size())
+        impl->pending = impl->start(impl->index);
+
+      buf = result;
+      return true;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
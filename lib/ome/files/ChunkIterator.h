@@ -0,0 +1,167 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#ifndef OME_FILES_CHUNKITERATOR_H
+#define OME_FILES_CHUNKITERATOR_H
+
+#include <memory>
+#include <vector>
+
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class FormatReader;
+    class VariantPixelBuffer;
+
+    /**
+     * Iterate over an image plane, or a block of planes, in chunks.
+     *
+     * The plane is divided into chunks of the optimal tile size of
+     * the reader (see FormatReader::getOptimalTileWidth() and
+     * FormatReader::getOptimalTileHeight()), aligned to the tile
+     * grid and clipped to the edges of the plane.  Chunks are
+     * visited in row-major order, which is the order in which TIFF
+     * tiles and strips are stored.  Each call to next() returns the
+     * region and pixel data of the next chunk.
+     *
+     * If read-ahead is enabled, the next chunk is read on the
+     * executor of the reader (see FormatReader::getExecutor()) while
+     * the caller processes the current chunk.  Buffers released by
+     * the caller are reused for later chunks, so at most two chunk
+     * buffers are held at once, however large the plane.
+     *
+     * The series and resolution are those current when the iterator
+     * is constructed; changing the current series or resolution
+     * afterwards does not affect the iterator.  The reader must
+     * remain open until the iterator is destroyed.
+     */
+    class ChunkIterator
+    {
+    public:
+      /**
+       * Constructor for a single plane.
+       *
+       * Chunks are read with FormatReader::openBytes() with an
+       * explicit series and resolution.
+       *
+       * @param reader the reader to read from.
+       * @param plane the plane index within the current series.
+       * @param readAhead @c true to read the next chunk in the
+       * background, @c false otherwise.
+       * @throws std::logic_error if the plane is invalid.
+       */
+      ChunkIterator(const FormatReader& reader,
+                    dimension_size_type plane,
+                    bool                readAhead = false);
+
+      /**
+       * Constructor for a block of planes.
+       *
+       * Chunks are read with FormatReader::openBytes() with an
+       * explicit series and resolution and @c Z, @c T and @c C
+       * ranges, so each chunk contains the same region of every
+       * plane in the block.
+       *
+       * @param reader the reader to read from.
+       * @param zRange the range of @c Z indices.
+       * @param tRange the range of @c T indices.
+       * @param cRange the range of effective @c C indices.
+       * @param readAhead @c true to read the next chunk in the
+       * background, @c false otherwise.
+       */
+      ChunkIterator(const FormatReader&   reader,
+                    const DimensionRange& zRange,
+                    const DimensionRange& tRange,
+                    const DimensionRange& cRange,
+                    bool                  readAhead = false);
+
+      /// Destructor.  Waits for any chunk being read ahead.
+      ~ChunkIterator();
+
+      /// @cond SKIP
+      ChunkIterator (const ChunkIterator&) = delete;
+
+      ChunkIterator&
+      operator= (const ChunkIterator&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get the chunk regions.
+       *
+       * @returns the regions of all chunks, in iteration order.
+       */
+      const std::vector<PlaneRegion>&
+      getRegions() const;
+
+      /**
+       * Read the next chunk.
+       *
+       * If @p buf holds the only reference to the buffer returned by
+       * a previous call, the buffer is reused for a later chunk.
+       *
+       * @param region set to the region of the chunk.
+       * @param buf set to the pixel data of the chunk.
+       * @returns @c true if a chunk was read, or @c false if there
+       * are no more chunks.
+       * @throws the exception thrown by the reader, if the read
+       * failed.
+       */
+      bool
+      next(PlaneRegion&                         region,
+           std::shared_ptr<VariantPixelBuffer>& buf);
+
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+    };
+
+  }
+}
+
+#endif // OME_FILES_CHUNKITERATOR_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,1244 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/preprocessor.hpp>
+
+#include <ome/files/Downsample.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+// SSE2 is part of the x86-64 baseline.  Other platforms use the
+// scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define OME_FILES_DOWNSAMPLE_SSE2
+# include <emmintrin.h>
+#endif
+
+using ome::files::dimension_size_type;
+using ome::files::DownsampleMethod;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+
+namespace
+{
+
+  // Mean of a block of pixel values.  Integer types are summed
+  // exactly, and rounded to nearest with halves rounded away from
+  // zero (as for std::round).
+  template<typename T>
+  struct Mean
+  {
+    typedef typename std::conditional<std::is_signed<T>::value,
+                                      int64_t, uint64_t>::type accumulator_type;
+
+    static T
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      const accumulator_type c = static_cast<accumulator_type>(count);
+      return static_cast<T>(std::is_signed<T>::value && sum < accumulator_type(0) ?
+                            -((-sum * 2 + c) / (c * 2)) :
+                            (sum * 2 + c) / (c * 2));
+    }
+  };
+
+  template<>
+  struct Mean<float>
+  {
+    typedef double accumulator_type;
+
+    static float
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      return static_cast<float>(sum / static_cast<double>(count));
+    }
+  };
+
+  template<>
+  struct Mean<double>
+  {
+    typedef double accumulator_type;
+
+    static double
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      return sum / static_cast<double>(count);
+    }
+  };
+
+  template<>
+  struct Mean<std::complex<float>>
+  {
+    typedef std::complex<double> accumulator_type;
+
+    static std::complex<float>
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      return std::complex<float>(sum / static_cast<double>(count));
+    }
+  };
+
+  template<>
+  struct Mean<std::complex<double>>
+  {
+    typedef std::complex<double> accumulator_type;
+
+    static std::complex<double>
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      return sum / static_cast<double>(count);
+    }
+  };
+
+  template<>
+  struct Mean<bool>
+  {
+    typedef dimension_size_type accumulator_type;
+
+    static bool
+    result(accumulator_type    sum,
+           dimension_size_type count)
+    {
+      return sum * 2U >= count;
+    }
+  };
+
+  // Mean of blocks of a fixed size.  Integer blocks with a power
+  // of two size (the common case for 2×2 and 4×4 blocks) are divided
+  // by shifting, with the same rounding as Mean.
+  template<typename T,
+           bool Integer = std::is_integral<T>::value && !std::is_same<T, bool>::value>
+  struct MeanDivisor
+  {
+    dimension_size_type count;
+
+    explicit
+    MeanDivisor(dimension_size_type count):
+      count(count)
+    {}
+
+    T
+    operator()(typename Mean<T>::accumulator_type sum) const
+    {
+      return Mean<T>::result(sum, count);
+    }
+  };
+
+  template<typename T>
+  struct MeanDivisor<T, true>
+  {
+    typedef typename Mean<T>::accumulator_type accumulator_type;
+
+    dimension_size_type count;
+    int shift;
+
+    explicit
+    MeanDivisor(dimension_size_type count):
+      count(count),
+      shift(-1)
+    {
+      if (count && (count & (count - 1U)) == 0U)
+        {
+          shift = 0;
+          while ((dimension_size_type(1U) << shift) < count)
+            ++shift;
+        }
+    }
+
+    T
+    operator()(accumulator_type sum) const
+    {
+      if (shift < 0)
+        return Mean<T>::result(sum, count);
+
+      const accumulator_type half = static_cast<accumulator_type>(count / 2U);
+      return static_cast<T>(std::is_signed<T>::value && sum < accumulator_type(0) ?
+                            -((-sum + half) >> shift) :
+                            (sum + half) >> shift);
+    }
+  };
+
+  // Vectorised kernels for the single pass 2×2 reduction of two
+  // contiguous rows (meanPairs and Extremum::pairs).  Each makes as
+  // many whole vectors of destination pixels as possible, and
+  // returns the number made; the scalar loop makes the rest, with
+  // identical results.  There are SSE2 kernels for 8- and 16-bit
+  // unsigned integers only: other types, and other platforms, use
+  // the scalar loop throughout.  (Floating point kernels were no
+  // faster than the scalar loop, whose mean is summed in double
+  // precision.)
+  template<typename T>
+  struct PairKernel
+  {
+    static dimension_size_type
+    mean(const T            * /* row0 */,
+         const T            * /* row1 */,
+         T                  * /* dest */,
+         dimension_size_type /* n */)
+    {
+      return 0U;
+    }
+
+    static dimension_size_type
+    extremum(const T            * /* row0 */,
+             const T            * /* row1 */,
+             T                  * /* dest */,
+             dimension_size_type /* n */,
+             bool                /* maximum */)
+    {
+      return 0U;
+    }
+  };
+
+#ifdef OME_FILES_DOWNSAMPLE_SSE2
+
+  inline __m128i
+  load128(const void *src)
+  {
+    return _mm_loadu_si128(static_cast<const __m128i *>(src));
+  }
+
+  inline void
+  store128(void    *dest,
+           __m128i  value)
+  {
+    _mm_storeu_si128(static_cast<__m128i *>(dest), value);
+  }
+
+  template<>
+  struct PairKernel<uint8_t>
+  {
+    // 16 destination pixels from 32 columns of each row.  The even
+    // and odd columns are widened to 16 bits, where the sum of four
+    // values cannot overflow.
+    static dimension_size_type
+    mean(const uint8_t      *row0,
+         const uint8_t      *row1,
+         uint8_t            *dest,
+         dimension_size_type n)
+    {
+      const __m128i low = _mm_set1_epi16(0x00FF);
+      const __m128i half = _mm_set1_epi16(2);
+      dimension_size_type i = 0;
+      for (; i + 16U <= n; i += 16U)
+        {
+          __m128i result[2];
+          for (dimension_size_type h = 0; h < 2U; ++h)
+            {
+              const __m128i a = load128(row0 + (i + h * 8U) * 2U);
+              const __m128i b = load128(row1 + (i + h * 8U) * 2U);
+              const __m128i sum =
+                _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8)),
+                              _mm_add_epi16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8)));
+              result[h] = _mm_srli_epi16(_mm_add_epi16(sum, half), 2);
+            }
+          store128(dest + i, _mm_packus_epi16(result[0], result[1]));
+        }
+      return i;
+    }
+
+    static dimension_size_type
+    extremum(const uint8_t      *row0,
+             const uint8_t      *row1,
+             uint8_t            *dest,
+             dimension_size_type n,
+             bool                maximum)
+    {
+      const __m128i low = _mm_set1_epi16(0x00FF);
+      dimension_size_type i = 0;
+      for (; i + 16U <= n; i += 16U)
+        {
+          __m128i result[2];
+          for (dimension_size_type h = 0; h < 2U; ++h)
+            {
+              const __m128i a = load128(row0 + (i + h * 8U) * 2U);
+              const __m128i b = load128(row1 + (i + h * 8U) * 2U);
+              const __m128i v = maximum ? _mm_max_epu8(a, b) : _mm_min_epu8(a, b);
+              const __m128i even = _mm_and_si128(v, low);
+              const __m128i odd = _mm_srli_epi16(v, 8);
+              result[h] = maximum ? _mm_max_epi16(even, odd) : _mm_min_epi16(even, odd);
+            }
+          store128(dest + i, _mm_packus_epi16(result[0], result[1]));
+        }
+      return i;
+    }
+  };
+
+  template<>
+  struct PairKernel<uint16_t>
+  {
+    // Pack the low 16 bits of each 32-bit lane of two vectors.  The
+    // values are sign extended first, so that the signed saturating
+    // pack (SSE2 has no unsigned 32-bit pack) leaves them unchanged.
+    static __m128i
+    packLow(__m128i a,
+            __m128i b)
+    {
+      return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                             _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    }
+
+    // 8 destination pixels from 16 columns of each row.  The even
+    // and odd columns are widened to 32 bits.
+    static dimension_size_type
+    mean(const uint16_t     *row0,
+         const uint16_t     *row1,
+         uint16_t           *dest,
+         dimension_size_type n)
+    {
+      const __m128i low = _mm_set1_epi32(0xFFFF);
+      const __m128i half = _mm_set1_epi32(2);
+      dimension_size_type i = 0;
+      for (; i + 8U <= n; i += 8U)
+        {
+          __m128i result[2];
+          for (dimension_size_type h = 0; h < 2U; ++h)
+            {
+              const __m128i a = load128(row0 + (i + h * 4U) * 2U);
+              const __m128i b = load128(row1 + (i + h * 4U) * 2U);
+              const __m128i sum =
+                _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a, low), _mm_srli_epi32(a, 16)),
+                              _mm_add_epi32(_mm_and_si128(b, low), _mm_srli_epi32(b, 16)));
+              result[h] = _mm_srli_epi32(_mm_add_epi32(sum, half), 2);
+            }
+          store128(dest + i, packLow(result[0], result[1]));
+        }
+      return i;
+    }
+
+    // SSE2 only compares signed 16-bit values, so the values are
+    // offset by 0x8000 to preserve their order.
+    static dimension_size_type
+    extremum(const uint16_t     *row0,
+             const uint16_t     *row1,
+             uint16_t           *dest,
+             dimension_size_type n,
+             bool                maximum)
+    {
+      const __m128i bias = _mm_set1_epi16(static_cast<short>(-0x8000));
+      dimension_size_type i = 0;
+      for (; i + 8U <= n; i += 8U)
+        {
+          __m128i result[2];
+          for (dimension_size_type h = 0; h < 2U; ++h)
+            {
+              const __m128i a = _mm_xor_si128(load128(row0 + (i + h * 4U) * 2U), bias);
+              const __m128i b = _mm_xor_si128(load128(row1 + (i + h * 4U) * 2U), bias);
+              const __m128i v = maximum ? _mm_max_epi16(a, b) : _mm_min_epi16(a, b);
+              // Move each odd column next to the preceding even column.
+              const __m128i odd = _mm_srli_epi32(v, 16);
+              result[h] = maximum ? _mm_max_epi16(v, odd) : _mm_min_epi16(v, odd);
+            }
+          store128(dest + i, _mm_xor_si128(packLow(result[0], result[1]), bias));
+        }
+      return i;
+    }
+  };
+
+#endif // OME_FILES_DOWNSAMPLE_SSE2
+
+  // Mean of each pair of columns of two contiguous rows of the
+  // given width, for the common 2×2 reduction.  Each block is summed
+  // and divided in a single pass, without the intermediate row sums
+  // of the general case (see downsample-benchmark).  The values are
+  // added in the same order as sumRow followed by the column
+  // reduction, so floating point results are identical.  Whole vectors
+  // of columns are reduced by PairKernel.
+  template<typename T>
+  void
+  meanPairs(const T            *row0,
+            const T            *row1,
+            T                  *dest,
+            dimension_size_type width)
+  {
+    typedef typename Mean<T>::accumulator_type A;
+    const MeanDivisor<T> full(4U);
+    const dimension_size_type n = width / 2U;
+    for (dimension_size_type i = PairKernel<T>::mean(row0, row1, dest, n); i < n; ++i)
+      {
+        const A left = static_cast<A>(row0[i * 2U]) + static_cast<A>(row1[i * 2U]);
+        const A right = static_cast<A>(row0[i * 2U + 1U]) + static_cast<A>(row1[i * 2U + 1U]);
+        dest[i] = full(left + right);
+      }
+    if (width % 2U)
+      dest[n] = MeanDivisor<T>(2U)(static_cast<A>(row0[width - 1U]) +
+                                   static_cast<A>(row1[width - 1U]));
+  }
+
+  template<typename T>
+  struct IsComplex : std::false_type
+  {};
+
+  template<typename T>
+  struct IsComplex<std::complex<T>> : std::true_type
+  {};
+
+  // Sum a row of source elements into the accumulators.
+  template<typename A, typename T>
+  inline void
+  sumRow(A                  *acc,
+         const T            *row,
+         dimension_size_type n,
+         std::ptrdiff_t      stride)
+  {
+    if (stride == 1)
+      {
+        for (dimension_size_type i = 0; i < n; ++i)
+          acc[i] += static_cast<A>(row[i]);
+      }
+    else
+      {
+        for (dimension_size_type i = 0; i < n; ++i)
+          acc[i] += static_cast<A>(row[static_cast<std::ptrdiff_t>(i) * stride]);
+      }
+  }
+
+  // Minimum and maximum of each block.  Not defined for complex
+  // types, which have no ordering.
+  template<typename T, bool Complex = IsComplex<T>::value>
+  struct Extremum
+  {
+    // Avoid the std::vector<bool> specialisation.
+    typedef typename std::conditional<std::is_same<T, bool>::value,
+                                      uint8_t, T>::type value_type;
+
+    std::vector<value_type> acc;
+
+    // Reduce rows of the source into the accumulators.
+    void
+    rows(const T            *row,
+         dimension_size_type rows,
+         std::ptrdiff_t      rowstride,
+         dimension_size_type n,
+         std::ptrdiff_t      stride,
+         bool                maximum)
+    {
+      acc.resize(n);
+      for (dimension_size_type i = 0; i < n; ++i)
+        acc[i] = static_cast<value_type>(row[static_cast<std::ptrdiff_t>(i) * stride]);
+
+      for (dimension_size_type r = 1; r < rows; ++r)
+        {
+          const T *next = row + static_cast<std::ptrdiff_t>(r) * rowstride;
+          value_type *a = &acc[0];
+          if (stride == 1 && maximum)
+            for (dimension_size_type i = 0; i < n; ++i)
+              a[i] = std::max(a[i], static_cast<value_type>(next[i]));
+          else if (stride == 1)
+            for (dimension_size_type i = 0; i < n; ++i)
+              a[i] = std::min(a[i], static_cast<value_type>(next[i]));
+          else if (maximum)
+            for (dimension_size_type i = 0; i < n; ++i)
+              a[i] = std::max(a[i], static_cast<value_type>(next[static_cast<std::ptrdiff_t>(i) * stride]));
+          else
+            for (dimension_size_type i = 0; i < n; ++i)
+              a[i] = std::min(a[i], static_cast<value_type>(next[static_cast<std::ptrdiff_t>(i) * stride]));
+        }
+    }
+
+    // Reduce a block of accumulated columns.
+    T
+    columns(dimension_size_type first,
+            dimension_size_type cols,
+            dimension_size_type lanes,
+            bool                maximum) const
+    {
+      value_type result = acc[first];
+      for (dimension_size_type c = 1; c < cols; ++c)
+        {
+          const value_type v = acc[first + c * lanes];
+          result = maximum ? std::max(result, v) : std::min(result, v);
+        }
+      return static_cast<T>(result);
+    }
+
+    // Reduce each pair of columns of two contiguous rows, in a
+    // single loop as for meanPairs.  The comparisons are made in
+    // the same order as rows followed by columns, so NaN values are
+    // handled identically.
+    void
+    pairs(const T            *row0,
+          const T            *row1,
+          T                  *dest,
+          dimension_size_type width,
+          bool                maximum) const
+    {
+      const dimension_size_type n = width / 2U;
+      const dimension_size_type first = PairKernel<T>::extremum(row0, row1, dest, n, maximum);
+      if (maximum)
+        for (dimension_size_type i = first; i < n; ++i)
+          dest[i] = std::max(std::max(row0[i * 2U], row1[i * 2U]),
+                             std::max(row0[i * 2U + 1U], row1[i * 2U + 1U]));
+      else
+        for (dimension_size_type i = first; i < n; ++i)
+          dest[i] = std::min(std::min(row0[i * 2U], row1[i * 2U]),
+                             std::min(row0[i * 2U + 1U], row1[i * 2U + 1U]));
+      if (width % 2U)
+        dest[n] = maximum ?
+          std::max(row0[width - 1U], row1[width - 1U]) :
+          std::min(row0[width - 1U], row1[width - 1U]);
+    }
+  };
+
+  template<typename T>
+  struct Extremum<T, true>
+  {
+    void
+    rows(const T            * /* row */,
+         dimension_size_type /* rows */,
+         std::ptrdiff_t      /* rowstride */,
+         dimension_size_type /* n */,
+         std::ptrdiff_t      /* stride */,
+         bool                /* maximum */)
+    {
+      throw std::logic_error("Minimum and maximum downsampling are not supported for complex pixel types");
+    }
+
+    T
+    columns(dimension_size_type /* first */,
+            dimension_size_type /* cols */,
+            dimension_size_type /* lanes */,
+            bool                /* maximum */) const
+    {
+      return T();
+    }
+
+    void
+    pairs(const T            * /* row0 */,
+          const T            * /* row1 */,
+          T                  * /* dest */,
+          dimension_size_type /* width */,
+          bool                /* maximum */) const
+    {
+      throw std::logic_error("Minimum and maximum downsampling are not supported for complex pixel types");
+    }
+  };
+
+  // Most frequent value of a block, preferring the value which
+  // occurs first in the event of a tie.  Integer types are sorted;
+  // other types (which may be unordered, or include NaN) are
+  // compared pairwise.
+  template<typename T, bool Integral = std::is_integral<T>::value>
+  struct Mode
+  {
+    T
+    operator()(const std::vector<T>& values)
+    {
+      dimension_size_type best = 0U;
+      dimension_size_type bestCount = 0U;
+      for (dimension_size_type i = 0; i < values.size(); ++i)
+        {
+          dimension_size_type count = 0U;
+          for (dimension_size_type j = i; j < values.size(); ++j)
+            if (values[j] == values[i])
+              ++count;
+          if (count > bestCount)
+            {
+              best = i;
+              bestCount = count;
+            }
+        }
+      return values[best];
+    }
+  };
+
+  template<typename T>
+  struct Mode<T, true>
+  {
+    std::vector<std::pair<T, dimension_size_type>> sorted;
+
+    T
+    operator()(const std::vector<T>& values)
+    {
+      sorted.resize(values.size());
+      for (dimension_size_type i = 0; i < values.size(); ++i)
+        sorted[i] = std::make_pair(values[i], i);
+      std::sort(sorted.begin(), sorted.end());
+
+      dimension_size_type best = 0U;
+      dimension_size_type bestCount = 0U;
+      dimension_size_type bestFirst = 0U;
+      for (dimension_size_type i = 0; i < sorted.size();)
+        {
+          dimension_size_type j = i + 1U;
+          while (j < sorted.size() && sorted[j].first == sorted[i].first)
+            ++j;
+          const dimension_size_type count = j - i;
+          // sorted[i] has the lowest index for this value.
+          if (count > bestCount ||
+              (count == bestCount && sorted[i].second < bestFirst))
+            {
+              best = i;
+              bestCount = count;
+              bestFirst = sorted[i].second;
+            }
+          i = j;
+        }
+      return sorted[best].first;
+    }
+  };
+
+  // Advance an index over all dimensions other than X and Y.
+  // Returns false when all planes have been visited.
+  bool
+  nextPlane(std::array<dimension_size_type, 9>&                 idx,
+            const std::array<VariantPixelBuffer::size_type, 9>& shape)
+  {
+    for (dimension_size_type d = 2; d < PixelBufferBase::dimensions; ++d)
+      {
+        if (++idx[d] < shape[d])
+          return true;
+        idx[d] = 0U;
+      }
+    return false;
+  }
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  bufferShape(const VariantPixelBuffer::size_type *shape_ptr)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    std::copy(shape_ptr, shape_ptr + PixelBufferBase::dimensions,
+              shape.begin());
+    return shape;
+  }
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  bufferShape(const VariantPixelBuffer& buf)
+  {
+    return bufferShape(buf.shape());
+  }
+
+  // Shape of a downsampled buffer.
+  std::array<VariantPixelBuffer::size_type, 9>
+  downsampledShape(const VariantPixelBuffer::size_type *shape_ptr,
+                   dimension_size_type                  factorX,
+                   dimension_size_type                  factorY)
+  {
+    if (!factorX || !factorY)
+      throw std::logic_error("Downsampling factors must be nonzero");
+
+    std::array<VariantPixelBuffer::size_type, 9> shape(bufferShape(shape_ptr));
+    shape[ome::files::DIM_SPATIAL_X] = (shape[ome::files::DIM_SPATIAL_X] + factorX - 1U) / factorX;
+    shape[ome::files::DIM_SPATIAL_Y] = (shape[ome::files::DIM_SPATIAL_Y] + factorY - 1U) / factorY;
+    return shape;
+  }
+
+  template<typename T>
+  void
+  downsampleKernel(const PixelBuffer<T>& source,
+                   PixelBuffer<T>&       dest,
+                   dimension_size_type   factorX,
+                   dimension_size_type   factorY,
+                   DownsampleMethod      method)
+  {
+    typedef typename Mean<T>::accumulator_type sum_type;
+
+    const std::array<VariantPixelBuffer::size_type, 9> source_shape(bufferShape(source.shape()));
+    const std::array<VariantPixelBuffer::size_type, 9> dest_shape(bufferShape(dest.shape()));
+
+    const T *sdata = source.array().origin();
+    T *ddata = dest.array().origin();
+    const boost::multi_array_types::index *sstrides = source.strides();
+    const boost::multi_array_types::index *dstrides = dest.strides();
+
+    const dimension_size_type sw = source_shape[ome::files::DIM_SPATIAL_X];
+    const dimension_size_type sh = source_shape[ome::files::DIM_SPATIAL_Y];
+    const dimension_size_type dw = dest_shape[ome::files::DIM_SPATIAL_X];
+    const dimension_size_type dh = dest_shape[ome::files::DIM_SPATIAL_Y];
+    const dimension_size_type samples = source_shape[ome::files::DIM_SUBCHANNEL];
+
+    // If X and the subchannels are interleaved in both buffers, each
+    // row is a single contiguous run of samples × width elements,
+    // and the subchannels are processed together as "lanes".
+    // Otherwise each subchannel is processed separately.
+    const std::ptrdiff_t isamples = static_cast<std::ptrdiff_t>(samples);
+    const bool interleaved = samples > 1U &&
+      sstrides[ome::files::DIM_SUBCHANNEL] == 1 && sstrides[ome::files::DIM_SPATIAL_X] == isamples &&
+      dstrides[ome::files::DIM_SUBCHANNEL] == 1 && dstrides[ome::files::DIM_SPATIAL_X] == isamples;
+    const dimension_size_type lanes = interleaved ? samples : 1U;
+    const std::ptrdiff_t sstep = interleaved ? 1 : sstrides[ome::files::DIM_SPATIAL_X];
+    const std::ptrdiff_t dstep = interleaved ? 1 : dstrides[ome::files::DIM_SPATIAL_X];
+    const std::ptrdiff_t ssy = sstrides[ome::files::DIM_SPATIAL_Y];
+    const std::ptrdiff_t dsy = dstrides[ome::files::DIM_SPATIAL_Y];
+    const dimension_size_type n = sw * lanes;
+    // Pairs of rows of a single lane with contiguous columns are
+    // reduced by meanPairs or Extremum::pairs; a last single row (if
+    // the height is odd) uses the general case.
+    const bool pairs = factorX == 2U && lanes == 1U && sstep == 1 && dstep == 1;
+
+    std::array<VariantPixelBuffer::size_type, 9> planes(source_shape);
+    if (interleaved)
+      planes[ome::files::DIM_SUBCHANNEL] = 1U;
+
+    std::vector<sum_type> sums;
+    Extremum<T> extremum;
+    std::vector<T> block;
+    Mode<T> mode;
+    const bool maximum = method == ome::files::DOWNSAMPLE_MAX;
+
+    std::array<dimension_size_type, 9> idx;
+    std::fill(idx.begin(), idx.end(), 0U);
+    if (!source.num_elements())
+      return;
+    do
+      {
+        std::ptrdiff_t soffset = 0;
+        std::ptrdiff_t doffset = 0;
+        for (dimension_size_type d = 2; d < PixelBufferBase::dimensions; ++d)
+          {
+            soffset += static_cast<std::ptrdiff_t>(idx[d]) * sstrides[d];
+            doffset += static_cast<std::ptrdiff_t>(idx[d]) * dstrides[d];
+          }
+
+        for (dimension_size_type dy = 0; dy < dh; ++dy)
+          {
+            const dimension_size_type sy = dy * factorY;
+            const dimension_size_type rows = std::min(factorY, sh - sy);
+            const T *srow = sdata + soffset + static_cast<std::ptrdiff_t>(sy) * ssy;
+            T *drow = ddata + doffset + static_cast<std::ptrdiff_t>(dy) * dsy;
+
+            switch(method)
+              {
+              case ome::files::DOWNSAMPLE_NEAREST:
+                for (dimension_size_type dx = 0; dx < dw; ++dx)
+                  for (dimension_size_type l = 0; l < lanes; ++l)
+                    drow[static_cast<std::ptrdiff_t>(dx * lanes + l) * dstep] =
+                      srow[static_cast<std::ptrdiff_t>(dx * factorX * lanes + l) * sstep];
+                break;
+
+              case ome::files::DOWNSAMPLE_MEAN:
+                if (pairs && rows == 2U)
+                  {
+                    meanPairs(srow, srow + ssy, drow, sw);
+                    break;
+                  }
+                sums.assign(n, sum_type());
+                for (dimension_size_type r = 0; r < rows; ++r)
+                  sumRow(&sums[0], srow + static_cast<std::ptrdiff_t>(r) * ssy, n, sstep);
+                {
+                  // All blocks but the last have the same size.
+                  const MeanDivisor<T> full(rows * factorX);
+                  const MeanDivisor<T> last(rows * (sw - (dw - 1U) * factorX));
+                  for (dimension_size_type dx = 0; dx < dw; ++dx)
+                    {
+                      const dimension_size_type sx = dx * factorX;
+                      const dimension_size_type cols = std::min(factorX, sw - sx);
+                      const MeanDivisor<T>& divisor(dx + 1U < dw ? full : last);
+                      if (lanes == 1U)
+                        {
+                          sum_type sum = sum_type();
+                          for (dimension_size_type c = 0; c < cols; ++c)
+                            sum += sums[sx + c];
+                          drow[static_cast<std::ptrdiff_t>(dx) * dstep] = divisor(sum);
+                        }
+                      else
+                        {
+                          for (dimension_size_type l = 0; l < lanes; ++l)
+                            {
+                              sum_type sum = sum_type();
+                              for (dimension_size_type c = 0; c < cols; ++c)
+                                sum += sums[(sx + c) * lanes + l];
+                              drow[static_cast<std::ptrdiff_t>(dx * lanes + l) * dstep] = divisor(sum);
+                            }
+                        }
+                    }
+                }
+                break;
+
+              case ome::files::DOWNSAMPLE_MIN:
+              case ome::files::DOWNSAMPLE_MAX:
+                if (pairs && rows == 2U)
+                  {
+                    extremum.pairs(srow, srow + ssy, drow, sw, maximum);
+                    break;
+                  }
+                extremum.rows(srow, rows, ssy, n, sstep, maximum);
+                for (dimension_size_type dx = 0; dx < dw; ++dx)
+                  {
+                    const dimension_size_type sx = dx * factorX;
+                    const dimension_size_type cols = std::min(factorX, sw - sx);
+                    for (dimension_size_type l = 0; l < lanes; ++l)
+                      drow[static_cast<std::ptrdiff_t>(dx * lanes + l) * dstep] =
+                        extremum.columns(sx * lanes + l, cols, lanes, maximum);
+                  }
+                break;
+
+              case ome::files::DOWNSAMPLE_MODE:
+                for (dimension_size_type dx = 0; dx < dw; ++dx)
+                  {
+                    const dimension_size_type sx = dx * factorX;
+                    const dimension_size_type cols = std::min(factorX, sw - sx);
+                    for (dimension_size_type l = 0; l < lanes; ++l)
+                      {
+                        block.clear();
+                        for (dimension_size_type r = 0; r < rows; ++r)
+                          for (dimension_size_type c = 0; c < cols; ++c)
+                            block.push_back(srow[static_cast<std::ptrdiff_t>(r) * ssy +
+                                                 static_cast<std::ptrdiff_t>((sx + c) * lanes + l) * sstep]);
+                        drow[static_cast<std::ptrdiff_t>(dx * lanes + l) * dstep] = mode(block);
+                      }
+                  }
+                break;
+              }
+          }
+      }
+    while (nextPlane(idx, planes));
+  }
+
+  struct DownsampleVisitor
+  {
+    VariantPixelBuffer& dest;
+    dimension_size_type factorX;
+    dimension_size_type factorY;
+    DownsampleMethod method;
+
+    DownsampleVisitor(VariantPixelBuffer& dest,
+                      dimension_size_type factorX,
+                      dimension_size_type factorY,
+                      DownsampleMethod    method):
+      dest(dest),
+      factorX(factorX),
+      factorY(factorY),
+      method(method)
+    {}
+
+    template<typename T>
+    void
+    operator()(const T& source)
+    {
+      dest.setBuffer(downsampledShape(source->shape(), factorX, factorY),
+                     source->pixelType(), source->storage_order());
+      T& destbuf = ome::compat::get<T>(dest.vbuffer());
+
+      ome::files::downsample(*source, *destbuf, factorX, factorY, method);
+    }
+  };
+
+  // Accumulate a pixel value as real and imaginary parts.
+  template<typename T>
+  inline void
+  accumulate(double& re,
+             double& /* im */,
+             T       value)
+  {
+    re += static_cast<double>(value);
+  }
+
+  template<typename T>
+  inline void
+  accumulate(double&         re,
+             double&         im,
+             std::complex<T> value)
+  {
+    re += static_cast<double>(value.real());
+    im += static_cast<double>(value.imag());
+  }
+
+  // Area average from real and imaginary sums.
+  template<typename T>
+  struct Average
+  {
+    static T
+    result(double              re,
+           double              /* im */,
+           dimension_size_type count)
+    {
+      typedef typename Mean<T>::accumulator_type accumulator_type;
+      return Mean<T>::result(static_cast<accumulator_type>(re), count);
+    }
+  };
+
+  template<typename T>
+  struct Average<std::complex<T>>
+  {
+    static std::complex<T>
+    result(double              re,
+           double              im,
+           dimension_size_type count)
+    {
+      return Mean<std::complex<T>>::result(std::complex<double>(re, im), count);
+    }
+  };
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    bool
+    isDownsampleSupported(DownsampleMethod                    method,
+                          ::ome::xml::model::enums::PixelType pixeltype)
+    {
+      if (method == DOWNSAMPLE_MIN || method == DOWNSAMPLE_MAX)
+        return !(pixeltype == ::ome::xml::model::enums::PixelType::COMPLEXFLOAT ||
+                 pixeltype == ::ome::xml::model::enums::PixelType::COMPLEXDOUBLE);
+      return true;
+    }
+
+    template<typename T>
+    void
+    downsample(const PixelBuffer<T>& source,
+               PixelBuffer<T>&       dest,
+               dimension_size_type   factorX,
+               dimension_size_type   factorY,
+               DownsampleMethod      method)
+    {
+      if (!isDownsampleSupported(method, source.pixelType()))
+        {
+          boost::format fmt("Downsampling method %1% is not supported for pixel type %2%");
+          fmt % method % source.pixelType();
+          throw std::logic_error(fmt.str());
+        }
+
+      const std::array<VariantPixelBuffer::size_type, 9> expected(downsampledShape(source.shape(), factorX, factorY));
+      if (!std::equal(expected.begin(), expected.end(), dest.shape()))
+        throw std::logic_error("Downsampling destination extents do not match the downsampled source extents");
+
+      downsampleKernel(source, dest, factorX, factorY, method);
+    }
+
+#define OME_FILES_DOWNSAMPLE_INSTANTIATE(maR, maProperty, maType)       \
+    template void                                                       \
+    downsample(const PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& source, \
+               PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>&       dest, \
+               dimension_size_type                                                                        factorX, \
+               dimension_size_type                                                                        factorY, \
+               DownsampleMethod                                                                           method);
+
+    BOOST_PP_SEQ_FOR_EACH(OME_FILES_DOWNSAMPLE_INSTANTIATE, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_DOWNSAMPLE_INSTANTIATE
+
+    void
+    downsample(const VariantPixelBuffer& source,
+               VariantPixelBuffer&       dest,
+               dimension_size_type       factorX,
+               dimension_size_type       factorY,
+               DownsampleMethod          method)
+    {
+      DownsampleVisitor v(dest, factorX, factorY, method);
+      ome::compat::visit(v, source.vbuffer());
+    }
+
+    void
+    downsample(const VariantPixelBuffer& source,
+               VariantPixelBuffer&       dest,
+               DownsampleMethod          method)
+    {
+      downsample(source, dest, 2U, 2U, method);
+    }
+
+    class AreaAverage::Impl
+    {
+    public:
+      /// Source width.
+      dimension_size_type sizeX;
+      /// Source height.
+      dimension_size_type sizeY;
+      /// Destination buffer.
+      VariantPixelBuffer& dest;
+      /// Destination shape.
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      /// Destination column for each source column.
+      std::vector<dimension_size_type> columns;
+      /// Number of source columns contributing to each destination column.
+      std::vector<dimension_size_type> columnCount;
+      /// Reduction factor in X if integral, or zero.
+      dimension_size_type factorX;
+      /// Number of source rows added to each destination row.
+      std::vector<dimension_size_type> rowCount;
+      /// Real sums, ordered by plane, row and column.
+      std::vector<double> re;
+      /// Imaginary sums (complex pixel types only).
+      std::vector<double> im;
+
+      Impl(dimension_size_type sizeX,
+           dimension_size_type sizeY,
+           VariantPixelBuffer& dest):
+        sizeX(sizeX),
+        sizeY(sizeY),
+        dest(dest),
+        shape(bufferShape(dest)),
+        columns(sizeX),
+        columnCount(shape[DIM_SPATIAL_X], 0U),
+        factorX(0U),
+        rowCount(shape[DIM_SPATIAL_Y], 0U),
+        re(),
+        im()
+      {
+        const dimension_size_type dw = shape[DIM_SPATIAL_X];
+        const dimension_size_type dh = shape[DIM_SPATIAL_Y];
+
+        if (!dw || !dh || dw > sizeX || dh > sizeY)
+          throw std::logic_error("Area average destination size must be nonzero and not larger than the source size");
+
+        for (dimension_size_type x = 0; x < sizeX; ++x)
+          {
+            columns[x] = (x * dw) / sizeX;
+            ++columnCount[columns[x]];
+          }
+        if (sizeX % dw == 0U)
+          factorX = sizeX / dw;
+
+        re.assign(dest.num_elements(), 0.0);
+        if (dest.pixelType() == ::ome::xml::model::enums::PixelType::COMPLEXFLOAT ||
+            dest.pixelType() == ::ome::xml::model::enums::PixelType::COMPLEXDOUBLE)
+          im.assign(dest.num_elements(), 0.0);
+      }
+
+      // Offset of the first sum for the plane at idx.
+      dimension_size_type
+      planeOffset(const std::array<dimension_size_type, 9>& idx) const
+      {
+        dimension_size_type offset = 0U;
+        for (dimension_size_type d = PixelBufferBase::dimensions - 1U; d >= 2U; --d)
+          offset = (offset * shape[d]) + idx[d];
+        return offset * shape[DIM_SPATIAL_X] * shape[DIM_SPATIAL_Y];
+      }
+
+      template<typename T>
+      void
+      add(const T&            source,
+          dimension_size_type y)
+      {
+        typedef typename T::element_type::value_type value_type;
+        typedef typename Mean<value_type>::accumulator_type accumulator_type;
+
+        const VariantPixelBuffer::size_type *source_shape(source->shape());
+        const dimension_size_type h = source_shape[DIM_SPATIAL_Y];
+        const dimension_size_type dw = shape[DIM_SPATIAL_X];
+        const dimension_size_type dh = shape[DIM_SPATIAL_Y];
+
+        const value_type *sdata = source->array().origin();
+        const boost::multi_array_types::index *sstrides = source->strides();
+        const std::ptrdiff_t ssx = sstrides[DIM_SPATIAL_X];
+        const std::ptrdiff_t ssy = sstrides[DIM_SPATIAL_Y];
+        const bool complex = !im.empty();
+
+        std::array<dimension_size_type, 9> idx;
+        std::fill(idx.begin(), idx.end(), 0U);
+        do
+          {
+            std::ptrdiff_t soffset = 0;
+            for (dimension_size_type d = 2; d < PixelBufferBase::dimensions; ++d)
+              soffset += static_cast<std::ptrdiff_t>(idx[d]) * sstrides[d];
+            const dimension_size_type poffset = planeOffset(idx);
+
+            for (dimension_size_type r = 0; r < h; ++r)
+              {
+                const dimension_size_type dy = ((y + r) * dh) / sizeY;
+                const value_type *row = sdata + soffset + static_cast<std::ptrdiff_t>(r) * ssy;
+                double *rerow = &re[poffset + (dy * dw)];
+                double *imrow = complex ? &im[poffset + (dy * dw)] : nullptr;
+                double unused = 0.0;
+
+                if (factorX)
+                  {
+                    // Each destination column is a run of factorX
+                    // source columns.  Sum each run before adding it
+                    // to the destination sum, rather than adding each
+                    // pixel in turn through the column table.
+                    const value_type *p = row;
+                    for (dimension_size_type dx = 0; dx < dw; ++dx)
+                      {
+                        accumulator_type sum = accumulator_type();
+                        for (dimension_size_type i = 0; i < factorX; ++i, p += ssx)
+                          sum += static_cast<accumulator_type>(*p);
+                        accumulate(rerow[dx], complex ? imrow[dx] : unused, sum);
+                      }
+                  }
+                else
+                  {
+                    for (dimension_size_type x = 0; x < sizeX; ++x)
+                      {
+                        const dimension_size_type dx = columns[x];
+                        accumulate(rerow[dx], complex ? imrow[dx] : unused,
+                                   row[static_cast<std::ptrdiff_t>(x) * ssx]);
+                      }
+                  }
+              }
+          }
+        while (nextPlane(idx, shape));
+
+        for (dimension_size_type r = 0; r < h; ++r)
+          ++rowCount[((y + r) * dh) / sizeY];
+      }
+
+      template<typename T>
+      void
+      finish(T& destbuf)
+      {
+        typedef typename T::element_type::value_type value_type;
+
+        const dimension_size_type dw = shape[DIM_SPATIAL_X];
+        const dimension_size_type dh = shape[DIM_SPATIAL_Y];
+
+        value_type *ddata = destbuf->array().origin();
+        const boost::multi_array_types::index *dstrides = destbuf->strides();
+        const std::ptrdiff_t dsx = dstrides[DIM_SPATIAL_X];
+        const std::ptrdiff_t dsy = dstrides[DIM_SPATIAL_Y];
+
+        std::array<dimension_size_type, 9> idx;
+        std::fill(idx.begin(), idx.end(), 0U);
+        do
+          {
+            std::ptrdiff_t doffset = 0;
+            for (dimension_size_type d = 2; d < PixelBufferBase::dimensions; ++d)
+              doffset += static_cast<std::ptrdiff_t>(idx[d]) * dstrides[d];
+            const dimension_size_type poffset = planeOffset(idx);
+
+            for (dimension_size_type dy = 0; dy < dh; ++dy)
+              {
+                if (!rowCount[dy])
+                  continue;
+
+                for (dimension_size_type dx = 0; dx < dw; ++dx)
+                  {
+                    const dimension_size_type i = poffset + (dy * dw) + dx;
+                    ddata[doffset +
+                          static_cast<std::ptrdiff_t>(dx) * dsx +
+                          static_cast<std::ptrdiff_t>(dy) * dsy] =
+                      Average<value_type>::result(re[i], im.empty() ? 0.0 : im[i],
+                                                  rowCount[dy] * columnCount[dx]);
+                  }
+              }
+          }
+        while (nextPlane(idx, shape));
+      }
+
+      struct AddVisitor
+      {
+        Impl& impl;
+        dimension_size_type y;
+
+        AddVisitor(Impl&               impl,
+                   dimension_size_type y):
+          impl(impl),
+          y(y)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& source)
+        {
+          impl.add(source, y);
+        }
+      };
+
+      struct FinishVisitor
+      {
+        Impl& impl;
+
+        FinishVisitor(Impl& impl):
+          impl(impl)
+        {}
+
+        template<typename T>
+        void
+        operator()(T& destbuf)
+        {
+          impl.finish(destbuf);
+        }
+      };
+    };
+
+    AreaAverage::AreaAverage(dimension_size_type sizeX,
+                             dimension_size_type sizeY,
+                             VariantPixelBuffer& dest):
+      impl(std::make_shared<Impl>(sizeX, sizeY, dest))
+    {
+    }
+
+    AreaAverage::~AreaAverage()
+    {
+    }
+
+    void
+    AreaAverage::add(const VariantPixelBuffer& buf,
+                     dimension_size_type       y)
+    {
+      const std::array<VariantPixelBuffer::size_type, 9> source_shape(bufferShape(buf));
+
+      if (buf.pixelType() != impl->dest.pixelType())
+        throw std::logic_error("Area average source and destination pixel types differ");
+      if (source_shape[DIM_SPATIAL_X] != impl->sizeX ||
+          y + source_shape[DIM_SPATIAL_Y] > impl->sizeY)
+        throw std::logic_error("Area average source region out of range");
+      for (dimension_size_type d = 2; d < PixelBufferBase::dimensions; ++d)
+        if (source_shape[d] != impl->shape[d])
+          throw std::logic_error("Area average source and destination dimension extents differ");
+
+      Impl::AddVisitor v(*impl, y);
+      ome::compat::visit(v, buf.vbuffer());
+    }
+
+    void
+    AreaAverage::finish()
+    {
+      Impl::FinishVisitor v(*impl);
+      ome::compat::visit(v, impl->dest.vbuffer());
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
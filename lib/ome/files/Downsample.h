@@ -0,0 +1,232 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_DOWNSAMPLE_H
+#define OME_FILES_DOWNSAMPLE_H
+
+#include <memory>
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    template<typename T>
+    class PixelBuffer;
+    class VariantPixelBuffer;
+
+    /**
+     * Downsampling method.
+     */
+    enum DownsampleMethod
+      {
+        DOWNSAMPLE_NEAREST, ///< Nearest neighbour (first pixel of each block).
+        DOWNSAMPLE_MEAN,    ///< Mean of each block.
+        DOWNSAMPLE_MIN,     ///< Minimum of each block.
+        DOWNSAMPLE_MAX,     ///< Maximum of each block.
+        DOWNSAMPLE_MODE     ///< Most frequent value of each block (for label images).
+      };
+
+    /**
+     * Check if a downsampling method is supported for a pixel type.
+     *
+     * Minimum and maximum are not supported for complex pixel types;
+     * all other combinations are supported.
+     *
+     * @param method the downsampling method.
+     * @param pixeltype the pixel type.
+     * @returns @c true if supported, @c false otherwise.
+     */
+    bool
+    isDownsampleSupported(DownsampleMethod                    method,
+                          ::ome::xml::model::enums::PixelType pixeltype);
+
+    /**
+     * Downsample a pixel buffer by integer factors in X and Y.
+     *
+     * Each block of @p factorX × @p factorY pixels in the source is
+     * reduced to a single pixel in the destination.  If the source
+     * width or height is not a multiple of the factor, the blocks at
+     * the right and bottom edges are reduced using only the pixels
+     * present.  All other dimensions are unchanged, and each
+     * subchannel is reduced independently.
+     *
+     * The destination must have the reduced X and Y extents
+     * (rounded up) and the same extents as the source in all other
+     * dimensions.  The source and destination storage orders may
+     * differ.  Performance is described in the "Pixel processing
+     * performance" section of the OME Files documentation.
+     *
+     * For integer pixel types, the mean is rounded to the nearest
+     * integer.  For bit pixel types, the mean is set if at least
+     * half of the pixels in the block are set.  For the mode, ties
+     * are resolved in favour of the value which occurs first in the
+     * block, scanning rows from top to bottom.
+     *
+     * @param source the pixel buffer to downsample.
+     * @param dest the destination pixel buffer.
+     * @param factorX the reduction factor in X.
+     * @param factorY the reduction factor in Y.
+     * @param method the downsampling method.
+     * @throws std::logic_error if a factor is zero, the destination
+     * extents are incorrect, or the method is not supported for the
+     * pixel type.
+     */
+    template<typename T>
+    void
+    downsample(const PixelBuffer<T>& source,
+               PixelBuffer<T>&       dest,
+               dimension_size_type   factorX,
+               dimension_size_type   factorY,
+               DownsampleMethod      method = DOWNSAMPLE_MEAN);
+
+    /**
+     * Downsample a pixel buffer by integer factors in X and Y.
+     *
+     * The destination buffer will be resized to the downsampled
+     * size, and will have the same pixel type and storage order as
+     * the source.
+     *
+     * @copydetails downsample(const PixelBuffer<T>&,PixelBuffer<T>&,dimension_size_type,dimension_size_type,DownsampleMethod)
+     */
+    void
+    downsample(const VariantPixelBuffer& source,
+               VariantPixelBuffer&       dest,
+               dimension_size_type       factorX,
+               dimension_size_type       factorY,
+               DownsampleMethod          method = DOWNSAMPLE_MEAN);
+
+    /**
+     * Downsample a pixel buffer by a factor of two in X and Y.
+     *
+     * Equivalent to downsampling with factors of two in X and Y.
+     *
+     * @param source the pixel buffer to downsample.
+     * @param dest the destination pixel buffer.
+     * @param method the downsampling method.
+     */
+    void
+    downsample(const VariantPixelBuffer& source,
+               VariantPixelBuffer&       dest,
+               DownsampleMethod          method = DOWNSAMPLE_MEAN);
+
+    /**
+     * Streaming area-average reduction to an arbitrary size.
+     *
+     * The source image is provided as a series of bands, each
+     * covering the full source width and one or more rows.  Each
+     * source pixel at (x, y) contributes to the destination pixel at
+     * (x × dw ÷ sw, y × dh ÷ sh), where sw and sh are the source size
+     * and dw and dh are the destination size.  Only accumulators of
+     * the destination size are held, so a large source image may be
+     * reduced without holding it in memory.
+     *
+     * The destination buffer determines the reduced size, the pixel
+     * type, and the extents of all dimensions other than X and Y,
+     * which must match those of the source bands.  The storage order
+     * of the bands and the destination may differ.
+     *
+     * Rounding of integer and bit pixel types is the same as for
+     * downsample().
+     */
+    class AreaAverage
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param sizeX the source image width.
+       * @param sizeY the source image height.
+       * @param dest the destination pixel buffer.
+       */
+      AreaAverage(dimension_size_type sizeX,
+                  dimension_size_type sizeY,
+                  VariantPixelBuffer& dest);
+
+      /// Destructor.
+      ~AreaAverage();
+
+      /// @cond SKIP
+      AreaAverage (const AreaAverage&) = delete;
+
+      AreaAverage&
+      operator= (const AreaAverage&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Add a band of source rows.
+       *
+       * @param buf the source pixel buffer; the width must be the
+       * source image width.
+       * @param y the source row of the first row in @p buf.
+       * @throws std::logic_error if the band is not compatible with
+       * the source size or destination buffer.
+       */
+      void
+      add(const VariantPixelBuffer& buf,
+          dimension_size_type       y);
+
+      /**
+       * Store the averaged pixel values in the destination buffer.
+       *
+       * Destination pixels with no contributing source pixels are
+       * left unchanged.
+       */
+      void
+      finish();
+
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+    };
+
+  }
+}
+
+#endif // OME_FILES_DOWNSAMPLE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,181 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ome/files/Executor.h>
+
+#include <ome/common/log.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    Executor::~Executor()
+    {
+    }
+
+    class ThreadPoolExecutor::Impl
+    {
+    public:
+      /// Worker threads.
+      std::vector<std::thread> threads;
+      /// Queued tasks.
+      std::deque<task_type> tasks;
+      /// Lock for the task queue.
+      std::mutex mutex;
+      /// Signalled when a task is queued or the pool is stopping.
+      std::condition_variable changed;
+      /// The pool is stopping.
+      bool stopping;
+      /// Message logger, for exceptions thrown by tasks.
+      ome::common::Logger logger;
+
+      Impl(dimension_size_type nthreads):
+        threads(),
+        tasks(),
+        mutex(),
+        changed(),
+        stopping(false),
+        logger(ome::common::createLogger("ThreadPoolExecutor"))
+      {
+        if (!nthreads)
+          nthreads = std::max(1U, std::thread::hardware_concurrency());
+
+        threads.reserve(nthreads);
+        for (dimension_size_type i = 0; i < nthreads; ++i)
+          threads.emplace_back(&Impl::run, this);
+      }
+
+      ~Impl()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stopping = true;
+        }
+        changed.notify_all();
+
+        for (auto& thread : threads)
+          thread.join();
+      }
+
+      void
+      run()
+      {
+        while (true)
+          {
+            task_type task;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              changed.wait(lock, [this]() { return stopping || !tasks.empty(); });
+              // Remaining tasks are run before stopping.
+              if (tasks.empty())
+                return;
+              task = std::move(tasks.front());
+              tasks.pop_front();
+            }
+
+            // An exception escaping the thread would terminate the
+            // process, so log it and continue with the next task.
+            try
+              {
+                task();
+              }
+            catch (const std::exception& e)
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                BOOST_LOG_SEV(logger, ome::logging::trivial::error)
+                  << "Task failed: " << e.what();
+              }
+            catch (...)
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                BOOST_LOG_SEV(logger, ome::logging::trivial::error)
+                  << "Task failed with an unknown exception";
+              }
+          }
+      }
+    };
+
+    ThreadPoolExecutor::ThreadPoolExecutor(dimension_size_type threads):
+      Executor(),
+      impl(std::make_shared<Impl>(threads))
+    {
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor()
+    {
+    }
+
+    void
+    ThreadPoolExecutor::execute(task_type task)
+    {
+      {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->tasks.push_back(std::move(task));
+      }
+      impl->changed.notify_one();
+    }
+
+    dimension_size_type
+    ThreadPoolExecutor::getThreadCount() const
+    {
+      return impl->threads.size();
+    }
+
+    std::shared_ptr<Executor>
+    getDefaultExecutor()
+    {
+      static std::shared_ptr<Executor> executor(std::make_shared<ThreadPoolExecutor>());
+      return executor;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,154 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#ifndef OME_FILES_EXECUTOR_H
+#define OME_FILES_EXECUTOR_H
+
+#include <functional>
+#include <memory>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Executor for asynchronous tasks.
+     *
+     * An executor runs tasks submitted to it, typically on one or
+     * more worker threads.  Readers use an executor to run
+     * asynchronous reads; applications may implement this interface
+     * to run reads on their own thread pool.
+     */
+    class Executor
+    {
+    public:
+      /// Task type.
+      typedef std::function<void ()> task_type;
+
+      /// Destructor.
+      virtual
+      ~Executor();
+
+      /**
+       * Run a task.
+       *
+       * The task may be run on any thread, before or after this
+       * method returns, but must be run exactly once.  Tasks should
+       * not throw: failures should be reported to the submitter, for
+       * example through a std::promise.  What happens to an
+       * exception thrown by a task depends upon the executor.
+       *
+       * @param task the task to run.
+       */
+      virtual
+      void
+      execute(task_type task) = 0;
+    };
+
+    /**
+     * Executor running tasks on a fixed pool of threads.
+     *
+     * Tasks are run in the order they are submitted.  The destructor
+     * waits for all submitted tasks to be run.  If a task throws an
+     * exception, it is logged as an error and the worker thread
+     * continues with the next task.
+     */
+    class ThreadPoolExecutor : public Executor
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param threads the number of worker threads; if zero, the
+       * number of hardware threads is used.
+       */
+      explicit
+      ThreadPoolExecutor(dimension_size_type threads = 0U);
+
+      /// Destructor.
+      ~ThreadPoolExecutor();
+
+      /// @cond SKIP
+      ThreadPoolExecutor (const ThreadPoolExecutor&) = delete;
+
+      ThreadPoolExecutor&
+      operator= (const ThreadPoolExecutor&) = delete;
+      /// @endcond SKIP
+
+      // Documented in superclass.
+      void
+      execute(task_type task);
+
+      /**
+       * Get the number of worker threads.
+       *
+       * @returns the number of threads.
+       */
+      dimension_size_type
+      getThreadCount() const;
+
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+    };
+
+    /**
+     * Get the default executor.
+     *
+     * This is a ThreadPoolExecutor with one thread per hardware
+     * thread, shared by all readers which do not have an executor
+     * set.  It is created on first use.
+     *
+     * @returns the default executor.
+     */
+    std::shared_ptr<Executor>
+    getDefaultExecutor();
+
+  }
+}
+
+#endif // OME_FILES_EXECUTOR_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
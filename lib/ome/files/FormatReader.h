@@ -39,12 +39,15 @@
 #define OME_FILES_FORMATREADER_H
 
 #include <array>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <map>
 
 #include <boost/optional.hpp>
+#include <boost/preprocessor.hpp>
 
 #include <ome/compat/memory.h>
 
@@ -53,6 +56,9 @@
 #include <ome/files/FormatHandler.h>
 #include <ome/files/MetadataConfigurable.h>
 #include <ome/files/MetadataMap.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/PlaneRegion.h>
 #include <ome/files/Types.h>
 
 #include <ome/xml/meta/MetadataStore.h>
@@ -62,6 +68,7 @@ namespace ome
   namespace files
   {
 
+    class Executor;
     class VariantPixelBuffer;
 
     /**
@@ -208,6 +215,25 @@ namespace ome
       bool
       isThisType(std::istream& stream) const = 0;
 
+      /**
+       * Create an independent copy of this reader.
+       *
+       * If a dataset is open, the copy has the same dataset open,
+       * without repeating the work done by setId().  The parsed core
+       * metadata and metadata store are shared with this reader, so
+       * must not be modified.  The copy has its own file handles and
+       * its own current series, resolution and plane (initially
+       * zero), and so may be used by a different thread from this
+       * reader.  Closing either reader does not affect the other.
+       *
+       * @returns the new reader.
+       * @throws std::logic_error if the reader does not support
+       * cloning.
+       */
+      virtual
+      std::shared_ptr<FormatReader>
+      clone() const = 0;
+
       /**
        * Determine the number of image planes in the current series.
        *
@@ -582,12 +608,408 @@ namespace ome
                 dimension_size_type w,
                 dimension_size_type h) const = 0;
 
+      /**
+       * Obtain a decimated sub-image of an image plane.
+       *
+       * Obtain and copy every @c stepX'th column and @c stepY'th row
+       * of the sub-image of an image plane from the current series
+       * into a VariantPixelBuffer of size
+       *
+       * \code{.cpp}
+       * ⌈w/stepX⌉ * ⌈h/stepY⌉ * bytesPerPixel * getRGBChannelCount(channel)
+       * \endcode
+       *
+       * The pixel at (@c x, @c y) is always included.  This is
+       * intended for quick-look previews; readers which support it
+       * will only read and decode the parts of the plane containing
+       * sampled pixels.  Other readers will read the whole sub-image
+       * and then decimate it.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @param stepX the column step (1 to read every column).
+       * @param stepY the row step (1 to read every row).
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if either step is zero.
+       */
+      virtual
+      void
+      openBytes(dimension_size_type plane,
+                VariantPixelBuffer& buf,
+                dimension_size_type x,
+                dimension_size_type y,
+                dimension_size_type w,
+                dimension_size_type h,
+                dimension_size_type stepX,
+                dimension_size_type stepY) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane in any series and
+       * resolution.
+       *
+       * Unlike the other openBytes() methods, the series, resolution
+       * and plane are specified explicitly.  The current series,
+       * resolution and plane are neither used nor changed, so this
+       * method may be used by several threads sharing a single
+       * reader.  Readers which support this document it as
+       * thread-safe; concurrent calls are then permitted once
+       * setId() has completed, provided that no other thread calls
+       * a method which changes the reader state (for example
+       * setSeries(), setResolution(), setPlane(), the other
+       * openBytes() methods, or close()) at the same time.  For
+       * other readers, calls are serialised and the reader state is
+       * changed while reading.
+       *
+       * Thread-safe does not mean that reads are decoded in parallel.
+       * The TIFF readers hold a single process-wide libtiff lock
+       * (tiff::Sentry) while reading and decoding the tiles of a
+       * region, so concurrent reads of TIFF data are decoded one at a
+       * time.  Only the work done outside libtiff, such as copying,
+       * conversion and normalization, may overlap.
+       *
+       * @param series the series.
+       * @param resolution the resolution level within the series;
+       * must be zero if resolutions are flattened.
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @param buf the destination pixel buffer.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the series, resolution or plane
+       * is invalid.
+       */
+      virtual
+      void
+      openBytes(dimension_size_type series,
+                dimension_size_type resolution,
+                dimension_size_type plane,
+                const PlaneRegion&  region,
+                VariantPixelBuffer& buf) const = 0;
+
+      /**
+       * Obtain a block of sub-images of several image planes.
+       *
+       * The same sub-image of every plane in the specified ranges of
+       * the @c Z, @c T and @c C dimensions of the current series and
+       * resolution is read into a single pixel buffer, with @c Z,
+       * @c T and @c C extents of the size of each range.  The buffer
+       * is allocated once, with the planar or interleaved storage
+       * order of the series, unless it already has the required
+       * shape, pixel type and storage order; where possible, each
+       * plane is decoded directly into its position within the
+       * buffer.  Planes may be read by several threads on the
+       * executor set with setExecutor(), if the reader supports
+       * concurrent reads (see openBytes() with an explicit series
+       * and resolution).  For the TIFF readers, decoding is
+       * serialised by the libtiff lock, so this only overlaps the
+       * work done outside libtiff, such as copying planes which
+       * could not be decoded in place and normalization.
+       *
+       * The @c C range is of effective channels (see
+       * getEffectiveSizeC()), and every channel in the range must
+       * have the same number of subchannels.  The current series,
+       * resolution and plane are not changed.
+       *
+       * @param zRange the range of @c Z indices.
+       * @param tRange the range of @c T indices.
+       * @param cRange the range of effective @c C indices.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole of each plane is read.
+       * @param buf the destination pixel buffer.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if a range is empty or out of
+       * bounds, or the channels have different numbers of
+       * subchannels.
+       */
+      virtual
+      void
+      openBytes(const DimensionRange& zRange,
+                const DimensionRange& tRange,
+                const DimensionRange& cRange,
+                const PlaneRegion&    region,
+                VariantPixelBuffer&   buf) const = 0;
+
+      /**
+       * Obtain a block of sub-images of several image planes in any
+       * series and resolution.
+       *
+       * As for openBytes() with @c Z, @c T and @c C ranges, but the
+       * series and resolution are specified explicitly, and the
+       * current series, resolution and plane are neither used nor
+       * changed.  This is safe to use while another thread changes
+       * the current series, for readers supporting concurrent reads
+       * (see openBytes() with an explicit series and resolution).
+       *
+       * @param series the series.
+       * @param resolution the resolution level within the series;
+       * must be zero if resolutions are flattened.
+       * @param zRange the range of @c Z indices.
+       * @param tRange the range of @c T indices.
+       * @param cRange the range of effective @c C indices.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole of each plane is read.
+       * @param buf the destination pixel buffer.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the series or resolution is
+       * invalid, a range is empty or out of bounds, or the channels
+       * have different numbers of subchannels.
+       */
+      virtual
+      void
+      openBytes(dimension_size_type   series,
+                dimension_size_type   resolution,
+                const DimensionRange& zRange,
+                const DimensionRange& tRange,
+                const DimensionRange& cRange,
+                const PlaneRegion&    region,
+                VariantPixelBuffer&   buf) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane in caller-owned memory.
+       *
+       * The sub-image of the plane in the current series and
+       * resolution is stored in the memory at @p dest, which must be
+       * large enough to hold it with the specified strides.  Pixels
+       * within a row are adjacent.  If @p sampleStride is the size of
+       * one sample, the samples of each pixel are adjacent
+       * (interleaved), and each pixel occupies the size of all of its
+       * samples; otherwise each sample is stored as a separate plane
+       * (planar), @p sampleStride bytes apart, and each pixel
+       * occupies the size of one sample.  The pixel type must match
+       * the pixel type of the series, and the memory must be
+       * suitably aligned for it.
+       *
+       * If there is no row or sample padding, the pixel data is
+       * decoded directly into @p dest where the reader supports it,
+       * interleaving or deinterleaving the samples if the layout
+       * differs from that of the series (see isInterleaved()).
+       * Otherwise, the data is read in bands and copied into
+       * @p dest.  The current series, resolution and plane are
+       * not changed.
+       *
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @param dest the destination memory.
+       * @param rowStride the number of bytes between the start of
+       * successive rows.
+       * @param sampleStride the number of bytes between successive
+       * samples of a pixel.
+       * @param pixelType the pixel type of the destination memory.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the pixel type does not match,
+       * the plane or region is invalid, or the strides are too small
+       * for the region.
+       */
+      virtual
+      void
+      openBytes(dimension_size_type                 plane,
+                const PlaneRegion&                  region,
+                void                               *dest,
+                dimension_size_type                 rowStride,
+                dimension_size_type                 sampleStride,
+                ::ome::xml::model::enums::PixelType pixelType) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane in a typed pixel buffer.
+       *
+       * For repeated reads of regions of a known pixel type, for
+       * example when serving tiles.  The read is dispatched once to
+       * the overload of openTypedBytesImpl() for the pixel type, and
+       * readers able to decode directly into a typed buffer
+       * transfer the samples with code specialised for the type,
+       * without a variant or run-time pixel type dispatch for each
+       * tile.  The pixel data is stored directly in @p buf, which is
+       * never reallocated, so it may be reused for every read of the
+       * same size.  The buffer must have the extents of the region,
+       * with the number of samples of the plane as the subchannel
+       * extent and one for all other dimensions, and may be in any
+       * storage order.
+       *
+       * @tparam P the pixel type of the series.
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @param buf the destination pixel buffer.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the pixel type does not match,
+       * or the plane, region or buffer extents are invalid.
+       */
+      template<int P>
+      void
+      openTypedBytes(dimension_size_type                                 plane,
+                     const PlaneRegion&                                  region,
+                     PixelBuffer<typename PixelProperties<P>::std_type>& buf) const
+      {
+        openTypedBytesImpl(plane, region, buf);
+      }
+
+    protected:
+      /**
+       * Obtain a sub-image of an image plane in a typed pixel buffer.
+       *
+       * Implementation of openTypedBytes(), with one overload for
+       * each pixel type.
+       *
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @param buf the destination pixel buffer.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the pixel type does not match,
+       * or the plane, region or buffer extents are invalid.
+       */
+#define OME_FILES_FORMATREADER_OPENTYPEDBYTESIMPL(maR, maProperty, maType) \
+      virtual                                                           \
+      void                                                              \
+      openTypedBytesImpl(dimension_size_type plane,                     \
+                         const PlaneRegion&  region,                    \
+                         PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf) const = 0;
+
+      BOOST_PP_SEQ_FOR_EACH(OME_FILES_FORMATREADER_OPENTYPEDBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_FORMATREADER_OPENTYPEDBYTESIMPL
+
+    public:
+      /**
+       * Obtain a sub-image of an image plane asynchronously.
+       *
+       * The current series and resolution are used; the read is
+       * queued and this method returns immediately.  Changing the
+       * current series or resolution afterwards does not affect the
+       * read.  Reads are queued and run as for the overload with an
+       * explicit series and resolution.
+       *
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @returns a future for the pixel data.
+       */
+      virtual
+      std::future<std::shared_ptr<VariantPixelBuffer>>
+      openBytesAsync(dimension_size_type plane,
+                     const PlaneRegion&  region) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane in any series and
+       * resolution asynchronously.
+       *
+       * The read is queued and this method returns immediately.
+       * Queued reads are run on the executor set with setExecutor(),
+       * or the default executor if none is set.  Each read is
+       * performed as for openBytes() with an explicit series,
+       * resolution and plane, so the current reader state is not
+       * used.  Queued reads are not run in submission order; pending
+       * reads of the same plane are run together, and the remainder
+       * in plane order, to avoid repeatedly switching between TIFF
+       * directories.
+       *
+       * Any exception thrown by the read is stored in the future.
+       * close() and destruction of the reader wait for all queued
+       * reads to complete, and so must not be called from a task
+       * run by the executor, nor while the executor is unable to
+       * run tasks.
+       *
+       * @param series the series.
+       * @param resolution the resolution level within the series;
+       * must be zero if resolutions are flattened.
+       * @param plane the plane index within the series.
+       * @param region the sub-image to read; if the region is not
+       * valid (has zero size), the whole plane is read.
+       * @returns a future for the pixel data.
+       */
+      virtual
+      std::future<std::shared_ptr<VariantPixelBuffer>>
+      openBytesAsync(dimension_size_type series,
+                     dimension_size_type resolution,
+                     dimension_size_type plane,
+                     const PlaneRegion&  region) const = 0;
+
+      /**
+       * Set the executor for asynchronous reads.
+       *
+       * @param executor the executor, or null to use the default
+       * executor.
+       */
+      virtual
+      void
+      setExecutor(std::shared_ptr<Executor> executor) = 0;
+
+      /**
+       * Get the executor for asynchronous reads.
+       *
+       * @returns the executor, or the default executor if none has
+       * been set.
+       */
+      virtual
+      std::shared_ptr<Executor>
+      getExecutor() const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane at a given size.
+       *
+       * The sub-image is specified in the coordinates of the current
+       * resolution, and is resampled to @c sizeX by @c sizeY pixels.
+       * The smallest resolution level (no larger than the current
+       * resolution) at which the sub-image is at least as large as
+       * the requested size is used as the source, and only the
+       * corresponding region of that level is read.  The reduced
+       * resolution levels are used whether or not resolutions are
+       * flattened into separate series.  Reduction is by
+       * area averaging, reading one band of rows at a time, so the
+       * sub-image is never held in memory at its full size.
+       * Enlargement (only possible if the current resolution is
+       * smaller than the requested size) uses the nearest
+       * neighbour.
+       *
+       * The current resolution and plane are unchanged.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @param sizeX the width of the destination.
+       * @param sizeY the height of the destination.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if any size is zero.
+       */
+      virtual
+      void
+      openRegionAtScale(dimension_size_type plane,
+                        VariantPixelBuffer& buf,
+                        dimension_size_type x,
+                        dimension_size_type y,
+                        dimension_size_type w,
+                        dimension_size_type h,
+                        dimension_size_type sizeX,
+                        dimension_size_type sizeY) const = 0;
+
       /**
        * Obtain a thumbnail of an image plane.
        *
        * Obtail and copy the thumbnail for the specified image plane
        * from the current series into a VariantPixelBuffer.
        *
+       * The thumbnail will be of size getThumbSizeX() by
+       * getThumbSizeY().  The whole plane is resampled as for
+       * openRegionAtScale(), so if the series has reduced resolution
+       * levels, the smallest level which is not smaller than the
+       * thumbnail will be used as the source.
+       *
        * @param plane the plane index within the series.
        * @param buf the destination pixel buffer.
        */
@@ -656,6 +1078,18 @@ namespace ome
       /**
        * Set float normalization.
        *
+       * If enabled, @c FLOAT and @c DOUBLE pixel data are rescaled
+       * to the range [0, 1] using the minimum and maximum finite
+       * values of the whole plane, so a region of a plane is
+       * normalized the same way as the whole plane.  The range of
+       * each plane is taken from the file if it is recorded there
+       * (for example, in the TIFF SMinSampleValue and
+       * SMaxSampleValue tags written by OMETIFFWriter with
+       * statistics enabled), and is otherwise found by reading the
+       * plane once, on first use.
+       * Scaled reads use the range of the resolution level read.
+       * Other pixel types are not changed.
+       *
        * @param normalize @c true to enable normalization, or @c false
        * to disable.
        */
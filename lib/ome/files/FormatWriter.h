@@ -61,6 +61,7 @@ namespace ome
   namespace files
   {
 
+    class TileSizePolicy;
     class VariantPixelBuffer;
 
     /**
@@ -342,6 +343,49 @@ namespace ome
       const boost::optional<std::string>&
       getCompression() const = 0;
 
+      /**
+       * Set the predictor to apply before compression.
+       *
+       * A predictor can considerably improve the compression ratio
+       * of continuous-tone images.  Not all predictors are usable
+       * with every compression type and pixel type.
+       *
+       * @param predictor the predictor.
+       */
+      virtual
+      void
+      setPredictor(const std::string& predictor) = 0;
+
+      /**
+       * Get the predictor to apply before compression.
+       *
+       * @returns the predictor.
+       */
+      virtual
+      const boost::optional<std::string>&
+      getPredictor() const = 0;
+
+      /**
+       * Set the compression level to use when writing.
+       *
+       * The valid range of levels is specific to the compression
+       * type in use.
+       *
+       * @param level the compression level.
+       */
+      virtual
+      void
+      setCompressionLevel(int level) = 0;
+
+      /**
+       * Get the compression level to use when writing.
+       *
+       * @returns the compression level.
+       */
+      virtual
+      const boost::optional<int>&
+      getCompressionLevel() const = 0;
+
       /**
        * Set subchannel interleaving.
        *
@@ -392,6 +436,55 @@ namespace ome
       bool
       getWriteSequentially() const = 0;
 
+      /**
+       * Write sparse tiles.
+       *
+       * If enabled, tiles which consist entirely of the fill value
+       * will not be written, if supported by the underlying file
+       * format.  This can save considerable space and time when
+       * writing images with large empty areas, such as whole slide
+       * scans and plate wells.
+       *
+       * @param sparse @c true to skip writing empty tiles, @c false
+       * to write all tiles.
+       */
+      virtual
+      void
+      setSparse(bool sparse) = 0;
+
+      /**
+       * Check if sparse tiles are written.
+       *
+       * @returns @c true if empty tiles are skipped, @c false if not.
+       */
+      virtual
+      bool
+      getSparse() const = 0;
+
+      /**
+       * Set the fill value for sparse tiles.
+       *
+       * The value is only stored in the file if sparse tiles are
+       * written (see setSparse()).
+       *
+       * @param fillvalue the sample value of empty tiles; zero by
+       * default.
+       * @throws std::logic_error if the pixel type of any series
+       * can not hold the value (see isRepresentable()).
+       */
+      virtual
+      void
+      setFillValue(double fillvalue) = 0;
+
+      /**
+       * Get the fill value for sparse tiles.
+       *
+       * @returns the sample value of empty tiles.
+       */
+      virtual
+      double
+      getFillValue() const = 0;
+
       /**
        * Set the requested tile width.
        *
@@ -447,6 +540,30 @@ namespace ome
       virtual
       dimension_size_type
       getTileSizeY() const = 0;
+
+      /**
+       * Set the tile size policy.
+       *
+       * The policy is used to choose the strip or tile size when no
+       * tile size has been set with setTileSizeX() and
+       * setTileSizeY().  If no policy is set, the writer default
+       * will be used.
+       *
+       * @param policy the tile size policy, or null to use the
+       * writer default.
+       */
+      virtual
+      void
+      setTileSizePolicy(std::shared_ptr<const TileSizePolicy> policy) = 0;
+
+      /**
+       * Get the tile size policy.
+       *
+       * @returns the tile size policy, or null if unset.
+       */
+      virtual
+      std::shared_ptr<const TileSizePolicy>
+      getTileSizePolicy() const = 0;
     };
 
   }
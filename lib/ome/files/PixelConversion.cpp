@@ -0,0 +1,460 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+// SSE2 is part of the x86-64 baseline.  Other platforms use the
+// scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define OME_FILES_PIXELCONVERSION_SSE2
+# include <emmintrin.h>
+#endif
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+
+namespace
+{
+
+  // Arithmetic type for a conversion: float if both types are
+  // exactly representable as float, otherwise double.
+  template<typename T>
+  struct ExactFloat
+  {
+    static const bool value = sizeof(T) <= 2U || std::is_same<T, float>::value;
+  };
+
+  template<typename S, typename D>
+  struct Work
+  {
+    typedef typename std::conditional<ExactFloat<S>::value && ExactFloat<D>::value,
+                                      float, double>::type type;
+  };
+
+  // Range, rounding and NaN handling for a floating point
+  // destination type.
+  template<typename D, typename W, class Enable = void>
+  struct Store
+  {
+    static W lowest() { return static_cast<W>(std::numeric_limits<D>::lowest()); }
+    static W highest() { return static_cast<W>(std::numeric_limits<D>::max()); }
+    static W finite(W v) { return v; }
+    static D round(W v) { return static_cast<D>(v); }
+  };
+
+  // Integer destination types round to nearest, with halves away
+  // from zero.
+  template<typename D, typename W>
+  struct Store<D, W, typename std::enable_if<std::is_integral<D>::value &&
+                                             !std::is_same<D, bool>::value>::type>
+  {
+    static W lowest() { return static_cast<W>(std::numeric_limits<D>::min()); }
+    static W highest() { return static_cast<W>(std::numeric_limits<D>::max()); }
+    static W finite(W v) { return v == v ? v : W(0); }
+    static D round(W v) { return static_cast<D>(v < W(0) ? v - W(0.5) : v + W(0.5)); }
+  };
+
+  // Bit destination types are set unless the value rounds to zero.
+  template<typename W>
+  struct Store<bool, W>
+  {
+    static W lowest() { return W(0); }
+    static W highest() { return W(1); }
+    static W finite(W v) { return v == v ? v : W(0); }
+    static bool round(W v) { return v <= W(-0.5) || v >= W(0.5); }
+  };
+
+  // Vectorised kernels for clamped conversion, such as 16-bit data
+  // to 8-bit for display.  Each converts as many whole vectors of
+  // values as possible, and returns the number converted; the
+  // scalar loop converts the rest, with identical results.  There
+  // are SSE2 kernels from 8- and 16-bit integer and float types to
+  // 8- and 16-bit unsigned integer types, all of which convert in
+  // float; other conversions, and other platforms, convert none.
+  template<typename S, typename D, class Enable = void>
+  struct ClampKernel
+  {
+    static dimension_size_type
+    apply(const S             * /* src */,
+          D                   * /* dest */,
+          dimension_size_type  /* count */,
+          typename Work<S, D>::type /* scale */,
+          typename Work<S, D>::type /* offset */)
+    {
+      return 0U;
+    }
+  };
+
+#ifdef OME_FILES_PIXELCONVERSION_SSE2
+
+  template<typename T>
+  struct ClampSource : std::false_type
+  {};
+
+  template<> struct ClampSource<uint8_t> : std::true_type {};
+  template<> struct ClampSource<uint16_t> : std::true_type {};
+  template<> struct ClampSource<int16_t> : std::true_type {};
+  template<> struct ClampSource<float> : std::true_type {};
+
+  template<typename T>
+  struct ClampDest : std::false_type
+  {};
+
+  template<> struct ClampDest<uint8_t> : std::true_type {};
+  template<> struct ClampDest<uint16_t> : std::true_type {};
+
+  // Load 8 source values as two vectors of float.
+  inline void
+  widen(const uint8_t *src,
+        __m128&        lo,
+        __m128&        hi)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64(static_cast<const __m128i *>(static_cast<const void *>(src))), zero);
+    lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+  }
+
+  inline void
+  widen(const uint16_t *src,
+        __m128&         lo,
+        __m128&         hi)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v = _mm_loadu_si128(static_cast<const __m128i *>(static_cast<const void *>(src)));
+    lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+  }
+
+  inline void
+  widen(const int16_t *src,
+        __m128&        lo,
+        __m128&        hi)
+  {
+    // Sign extend each value from the high half of a 32-bit lane.
+    const __m128i v = _mm_loadu_si128(static_cast<const __m128i *>(static_cast<const void *>(src)));
+    lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+  }
+
+  inline void
+  widen(const float *src,
+        __m128&      lo,
+        __m128&      hi)
+  {
+    lo = _mm_loadu_ps(src);
+    hi = _mm_loadu_ps(src + 4);
+  }
+
+  // Store 8 values, already in the range of the destination type,
+  // from two vectors of 32-bit integers.
+  inline void
+  narrow(uint8_t *dest,
+         __m128i  lo,
+         __m128i  hi)
+  {
+    const __m128i v = _mm_packs_epi32(lo, hi);
+    _mm_storel_epi64(static_cast<__m128i *>(static_cast<void *>(dest)), _mm_packus_epi16(v, v));
+  }
+
+  inline void
+  narrow(uint16_t *dest,
+         __m128i   lo,
+         __m128i   hi)
+  {
+    // SSE2 has no unsigned 32-bit pack, so sign extend the low 16
+    // bits, which the signed saturating pack leaves unchanged.
+    _mm_storeu_si128(static_cast<__m128i *>(static_cast<void *>(dest)),
+                     _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16),
+                                     _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16)));
+  }
+
+  template<typename S, typename D>
+  struct ClampKernel<S, D, typename std::enable_if<ClampSource<S>::value &&
+                                                   ClampDest<D>::value>::type>
+  {
+    // As for Convert, NaN becomes zero, values are clamped to the
+    // destination range, and 0.5 is added before truncation, which
+    // rounds halves away from zero for the non-negative results.
+    static dimension_size_type
+    apply(const S             *src,
+          D                   *dest,
+          dimension_size_type  count,
+          float                scale,
+          float                offset)
+    {
+      const __m128 s = _mm_set1_ps(scale);
+      const __m128 o = _mm_set1_ps(offset);
+      const __m128 lo = _mm_set1_ps(0.0f);
+      const __m128 hi = _mm_set1_ps(static_cast<float>(std::numeric_limits<D>::max()));
+      const __m128 half = _mm_set1_ps(0.5f);
+
+      dimension_size_type i = 0;
+      for (; i + 8U <= count; i += 8U)
+        {
+          __m128 v[2];
+          widen(src + i, v[0], v[1]);
+          __m128i r[2];
+          for (dimension_size_type h = 0; h < 2U; ++h)
+            {
+              __m128 x = _mm_add_ps(_mm_mul_ps(v[h], s), o);
+              x = _mm_and_ps(x, _mm_cmpord_ps(x, x));
+              x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+              r[h] = _mm_cvttps_epi32(_mm_add_ps(x, half));
+            }
+          narrow(dest + i, r[0], r[1]);
+        }
+      return i;
+    }
+  };
+
+#endif // OME_FILES_PIXELCONVERSION_SSE2
+
+  // Convert real pixel types.
+  template<typename S, typename D>
+  struct Convert
+  {
+    static void
+    apply(const S             *src,
+          D                   *dest,
+          dimension_size_type  count,
+          double               scale,
+          double               offset,
+          bool                 clamp)
+    {
+      typedef typename Work<S, D>::type W;
+      typedef Store<D, W> store;
+
+      const W s = static_cast<W>(scale);
+      const W o = static_cast<W>(offset);
+
+      if (clamp)
+        {
+          const W lo = store::lowest();
+          const W hi = store::highest();
+          for (dimension_size_type i = ClampKernel<S, D>::apply(src, dest, count, s, o); i < count; ++i)
+            dest[i] = store::round(std::min(std::max(store::finite((static_cast<W>(src[i]) * s) + o), lo), hi));
+        }
+      else
+        {
+          for (dimension_size_type i = 0; i < count; ++i)
+            dest[i] = store::round((static_cast<W>(src[i]) * s) + o);
+        }
+    }
+  };
+
+  // Convert real to complex pixel types.
+  template<typename S, typename U>
+  struct Convert<S, std::complex<U>>
+  {
+    static void
+    apply(const S             *src,
+          std::complex<U>     *dest,
+          dimension_size_type  count,
+          double               scale,
+          double               offset,
+          bool                 /* clamp */)
+    {
+      const U s = static_cast<U>(scale);
+      const U o = static_cast<U>(offset);
+      for (dimension_size_type i = 0; i < count; ++i)
+        dest[i] = std::complex<U>((static_cast<U>(src[i]) * s) + o, U(0));
+    }
+  };
+
+  // Complex to real pixel types are not supported.
+  template<typename T, typename D>
+  struct Convert<std::complex<T>, D>
+  {
+    static void
+    apply(const std::complex<T> * /* src */,
+          D                     * /* dest */,
+          dimension_size_type     /* count */,
+          double                  /* scale */,
+          double                  /* offset */,
+          bool                    /* clamp */)
+    {
+      throw std::logic_error("Conversion of complex to real pixel types is not supported");
+    }
+  };
+
+  // Convert complex pixel types.
+  template<typename T, typename U>
+  struct Convert<std::complex<T>, std::complex<U>>
+  {
+    static void
+    apply(const std::complex<T> *src,
+          std::complex<U>       *dest,
+          dimension_size_type    count,
+          double                 scale,
+          double                 offset,
+          bool                   /* clamp */)
+    {
+      typedef typename std::conditional<std::is_same<T, double>::value ||
+                                        std::is_same<U, double>::value,
+                                        double, float>::type W;
+      const W s = static_cast<W>(scale);
+      const W o = static_cast<W>(offset);
+      for (dimension_size_type i = 0; i < count; ++i)
+        dest[i] = std::complex<U>(static_cast<U>((static_cast<W>(src[i].real()) * s) + o),
+                                  static_cast<U>(static_cast<W>(src[i].imag()) * s));
+    }
+  };
+
+  template<typename S>
+  struct ConvertDestVisitor
+  {
+    const PixelBuffer<S>& source;
+    double                scale;
+    double                offset;
+    bool                  clamp;
+
+    ConvertDestVisitor(const PixelBuffer<S>& source,
+                       double                scale,
+                       double                offset,
+                       bool                  clamp):
+      source(source),
+      scale(scale),
+      offset(offset),
+      clamp(clamp)
+    {}
+
+    template<typename T>
+    void
+    operator()(std::shared_ptr<T>& dest) const
+    {
+      Convert<S, typename T::value_type>::apply(source.data(), dest->data(), source.num_elements(),
+                                                scale, offset, clamp);
+    }
+  };
+
+  struct ConvertSourceVisitor
+  {
+    VariantPixelBuffer& dest;
+    double              scale;
+    double              offset;
+    bool                clamp;
+
+    ConvertSourceVisitor(VariantPixelBuffer& dest,
+                         double              scale,
+                         double              offset,
+                         bool                clamp):
+      dest(dest),
+      scale(scale),
+      offset(offset),
+      clamp(clamp)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source) const
+    {
+      ConvertDestVisitor<typename T::value_type> v(*source, scale, offset, clamp);
+      ome::compat::visit(v, dest.vbuffer());
+    }
+  };
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    bool
+    isPixelConversionSupported(::ome::xml::model::enums::PixelType source,
+                               ::ome::xml::model::enums::PixelType dest)
+    {
+      return !isComplex(source) || isComplex(dest);
+    }
+
+    void
+    convertPixelType(const VariantPixelBuffer&           source,
+                     VariantPixelBuffer&                 dest,
+                     ::ome::xml::model::enums::PixelType pixeltype,
+                     double                              scale,
+                     double                              offset,
+                     bool                                clamp)
+    {
+      if (!isPixelConversionSupported(source.pixelType(), pixeltype))
+        {
+          boost::format fmt("Conversion from pixel type %1% to %2% is not supported");
+          fmt % source.pixelType() % pixeltype;
+          throw std::logic_error(fmt.str());
+        }
+
+      // Hold a reference to the source data, since it will be
+      // replaced if the source is also the destination and needs
+      // resizing.
+      const VariantPixelBuffer src(source);
+
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      const VariantPixelBuffer::size_type *sshape = src.shape();
+      std::copy(sshape, sshape + PixelBufferBase::dimensions, shape.begin());
+
+      if (pixeltype != dest.pixelType() ||
+          !std::equal(shape.begin(), shape.end(), dest.shape()) ||
+          !(src.storage_order() == dest.storage_order()))
+        dest.setBuffer(shape, pixeltype, src.storage_order());
+
+      ConvertSourceVisitor v(dest, scale, offset, clamp);
+      ome::compat::visit(v, src.vbuffer());
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,122 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#ifndef OME_FILES_PIXELCONVERSION_H
+#define OME_FILES_PIXELCONVERSION_H
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class VariantPixelBuffer;
+
+    /**
+     * Check if conversion between two pixel types is supported.
+     *
+     * Complex pixel types may only be converted to complex pixel
+     * types; all other combinations are supported.
+     *
+     * @param source the source pixel type.
+     * @param dest the destination pixel type.
+     * @returns @c true if supported, @c false otherwise.
+     */
+    bool
+    isPixelConversionSupported(::ome::xml::model::enums::PixelType source,
+                               ::ome::xml::model::enums::PixelType dest);
+
+    /**
+     * Convert pixel values to a different pixel type.
+     *
+     * Each destination value is the source value multiplied by @p
+     * scale, with @p offset added.  For example, 12-bit data stored
+     * as uint16 may be converted to uint8 for display with a scale
+     * of 1/16, and uint16 may be normalised to the range [0, 1] as
+     * float with a scale of 1/65535.
+     *
+     * The arithmetic is performed in single precision where both
+     * pixel types are exactly representable in it, and in double
+     * precision otherwise.  Results are rounded to the nearest
+     * integer (halves away from zero) for integer destination
+     * types; for bit destination types, results which round to zero
+     * are clear and all others are set.  If @p clamp is @c true,
+     * results are clamped to the range of the destination type
+     * (NaN values become zero for integer destination types);
+     * otherwise results must be representable in the destination
+     * type.  For complex pixel types, the real and imaginary parts
+     * are scaled, the offset is added to the real part, and no
+     * clamping is performed.
+     *
+     * The destination buffer will be resized to the extents and
+     * storage order of the source, unless it already has them and
+     * the requested pixel type.  The source and destination may be
+     * the same buffer.  The conversion is a single pass over the
+     * buffer data, specialised for each pair of pixel types; see the
+     * "Pixel processing performance" section of the OME Files
+     * documentation for measurements.
+     *
+     * @param source the pixel buffer to convert.
+     * @param dest the destination pixel buffer.
+     * @param pixeltype the destination pixel type.
+     * @param scale the factor to multiply each value by.
+     * @param offset the value to add to each scaled value.
+     * @param clamp @c true to clamp results to the range of the
+     * destination type, or @c false if they are known to be in range.
+     * @throws std::logic_error if the conversion is not supported.
+     */
+    void
+    convertPixelType(const VariantPixelBuffer&           source,
+                     VariantPixelBuffer&                 dest,
+                     ::ome::xml::model::enums::PixelType pixeltype,
+                     double                              scale = 1.0,
+                     double                              offset = 0.0,
+                     bool                                clamp = true);
+
+  }
+}
+
+#endif // OME_FILES_PIXELCONVERSION_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
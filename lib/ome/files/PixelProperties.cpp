@@ -37,7 +37,10 @@
 
 #include <ome/files/PixelProperties.h>
 
+#include <cmath>
+#include <limits>
 #include <stdexcept>
+#include <type_traits>
 
 #include <boost/preprocessor.hpp>
 
@@ -182,6 +185,57 @@ namespace ome
 
 #undef COMPLEX_PT_CASE
 
+    namespace
+    {
+
+      template<typename T>
+      inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+      representable(double value)
+      {
+        return (std::floor(value) == value &&
+                value >= static_cast<double>(std::numeric_limits<T>::min()) &&
+                value <= static_cast<double>(std::numeric_limits<T>::max()));
+      }
+
+      template<typename T>
+      inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+      representable(double value)
+      {
+        return (!std::isfinite(value) ||
+                (value >= static_cast<double>(std::numeric_limits<T>::lowest()) &&
+                 value <= static_cast<double>(std::numeric_limits<T>::max())));
+      }
+
+      template<typename T>
+      inline typename std::enable_if<std::is_floating_point<typename T::value_type>::value, bool>::type
+      representable(double value)
+      {
+        return representable<typename T::value_type>(value);
+      }
+
+    }
+
+#define REPRESENTABLE_PT_CASE(maR, maProperty, maType)                                          \
+        case PixelType::maType:                                                                 \
+          maProperty = representable<PixelProperties< PixelType::maType>::std_type>(value);     \
+          break;
+
+    bool
+    isRepresentable(double                              value,
+                    ::ome::xml::model::enums::PixelType pixeltype)
+    {
+      bool is_representable = false;
+
+      switch(pixeltype)
+        {
+          BOOST_PP_SEQ_FOR_EACH(REPRESENTABLE_PT_CASE, is_representable, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES);
+        }
+
+      return is_representable;
+    }
+
+#undef REPRESENTABLE_PT_CASE
+
 #ifdef __GNUC__
 #  pragma GCC diagnostic pop
 #endif
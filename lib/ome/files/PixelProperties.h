@@ -479,6 +479,24 @@ namespace ome
     bool
     isComplex(::ome::xml::model::enums::PixelType pixeltype);
 
+    /**
+     * Check whether a value can be stored in a PixelType.
+     *
+     * Integer types require an integral value within the range of
+     * the type, and BIT requires zero or one.  Floating point types
+     * require a value within the range of the type, or an infinity
+     * or NaN.  Complex types use the range of their real part.
+     *
+     * @param value the value to check.
+     * @param pixeltype the PixelType to query.
+     *
+     * @returns @c true if the value can be converted to the pixel
+     * type, @c false otherwise.
+     */
+    bool
+    isRepresentable(double                              value,
+                    ::ome::xml::model::enums::PixelType pixeltype);
+
     /**
      * Determine a likely pixel type from its the storage size in bytes.
      *
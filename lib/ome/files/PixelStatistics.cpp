@@ -0,0 +1,644 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+// SSE2 is part of the x86-64 baseline.  Other platforms use the
+// scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define OME_FILES_PIXELSTATISTICS_SSE2
+# include <emmintrin.h>
+#endif
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::VariantPixelBuffer;
+using ::ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // Initial minimum; any value (other than NaN) is not greater.
+  template<typename T>
+  T
+  initialMinimum()
+  {
+    return std::numeric_limits<T>::has_infinity ?
+      std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+  }
+
+  // Initial maximum; any value (other than NaN) is not less.
+  template<typename T>
+  T
+  initialMaximum()
+  {
+    return std::numeric_limits<T>::has_infinity ?
+      -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+  }
+
+  // Vectorised kernels for the minimum and maximum of count pixels
+  // of up to four interleaved samples.  Each scans as many whole
+  // vectors of pixels as possible, updates lo and hi for each
+  // sample, and returns the number of pixels scanned; the scalar
+  // loop scans the rest.  The results are identical to the scalar
+  // loop, except that the sign of a zero minimum or maximum may
+  // differ, since values are compared in a different order.  There
+  // are SSE2 kernels for all integer and floating point types other
+  // than bit; other types, and other platforms, scan none.
+  template<typename T, class Enable = void>
+  struct MinMaxKernel
+  {
+    static dimension_size_type
+    apply(const T             * /* data */,
+          dimension_size_type   /* count */,
+          dimension_size_type   /* samples */,
+          T                   * /* lo */,
+          T                   * /* hi */)
+    {
+      return 0U;
+    }
+  };
+
+#ifdef OME_FILES_PIXELSTATISTICS_SSE2
+
+  inline __m128i
+  loadVector(const void *src)
+  {
+    return _mm_loadu_si128(static_cast<const __m128i *>(src));
+  }
+
+  inline void
+  storeVector(void    *dest,
+              __m128i  v)
+  {
+    _mm_storeu_si128(static_cast<__m128i *>(dest), v);
+  }
+
+  // Vector operations for each type: load, set and store, and the
+  // minimum and maximum of a vector of values and an accumulator,
+  // which return the accumulator if the value is not less or
+  // greater, respectively, as for the scalar loop.  Types without
+  // operations have no lanes.
+  template<typename T>
+  struct MinMaxOps
+  {
+    static const dimension_size_type lanes = 0U;
+  };
+
+  template<>
+  struct MinMaxOps<uint8_t>
+  {
+    typedef __m128i vector_type;
+    static const dimension_size_type lanes = 16U;
+
+    static vector_type load(const uint8_t *src) { return loadVector(src); }
+    static vector_type set(uint8_t v) { return _mm_set1_epi8(static_cast<char>(v)); }
+    static void store(uint8_t *dest, vector_type v) { storeVector(dest, v); }
+    static vector_type lower(vector_type v, vector_type l) { return _mm_min_epu8(v, l); }
+    static vector_type upper(vector_type v, vector_type h) { return _mm_max_epu8(v, h); }
+  };
+
+  // Signed bytes are offset to compare as unsigned.
+  template<>
+  struct MinMaxOps<int8_t> : MinMaxOps<uint8_t>
+  {
+    static vector_type bias() { return _mm_set1_epi8(static_cast<char>(0x80)); }
+    static vector_type load(const int8_t *src) { return _mm_xor_si128(loadVector(src), bias()); }
+    static vector_type set(int8_t v) { return _mm_xor_si128(_mm_set1_epi8(v), bias()); }
+    static void store(int8_t *dest, vector_type v) { storeVector(dest, _mm_xor_si128(v, bias())); }
+  };
+
+  template<>
+  struct MinMaxOps<int16_t>
+  {
+    typedef __m128i vector_type;
+    static const dimension_size_type lanes = 8U;
+
+    static vector_type load(const int16_t *src) { return loadVector(src); }
+    static vector_type set(int16_t v) { return _mm_set1_epi16(v); }
+    static void store(int16_t *dest, vector_type v) { storeVector(dest, v); }
+    static vector_type lower(vector_type v, vector_type l) { return _mm_min_epi16(v, l); }
+    static vector_type upper(vector_type v, vector_type h) { return _mm_max_epi16(v, h); }
+  };
+
+  // Unsigned 16-bit values are offset to compare as signed.
+  template<>
+  struct MinMaxOps<uint16_t> : MinMaxOps<int16_t>
+  {
+    static vector_type bias() { return _mm_set1_epi16(static_cast<short>(0x8000)); }
+    static vector_type load(const uint16_t *src) { return _mm_xor_si128(loadVector(src), bias()); }
+    static vector_type set(uint16_t v) { return _mm_xor_si128(_mm_set1_epi16(static_cast<short>(v)), bias()); }
+    static void store(uint16_t *dest, vector_type v) { storeVector(dest, _mm_xor_si128(v, bias())); }
+  };
+
+  // SSE2 has no 32-bit minimum or maximum, so select using a
+  // comparison.
+  template<>
+  struct MinMaxOps<int32_t>
+  {
+    typedef __m128i vector_type;
+    static const dimension_size_type lanes = 4U;
+
+    static vector_type load(const int32_t *src) { return loadVector(src); }
+    static vector_type set(int32_t v) { return _mm_set1_epi32(v); }
+    static void store(int32_t *dest, vector_type v) { storeVector(dest, v); }
+
+    static vector_type
+    lower(vector_type v, vector_type l)
+    {
+      const __m128i less = _mm_cmplt_epi32(v, l);
+      return _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, l));
+    }
+
+    static vector_type
+    upper(vector_type v, vector_type h)
+    {
+      const __m128i greater = _mm_cmpgt_epi32(v, h);
+      return _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, h));
+    }
+  };
+
+  // Unsigned 32-bit values are offset to compare as signed.
+  template<>
+  struct MinMaxOps<uint32_t> : MinMaxOps<int32_t>
+  {
+    static vector_type bias() { return _mm_set1_epi32(static_cast<int>(0x80000000U)); }
+    static vector_type load(const uint32_t *src) { return _mm_xor_si128(loadVector(src), bias()); }
+    static vector_type set(uint32_t v) { return _mm_xor_si128(_mm_set1_epi32(static_cast<int>(v)), bias()); }
+    static void store(uint32_t *dest, vector_type v) { storeVector(dest, _mm_xor_si128(v, bias())); }
+  };
+
+  // MINPS and MAXPS return the second operand if either is NaN, so
+  // NaN values are skipped.
+  template<>
+  struct MinMaxOps<float>
+  {
+    typedef __m128 vector_type;
+    static const dimension_size_type lanes = 4U;
+
+    static vector_type load(const float *src) { return _mm_loadu_ps(src); }
+    static vector_type set(float v) { return _mm_set1_ps(v); }
+    static void store(float *dest, vector_type v) { _mm_storeu_ps(dest, v); }
+    static vector_type lower(vector_type v, vector_type l) { return _mm_min_ps(v, l); }
+    static vector_type upper(vector_type v, vector_type h) { return _mm_max_ps(v, h); }
+  };
+
+  template<>
+  struct MinMaxOps<double>
+  {
+    typedef __m128d vector_type;
+    static const dimension_size_type lanes = 2U;
+
+    static vector_type load(const double *src) { return _mm_loadu_pd(src); }
+    static vector_type set(double v) { return _mm_set1_pd(v); }
+    static void store(double *dest, vector_type v) { _mm_storeu_pd(dest, v); }
+    static vector_type lower(vector_type v, vector_type l) { return _mm_min_pd(v, l); }
+    static vector_type upper(vector_type v, vector_type h) { return _mm_max_pd(v, h); }
+  };
+
+  template<typename T>
+  struct MinMaxKernel<T, typename std::enable_if<(MinMaxOps<T>::lanes > 0U)>::type>
+  {
+    typedef MinMaxOps<T> ops;
+    typedef typename ops::vector_type vector_type;
+
+    // Scan whole periods of P vectors, where P vectors contain a
+    // whole number of pixels; lane j of vector k accumulates sample
+    // (k * lanes + j) % samples.
+    template<dimension_size_type P>
+    static dimension_size_type
+    scan(const T             *data,
+         dimension_size_type  count,
+         dimension_size_type  samples,
+         T                   *lo,
+         T                   *hi)
+    {
+      const dimension_size_type lanes = ops::lanes;
+      const dimension_size_type size = count * samples;
+
+      vector_type l[P];
+      vector_type h[P];
+      for (dimension_size_type k = 0; k < P; ++k)
+        {
+          l[k] = ops::set(initialMinimum<T>());
+          h[k] = ops::set(initialMaximum<T>());
+        }
+
+      dimension_size_type i = 0;
+      for (; i + (P * lanes) <= size; i += P * lanes)
+        {
+          for (dimension_size_type k = 0; k < P; ++k)
+            {
+              const vector_type v = ops::load(data + i + (k * lanes));
+              l[k] = ops::lower(v, l[k]);
+              h[k] = ops::upper(v, h[k]);
+            }
+        }
+
+      T lv[ops::lanes];
+      T hv[ops::lanes];
+      for (dimension_size_type k = 0; k < P; ++k)
+        {
+          ops::store(lv, l[k]);
+          ops::store(hv, h[k]);
+          for (dimension_size_type j = 0; j < lanes; ++j)
+            {
+              const dimension_size_type s = ((k * lanes) + j) % samples;
+              lo[s] = lv[j] < lo[s] ? lv[j] : lo[s];
+              hi[s] = hi[s] < hv[j] ? hv[j] : hi[s];
+            }
+        }
+
+      return i / samples;
+    }
+
+    static dimension_size_type
+    apply(const T             *data,
+          dimension_size_type  count,
+          dimension_size_type  samples,
+          T                   *lo,
+          T                   *hi)
+    {
+      // The number of vectors in a period is samples divided by
+      // their greatest common divisor with lanes.
+      const dimension_size_type lanes = ops::lanes;
+      dimension_size_type divisor = samples;
+      while (lanes % divisor || samples % divisor)
+        --divisor;
+
+      switch (samples / divisor)
+        {
+        case 1U:
+          return scan<1U>(data, count, samples, lo, hi);
+        case 2U:
+          return scan<2U>(data, count, samples, lo, hi);
+        case 3U:
+          return scan<3U>(data, count, samples, lo, hi);
+        default:
+          return 0U;
+        }
+    }
+  };
+
+#endif // OME_FILES_PIXELSTATISTICS_SSE2
+
+  // Minimum and maximum of count values separated by step.  NaN
+  // values compare false, so are skipped.
+  template<typename T>
+  void
+  minmax(const T            *data,
+         dimension_size_type count,
+         dimension_size_type step,
+         T&                  lo,
+         T&                  hi)
+  {
+    T l = lo;
+    T h = hi;
+    if (step == 1U)
+      {
+        for (dimension_size_type i = MinMaxKernel<T>::apply(data, count, 1U, &l, &h); i < count; ++i)
+          {
+            const T v = data[i];
+            l = v < l ? v : l;
+            h = h < v ? v : h;
+          }
+      }
+    else
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          {
+            const T v = data[i * step];
+            l = v < l ? v : l;
+            h = h < v ? v : h;
+          }
+      }
+    lo = l;
+    hi = h;
+  }
+
+  // Histogram of count values separated by step.
+  template<typename T>
+  void
+  histogram(const T               *data,
+            dimension_size_type    count,
+            dimension_size_type    step,
+            dimension_size_type    shift,
+            std::vector<uint64_t>& bins,
+            std::true_type)
+  {
+    const int64_t offset = static_cast<int64_t>(std::numeric_limits<T>::min());
+    for (dimension_size_type i = 0; i < count; ++i)
+      {
+        const uint64_t v = static_cast<uint64_t>(static_cast<int64_t>(data[i * step]) - offset);
+        ++bins[static_cast<std::vector<uint64_t>::size_type>(v >> shift)];
+      }
+  }
+
+  // Histograms are not supported for floating point types.
+  template<typename T>
+  void
+  histogram(const T               * /* data */,
+            dimension_size_type     /* count */,
+            dimension_size_type     /* step */,
+            dimension_size_type     /* shift */,
+            std::vector<uint64_t>&  /* bins */,
+            std::false_type)
+  {
+  }
+
+  // Accumulate the statistics of a pixel buffer.
+  struct StatisticsVisitor
+  {
+    dimension_size_type shift;
+    std::vector<double>& minimum;
+    std::vector<double>& maximum;
+    std::vector<std::vector<uint64_t>>& histograms;
+
+    StatisticsVisitor(dimension_size_type                 shift,
+                      std::vector<double>&                minimum,
+                      std::vector<double>&                maximum,
+                      std::vector<std::vector<uint64_t>>& histograms):
+      shift(shift),
+      minimum(minimum),
+      maximum(maximum),
+      histograms(histograms)
+    {}
+
+    // The minimum and maximum of the first values have already been
+    // found if first is nonzero.
+    template<typename T>
+    void
+    run(const T            *data,
+        dimension_size_type count,
+        dimension_size_type step,
+        dimension_size_type first,
+        dimension_size_type sample,
+        std::vector<T>&     lo,
+        std::vector<T>&     hi)
+    {
+      // Local copies, since std::vector<bool> elements are not
+      // addressable.
+      T l = lo[sample];
+      T h = hi[sample];
+      minmax(data + (first * step), count - first, step, l, h);
+      lo[sample] = l;
+      hi[sample] = h;
+      if (!histograms.empty())
+        histogram(data, count, step, shift, histograms[sample],
+                  std::integral_constant<bool, std::is_integral<T>::value>());
+    }
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<T>>& buf)
+    {
+      const T *data = buf->data();
+      const dimension_size_type size = buf->num_elements();
+      const dimension_size_type samples = buf->shape()[ome::files::DIM_SUBCHANNEL];
+      const dimension_size_type stride = static_cast<dimension_size_type>(buf->strides()[ome::files::DIM_SUBCHANNEL]);
+
+      if (!size)
+        return;
+
+      std::vector<T> lo(samples, initialMinimum<T>());
+      std::vector<T> hi(samples, initialMaximum<T>());
+
+      if (stride == 1U)
+        {
+          // Interleaved subchannels.  Up to four are scanned
+          // together by the vector kernel.
+          const dimension_size_type count = size / samples;
+          dimension_size_type first = 0U;
+          if (samples <= 4U)
+            {
+              T l[4];
+              T h[4];
+              std::copy(lo.begin(), lo.end(), l);
+              std::copy(hi.begin(), hi.end(), h);
+              first = MinMaxKernel<T>::apply(data, count, samples, l, h);
+              std::copy(l, l + samples, lo.begin());
+              std::copy(h, h + samples, hi.begin());
+            }
+          for (dimension_size_type s = 0; s < samples; ++s)
+            run(data + s, count, samples, first, s, lo, hi);
+        }
+      else
+        {
+          // Each run of stride values is a single subchannel.
+          for (dimension_size_type r = 0; r < size / stride; ++r)
+            run(data + (r * stride), stride, 1U, 0U, r % samples, lo, hi);
+        }
+
+      for (dimension_size_type s = 0; s < samples; ++s)
+        {
+          // Values are only converted if present, since the initial
+          // values of integer types are not the infinities.
+          if (!(hi[s] < lo[s]))
+            {
+              minimum[s] = std::min(minimum[s], static_cast<double>(lo[s]));
+              maximum[s] = std::max(maximum[s], static_cast<double>(hi[s]));
+            }
+        }
+    }
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<std::complex<T>>>& /* buf */)
+    {
+      throw std::logic_error("Pixel statistics are not supported for complex pixel types");
+    }
+  };
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    PixelStatistics::PixelStatistics(::ome::xml::model::enums::PixelType pixeltype,
+                                     dimension_size_type                 samples,
+                                     dimension_size_type                 bins):
+      pixelType(pixeltype),
+      bins(bins),
+      shift(0U),
+      count(0U),
+      minimum(samples, std::numeric_limits<double>::infinity()),
+      maximum(samples, -std::numeric_limits<double>::infinity()),
+      histogram()
+    {
+      if (!isSupported(pixeltype, bins))
+        {
+          boost::format fmt("Pixel statistics with %1% histogram bins are not supported for pixel type %2%");
+          fmt % bins % pixeltype;
+          throw std::logic_error(fmt.str());
+        }
+      if (!samples)
+        throw std::logic_error("Pixel statistics require at least one subchannel");
+
+      if (bins)
+        {
+          dimension_size_type binbits = 0U;
+          while ((dimension_size_type(1U) << binbits) < bins)
+            ++binbits;
+          shift = significantBitsPerPixel(pixeltype) - binbits;
+          histogram.assign(samples, std::vector<uint64_t>(bins, 0U));
+        }
+    }
+
+    bool
+    PixelStatistics::isSupported(::ome::xml::model::enums::PixelType pixeltype,
+                                 dimension_size_type                 bins)
+    {
+      if (isComplex(pixeltype))
+        return false;
+      if (bins)
+        {
+          const dimension_size_type bits = significantBitsPerPixel(pixeltype);
+          return (isInteger(pixeltype) &&
+                  (bins & (bins - 1U)) == 0U &&
+                  bits < std::numeric_limits<dimension_size_type>::digits &&
+                  bins <= (dimension_size_type(1U) << bits));
+        }
+      return true;
+    }
+
+    ::ome::xml::model::enums::PixelType
+    PixelStatistics::getPixelType() const
+    {
+      return pixelType;
+    }
+
+    dimension_size_type
+    PixelStatistics::getSamples() const
+    {
+      return minimum.size();
+    }
+
+    dimension_size_type
+    PixelStatistics::getBins() const
+    {
+      return bins;
+    }
+
+    uint64_t
+    PixelStatistics::getCount() const
+    {
+      return count;
+    }
+
+    void
+    PixelStatistics::add(const VariantPixelBuffer& buf)
+    {
+      if (buf.pixelType() != pixelType)
+        {
+          boost::format fmt("Pixel buffer type %1% does not match statistics pixel type %2%");
+          fmt % buf.pixelType() % pixelType;
+          throw std::logic_error(fmt.str());
+        }
+      if (buf.shape()[DIM_SUBCHANNEL] != minimum.size())
+        {
+          boost::format fmt("Pixel buffer subchannel count %1% does not match statistics subchannel count %2%");
+          fmt % buf.shape()[DIM_SUBCHANNEL] % minimum.size();
+          throw std::logic_error(fmt.str());
+        }
+
+      StatisticsVisitor v(shift, minimum, maximum, histogram);
+      ome::compat::visit(v, buf.vbuffer());
+
+      count += buf.num_elements() / minimum.size();
+    }
+
+    double
+    PixelStatistics::getMinimum(dimension_size_type sample) const
+    {
+      return minimum.at(sample);
+    }
+
+    double
+    PixelStatistics::getMaximum(dimension_size_type sample) const
+    {
+      return maximum.at(sample);
+    }
+
+    const std::vector<uint64_t>&
+    PixelStatistics::getHistogram(dimension_size_type sample) const
+    {
+      static const std::vector<uint64_t> none;
+      return histogram.empty() ? none : histogram.at(sample);
+    }
+
+    double
+    PixelStatistics::getHistogramMinimum() const
+    {
+      const dimension_size_type bits = significantBitsPerPixel(pixelType);
+      return isSigned(pixelType) ? -std::ldexp(1.0, static_cast<int>(bits) - 1) : 0.0;
+    }
+
+    double
+    PixelStatistics::getHistogramMaximum() const
+    {
+      const dimension_size_type bits = significantBitsPerPixel(pixelType);
+      return isSigned(pixelType) ?
+        std::ldexp(1.0, static_cast<int>(bits) - 1) - 1.0 :
+        std::ldexp(1.0, static_cast<int>(bits)) - 1.0;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
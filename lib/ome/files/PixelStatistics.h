@@ -0,0 +1,227 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PIXELSTATISTICS_H
+#define OME_FILES_PIXELSTATISTICS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class VariantPixelBuffer;
+
+    /**
+     * Pixel value statistics.
+     *
+     * Accumulates the minimum and maximum value of each subchannel
+     * over one or more pixel buffers, and optionally a histogram of
+     * each subchannel with a fixed number of bins.  This allows the
+     * statistics of an image to be computed while the image is being
+     * written, rather than reading it again afterward.
+     *
+     * Each buffer is scanned in runs of values belonging to a single
+     * subchannel; up to four interleaved subchannels are scanned
+     * together, and more with a stride.  Measurements are described
+     * in the "Pixel processing performance" section of the OME Files
+     * documentation.
+     *
+     * Complex pixel types are not supported.  Histograms are only
+     * supported for integer and bit pixel types; the bins divide the
+     * full range of the pixel type equally, so the number of bins
+     * must be a power of two no greater than the number of possible
+     * values.  Floating point NaN values are ignored.
+     */
+    class PixelStatistics
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param pixeltype the pixel type.
+       * @param samples the number of subchannels.
+       * @param bins the number of histogram bins, or zero for no
+       * histogram.
+       * @throws std::logic_error if the pixel type or number of bins
+       * is not supported, or there are no subchannels.
+       */
+      PixelStatistics(::ome::xml::model::enums::PixelType pixeltype,
+                      dimension_size_type                 samples,
+                      dimension_size_type                 bins = 0U);
+
+      /**
+       * Check if statistics are supported for a pixel type.
+       *
+       * @param pixeltype the pixel type.
+       * @param bins the number of histogram bins, or zero for no
+       * histogram.
+       * @returns @c true if supported, @c false otherwise.
+       */
+      static bool
+      isSupported(::ome::xml::model::enums::PixelType pixeltype,
+                  dimension_size_type                 bins = 0U);
+
+      /**
+       * Get the pixel type.
+       *
+       * @returns the pixel type.
+       */
+      ::ome::xml::model::enums::PixelType
+      getPixelType() const;
+
+      /**
+       * Get the number of subchannels.
+       *
+       * @returns the number of subchannels.
+       */
+      dimension_size_type
+      getSamples() const;
+
+      /**
+       * Get the number of histogram bins.
+       *
+       * @returns the number of bins, or zero if no histogram is
+       * accumulated.
+       */
+      dimension_size_type
+      getBins() const;
+
+      /**
+       * Get the number of values accumulated for each subchannel.
+       *
+       * NaN values are included.
+       *
+       * @returns the number of values.
+       */
+      uint64_t
+      getCount() const;
+
+      /**
+       * Accumulate the values in a pixel buffer.
+       *
+       * @param buf the pixel buffer.
+       * @throws std::logic_error if the pixel type or number of
+       * subchannels of @p buf does not match.
+       */
+      void
+      add(const VariantPixelBuffer& buf);
+
+      /**
+       * Get the minimum value of a subchannel.
+       *
+       * @param sample the subchannel.
+       * @returns the minimum value, or +∞ if no values (other than
+       * NaN) have been accumulated.
+       */
+      double
+      getMinimum(dimension_size_type sample) const;
+
+      /**
+       * Get the maximum value of a subchannel.
+       *
+       * @param sample the subchannel.
+       * @returns the maximum value, or −∞ if no values (other than
+       * NaN) have been accumulated.
+       */
+      double
+      getMaximum(dimension_size_type sample) const;
+
+      /**
+       * Get the histogram of a subchannel.
+       *
+       * Bin @c i contains the number of values @c v where
+       * (@c v − getHistogramMinimum()) × getBins() ÷
+       * (getHistogramMaximum() − getHistogramMinimum() + 1) is @c i.
+       *
+       * @param sample the subchannel.
+       * @returns the bin counts (empty if no histogram is
+       * accumulated).
+       */
+      const std::vector<uint64_t>&
+      getHistogram(dimension_size_type sample) const;
+
+      /**
+       * Get the smallest value counted by the histogram.
+       *
+       * @returns the minimum value of the pixel type.
+       */
+      double
+      getHistogramMinimum() const;
+
+      /**
+       * Get the largest value counted by the histogram.
+       *
+       * @returns the maximum value of the pixel type.
+       */
+      double
+      getHistogramMaximum() const;
+
+    private:
+      /// Pixel type.
+      ::ome::xml::model::enums::PixelType pixelType;
+      /// Number of histogram bins.
+      dimension_size_type bins;
+      /// Shift to convert a value offset to a histogram bin.
+      dimension_size_type shift;
+      /// Number of values accumulated per subchannel.
+      uint64_t count;
+      /// Minimum value of each subchannel.
+      std::vector<double> minimum;
+      /// Maximum value of each subchannel.
+      std::vector<double> maximum;
+      /// Histogram of each subchannel.
+      std::vector<std::vector<uint64_t>> histogram;
+    };
+
+  }
+}
+
+#endif // OME_FILES_PIXELSTATISTICS_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
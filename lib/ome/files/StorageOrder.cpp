@@ -0,0 +1,641 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/preprocessor.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/StorageOrder.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+// SSE2 is part of the x86-64 baseline.  SSSE3 is used if the compiler
+// targets it or, with GCC and Clang, if the processor supports it at
+// run time.  Other platforms use the scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define OME_FILES_STORAGEORDER_SSE2
+# include <emmintrin.h>
+# if defined(__SSSE3__)
+#  define OME_FILES_STORAGEORDER_SSSE3
+#  define OME_FILES_STORAGEORDER_SSSE3_TARGET
+# elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define OME_FILES_STORAGEORDER_SSSE3
+#  define OME_FILES_STORAGEORDER_SSSE3_TARGET __attribute__((target("ssse3")))
+# endif
+# ifdef OME_FILES_STORAGEORDER_SSSE3
+#  include <tmmintrin.h>
+# endif
+#endif
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+
+namespace
+{
+
+  typedef boost::multi_array_types::index index_type;
+
+  // Layout of the samples of a row.
+  enum RowLayout
+    {
+      ROW_INTERLEAVED, // Samples of each pixel adjacent, pixels adjacent.
+      ROW_PLANAR,      // Pixels of each sample adjacent.
+      ROW_OTHER        // Any other layout.
+    };
+
+  RowLayout
+  rowLayout(const index_type    *strides,
+            dimension_size_type  samples)
+  {
+    const index_type xstride = strides[ome::files::DIM_SPATIAL_X];
+    if (xstride == 1)
+      return ROW_PLANAR;
+    if (xstride == static_cast<index_type>(samples) &&
+        strides[ome::files::DIM_SUBCHANNEL] == 1)
+      return ROW_INTERLEAVED;
+    return ROW_OTHER;
+  }
+
+  // Vectorised kernels for deinterleaveRow and interleaveRow.  Each
+  // transfers as many whole vectors of pixels as possible, and
+  // returns the number of pixels transferred; the scalar loop
+  // transfers the rest.  There are kernels for three and four
+  // samples of 8- and 16-bit integer types on x86; other types,
+  // sample counts and platforms transfer none.  Sizes are in bytes,
+  // since only the bit patterns are moved.
+  template<typename V, unsigned int N,
+           std::size_t Size = std::is_integral<V>::value ? sizeof(V) : 0U>
+  struct SampleKernel
+  {
+    static dimension_size_type
+    deinterleave(const V             * /* src */,
+                 V                   * /* dest */,
+                 index_type           /* dstride */,
+                 dimension_size_type  /* width */)
+    {
+      return 0U;
+    }
+
+    static dimension_size_type
+    interleave(const V             * /* src */,
+               V                   * /* dest */,
+               index_type           /* sstride */,
+               dimension_size_type  /* width */)
+    {
+      return 0U;
+    }
+  };
+
+#ifdef OME_FILES_STORAGEORDER_SSE2
+
+  inline __m128i
+  load128(const void *src)
+  {
+    return _mm_loadu_si128(static_cast<const __m128i *>(src));
+  }
+
+  inline void
+  store128(void    *dest,
+           __m128i  value)
+  {
+    _mm_storeu_si128(static_cast<__m128i *>(dest), value);
+  }
+
+  // Four 8-bit samples: 16 pixels at once.
+  template<typename V>
+  struct SampleKernel<V, 4, 1>
+  {
+    static dimension_size_type
+    deinterleave(const V             *src,
+                 V                   *dest,
+                 index_type           dstride,
+                 dimension_size_type  width)
+    {
+      // Each sample is moved to the low byte of its 32-bit pixel,
+      // and the pixels packed to bytes.
+      const __m128i low = _mm_set1_epi32(0xFF);
+      dimension_size_type x = 0;
+      for (; x + 16U <= width; x += 16U)
+        {
+          __m128i v[4];
+          for (unsigned int i = 0; i < 4U; ++i)
+            v[i] = load128(src + (x + i * 4U) * 4U);
+          for (unsigned int s = 0; s < 4U; ++s)
+            {
+              __m128i p[4];
+              for (unsigned int i = 0; i < 4U; ++i)
+                p[i] = _mm_and_si128(_mm_srli_epi32(v[i], static_cast<int>(s * 8U)), low);
+              store128(dest + (s * dstride) + static_cast<index_type>(x),
+                       _mm_packus_epi16(_mm_packs_epi32(p[0], p[1]),
+                                        _mm_packs_epi32(p[2], p[3])));
+            }
+        }
+      return x;
+    }
+
+    static dimension_size_type
+    interleave(const V             *src,
+               V                   *dest,
+               index_type           sstride,
+               dimension_size_type  width)
+    {
+      dimension_size_type x = 0;
+      for (; x + 16U <= width; x += 16U)
+        {
+          const index_type ix = static_cast<index_type>(x);
+          const __m128i s0 = load128(src + ix);
+          const __m128i s1 = load128(src + sstride + ix);
+          const __m128i s2 = load128(src + (2 * sstride) + ix);
+          const __m128i s3 = load128(src + (3 * sstride) + ix);
+          const __m128i lo01 = _mm_unpacklo_epi8(s0, s1);
+          const __m128i hi01 = _mm_unpackhi_epi8(s0, s1);
+          const __m128i lo23 = _mm_unpacklo_epi8(s2, s3);
+          const __m128i hi23 = _mm_unpackhi_epi8(s2, s3);
+          store128(dest + (x * 4U), _mm_unpacklo_epi16(lo01, lo23));
+          store128(dest + (x * 4U) + 16U, _mm_unpackhi_epi16(lo01, lo23));
+          store128(dest + (x * 4U) + 32U, _mm_unpacklo_epi16(hi01, hi23));
+          store128(dest + (x * 4U) + 48U, _mm_unpackhi_epi16(hi01, hi23));
+        }
+      return x;
+    }
+  };
+
+  // Four 16-bit samples: 8 pixels at once, by transposing 4×8
+  // blocks.
+  template<typename V>
+  struct SampleKernel<V, 4, 2>
+  {
+    static dimension_size_type
+    deinterleave(const V             *src,
+                 V                   *dest,
+                 index_type           dstride,
+                 dimension_size_type  width)
+    {
+      dimension_size_type x = 0;
+      for (; x + 8U <= width; x += 8U)
+        {
+          const index_type ix = static_cast<index_type>(x);
+          const __m128i v0 = load128(src + (x * 4U));
+          const __m128i v1 = load128(src + (x * 4U) + 8U);
+          const __m128i v2 = load128(src + (x * 4U) + 16U);
+          const __m128i v3 = load128(src + (x * 4U) + 24U);
+          // Pixels 0 and 2, and 1 and 3, then 4 and 6, and 5 and 7.
+          const __m128i a = _mm_unpacklo_epi16(v0, v1);
+          const __m128i b = _mm_unpackhi_epi16(v0, v1);
+          const __m128i c = _mm_unpacklo_epi16(v2, v3);
+          const __m128i d = _mm_unpackhi_epi16(v2, v3);
+          // Samples 0 and 1, and 2 and 3, of pixels 0–3 and 4–7.
+          const __m128i e = _mm_unpacklo_epi16(a, b);
+          const __m128i f = _mm_unpackhi_epi16(a, b);
+          const __m128i g = _mm_unpacklo_epi16(c, d);
+          const __m128i h = _mm_unpackhi_epi16(c, d);
+          store128(dest + ix, _mm_unpacklo_epi64(e, g));
+          store128(dest + dstride + ix, _mm_unpackhi_epi64(e, g));
+          store128(dest + (2 * dstride) + ix, _mm_unpacklo_epi64(f, h));
+          store128(dest + (3 * dstride) + ix, _mm_unpackhi_epi64(f, h));
+        }
+      return x;
+    }
+
+    static dimension_size_type
+    interleave(const V             *src,
+               V                   *dest,
+               index_type           sstride,
+               dimension_size_type  width)
+    {
+      dimension_size_type x = 0;
+      for (; x + 8U <= width; x += 8U)
+        {
+          const index_type ix = static_cast<index_type>(x);
+          const __m128i s0 = load128(src + ix);
+          const __m128i s1 = load128(src + sstride + ix);
+          const __m128i s2 = load128(src + (2 * sstride) + ix);
+          const __m128i s3 = load128(src + (3 * sstride) + ix);
+          const __m128i lo01 = _mm_unpacklo_epi16(s0, s1);
+          const __m128i hi01 = _mm_unpackhi_epi16(s0, s1);
+          const __m128i lo23 = _mm_unpacklo_epi16(s2, s3);
+          const __m128i hi23 = _mm_unpackhi_epi16(s2, s3);
+          store128(dest + (x * 4U), _mm_unpacklo_epi32(lo01, lo23));
+          store128(dest + (x * 4U) + 8U, _mm_unpackhi_epi32(lo01, lo23));
+          store128(dest + (x * 4U) + 16U, _mm_unpacklo_epi32(hi01, hi23));
+          store128(dest + (x * 4U) + 24U, _mm_unpackhi_epi32(hi01, hi23));
+        }
+      return x;
+    }
+  };
+
+#endif // OME_FILES_STORAGEORDER_SSE2
+
+#ifdef OME_FILES_STORAGEORDER_SSSE3
+
+  // Whether the processor supports SSSE3.
+  bool
+  haveSSSE3()
+  {
+#ifdef __SSSE3__
+    return true;
+#else
+    static const bool supported = []
+      {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") != 0;
+      }();
+    return supported;
+#endif
+  }
+
+  // Three samples of Size bytes, with byte shuffles: three vectors
+  // of interleaved pixels correspond to one vector of each sample.
+  // Each vector of the result is the combination of a shuffle of
+  // each of the three source vectors, with bytes from other vectors
+  // zeroed.
+  template<std::size_t Size>
+  OME_FILES_STORAGEORDER_SSSE3_TARGET
+  dimension_size_type
+  deinterleave3(const uint8_t       *src,
+                uint8_t             *dest,
+                index_type           dstride,
+                dimension_size_type  width)
+  {
+    const unsigned int lanes = 16U / Size;
+
+    // Shuffle of source vector k for sample s.
+    __m128i shuffle[9];
+    for (unsigned int s = 0; s < 3U; ++s)
+      for (unsigned int k = 0; k < 3U; ++k)
+        {
+          std::array<int8_t, 16> m;
+          for (unsigned int b = 0; b < 16U; ++b)
+            {
+              const unsigned int element = (b / Size) * 3U + s;
+              m[b] = element / lanes == k ?
+                static_cast<int8_t>((element % lanes) * Size + b % Size) : int8_t(-1);
+            }
+          shuffle[s * 3U + k] = load128(m.data());
+        }
+
+    dimension_size_type x = 0;
+    for (; x + lanes <= width; x += lanes)
+      {
+        const __m128i v0 = load128(src + (x * 3U * Size));
+        const __m128i v1 = load128(src + (x * 3U * Size) + 16U);
+        const __m128i v2 = load128(src + (x * 3U * Size) + 32U);
+        for (unsigned int s = 0; s < 3U; ++s)
+          store128(dest + ((s * dstride) + static_cast<index_type>(x)) * static_cast<index_type>(Size),
+                   _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, shuffle[s * 3U]),
+                                             _mm_shuffle_epi8(v1, shuffle[s * 3U + 1U])),
+                                _mm_shuffle_epi8(v2, shuffle[s * 3U + 2U])));
+      }
+    return x;
+  }
+
+  template<std::size_t Size>
+  OME_FILES_STORAGEORDER_SSSE3_TARGET
+  dimension_size_type
+  interleave3(const uint8_t       *src,
+              uint8_t             *dest,
+              index_type           sstride,
+              dimension_size_type  width)
+  {
+    const unsigned int lanes = 16U / Size;
+
+    // Shuffle of sample s for destination vector k.
+    __m128i shuffle[9];
+    for (unsigned int k = 0; k < 3U; ++k)
+      for (unsigned int s = 0; s < 3U; ++s)
+        {
+          std::array<int8_t, 16> m;
+          for (unsigned int b = 0; b < 16U; ++b)
+            {
+              const unsigned int element = k * lanes + b / Size;
+              m[b] = element % 3U == s ?
+                static_cast<int8_t>((element / 3U) * Size + b % Size) : int8_t(-1);
+            }
+          shuffle[k * 3U + s] = load128(m.data());
+        }
+
+    dimension_size_type x = 0;
+    for (; x + lanes <= width; x += lanes)
+      {
+        const index_type ix = static_cast<index_type>(x);
+        const index_type size = static_cast<index_type>(Size);
+        const __m128i s0 = load128(src + ix * size);
+        const __m128i s1 = load128(src + (sstride + ix) * size);
+        const __m128i s2 = load128(src + ((2 * sstride) + ix) * size);
+        for (unsigned int k = 0; k < 3U; ++k)
+          store128(dest + (x * 3U * Size) + (k * 16U),
+                   _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(s0, shuffle[k * 3U]),
+                                             _mm_shuffle_epi8(s1, shuffle[k * 3U + 1U])),
+                                _mm_shuffle_epi8(s2, shuffle[k * 3U + 2U])));
+      }
+    return x;
+  }
+
+  template<typename V, std::size_t Size>
+  struct SampleKernel3
+  {
+    static dimension_size_type
+    deinterleave(const V             *src,
+                 V                   *dest,
+                 index_type           dstride,
+                 dimension_size_type  width)
+    {
+      if (!haveSSSE3())
+        return 0U;
+      return deinterleave3<Size>(reinterpret_cast<const uint8_t *>(src),
+                                 reinterpret_cast<uint8_t *>(dest), dstride, width);
+    }
+
+    static dimension_size_type
+    interleave(const V             *src,
+               V                   *dest,
+               index_type           sstride,
+               dimension_size_type  width)
+    {
+      if (!haveSSSE3())
+        return 0U;
+      return interleave3<Size>(reinterpret_cast<const uint8_t *>(src),
+                               reinterpret_cast<uint8_t *>(dest), sstride, width);
+    }
+  };
+
+  template<typename V>
+  struct SampleKernel<V, 3, 1> : SampleKernel3<V, 1>
+  {};
+
+  template<typename V>
+  struct SampleKernel<V, 3, 2> : SampleKernel3<V, 2>
+  {};
+
+#endif // OME_FILES_STORAGEORDER_SSSE3
+
+  // Deinterleave a row of N samples per pixel into N sample rows.
+  template<typename V, unsigned int N>
+  void
+  deinterleaveRow(const V             *src,
+                  V                   *dest,
+                  index_type           sstride,
+                  dimension_size_type  width)
+  {
+    for (dimension_size_type x = SampleKernel<V, N>::deinterleave(src, dest, sstride, width); x < width; ++x)
+      for (unsigned int s = 0; s < N; ++s)
+        dest[(s * sstride) + static_cast<index_type>(x)] = src[(x * N) + s];
+  }
+
+  // Interleave N sample rows into a row of N samples per pixel.
+  template<typename V, unsigned int N>
+  void
+  interleaveRow(const V             *src,
+                V                   *dest,
+                index_type           sstride,
+                dimension_size_type  width)
+  {
+    for (dimension_size_type x = SampleKernel<V, N>::interleave(src, dest, sstride, width); x < width; ++x)
+      for (unsigned int s = 0; s < N; ++s)
+        dest[(x * N) + s] = src[(s * sstride) + static_cast<index_type>(x)];
+  }
+
+  // Copy a row with arbitrary pixel and sample strides.
+  template<typename V>
+  void
+  copyRowStrided(const V             *src,
+                 V                   *dest,
+                 const index_type    *sstrides,
+                 const index_type    *dstrides,
+                 dimension_size_type  width,
+                 dimension_size_type  samples)
+  {
+    const index_type sx = sstrides[ome::files::DIM_SPATIAL_X];
+    const index_type ss = sstrides[ome::files::DIM_SUBCHANNEL];
+    const index_type dx = dstrides[ome::files::DIM_SPATIAL_X];
+    const index_type ds = dstrides[ome::files::DIM_SUBCHANNEL];
+
+    for (index_type s = 0; s < static_cast<index_type>(samples); ++s)
+      for (index_type x = 0; x < static_cast<index_type>(width); ++x)
+        dest[(x * dx) + (s * ds)] = src[(x * sx) + (s * ss)];
+  }
+
+  template<typename V>
+  void
+  copyRow(const V             *src,
+          V                   *dest,
+          const index_type    *sstrides,
+          const index_type    *dstrides,
+          RowLayout            slayout,
+          RowLayout            dlayout,
+          dimension_size_type  width,
+          dimension_size_type  samples)
+  {
+    const index_type ss = sstrides[ome::files::DIM_SUBCHANNEL];
+    const index_type ds = dstrides[ome::files::DIM_SUBCHANNEL];
+
+    if (slayout == ROW_INTERLEAVED && dlayout == ROW_INTERLEAVED)
+      {
+        std::copy(src, src + (width * samples), dest);
+      }
+    else if (slayout == ROW_PLANAR && dlayout == ROW_PLANAR)
+      {
+        for (index_type s = 0; s < static_cast<index_type>(samples); ++s)
+          std::copy(src + (s * ss), src + (s * ss) + width, dest + (s * ds));
+      }
+    else if (slayout == ROW_INTERLEAVED && dlayout == ROW_PLANAR)
+      {
+        switch (samples)
+          {
+          case 2: deinterleaveRow<V, 2>(src, dest, ds, width); break;
+          case 3: deinterleaveRow<V, 3>(src, dest, ds, width); break;
+          case 4: deinterleaveRow<V, 4>(src, dest, ds, width); break;
+          case 5: deinterleaveRow<V, 5>(src, dest, ds, width); break;
+          case 6: deinterleaveRow<V, 6>(src, dest, ds, width); break;
+          case 7: deinterleaveRow<V, 7>(src, dest, ds, width); break;
+          case 8: deinterleaveRow<V, 8>(src, dest, ds, width); break;
+          default: copyRowStrided(src, dest, sstrides, dstrides, width, samples); break;
+          }
+      }
+    else if (slayout == ROW_PLANAR && dlayout == ROW_INTERLEAVED)
+      {
+        switch (samples)
+          {
+          case 2: interleaveRow<V, 2>(src, dest, ss, width); break;
+          case 3: interleaveRow<V, 3>(src, dest, ss, width); break;
+          case 4: interleaveRow<V, 4>(src, dest, ss, width); break;
+          case 5: interleaveRow<V, 5>(src, dest, ss, width); break;
+          case 6: interleaveRow<V, 6>(src, dest, ss, width); break;
+          case 7: interleaveRow<V, 7>(src, dest, ss, width); break;
+          case 8: interleaveRow<V, 8>(src, dest, ss, width); break;
+          default: copyRowStrided(src, dest, sstrides, dstrides, width, samples); break;
+          }
+      }
+    else
+      {
+        copyRowStrided(src, dest, sstrides, dstrides, width, samples);
+      }
+  }
+
+  // Advance to the next row, incrementing all dimensions other than
+  // X and subchannel; returns false after the last row.
+  bool
+  nextRow(PixelBufferBase::indices_type&   idx,
+          const PixelBufferBase::size_type *shape)
+  {
+    for (dimension_size_type d = 0; d < PixelBufferBase::dimensions; ++d)
+      {
+        if (d == ome::files::DIM_SPATIAL_X || d == ome::files::DIM_SUBCHANNEL)
+          continue;
+        if (static_cast<PixelBufferBase::size_type>(++idx[d]) < shape[d])
+          return true;
+        idx[d] = 0;
+      }
+    return false;
+  }
+
+  struct ConvertStorageOrderVisitor
+  {
+    VariantPixelBuffer& dest;
+
+    ConvertStorageOrderVisitor(VariantPixelBuffer& dest):
+      dest(dest)
+    {}
+
+    template<typename T>
+    void
+    operator()(const T& source)
+    {
+      T& destbuf = ome::compat::get<T>(dest.vbuffer());
+
+      ome::files::convertStorageOrder(*source, *destbuf);
+    }
+  };
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    template<typename T>
+    void
+    convertStorageOrder(const PixelBuffer<T>& source,
+                        PixelBuffer<T>&       dest)
+    {
+      const PixelBufferBase::size_type *shape = source.shape();
+      if (!std::equal(shape, shape + PixelBufferBase::dimensions, dest.shape()))
+        throw std::logic_error("Storage order conversion destination extents do not match the source extents");
+
+      if (!source.num_elements())
+        return;
+
+      const index_type *sstrides = source.strides();
+      const index_type *dstrides = dest.strides();
+      const dimension_size_type width = shape[DIM_SPATIAL_X];
+      const dimension_size_type samples = shape[DIM_SUBCHANNEL];
+      const RowLayout slayout = rowLayout(sstrides, samples);
+      const RowLayout dlayout = rowLayout(dstrides, samples);
+
+      const T *sorigin = source.origin();
+      T *dorigin = dest.array().origin();
+
+      PixelBufferBase::indices_type idx;
+      std::fill(idx.begin(), idx.end(), 0);
+      do
+        {
+          index_type soffset = 0;
+          index_type doffset = 0;
+          for (dimension_size_type d = 0; d < PixelBufferBase::dimensions; ++d)
+            {
+              soffset += idx[d] * sstrides[d];
+              doffset += idx[d] * dstrides[d];
+            }
+
+          copyRow(sorigin + soffset, dorigin + doffset, sstrides, dstrides,
+                  slayout, dlayout, width, samples);
+        }
+      while (nextRow(idx, shape));
+    }
+
+#define OME_FILES_STORAGEORDER_INSTANTIATE(maR, maProperty, maType)     \
+    template void                                                       \
+    convertStorageOrder(const PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& source, \
+                        PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>&       dest);
+
+    BOOST_PP_SEQ_FOR_EACH(OME_FILES_STORAGEORDER_INSTANTIATE, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_STORAGEORDER_INSTANTIATE
+
+    void
+    convertStorageOrder(const VariantPixelBuffer& source,
+                        VariantPixelBuffer&       dest)
+    {
+      if (source.pixelType() != dest.pixelType())
+        throw std::logic_error("Storage order conversion destination pixel type does not match the source pixel type");
+
+      ConvertStorageOrderVisitor v(dest);
+      ome::compat::visit(v, source.vbuffer());
+    }
+
+    void
+    convertStorageOrder(const VariantPixelBuffer&                source,
+                        VariantPixelBuffer&                      dest,
+                        ::ome::xml::model::enums::DimensionOrder order,
+                        bool                                     interleaved)
+    {
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      const VariantPixelBuffer::size_type *sshape = source.shape();
+      std::copy(sshape, sshape + PixelBufferBase::dimensions, shape.begin());
+
+      dest.setBuffer(shape, source.pixelType(),
+                     PixelBufferBase::make_storage_order(order, interleaved));
+      convertStorageOrder(source, dest);
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
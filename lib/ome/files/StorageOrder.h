@@ -0,0 +1,120 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#ifndef OME_FILES_STORAGEORDER_H
+#define OME_FILES_STORAGEORDER_H
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/DimensionOrder.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    template<typename T>
+    class PixelBuffer;
+    class VariantPixelBuffer;
+
+    /**
+     * Copy a pixel buffer into a buffer with a different storage order.
+     *
+     * The pixel values are copied in the logical order, as for
+     * assignment, but rows are converted with kernels specialised for
+     * the common storage orders.  Rows which are interleaved
+     * (subchannels varying fastest) in one buffer and planar (each
+     * subchannel stored separately) in the other are interleaved or
+     * deinterleaved with loops specialised for one to eight samples,
+     * and on x86 with vector kernels for three and four samples of
+     * 8- and 16-bit integer types.
+     * Rows with the same layout in both buffers are copied directly.
+     * Any other storage order is copied element by element.
+     * Measurements are described in the "Pixel processing
+     * performance" section of the OME Files documentation.
+     *
+     * @param source the pixel buffer to copy.
+     * @param dest the destination pixel buffer; the extents must be
+     * the same as the source, but the storage order may differ.  It
+     * must not share pixel data with the source.
+     * @throws std::logic_error if the extents differ.
+     */
+    template<typename T>
+    void
+    convertStorageOrder(const PixelBuffer<T>& source,
+                        PixelBuffer<T>&       dest);
+
+    /**
+     * Copy a pixel buffer into a buffer with a different storage order.
+     *
+     * @copydetails convertStorageOrder(const PixelBuffer<T>&,PixelBuffer<T>&)
+     * @throws std::logic_error if the pixel types differ.
+     */
+    void
+    convertStorageOrder(const VariantPixelBuffer& source,
+                        VariantPixelBuffer&       dest);
+
+    /**
+     * Copy a pixel buffer into a buffer with the specified storage order.
+     *
+     * The destination buffer will be resized to the extents of the
+     * source, with the same pixel type, and the storage order
+     * created by PixelBufferBase::make_storage_order() for @p order
+     * and @p interleaved.
+     *
+     * @param source the pixel buffer to copy.
+     * @param dest the destination pixel buffer.
+     * @param order the dimension order of the destination.
+     * @param interleaved @c true if subchannels are stored
+     * interleaved (varying fastest), or @c false if planar.
+     */
+    void
+    convertStorageOrder(const VariantPixelBuffer&                source,
+                        VariantPixelBuffer&                      dest,
+                        ::ome::xml::model::enums::DimensionOrder order,
+                        bool                                     interleaved);
+
+  }
+}
+
+#endif // OME_FILES_STORAGEORDER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,177 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <ome/files/PixelProperties.h>
+#include <ome/files/TileSizePolicy.h>
+
+namespace
+{
+
+  // Round up to a multiple of 16.
+  ome::files::dimension_size_type
+  round16(ome::files::dimension_size_type size)
+  {
+    return ((size + 15U) / 16U) * 16U;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    TileSizePolicy::TileSizePolicy(AccessPattern access):
+      access(access)
+    {
+    }
+
+    TileSizePolicy::~TileSizePolicy()
+    {
+    }
+
+    TileSizePolicy::AccessPattern
+    TileSizePolicy::getAccessPattern() const
+    {
+      return access;
+    }
+
+    void
+    TileSizePolicy::setAccessPattern(AccessPattern access)
+    {
+      this->access = access;
+    }
+
+    dimension_size_type
+    TileSizePolicy::getChunkSize(const boost::optional<std::string>& compression) const
+    {
+      // These sizes are heuristics, not measurements; no benchmark
+      // results are built in.  Use codec-benchmark, which reports
+      // the compression ratio and the time to read a region for each
+      // codec and tile size, to choose sizes for a specific system.
+      //
+      // Full plane: 64KiB (the writer's historical strip size) by
+      // default, since uncompressed data and codecs which compress
+      // small blocks independently (JPEG, WebP, JPEG 2000, and LERC,
+      // which encodes 8×8 blocks) gain little from larger chunks.
+      // Dictionary codecs compress better with more context:
+      // Deflate's window is 32KiB, so 128KiB chunks give it several
+      // windows of history; ZSTD and LZMA use much larger windows,
+      // so 512KiB chunks.  These sizes are per sample, since
+      // interleaving samples multiplies the chunk size without
+      // adding context to each sample.
+      //
+      // Random region: 32KiB for all codecs, the size of a 128×128
+      // tile of 16-bit samples.  Every codec decodes a whole chunk
+      // to read any part of it, so the chunk size bounds the data
+      // decoded outside a small region.  These sizes include all
+      // samples, since the cost of reading a region grows with the
+      // amount of data decoded.
+      //
+      // AdobeDeflate is the same codec as Deflate.
+      dimension_size_type full = 65536U;
+      const dimension_size_type region = 32768U;
+
+      if (compression)
+        {
+          const std::string& codec(*compression);
+          if (codec == "Deflate" || codec == "AdobeDeflate")
+            full = 131072U;
+          else if (codec == "ZSTD" || codec == "LZMA")
+            full = 524288U;
+        }
+
+      return access == RANDOM_REGION ? region : full;
+    }
+
+    TileSizePolicy::TileSize
+    TileSizePolicy::getTileSize(const Parameters& params) const
+    {
+      const dimension_size_type chunk = getChunkSize(params.compression);
+
+      // Full plane chunks are sized per sample; random region chunks
+      // include all samples.
+      dimension_size_type pixelbytes =
+        std::max(dimension_size_type(1U), dimension_size_type(bytesPerPixel(params.pixelType)));
+      if (access == RANDOM_REGION)
+        pixelbytes *= std::max(dimension_size_type(1U), params.samples);
+
+      TileSize size;
+
+      if (access == FULL_PLANE && params.sizeX < 2048U)
+        {
+          // Strips, for compatibility with readers which don't
+          // support tiles.  Use a multiple of 16 rows where possible
+          // to suit block-based codecs.
+          dimension_size_type rows = chunk / std::max(dimension_size_type(1U), params.sizeX * pixelbytes);
+          if (rows >= 16U)
+            rows -= rows % 16U;
+          rows = std::min(rows, params.sizeY);
+
+          size.tiled = false;
+          size.width = params.sizeX;
+          size.height = std::max(dimension_size_type(1U), rows);
+        }
+      else
+        {
+          // Square tiles of the nearest power of two to the target
+          // chunk size, but no larger than the image.
+          const double side = std::sqrt(static_cast<double>(chunk) / static_cast<double>(pixelbytes));
+          dimension_size_type edge = static_cast<dimension_size_type>
+            (std::pow(2.0, std::round(std::log2(std::max(side, 1.0)))));
+          edge = std::min(dimension_size_type(1024U), std::max(dimension_size_type(64U), edge));
+
+          size.tiled = true;
+          size.width = std::min(edge, round16(std::max(dimension_size_type(1U), params.sizeX)));
+          size.height = std::min(edge, round16(std::max(dimension_size_type(1U), params.sizeY)));
+        }
+
+      return size;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,182 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TILESIZEPOLICY_H
+#define OME_FILES_TILESIZEPOLICY_H
+
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Tile size policy.
+     *
+     * Choose the strip or tile dimensions used by a writer when no
+     * explicit tile size has been set.  The choice is made using the
+     * compression codec, pixel type, number of samples stored in
+     * each chunk, image size and the expected access pattern.
+     *
+     * The default implementation picks a target chunk size (the
+     * uncompressed size of a single strip or tile) for the codec
+     * and access pattern, and then derives strip or tile dimensions
+     * from it.  Larger chunks compress better when reading whole
+     * planes; smaller chunks reduce the amount of data decoded when
+     * reading small regions.  The chunk sizes are heuristics based
+     * upon how each codec compresses; no benchmark measurements are
+     * built in.  The codec-benchmark program in the test suite may
+     * be used to choose sizes for a specific system, and derived
+     * classes may override getChunkSize() or getTileSize() to
+     * change the policy.
+     */
+    class TileSizePolicy
+    {
+    public:
+      /// Expected access pattern when reading the image.
+      enum AccessPattern
+        {
+          FULL_PLANE,   ///< Whole planes are read.
+          RANDOM_REGION ///< Small regions are read at random.
+        };
+
+      /// Parameters used to choose a tile size.
+      struct Parameters
+      {
+        /// Compression codec name, or none if uncompressed.
+        boost::optional<std::string> compression;
+        /// Pixel type.
+        ::ome::xml::model::enums::PixelType pixelType;
+        /// Samples per pixel stored in each chunk (1 if planar).
+        dimension_size_type samples;
+        /// Image width.
+        dimension_size_type sizeX;
+        /// Image height.
+        dimension_size_type sizeY;
+      };
+
+      /// Strip or tile dimensions.
+      struct TileSize
+      {
+        /// @c true for tiles, @c false for strips.
+        bool tiled;
+        /// Tile width (image width for strips).
+        dimension_size_type width;
+        /// Tile or strip height.
+        dimension_size_type height;
+      };
+
+      /**
+       * Constructor.
+       *
+       * @param access the expected access pattern.
+       */
+      TileSizePolicy(AccessPattern access = FULL_PLANE);
+
+      /// Destructor.
+      virtual ~TileSizePolicy();
+
+      /**
+       * Get the expected access pattern.
+       *
+       * @returns the access pattern.
+       */
+      AccessPattern
+      getAccessPattern() const;
+
+      /**
+       * Set the expected access pattern.
+       *
+       * @param access the access pattern.
+       */
+      void
+      setAccessPattern(AccessPattern access);
+
+      /**
+       * Get the target chunk size.
+       *
+       * For full plane access, the size is for a single sample:
+       * the compression ratio depends upon the tile dimensions
+       * rather than the number of interleaved samples, so chunks of
+       * interleaved samples are proportionally larger.  For random
+       * region access, the size includes all samples, since the cost
+       * of reading a region grows with the amount of data decoded.
+       *
+       * @param compression the compression codec name, or none if
+       * uncompressed.
+       * @returns the uncompressed size of a strip or tile, in bytes.
+       */
+      virtual
+      dimension_size_type
+      getChunkSize(const boost::optional<std::string>& compression) const;
+
+      /**
+       * Get the strip or tile size.
+       *
+       * Tile dimensions are always multiples of 16, as required by
+       * TIFF.
+       *
+       * @param params the image parameters.
+       * @returns the strip or tile size.
+       */
+      virtual
+      TileSize
+      getTileSize(const Parameters& params) const;
+
+    private:
+      /// Expected access pattern.
+      AccessPattern access;
+    };
+
+  }
+}
+
+#endif // OME_FILES_TILESIZEPOLICY_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -71,6 +71,51 @@ namespace ome
         ENDIAN_NATIVE  ///< Native endian.
       };
 
+    /**
+     * A half-open range of dimension indices.
+     */
+    struct DimensionRange
+    {
+      /// The first index in the range.
+      dimension_size_type begin;
+      /// One past the last index in the range.
+      dimension_size_type end;
+
+      /**
+       * Default construct.
+       *
+       * By default the range is empty.
+       */
+      DimensionRange():
+        begin(0),
+        end(0)
+      {}
+
+      /**
+       * Construct from first and last indices.
+       *
+       * @param begin the first index in the range.
+       * @param end one past the last index in the range.
+       */
+      DimensionRange(dimension_size_type begin,
+                     dimension_size_type end):
+        begin(begin),
+        end(end)
+      {}
+
+      /**
+       * Get the number of indices in the range.
+       *
+       * @returns the size, or zero if the range is empty or
+       * reversed.
+       */
+      dimension_size_type
+      size() const
+      {
+        return end > begin ? end - begin : 0U;
+      }
+    };
+
   }
 }
 
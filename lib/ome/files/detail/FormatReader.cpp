@@ -35,8 +35,16 @@
  * #L%
  */
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
@@ -47,10 +55,15 @@
 
 #include <ome/compat/regex.h>
 
+#include <ome/files/Downsample.h>
+#include <ome/files/Executor.h>
 #include <ome/files/FormatTools.h>
 #include <ome/files/MetadataTools.h>
 #include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
 #include <ome/files/PixelProperties.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/StorageOrder.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/detail/FormatReader.h>
 
@@ -75,6 +88,289 @@ namespace ome
       {
         // Default thumbnail width and height.
         const dimension_size_type THUMBNAIL_DIMENSION = 128;
+
+        // Scale a region from one resolution level to another,
+        // rounding outward so that the whole region is covered.
+        PlaneRegion
+        scaleRegion(const PlaneRegion&  region,
+                    dimension_size_type fromX,
+                    dimension_size_type fromY,
+                    dimension_size_type toX,
+                    dimension_size_type toY)
+        {
+          const dimension_size_type x1 = (region.x * toX) / fromX;
+          const dimension_size_type y1 = (region.y * toY) / fromY;
+          const dimension_size_type x2 =
+            std::min(toX, ((region.x + region.w) * toX + fromX - 1U) / fromX);
+          const dimension_size_type y2 =
+            std::min(toY, ((region.y + region.h) * toY + fromY - 1U) / fromY);
+          return PlaneRegion(x1, y1, x2 > x1 ? x2 - x1 : 0U, y2 > y1 ? y2 - y1 : 0U);
+        }
+
+        // Nearest neighbour resampling of X and Y.
+        struct ResampleNearestVisitor
+        {
+          VariantPixelBuffer& dest;
+
+          explicit
+          ResampleNearestVisitor(VariantPixelBuffer& dest):
+            dest(dest)
+          {}
+
+          template<typename T>
+          void
+          operator()(std::shared_ptr<T>& src) const
+          {
+            std::shared_ptr<T>& dbuf(ome::compat::get<std::shared_ptr<T>>(dest.vbuffer()));
+
+            const typename T::size_type *sshape = src->shape();
+            const typename T::size_type *dshape = dbuf->shape();
+
+            typename T::indices_type sidx, didx;
+            std::fill(sidx.begin(), sidx.end(), 0);
+            std::fill(didx.begin(), didx.end(), 0);
+
+            for (dimension_size_type s = 0U; s < dshape[DIM_SUBCHANNEL]; ++s)
+              for (dimension_size_type y = 0U; y < dshape[DIM_SPATIAL_Y]; ++y)
+                for (dimension_size_type x = 0U; x < dshape[DIM_SPATIAL_X]; ++x)
+                  {
+                    sidx[DIM_SPATIAL_X] = (x * sshape[DIM_SPATIAL_X]) / dshape[DIM_SPATIAL_X];
+                    sidx[DIM_SPATIAL_Y] = (y * sshape[DIM_SPATIAL_Y]) / dshape[DIM_SPATIAL_Y];
+                    sidx[DIM_SUBCHANNEL] = didx[DIM_SUBCHANNEL] = s;
+                    didx[DIM_SPATIAL_X] = x;
+                    didx[DIM_SPATIAL_Y] = y;
+                    dbuf->at(didx) = src->at(sidx);
+                  }
+          }
+        };
+
+        void
+        resampleNearest(VariantPixelBuffer& source,
+                        VariantPixelBuffer& dest,
+                        dimension_size_type sizeX,
+                        dimension_size_type sizeY)
+        {
+          std::array<VariantPixelBuffer::size_type, 9> shape;
+          const VariantPixelBuffer::size_type *sshape = source.shape();
+          std::copy(sshape, sshape + PixelBufferBase::dimensions, shape.begin());
+          shape[DIM_SPATIAL_X] = sizeX;
+          shape[DIM_SPATIAL_Y] = sizeY;
+          dest.setBuffer(shape, source.pixelType(), source.storage_order());
+
+          ResampleNearestVisitor v(dest);
+          ome::compat::visit(v, source.vbuffer());
+        }
+
+        // Make a buffer referencing a plane within a block.
+        struct PlaneViewVisitor
+        {
+          VariantPixelBuffer&                          view;
+          const VariantPixelBuffer::indices_type&      origin;
+          const std::array<VariantPixelBuffer::size_type, 9>& shape;
+          const PixelBufferBase::storage_order_type&   order;
+
+          PlaneViewVisitor(VariantPixelBuffer&                                 view,
+                           const VariantPixelBuffer::indices_type&             origin,
+                           const std::array<VariantPixelBuffer::size_type, 9>& shape,
+                           const PixelBufferBase::storage_order_type&          order):
+            view(view),
+            origin(origin),
+            shape(shape),
+            order(order)
+          {}
+
+          template<typename T>
+          void
+          operator()(std::shared_ptr<T>& block) const
+          {
+            view.vbuffer() = std::make_shared<T>(&block->at(origin), shape,
+                                                 block->pixelType(), block->endianType(),
+                                                 order);
+          }
+        };
+
+        // Make a buffer referencing caller-owned memory, of the
+        // pixel type of the visited buffer.
+        struct ExternalViewVisitor
+        {
+          VariantPixelBuffer&                                 view;
+          void                                               *data;
+          const std::array<VariantPixelBuffer::size_type, 9>& shape;
+          const PixelBufferBase::storage_order_type&          order;
+
+          ExternalViewVisitor(VariantPixelBuffer&                                 view,
+                              void                                               *data,
+                              const std::array<VariantPixelBuffer::size_type, 9>& shape,
+                              const PixelBufferBase::storage_order_type&          order):
+            view(view),
+            data(data),
+            shape(shape),
+            order(order)
+          {}
+
+          template<typename T>
+          void
+          operator()(std::shared_ptr<T>& typed) const
+          {
+            view.vbuffer() = std::make_shared<T>(static_cast<typename T::value_type *>(data), shape,
+                                                 typed->pixelType(), ENDIAN_NATIVE, order);
+          }
+        };
+
+        // Copy pixel data into caller-owned memory with strides.
+        struct CopyStridedVisitor
+        {
+          uint8_t             *dest;
+          dimension_size_type  rowStride;
+          dimension_size_type  sampleStride;
+          dimension_size_type  pixelStride;
+
+          CopyStridedVisitor(uint8_t             *dest,
+                             dimension_size_type  rowStride,
+                             dimension_size_type  sampleStride,
+                             dimension_size_type  pixelStride):
+            dest(dest),
+            rowStride(rowStride),
+            sampleStride(sampleStride),
+            pixelStride(pixelStride)
+          {}
+
+          template<typename T>
+          void
+          operator()(std::shared_ptr<T>& src) const
+          {
+            typedef typename T::value_type value_type;
+
+            const typename T::size_type *shape = src->shape();
+            const auto xstride = src->array().strides()[DIM_SPATIAL_X];
+
+            typename T::indices_type idx;
+            std::fill(idx.begin(), idx.end(), 0);
+
+            for (dimension_size_type s = 0U; s < shape[DIM_SUBCHANNEL]; ++s)
+              for (dimension_size_type y = 0U; y < shape[DIM_SPATIAL_Y]; ++y)
+                {
+                  idx[DIM_SUBCHANNEL] = static_cast<typename T::indices_type::value_type>(s);
+                  idx[DIM_SPATIAL_Y] = static_cast<typename T::indices_type::value_type>(y);
+                  const value_type *in = &src->at(idx);
+                  uint8_t *out = dest + (y * rowStride) + (s * sampleStride);
+                  for (dimension_size_type x = 0U; x < shape[DIM_SPATIAL_X]; ++x)
+                    std::memcpy(out + (x * pixelStride), in + (x * xstride), sizeof(value_type));
+                }
+          }
+        };
+
+        // Find the minimum and maximum finite values of floating
+        // point pixel data, over one or more buffers.
+        struct FiniteRangeVisitor
+        {
+          double min;
+          double max;
+
+          FiniteRangeVisitor():
+            min(std::numeric_limits<double>::infinity()),
+            max(-std::numeric_limits<double>::infinity())
+          {}
+
+          template<typename T>
+          void
+          operator()(const std::shared_ptr<T>& /* buf */)
+          {
+          }
+
+          template<typename T>
+          void
+          range(const PixelBuffer<T>& buf)
+          {
+            T lo = std::numeric_limits<T>::infinity();
+            T hi = -std::numeric_limits<T>::infinity();
+            const T *data = buf.data();
+            for (dimension_size_type i = 0; i < buf.num_elements(); ++i)
+              {
+                const T v = data[i];
+                if (std::isfinite(v))
+                  {
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                  }
+              }
+            min = std::min(min, static_cast<double>(lo));
+            max = std::max(max, static_cast<double>(hi));
+          }
+
+          void
+          operator()(const std::shared_ptr<PixelBuffer<float>>& buf)
+          {
+            range(*buf);
+          }
+
+          void
+          operator()(const std::shared_ptr<PixelBuffer<double>>& buf)
+          {
+            range(*buf);
+          }
+        };
+
+        // Planes of a block read shared between threads.
+        struct BlockRead
+        {
+          // Read a plane; only called while the caller is waiting.
+          std::function<void (dimension_size_type)> read;
+          // Number of planes.
+          dimension_size_type count;
+          // Next plane to read.
+          dimension_size_type next;
+          // Number of planes being read.
+          dimension_size_type active;
+          // First exception thrown by a read.
+          std::exception_ptr error;
+          std::mutex mutex;
+          std::condition_variable idle;
+
+          BlockRead(std::function<void (dimension_size_type)> read,
+                    dimension_size_type                       count):
+            read(read),
+            count(count),
+            next(0U),
+            active(0U),
+            error(),
+            mutex(),
+            idle()
+          {}
+        };
+
+        // Read planes of a block until none remain.
+        void
+        readBlockPlanes(const std::shared_ptr<BlockRead>& state)
+        {
+          while (true)
+            {
+              dimension_size_type index;
+              {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->next >= state->count || state->error)
+                  return;
+                index = state->next++;
+                ++state->active;
+              }
+
+              std::exception_ptr error;
+              try
+                {
+                  state->read(index);
+                }
+              catch (...)
+                {
+                  error = std::current_exception();
+                }
+
+              std::lock_guard<std::mutex> lock(state->mutex);
+              if (error && !state->error)
+                state->error = error;
+              --state->active;
+              state->idle.notify_all();
+            }
+        }
       }
 
       FormatReader::FormatReader(const ReaderProperties& readerProperties):
@@ -99,13 +395,26 @@ namespace ome
         group(true),
         domains(),
         metadataStore(std::make_shared<DummyMetadata>()),
-        metadataOptions()
+        metadataOptions(),
+        stateMutex(),
+        normalizationRanges(),
+        normalizationMutex(),
+        executor(),
+        readQueue([this](dimension_size_type series,
+                         dimension_size_type resolution,
+                         dimension_size_type plane,
+                         const PlaneRegion&  region,
+                         VariantPixelBuffer& buf)
+                  {
+                    openBytes(series, resolution, plane, region, buf);
+                  })
       {
         assertId(currentId, false);
       }
 
       FormatReader::~FormatReader()
       {
+        readQueue.wait();
       }
 
       const std::string&
@@ -467,6 +776,44 @@ namespace ome
         return isStreamThisTypeImpl(stream);
       }
 
+      std::shared_ptr<::ome::files::FormatReader>
+      FormatReader::clone() const
+      {
+        throw std::logic_error("Cloning is not supported by this reader");
+      }
+
+      void
+      FormatReader::cloneState(const FormatReader& source)
+      {
+        currentId = source.currentId;
+        in.reset();
+        metadata = source.metadata;
+        coreIndex = 0;
+        series = 0;
+        plane = 0;
+        core = source.core;
+        resolution = 0;
+        flattenedResolutions = source.flattenedResolutions;
+        suffixNecessary = source.suffixNecessary;
+        suffixSufficient = source.suffixSufficient;
+        companionFiles = source.companionFiles;
+        datasetDescription = source.datasetDescription;
+        normalizeData = source.normalizeData;
+        filterMetadata = source.filterMetadata;
+        saveOriginalMetadata = source.saveOriginalMetadata;
+        indexedAsRGB = source.indexedAsRGB;
+        group = source.group;
+        domains = source.domains;
+        metadataStore = source.metadataStore;
+        metadataOptions = source.metadataOptions;
+        executor = source.executor;
+
+        // The normalization ranges are properties of the file, so
+        // are valid for the clone.
+        std::lock_guard<std::mutex> lock(source.normalizationMutex);
+        normalizationRanges = source.normalizationRanges;
+      }
+
       bool
       FormatReader::isFilenameThisTypeImpl(const boost::filesystem::path& /* name */) const
       {
@@ -741,23 +1088,738 @@ namespace ome
       {
         setPlane(plane);
         openBytesImpl(plane, buf, x, y, w, h);
+        normalizeBytes(buf, getCoreIndex(), plane);
       }
 
       void
-      FormatReader::openThumbBytes(dimension_size_type /* plane */,
-                                   VariantPixelBuffer& /* buf */) const
+      FormatReader::openBytes(dimension_size_type plane,
+                              VariantPixelBuffer& buf,
+                              dimension_size_type x,
+                              dimension_size_type y,
+                              dimension_size_type w,
+                              dimension_size_type h,
+                              dimension_size_type stepX,
+                              dimension_size_type stepY) const
+      {
+        if (stepX == 0U || stepY == 0U)
+          throw std::logic_error("Invalid zero step for sampled read");
+
+        setPlane(plane);
+        if (stepX == 1U && stepY == 1U)
+          openBytesImpl(plane, buf, x, y, w, h);
+        else
+          openSampledBytesImpl(plane, buf, x, y, w, h, stepX, stepY);
+        normalizeBytes(buf, getCoreIndex(), plane);
+      }
+
+      void
+      FormatReader::openBytes(dimension_size_type series,
+                              dimension_size_type resolution,
+                              dimension_size_type plane,
+                              const PlaneRegion&  region,
+                              VariantPixelBuffer& buf) const
+      {
+        assertId(currentId, true);
+
+        const dimension_size_type index = readCoreIndex(series, resolution);
+        const CoreMetadata& meta(getCoreMetadata(index));
+        if (plane >= meta.imageCount)
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        if (region.valid())
+          openIndexBytesImpl(index, plane, buf, region.x, region.y, region.w, region.h);
+        else
+          openIndexBytesImpl(index, plane, buf, 0U, 0U, meta.sizeX, meta.sizeY);
+        normalizeBytes(buf, index, plane);
+      }
+
+      dimension_size_type
+      FormatReader::readCoreIndex(dimension_size_type series,
+                                  dimension_size_type resolution) const
+      {
+        const dimension_size_type seriesIndex = seriesToCoreIndex(series);
+        const dimension_size_type resolutionCount =
+          hasFlattenedResolutions() ? 1U : getCoreMetadata(seriesIndex).resolutionCount;
+        if (resolution >= resolutionCount)
+          {
+            boost::format fmt("Invalid resolution: %1%");
+            fmt % resolution;
+            throw std::logic_error(fmt.str());
+          }
+
+        return seriesIndex + resolution;
+      }
+
+      void
+      FormatReader::openBytes(const DimensionRange& zRange,
+                              const DimensionRange& tRange,
+                              const DimensionRange& cRange,
+                              const PlaneRegion&    region,
+                              VariantPixelBuffer&   buf) const
+      {
+        assertId(currentId, true);
+
+        openBytes(getSeries(), getResolution(), zRange, tRange, cRange, region, buf);
+      }
+
+      void
+      FormatReader::openBytes(dimension_size_type   series,
+                              dimension_size_type   resolution,
+                              const DimensionRange& zRange,
+                              const DimensionRange& tRange,
+                              const DimensionRange& cRange,
+                              const PlaneRegion&    region,
+                              VariantPixelBuffer&   buf) const
+      {
+        assertId(currentId, true);
+
+        // The core metadata is used rather than the current series,
+        // which another thread may change.
+        const dimension_size_type index = readCoreIndex(series, resolution);
+        const CoreMetadata& meta(getCoreMetadata(index));
+
+        const std::array<const DimensionRange *, 3> ranges{{&zRange, &tRange, &cRange}};
+        const std::array<dimension_size_type, 3> sizes{{meta.sizeZ, meta.sizeT, meta.sizeC.size()}};
+        const std::array<const char *, 3> names{{"Z", "T", "C"}};
+        for (dimension_size_type i = 0; i < ranges.size(); ++i)
+          {
+            if (!ranges[i]->size() || ranges[i]->end > sizes[i])
+              {
+                boost::format fmt("Invalid %1% range: [%2%,%3%)");
+                fmt % names[i] % ranges[i]->begin % ranges[i]->end;
+                throw std::logic_error(fmt.str());
+              }
+          }
+
+        const dimension_size_type samples = meta.sizeC.at(cRange.begin);
+        for (dimension_size_type c = cRange.begin; c < cRange.end; ++c)
+          {
+            if (meta.sizeC.at(c) != samples)
+              throw std::logic_error("Channels in block have different numbers of subchannels");
+          }
+
+        const PlaneRegion plane(region.valid() ? region : PlaneRegion(0U, 0U, meta.sizeX, meta.sizeY));
+
+        std::array<VariantPixelBuffer::size_type, 9> shape, planeShape;
+        shape[DIM_SPATIAL_X] = plane.w;
+        shape[DIM_SPATIAL_Y] = plane.h;
+        shape[DIM_SUBCHANNEL] = samples;
+        shape[DIM_SPATIAL_Z] = zRange.size();
+        shape[DIM_TEMPORAL_T] = tRange.size();
+        shape[DIM_CHANNEL] = cRange.size();
+        shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1U;
+
+        planeShape = shape;
+        planeShape[DIM_SPATIAL_Z] = planeShape[DIM_TEMPORAL_T] = planeShape[DIM_CHANNEL] = 1U;
+
+        // Z, T and C vary more slowly than X, Y and subchannel in
+        // any storage order, so each plane is contiguous within the
+        // block.
+        const PixelBufferBase::storage_order_type order
+          (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                               meta.interleaved));
+
+        const VariantPixelBuffer::size_type *bufShape = buf.shape();
+        if (buf.pixelType() != meta.pixelType ||
+            !std::equal(shape.begin(), shape.end(), bufShape) ||
+            !(buf.storage_order() == order))
+          buf.setBuffer(shape, meta.pixelType, order);
+
+        const dimension_size_type count = shape[DIM_SPATIAL_Z] * shape[DIM_TEMPORAL_T] * shape[DIM_CHANNEL];
+
+        // Plane indices are found here, so that the helpers do not
+        // use the reader state.
+        std::vector<dimension_size_type> planes;
+        planes.reserve(count);
+        for (dimension_size_type i = 0; i < count; ++i)
+          planes.push_back(ome::files::getIndex(meta.dimensionOrder,
+                                                meta.sizeZ, meta.sizeC.size(), meta.sizeT,
+                                                meta.imageCount,
+                                                zRange.begin + i % zRange.size(),
+                                                cRange.begin + i / (zRange.size() * tRange.size()),
+                                                tRange.begin + (i / zRange.size()) % tRange.size()));
+
+        auto read = [&](dimension_size_type i)
+          {
+            const dimension_size_type z = zRange.begin + i % zRange.size();
+            const dimension_size_type t = tRange.begin + (i / zRange.size()) % tRange.size();
+            const dimension_size_type c = cRange.begin + i / (zRange.size() * tRange.size());
+
+            VariantPixelBuffer::indices_type origin;
+            std::fill(origin.begin(), origin.end(), 0);
+            origin[DIM_SPATIAL_Z] = static_cast<VariantPixelBuffer::indices_type::value_type>(z - zRange.begin);
+            origin[DIM_TEMPORAL_T] = static_cast<VariantPixelBuffer::indices_type::value_type>(t - tRange.begin);
+            origin[DIM_CHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(c - cRange.begin);
+
+            VariantPixelBuffer view;
+            PlaneViewVisitor v(view, origin, planeShape, order);
+            ome::compat::visit(v, buf.vbuffer());
+            const VariantPixelBuffer::raw_type *slot = view.data();
+
+            const dimension_size_type p = planes[i];
+            openIndexBytesImpl(index, p, view, plane.x, plane.y, plane.w, plane.h);
+            normalizeBytes(view, index, p);
+
+            // The reader replaced the view if it was unable to
+            // decode into it directly.
+            if (view.data() != slot)
+              {
+                const VariantPixelBuffer::size_type *viewShape = view.shape();
+                if (view.pixelType() != buf.pixelType() ||
+                    !std::equal(planeShape.begin(), planeShape.end(), viewShape))
+                  throw std::logic_error("Plane pixel type or shape does not match block");
+
+                VariantPixelBuffer dest;
+                PlaneViewVisitor dv(dest, origin, planeShape, order);
+                ome::compat::visit(dv, buf.vbuffer());
+                convertStorageOrder(view, dest);
+              }
+          };
+
+        std::shared_ptr<BlockRead> state(std::make_shared<BlockRead>(read, count));
+
+        // Helpers run on the executor; the calling thread reads any
+        // planes they have not started, so the read completes even
+        // if the executor is busy.  Readers which serialise decoding
+        // (the TIFF readers) only overlap the work outside the
+        // decoder.
+        const dimension_size_type helpers =
+          std::min(count - 1U, static_cast<dimension_size_type>(std::thread::hardware_concurrency()));
+        if (helpers)
+          {
+            std::shared_ptr<Executor> executor(getExecutor());
+            for (dimension_size_type i = 0; i < helpers; ++i)
+              executor->execute([state]() { readBlockPlanes(state); });
+          }
+
+        readBlockPlanes(state);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->idle.wait(lock, [&state]() { return state->active == 0U; });
+        if (state->error)
+          std::rethrow_exception(state->error);
+      }
+
+      void
+      FormatReader::openBytes(dimension_size_type                 plane,
+                              const PlaneRegion&                  region,
+                              void                               *dest,
+                              dimension_size_type                 rowStride,
+                              dimension_size_type                 sampleStride,
+                              ::ome::xml::model::enums::PixelType pixelType) const
+      {
+        assertId(currentId, true);
+
+        if (pixelType != getPixelType())
+          {
+            boost::format fmt("Destination pixel type %1% does not match pixel type %2%");
+            fmt % pixelType % getPixelType();
+            throw std::logic_error(fmt.str());
+          }
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        const PlaneRegion r(region.valid() ? region : PlaneRegion(0U, 0U, getSizeX(), getSizeY()));
+        if (r.x + r.w > getSizeX() || r.y + r.h > getSizeY())
+          {
+            boost::format fmt("Invalid region: %1%");
+            fmt % r;
+            throw std::logic_error(fmt.str());
+          }
+
+        if (!dest)
+          throw std::logic_error("Null destination");
+
+        const dimension_size_type channel = getZCTCoords(plane)[1];
+        const dimension_size_type samples = getRGBChannelCount(channel);
+        const dimension_size_type bpp = bytesPerPixel(pixelType);
+        const bool interleaved = samples == 1U ? isInterleaved() : sampleStride == bpp;
+        const dimension_size_type pixelStride = interleaved ? bpp * samples : bpp;
+
+        if (rowStride < r.w * pixelStride ||
+            (!interleaved && samples > 1U && sampleStride < rowStride * r.h))
+          {
+            boost::format fmt("Row stride %1% or sample stride %2% too small for region %3%");
+            fmt % rowStride % sampleStride % r;
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type index = getCoreIndex();
+
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        shape[DIM_SPATIAL_X] = r.w;
+        shape[DIM_SPATIAL_Y] = r.h;
+        shape[DIM_SUBCHANNEL] = samples;
+        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1U;
+
+        // Check a buffer returned by the reader can be copied to dest.
+        auto check = [&](const VariantPixelBuffer& buf, dimension_size_type h)
+          {
+            const VariantPixelBuffer::size_type *bshape = buf.shape();
+            if (buf.pixelType() != pixelType ||
+                bshape[DIM_SPATIAL_X] != r.w ||
+                bshape[DIM_SPATIAL_Y] != h ||
+                bshape[DIM_SUBCHANNEL] != samples)
+              throw std::logic_error("Plane pixel type or shape does not match destination");
+          };
+
+        if (rowStride == r.w * pixelStride &&
+            (interleaved || samples == 1U || sampleStride == rowStride * r.h))
+          {
+            // The memory has no padding, so wrap it in a pixel buffer
+            // and decode into it directly.
+            const PixelBufferBase::storage_order_type order
+              (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                   interleaved));
+            std::array<VariantPixelBuffer::size_type, 9> unit;
+            std::fill(unit.begin(), unit.end(), 1U);
+            VariantPixelBuffer typed(unit, pixelType);
+
+            VariantPixelBuffer view;
+            ExternalViewVisitor v(view, dest, shape, order);
+            ome::compat::visit(v, typed.vbuffer());
+
+            openIndexBytesImpl(index, plane, view, r.x, r.y, r.w, r.h);
+            normalizeBytes(view, index, plane);
+
+            // The reader replaced the view if it was unable to decode
+            // into it directly.
+            if (view.data() != static_cast<const VariantPixelBuffer::raw_type *>(dest))
+              {
+                check(view, r.h);
+                CopyStridedVisitor cv(static_cast<uint8_t *>(dest), rowStride, sampleStride, pixelStride);
+                ome::compat::visit(cv, view.vbuffer());
+              }
+          }
+        else
+          {
+            // Read in bands of the optimal height, to bound the
+            // temporary memory used, and copy each band into place.
+            const dimension_size_type bandHeight =
+              std::max(dimension_size_type(1U), std::min(getOptimalTileHeight(channel), r.h));
+
+            VariantPixelBuffer band;
+            for (dimension_size_type by = 0; by < r.h; by += bandHeight)
+              {
+                const dimension_size_type bh = std::min(bandHeight, r.h - by);
+                openIndexBytesImpl(index, plane, band, r.x, r.y + by, r.w, bh);
+                normalizeBytes(band, index, plane);
+                check(band, bh);
+
+                CopyStridedVisitor cv(static_cast<uint8_t *>(dest) + (by * rowStride),
+                                      rowStride, sampleStride, pixelStride);
+                ome::compat::visit(cv, band.vbuffer());
+              }
+          }
+      }
+
+      std::future<std::shared_ptr<VariantPixelBuffer>>
+      FormatReader::openBytesAsync(dimension_size_type plane,
+                                   const PlaneRegion&  region) const
+      {
+        assertId(currentId, true);
+
+        return openBytesAsync(getSeries(), getResolution(), plane, region);
+      }
+
+      std::future<std::shared_ptr<VariantPixelBuffer>>
+      FormatReader::openBytesAsync(dimension_size_type series,
+                                   dimension_size_type resolution,
+                                   dimension_size_type plane,
+                                   const PlaneRegion&  region) const
+      {
+        assertId(currentId, true);
+
+        return readQueue.submit(*getExecutor(), series, resolution, plane, region);
+      }
+
+      void
+      FormatReader::setExecutor(std::shared_ptr<Executor> executor)
+      {
+        this->executor = executor;
+      }
+
+      std::shared_ptr<Executor>
+      FormatReader::getExecutor() const
+      {
+        return executor ? executor : getDefaultExecutor();
+      }
+
+      void
+      FormatReader::openIndexBytesImpl(dimension_size_type coreIndex,
+                                       dimension_size_type plane,
+                                       VariantPixelBuffer& buf,
+                                       dimension_size_type x,
+                                       dimension_size_type y,
+                                       dimension_size_type w,
+                                       dimension_size_type h) const
+      {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        const dimension_size_type currentIndex = getCoreIndex();
+        const dimension_size_type currentPlane = getPlane();
+
+        try
+          {
+            setCoreIndex(coreIndex);
+            setPlane(plane);
+            openBytesImpl(plane, buf, x, y, w, h);
+          }
+        catch (...)
+          {
+            setCoreIndex(currentIndex);
+            setPlane(currentPlane);
+            throw;
+          }
+        setCoreIndex(currentIndex);
+        setPlane(currentPlane);
+      }
+
+      void
+      FormatReader::openSampledBytesImpl(dimension_size_type plane,
+                                         VariantPixelBuffer& buf,
+                                         dimension_size_type x,
+                                         dimension_size_type y,
+                                         dimension_size_type w,
+                                         dimension_size_type h,
+                                         dimension_size_type stepX,
+                                         dimension_size_type stepY) const
+      {
+        VariantPixelBuffer region;
+        openBytesImpl(plane, region, x, y, w, h);
+        downsample(region, buf, stepX, stepY, DOWNSAMPLE_NEAREST);
+      }
+
+      std::pair<double, double>
+      FormatReader::getNormalizationRange(dimension_size_type coreIndex,
+                                          dimension_size_type plane) const
+      {
+        const std::pair<dimension_size_type, dimension_size_type> key(coreIndex, plane);
+        {
+          std::lock_guard<std::mutex> lock(normalizationMutex);
+          auto found = normalizationRanges.find(key);
+          if (found != normalizationRanges.end())
+            return found->second;
+        }
+
+        std::pair<double, double> range;
+        if (!getRecordedRange(coreIndex, plane, range))
+          {
+            // Read through the core index, in bands of at most 1 MiB
+            // (as for the default optimal tile height), so that the
+            // whole plane is not held in memory and the current
+            // series and plane are not used or changed.
+            const CoreMetadata& meta(getCoreMetadata(coreIndex));
+            const dimension_size_type samples = meta.sizeC.empty() ? 1U :
+              *std::max_element(meta.sizeC.begin(), meta.sizeC.end());
+            const dimension_size_type rowBytes =
+              std::max(dimension_size_type(1U), meta.sizeX * samples * bytesPerPixel(meta.pixelType));
+            const dimension_size_type bandHeight =
+              std::max(dimension_size_type(1U),
+                       std::min((1024U * 1024U) / rowBytes, meta.sizeY));
+
+            FiniteRangeVisitor v;
+            VariantPixelBuffer band;
+            for (dimension_size_type y = 0; y < meta.sizeY; y += bandHeight)
+              {
+                openIndexBytesImpl(coreIndex, plane, band, 0U, y, meta.sizeX,
+                                   std::min(bandHeight, meta.sizeY - y));
+                ome::compat::visit(v, band.vbuffer());
+              }
+
+            range = std::make_pair(v.min, v.max);
+          }
+
+        std::lock_guard<std::mutex> lock(normalizationMutex);
+        normalizationRanges[key] = range;
+        return range;
+      }
+
+      bool
+      FormatReader::getRecordedRange(dimension_size_type        /* coreIndex */,
+                                     dimension_size_type        /* plane */,
+                                     std::pair<double, double>& /* range */) const
+      {
+        return false;
+      }
+
+      void
+      FormatReader::normalizeBytes(VariantPixelBuffer& buf,
+                                   dimension_size_type coreIndex,
+                                   dimension_size_type plane) const
+      {
+        if (!normalizeData)
+          return;
+
+        const ome::xml::model::enums::PixelType type(buf.pixelType());
+        if (type != ome::xml::model::enums::PixelType::FLOAT &&
+            type != ome::xml::model::enums::PixelType::DOUBLE)
+          return;
+
+        const std::pair<double, double> range(getNormalizationRange(coreIndex, plane));
+        if (!(range.second > range.first))
+          return;
+
+        const double scale = 1.0 / (range.second - range.first);
+        convertPixelType(buf, buf, type, scale, -range.first * scale, false);
+      }
+
+      template<typename T>
+      void
+      FormatReader::readTypedBytes(dimension_size_type plane,
+                                   const PlaneRegion&  region,
+                                   PixelBuffer<T>&     buf) const
+      {
+        assertId(currentId, true);
+
+        if (buf.pixelType() != getPixelType())
+          {
+            boost::format fmt("Destination pixel type %1% does not match pixel type %2%");
+            fmt % buf.pixelType() % getPixelType();
+            throw std::logic_error(fmt.str());
+          }
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        const PlaneRegion r(region.valid() ? region : PlaneRegion(0U, 0U, getSizeX(), getSizeY()));
+        if (r.x + r.w > getSizeX() || r.y + r.h > getSizeY())
+          {
+            boost::format fmt("Invalid region: %1%");
+            fmt % r;
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type samples = getRGBChannelCount(getZCTCoords(plane)[1]);
+        const PixelBufferBase::size_type *shape = buf.shape();
+        for (dimension_size_type d = 0; d < PixelBufferBase::dimensions; ++d)
+          {
+            const dimension_size_type expected = d == DIM_SPATIAL_X ? r.w :
+              d == DIM_SPATIAL_Y ? r.h : d == DIM_SUBCHANNEL ? samples : 1U;
+            if (shape[d] != expected)
+              throw std::logic_error("Pixel buffer extents do not match region");
+          }
+
+        const dimension_size_type index = getCoreIndex();
+        openTypedIndexBytesImpl(index, plane, buf, r.x, r.y, r.w, r.h);
+
+        if (normalizeData)
+          {
+            // Refer to the caller's buffer without taking ownership.
+            std::shared_ptr<PixelBuffer<T>> ref(std::shared_ptr<PixelBuffer<T>>(), &buf);
+            VariantPixelBuffer view(ref);
+            normalizeBytes(view, index, plane);
+          }
+      }
+
+      template<typename T>
+      void
+      FormatReader::readTypedIndexBytes(dimension_size_type coreIndex,
+                                        dimension_size_type plane,
+                                        PixelBuffer<T>&     buf,
+                                        dimension_size_type x,
+                                        dimension_size_type y,
+                                        dimension_size_type w,
+                                        dimension_size_type h) const
+      {
+        std::shared_ptr<PixelBuffer<T>> ref(std::shared_ptr<PixelBuffer<T>>(), &buf);
+        VariantPixelBuffer view(ref);
+
+        openIndexBytesImpl(coreIndex, plane, view, x, y, w, h);
+
+        // The reader replaced the view if it was unable to decode
+        // into it directly.
+        if (static_cast<const void *>(view.data()) != static_cast<const void *>(buf.data()))
+          {
+            const VariantPixelBuffer::size_type *vshape = view.shape();
+            if (view.pixelType() != buf.pixelType() ||
+                !std::equal(vshape, vshape + PixelBufferBase::dimensions, buf.shape()))
+              throw std::logic_error("Plane pixel type or shape does not match destination");
+
+            VariantPixelBuffer dest(ref);
+            convertStorageOrder(view, dest);
+          }
+      }
+
+#define OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL(maR, maProperty, maType) \
+      void                                                              \
+      FormatReader::openTypedBytesImpl(dimension_size_type plane,       \
+                                       const PlaneRegion&  region,      \
+                                       PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf) const \
+      {                                                                 \
+        readTypedBytes(plane, region, buf);                             \
+      }                                                                 \
+                                                                        \
+      void                                                              \
+      FormatReader::openTypedIndexBytesImpl(dimension_size_type coreIndex, \
+                                            dimension_size_type plane,  \
+                                            PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                            dimension_size_type x,      \
+                                            dimension_size_type y,      \
+                                            dimension_size_type w,      \
+                                            dimension_size_type h) const \
+      {                                                                 \
+        readTypedIndexBytes(coreIndex, plane, buf, x, y, w, h);         \
+      }
+
+      BOOST_PP_SEQ_FOR_EACH(OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL
+
+      void
+      FormatReader::openRegionAtScale(dimension_size_type plane,
+                                      VariantPixelBuffer& buf,
+                                      dimension_size_type x,
+                                      dimension_size_type y,
+                                      dimension_size_type w,
+                                      dimension_size_type h,
+                                      dimension_size_type sizeX,
+                                      dimension_size_type sizeY) const
       {
         assertId(currentId, true);
-        /**
-         * @todo Implement openThumbBytes.  This requires implementing
-         * image rescaling/resampling.
-         */
-        throw std::runtime_error("Thumbnail rescaling is not currently implemented");
+
+        if (!w || !h || !sizeX || !sizeY)
+          throw std::logic_error("Invalid zero size for scaled region read");
+
+        const dimension_size_type currentIndex = getCoreIndex();
+        const dimension_size_type currentPlane = getPlane();
+        const dimension_size_type fullX = getSizeX();
+        const dimension_size_type fullY = getSizeY();
+
+        // Find the core entries holding the resolution levels of the
+        // current image.  The core layout is the same whether or not
+        // resolutions are flattened: the full resolution entry is
+        // followed by resolutionCount - 1 reduced resolution entries,
+        // so the levels are found from the core metadata rather than
+        // getResolutionCount(), which is always 1 when flattened.
+        dimension_size_type levelEnd = currentIndex + 1U;
+        for (dimension_size_type i = 0; i < core.size();)
+          {
+            const dimension_size_type count =
+              std::max(dimension_size_type(1U), getCoreMetadata(i).resolutionCount);
+            if (currentIndex < i + count)
+              {
+                levelEnd = i + count;
+                break;
+              }
+            i += count;
+          }
+
+        // The region in the coordinates of the current resolution
+        // level.
+        PlaneRegion region(x, y, w, h);
+
+        try
+          {
+            // Use the smallest resolution level at which the region
+            // is at least as large as the destination.  Resolutions
+            // are ordered from largest to smallest.
+            dimension_size_type level = currentIndex;
+            for (dimension_size_type r = currentIndex + 1U;
+                 r < levelEnd;
+                 ++r)
+              {
+                const CoreMetadata& levelCore(getCoreMetadata(r));
+                PlaneRegion scaled(scaleRegion(region, fullX, fullY,
+                                               levelCore.sizeX, levelCore.sizeY));
+                if (scaled.w < sizeX || scaled.h < sizeY)
+                  break;
+                level = r;
+              }
+            setCoreIndex(level);
+            setPlane(plane);
+
+            if (level != currentIndex)
+              region = scaleRegion(region, fullX, fullY, getSizeX(), getSizeY());
+
+            if (region.w == sizeX && region.h == sizeY)
+              {
+                openBytesImpl(plane, buf, region.x, region.y, region.w, region.h);
+              }
+            else if (region.w >= sizeX && region.h >= sizeY)
+              {
+                const std::array<dimension_size_type, 3> coords(getZCTCoords(plane));
+                const dimension_size_type channel = coords[1];
+
+                std::array<VariantPixelBuffer::size_type, 9> shape;
+                shape[DIM_SPATIAL_X] = sizeX;
+                shape[DIM_SPATIAL_Y] = sizeY;
+                shape[DIM_SUBCHANNEL] = getRGBChannelCount(channel);
+                shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+                  shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+                PixelBufferBase::storage_order_type order
+                  (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                       isInterleaved(channel)));
+
+                buf.setBuffer(shape, getPixelType(), order);
+
+                // Read bands of the optimal tile height so that only
+                // one band is held in memory at once.
+                const dimension_size_type bandHeight =
+                  std::max(dimension_size_type(1U),
+                           std::min(getOptimalTileHeight(channel), region.h));
+
+                AreaAverage average(region.w, region.h, buf);
+                VariantPixelBuffer band;
+                for (dimension_size_type by = 0; by < region.h; by += bandHeight)
+                  {
+                    const dimension_size_type bh = std::min(bandHeight, region.h - by);
+                    openBytesImpl(plane, band, region.x, region.y + by, region.w, bh);
+                    average.add(band, by);
+                  }
+                average.finish();
+              }
+            else
+              {
+                VariantPixelBuffer source;
+                openBytesImpl(plane, source, region.x, region.y, region.w, region.h);
+                resampleNearest(source, buf, sizeX, sizeY);
+              }
+
+            // Normalize the scaled result rather than each band,
+            // using the range of the level read.
+            normalizeBytes(buf, level, plane);
+          }
+        catch (...)
+          {
+            setCoreIndex(currentIndex);
+            setPlane(currentPlane);
+            throw;
+          }
+        setCoreIndex(currentIndex);
+        setPlane(currentPlane);
+      }
+
+      void
+      FormatReader::openThumbBytes(dimension_size_type plane,
+                                   VariantPixelBuffer& buf) const
+      {
+        assertId(currentId, true);
+
+        openRegionAtScale(plane, buf, 0U, 0U, getSizeX(), getSizeY(),
+                          getThumbSizeX(), getThumbSizeY());
       }
 
       void
       FormatReader::close(bool fileOnly)
       {
+        readQueue.wait();
+
         if (in)
           in = std::shared_ptr<std::istream>(); // set to null.
         if (!fileOnly)
@@ -766,6 +1828,9 @@ namespace ome
             coreIndex = series = resolution = plane = 0;
             core.clear();
           }
+
+        std::lock_guard<std::mutex> lock(normalizationMutex);
+        normalizationRanges.clear();
       }
 
       dimension_size_type
@@ -41,9 +41,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <utility>
 
 #include <ome/files/FormatReader.h>
 #include <ome/files/FormatHandler.h>
+#include <ome/files/detail/ReadQueue.h>
 
 namespace ome
 {
@@ -207,6 +210,27 @@ namespace ome
         /// Metadata parsing options.
         MetadataOptions metadataOptions;
 
+        /// Lock for reads which temporarily change the current series and plane.
+        mutable std::mutex stateMutex;
+
+        /// Finite range of each plane read with normalization, by core index and plane.
+        mutable std::map<std::pair<dimension_size_type, dimension_size_type>,
+                         std::pair<double, double>> normalizationRanges;
+
+        /// Lock for normalizationRanges.
+        mutable std::mutex normalizationMutex;
+
+        /// Executor for asynchronous reads (null to use the default executor).
+        std::shared_ptr<Executor> executor;
+
+        /**
+         * Queue of asynchronous reads.
+         *
+         * Derived readers must wait for queued reads to complete
+         * before closing their files.
+         */
+        mutable ReadQueue readQueue;
+
         /// Constructor.
         FormatReader(const ReaderProperties&);
 
@@ -398,7 +422,34 @@ namespace ome
         bool
         isThisType(std::istream& stream) const;
 
+        /**
+         * @copydoc ome::files::FormatReader::clone()
+         *
+         * The default implementation throws std::logic_error.
+         * Readers supporting cloning should override this to create
+         * a new reader, copy the parsed state with cloneState(), copy
+         * any reader-specific state, and open their own file
+         * handles.
+         */
+        std::shared_ptr<::ome::files::FormatReader>
+        clone() const;
+
       protected:
+        /**
+         * Copy the parsed state of another reader.
+         *
+         * Used by clone() implementations.  The reader options,
+         * including resolution flattening and normalization, and any
+         * cached normalization ranges are copied.  The core metadata
+         * and metadata store are shared with @p source rather than
+         * copied.  The input stream is not copied, and the current
+         * series, resolution and plane are reset to zero.
+         *
+         * @param source the reader to copy.
+         */
+        void
+        cloneState(const FormatReader& source);
+
         /**
          * isThisType file implementation for readers.
          *
@@ -570,6 +621,72 @@ namespace ome
                   dimension_size_type w,
                   dimension_size_type h) const;
 
+        // Documented in superclass.
+        void
+        openBytes(dimension_size_type plane,
+                  VariantPixelBuffer& buf,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h,
+                  dimension_size_type stepX,
+                  dimension_size_type stepY) const;
+
+        // Documented in superclass.
+        void
+        openBytes(dimension_size_type series,
+                  dimension_size_type resolution,
+                  dimension_size_type plane,
+                  const PlaneRegion&  region,
+                  VariantPixelBuffer& buf) const;
+
+        // Documented in superclass.
+        void
+        openBytes(const DimensionRange& zRange,
+                  const DimensionRange& tRange,
+                  const DimensionRange& cRange,
+                  const PlaneRegion&    region,
+                  VariantPixelBuffer&   buf) const;
+
+        // Documented in superclass.
+        void
+        openBytes(dimension_size_type   series,
+                  dimension_size_type   resolution,
+                  const DimensionRange& zRange,
+                  const DimensionRange& tRange,
+                  const DimensionRange& cRange,
+                  const PlaneRegion&    region,
+                  VariantPixelBuffer&   buf) const;
+
+        // Documented in superclass.
+        void
+        openBytes(dimension_size_type                 plane,
+                  const PlaneRegion&                  region,
+                  void                               *dest,
+                  dimension_size_type                 rowStride,
+                  dimension_size_type                 sampleStride,
+                  ::ome::xml::model::enums::PixelType pixelType) const;
+
+        // Documented in superclass.
+        std::future<std::shared_ptr<VariantPixelBuffer>>
+        openBytesAsync(dimension_size_type plane,
+                       const PlaneRegion&  region) const;
+
+        // Documented in superclass.
+        std::future<std::shared_ptr<VariantPixelBuffer>>
+        openBytesAsync(dimension_size_type series,
+                       dimension_size_type resolution,
+                       dimension_size_type plane,
+                       const PlaneRegion&  region) const;
+
+        // Documented in superclass.
+        void
+        setExecutor(std::shared_ptr<Executor> executor);
+
+        // Documented in superclass.
+        std::shared_ptr<Executor>
+        getExecutor() const;
+
       protected:
         /**
          * @copydoc ome::files::FormatReader::openBytes(dimension_size_type,VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type)const
@@ -583,7 +700,225 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const = 0;
 
+        /**
+         * @copydoc ome::files::FormatReader::openBytes(dimension_size_type,VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type)const
+         *
+         * The default implementation reads the whole sub-image with
+         * openBytesImpl() and decimates it.  Readers able to skip
+         * unsampled data should override this.
+         */
+        virtual
+        void
+        openSampledBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type stepX,
+                             dimension_size_type stepY) const;
+
+        /**
+         * Obtain a sub-image of an image plane by core index.
+         *
+         * This is used by the openBytes() method taking an explicit
+         * series and resolution, and must not use or change the
+         * current series, resolution or plane.
+         *
+         * The default implementation temporarily makes the core
+         * index and plane current and calls openBytesImpl(),
+         * holding a lock for the duration.  Readers which can locate
+         * the plane without using the reader state should override
+         * this to allow concurrent reads.
+         *
+         * @param coreIndex the core index.
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+        virtual
+        void
+        openIndexBytesImpl(dimension_size_type coreIndex,
+                           dimension_size_type plane,
+                           VariantPixelBuffer& buf,
+                           dimension_size_type x,
+                           dimension_size_type y,
+                           dimension_size_type w,
+                           dimension_size_type h) const;
+
+#define OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL(maR, maProperty, maType) \
+        void                                                            \
+        openTypedBytesImpl(dimension_size_type plane,                   \
+                           const PlaneRegion&  region,                  \
+                           PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf) const;
+
+        // Documented in superclass.
+        BOOST_PP_SEQ_FOR_EACH(OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_DETAIL_FORMATREADER_OPENTYPEDBYTESIMPL
+
+        /**
+         * Obtain a sub-image of an image plane by core index in a
+         * typed pixel buffer.
+         *
+         * This is used by openTypedBytes(), with one overload for
+         * each pixel type.  As for openIndexBytesImpl(), it must not
+         * use or change the current series, resolution or plane.
+         * The buffer has the pixel type of the series and the
+         * extents of the sub-image, and must not be reallocated.
+         *
+         * The default implementation reads into a view of the
+         * buffer with openIndexBytesImpl(), and copies the pixel
+         * data into the buffer if the reader replaced the view.
+         * Readers able to decode directly into a typed buffer
+         * should override every overload.
+         *
+         * @param coreIndex the core index.
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+#define OME_FILES_DETAIL_FORMATREADER_OPENTYPEDINDEXBYTESIMPL(maR, maProperty, maType) \
+        virtual                                                         \
+        void                                                            \
+        openTypedIndexBytesImpl(dimension_size_type coreIndex,          \
+                                dimension_size_type plane,              \
+                                PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                dimension_size_type x,                  \
+                                dimension_size_type y,                  \
+                                dimension_size_type w,                  \
+                                dimension_size_type h) const;
+
+        BOOST_PP_SEQ_FOR_EACH(OME_FILES_DETAIL_FORMATREADER_OPENTYPEDINDEXBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_DETAIL_FORMATREADER_OPENTYPEDINDEXBYTESIMPL
+
+        /**
+         * Get the finite range of a plane for normalization.
+         *
+         * The range recorded in the file is used if there is one
+         * (see getRecordedRange()).  Otherwise the minimum and
+         * maximum finite values of the whole plane are found by
+         * reading it in bands with openIndexBytesImpl(), so the
+         * current series and plane are not used or changed.  The
+         * range is cached until the reader is closed.
+         *
+         * @param coreIndex the core index.
+         * @param plane the plane index.
+         * @returns the minimum and maximum finite values; the minimum
+         * is not less than the maximum if the plane has no range.
+         */
+        std::pair<double, double>
+        getNormalizationRange(dimension_size_type coreIndex,
+                              dimension_size_type plane) const;
+
+        /**
+         * Get the range of a plane recorded in the file.
+         *
+         * Formats which record the range of the sample values of
+         * each plane may override this so that
+         * getNormalizationRange() need not read the whole plane.
+         * The default records no range.
+         *
+         * @param coreIndex the core index.
+         * @param plane the plane index.
+         * @param range the minimum and maximum finite values.
+         * @returns @c true if a range is recorded, or @c false if
+         * the plane must be read to find it.
+         */
+        virtual
+        bool
+        getRecordedRange(dimension_size_type        coreIndex,
+                         dimension_size_type        plane,
+                         std::pair<double, double>& range) const;
+
+        /**
+         * Normalize floating point pixel data.
+         *
+         * If normalization is enabled and the pixel type is @c FLOAT
+         * or @c DOUBLE, the pixel data are rescaled in place so that
+         * the minimum and maximum finite values of the whole plane
+         * (see getNormalizationRange()) become @c 0 and @c 1.  The
+         * result of normalizing a region or band is therefore the
+         * same as the corresponding part of the normalized plane.
+         * Other pixel types, and planes with no range, are unchanged.
+         *
+         * @param buf the pixel buffer to normalize.
+         * @param coreIndex the core index of the plane read.
+         * @param plane the plane index of the plane read.
+         */
+        void
+        normalizeBytes(VariantPixelBuffer& buf,
+                       dimension_size_type coreIndex,
+                       dimension_size_type plane) const;
+
+      private:
+        /**
+         * Get the core index for a read with an explicit series and
+         * resolution.
+         *
+         * @param series the series.
+         * @param resolution the resolution level within the series.
+         * @returns the core index.
+         * @throws std::logic_error if the series or resolution is
+         * invalid.
+         */
+        dimension_size_type
+        readCoreIndex(dimension_size_type series,
+                      dimension_size_type resolution) const;
+
+        /**
+         * Check a typed read and make it with openTypedIndexBytesImpl().
+         *
+         * @param plane the plane index within the series.
+         * @param region the sub-image to read.
+         * @param buf the destination pixel buffer.
+         */
+        template<typename T>
+        void
+        readTypedBytes(dimension_size_type plane,
+                       const PlaneRegion&  region,
+                       PixelBuffer<T>&     buf) const;
+
+        /**
+         * Default implementation of openTypedIndexBytesImpl().
+         *
+         * @param coreIndex the core index.
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+        template<typename T>
+        void
+        readTypedIndexBytes(dimension_size_type coreIndex,
+                            dimension_size_type plane,
+                            PixelBuffer<T>&     buf,
+                            dimension_size_type x,
+                            dimension_size_type y,
+                            dimension_size_type w,
+                            dimension_size_type h) const;
+
       public:
+        // Documented in superclass.
+        void
+        openRegionAtScale(dimension_size_type plane,
+                          VariantPixelBuffer& buf,
+                          dimension_size_type x,
+                          dimension_size_type y,
+                          dimension_size_type w,
+                          dimension_size_type h,
+                          dimension_size_type sizeX,
+                          dimension_size_type sizeY) const;
+
         // Documented in superclass.
         void
         openThumbBytes(dimension_size_type plane,
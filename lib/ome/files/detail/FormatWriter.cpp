@@ -84,11 +84,16 @@ namespace ome
         series(0),
         plane(0),
         compression(boost::none),
+        predictor(boost::none),
+        compressionLevel(boost::none),
         interleaved(boost::none),
         sequential(false),
+        sparse(false),
+        fillValue(0.0),
         framesPerSecond(0),
         tile_size_x(boost::none),
         tile_size_y(boost::none),
+        tile_size_policy(),
         metadataRetrieve(std::make_shared<DummyMetadata>())
       {
         assertId(currentId, false);
@@ -135,7 +140,11 @@ namespace ome
         series = 0;
         plane = 0;
         compression = boost::none;
+        predictor = boost::none;
+        compressionLevel = boost::none;
         sequential = false;
+        sparse = false;
+        fillValue = 0.0;
         framesPerSecond = 0;
         metadataRetrieve.reset();
       }
@@ -309,6 +318,38 @@ namespace ome
         return this->compression;
       }
 
+      void
+      FormatWriter::setPredictor(const std::string& predictor)
+      {
+        std::set<std::string>::const_iterator i = writerProperties.predictor_types.find(predictor);
+        if (i == writerProperties.predictor_types.end())
+          {
+            boost::format fmt("Invalid predictor: %1%");
+            fmt % predictor;
+            throw std::logic_error(fmt.str());
+          }
+
+        this->predictor = predictor;
+      }
+
+      const boost::optional<std::string>&
+      FormatWriter::getPredictor() const
+      {
+        return this->predictor;
+      }
+
+      void
+      FormatWriter::setCompressionLevel(int level)
+      {
+        this->compressionLevel = level;
+      }
+
+      const boost::optional<int>&
+      FormatWriter::getCompressionLevel() const
+      {
+        return this->compressionLevel;
+      }
+
       void
       FormatWriter::setInterleaved(bool interleaved)
       {
@@ -341,6 +382,44 @@ namespace ome
         return sequential;
       }
 
+      void
+      FormatWriter::setSparse(bool sparse)
+      {
+        this->sparse = sparse;
+      }
+
+      bool
+      FormatWriter::getSparse() const
+      {
+        return sparse;
+      }
+
+      void
+      FormatWriter::setFillValue(double fillvalue)
+      {
+        if (metadataRetrieve)
+          {
+            for (dimension_size_type s = 0; s < metadataRetrieve->getImageCount(); ++s)
+              {
+                const ome::xml::model::enums::PixelType pixeltype(metadataRetrieve->getPixelsType(s));
+                if (!isRepresentable(fillvalue, pixeltype))
+                  {
+                    boost::format fmt("Fill value %1% can not be stored with pixel type %2% of series %3%");
+                    fmt % fillvalue % pixeltype % s;
+                    throw std::logic_error(fmt.str());
+                  }
+              }
+          }
+
+        this->fillValue = fillvalue;
+      }
+
+      double
+      FormatWriter::getFillValue() const
+      {
+        return fillValue;
+      }
+
       void
       FormatWriter::setMetadataRetrieve(std::shared_ptr<::ome::xml::meta::MetadataRetrieve>& retrieve)
       {
@@ -598,6 +677,18 @@ namespace ome
         return *tile_size_y;
       }
 
+      void
+      FormatWriter::setTileSizePolicy(std::shared_ptr<const TileSizePolicy> policy)
+      {
+        tile_size_policy = policy;
+      }
+
+      std::shared_ptr<const TileSizePolicy>
+      FormatWriter::getTileSizePolicy() const
+      {
+        return tile_size_policy;
+      }
+
     }
   }
 }
@@ -71,6 +71,8 @@ namespace ome
         std::set<std::string> compression_types;
         /// Supported compression codecs types for each pixel type.
         pixel_compression_type_map pixel_compression_types;
+        /// Supported predictors.
+        std::set<std::string> predictor_types;
         /// Stacks are supported.
         bool stacks;
 
@@ -88,6 +90,7 @@ namespace ome
           compression_suffixes(),
           compression_types(),
           pixel_compression_types(),
+          predictor_types(),
           stacks()
         {
           compression_suffixes.push_back(boost::filesystem::path(""));
@@ -127,12 +130,24 @@ namespace ome
         /// The compression type to use.
         boost::optional<std::string> compression;
 
+        /// The predictor to use.
+        boost::optional<std::string> predictor;
+
+        /// The compression level to use.
+        boost::optional<int> compressionLevel;
+
         /// Subchannel interleaving enabled.
         boost::optional<bool> interleaved;
 
         /// Planes are written sequentially.
         bool sequential;
 
+        /// Empty tiles are not written.
+        bool sparse;
+
+        /// Sample value of empty tiles.
+        double fillValue;
+
         /// The frames per second to use when writing.
         frame_rate_type framesPerSecond;
 
@@ -142,6 +157,9 @@ namespace ome
         /// Tile size Y.
         boost::optional<dimension_size_type> tile_size_y;
 
+        /// Tile size policy.
+        std::shared_ptr<const TileSizePolicy> tile_size_policy;
+
         /**
          * Current metadata store. Should never be accessed directly as the
          * semantics of getMetadataRetrieve() prevent "null" access.
@@ -407,6 +425,22 @@ namespace ome
         const boost::optional<std::string>&
         getCompression() const;
 
+        // Documented in superclass.
+        void
+        setPredictor(const std::string& predictor);
+
+        // Documented in superclass.
+        const boost::optional<std::string>&
+        getPredictor() const;
+
+        // Documented in superclass.
+        void
+        setCompressionLevel(int level);
+
+        // Documented in superclass.
+        const boost::optional<int>&
+        getCompressionLevel() const;
+
         // Documented in superclass.
         void
         setInterleaved(bool interleaved);
@@ -427,6 +461,22 @@ namespace ome
         bool
         getWriteSequentially() const;
 
+        // Documented in superclass.
+        void
+        setSparse(bool sparse);
+
+        // Documented in superclass.
+        bool
+        getSparse() const;
+
+        // Documented in superclass.
+        void
+        setFillValue(double fillvalue);
+
+        // Documented in superclass.
+        double
+        getFillValue() const;
+
         // Documented in superclass.
         void
         setId(const boost::filesystem::path& id);
@@ -466,6 +516,14 @@ namespace ome
         // Documented in superclass.
         dimension_size_type
         getTileSizeY() const;
+
+        // Documented in superclass.
+        void
+        setTileSizePolicy(std::shared_ptr<const TileSizePolicy> policy);
+
+        // Documented in superclass.
+        std::shared_ptr<const TileSizePolicy>
+        getTileSizePolicy() const;
       };
 
     }
@@ -67,6 +67,12 @@ namespace ome
         boost::filesystem::path id;
         /// IFD index.
         dimension_size_type ifd;
+        /**
+         * Resolution level.  0 is the IFD itself; higher levels are
+         * the SubIFDs of the IFD, with level @c n being SubIFD @c
+         * n-1.
+         */
+        dimension_size_type resolution;
         /// Certainty flag, for dealing with unspecified NumPlanes.
         bool certain;
         /// File status.
@@ -75,12 +81,13 @@ namespace ome
         /**
          * Default constructor.
          *
-         * File and IFD are default constructed; order is uncertain;
-         * status is unknown.
+         * File and IFD are default constructed; resolution is full;
+         * order is uncertain; status is unknown.
          */
         OMETIFFPlane():
           id(),
           ifd(),
+          resolution(0),
           certain(false),
           status(UNKNOWN)
         {
@@ -91,12 +98,13 @@ namespace ome
          *
          * @param id the TIFF file containing this plane.
          *
-         * IFD is default constructed; order is uncertain; status is
-         * unknown.
+         * IFD is default constructed; resolution is full; order is
+         * uncertain; status is unknown.
          */
         OMETIFFPlane(const boost::filesystem::path& id):
           id(id),
           ifd(),
+          resolution(0),
           certain(false),
           status(UNKNOWN)
         {
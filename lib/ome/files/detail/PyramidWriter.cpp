@@ -0,0 +1,379 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/detail/PyramidWriter.h>
+#include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/Tags.h>
+#include <ome/files/tiff/TIFF.h>
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBufferBase;
+using ome::files::PlaneRegion;
+using ome::files::VariantPixelBuffer;
+
+namespace
+{
+
+  // Round up to an even size, with a minimum of 16.
+  dimension_size_type
+  chunkSize(dimension_size_type size)
+  {
+    return std::max(dimension_size_type(16U), size + (size % 2U));
+  }
+
+  // Copy a region between pixel buffers of the same type.
+  struct CopyRegionVisitor
+  {
+    VariantPixelBuffer& dest;
+    const PlaneRegion& source_region;
+    const PlaneRegion& dest_region;
+
+    CopyRegionVisitor(VariantPixelBuffer& dest,
+                      const PlaneRegion&  source_region,
+                      const PlaneRegion&  dest_region):
+      dest(dest),
+      source_region(source_region),
+      dest_region(dest_region)
+    {}
+
+    template<typename T>
+    void
+    operator()(const T& v)
+    {
+      T& destbuf = ome::compat::get<T>(dest.vbuffer());
+
+      typedef boost::multi_array_types::index_range range;
+      const PlaneRegion& s(source_region);
+      const PlaneRegion& d(dest_region);
+      destbuf->array()[boost::indices[range(d.x, d.x + d.w)][range(d.y, d.y + d.h)][range()][range()][range()][range()][range()][range()][range()]] =
+        v->array()[boost::indices[range(s.x, s.x + s.w)][range(s.y, s.y + s.h)][range()][range()][range()][range()][range()][range()][range()]];
+    }
+  };
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+    namespace detail
+    {
+
+      PyramidWriter::PyramidWriter(const boost::filesystem::path& file,
+                                   dimension_size_type            nlevels,
+                                   DownsampleMethod               method,
+                                   const ome::files::tiff::IFD&   ifd):
+        method(method),
+        tileType(ifd.getTileType()),
+        tileWidth(ifd.getTileWidth()),
+        tileHeight(ifd.getTileHeight()),
+        chunkWidth(chunkSize(tileWidth)),
+        chunkHeight(chunkSize(tileHeight)),
+        pixelType(ifd.getPixelType()),
+        bits(ifd.getBitsPerSample()),
+        samples(ifd.getSamplesPerPixel()),
+        planarConfig(ifd.getPlanarConfiguration()),
+        photometric(ifd.getPhotometricInterpretation()),
+        compression(ifd.getCompression()),
+        predictor(ifd.getPredictor()),
+        compressionLevel(),
+        sparse(ifd.getSparse()),
+        fillValue(ifd.getFillValue()),
+        copyTiles(compression != ome::files::tiff::COMPRESSION_OJPEG),
+        levels(nlevels + 1U)
+      {
+        try
+          {
+            compressionLevel = ifd.getCompressionLevel();
+          }
+        catch (const ome::files::tiff::Exception&)
+          {
+            // Codec does not support compression levels.
+          }
+
+        levels.at(0).sizeX = ifd.getImageWidth();
+        levels.at(0).sizeY = ifd.getImageHeight();
+
+        try
+          {
+            for (dimension_size_type l = 1; l < levels.size(); ++l)
+              {
+                Level& level(levels.at(l));
+                const Level& previous(levels.at(l - 1));
+                level.sizeX = (previous.sizeX + 1U) / 2U;
+                level.sizeY = (previous.sizeY + 1U) / 2U;
+
+                boost::filesystem::path model(file.filename().string() + "-%%%%-%%%%-%%%%.tmp");
+                level.file = file.parent_path() / boost::filesystem::unique_path(model);
+                level.tiff = ome::files::tiff::TIFF::open(level.file, "w8");
+                level.ifd = level.tiff->getCurrentDirectory();
+                setupIFD(*level.ifd, l, copyTiles);
+              }
+          }
+        catch (...)
+          {
+            cleanup();
+            throw;
+          }
+      }
+
+      PyramidWriter::~PyramidWriter()
+      {
+        cleanup();
+      }
+
+      dimension_size_type
+      PyramidWriter::getLevels() const
+      {
+        return levels.size() - 1U;
+      }
+
+      void
+      PyramidWriter::write(const VariantPixelBuffer& buf,
+                           dimension_size_type       x,
+                           dimension_size_type       y,
+                           dimension_size_type       w,
+                           dimension_size_type       h)
+      {
+        accumulate(0U, buf, PlaneRegion(x, y, w, h));
+      }
+
+      void
+      PyramidWriter::accumulate(dimension_size_type       level,
+                                const VariantPixelBuffer& buf,
+                                const PlaneRegion&        region)
+      {
+        Level& current(levels.at(level));
+
+        // The last level is not downsampled further.
+        if (level + 1U >= levels.size())
+          return;
+
+        const dimension_size_type chunksX = (current.sizeX + chunkWidth - 1U) / chunkWidth;
+        const dimension_size_type x1 = region.x / chunkWidth;
+        const dimension_size_type x2 = (region.x + region.w + chunkWidth - 1U) / chunkWidth;
+        const dimension_size_type y1 = region.y / chunkHeight;
+        const dimension_size_type y2 = (region.y + region.h + chunkHeight - 1U) / chunkHeight;
+
+        for (dimension_size_type cy = y1; cy < y2; ++cy)
+          for (dimension_size_type cx = x1; cx < x2; ++cx)
+            {
+              const PlaneRegion chunkRegion
+                (PlaneRegion(cx * chunkWidth, cy * chunkHeight, chunkWidth, chunkHeight) &
+                 PlaneRegion(0U, 0U, current.sizeX, current.sizeY));
+              const PlaneRegion overlap(chunkRegion & region);
+              if (!overlap.area())
+                continue;
+
+              const dimension_size_type index = (cy * chunksX) + cx;
+              std::map<dimension_size_type, Chunk>::iterator i = current.chunks.find(index);
+              if (i == current.chunks.end())
+                {
+                  std::array<VariantPixelBuffer::size_type, 9> shape;
+                  shape[DIM_SPATIAL_X] = chunkRegion.w;
+                  shape[DIM_SPATIAL_Y] = chunkRegion.h;
+                  shape[DIM_SUBCHANNEL] = samples;
+                  shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+                    shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+                  PixelBufferBase::storage_order_type order
+                    (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                         planarConfig == ome::files::tiff::CONTIG));
+
+                  i = current.chunks.insert(std::make_pair(index, Chunk())).first;
+                  i->second.buffer.setBuffer(shape, pixelType, order);
+                  i->second.covered = 0U;
+                }
+
+              Chunk& chunk(i->second);
+              const PlaneRegion source_region(overlap.x - region.x, overlap.y - region.y,
+                                              overlap.w, overlap.h);
+              const PlaneRegion dest_region(overlap.x - chunkRegion.x, overlap.y - chunkRegion.y,
+                                            overlap.w, overlap.h);
+              CopyRegionVisitor v(chunk.buffer, source_region, dest_region);
+              ome::compat::visit(v, buf.vbuffer());
+              chunk.covered += overlap.area();
+
+              if (chunk.covered >= chunkRegion.area())
+                {
+                  VariantPixelBuffer reduced;
+                  downsample(chunk.buffer, reduced, method);
+                  current.chunks.erase(i);
+
+                  const PlaneRegion reducedRegion(chunkRegion.x / 2U, chunkRegion.y / 2U,
+                                                  (chunkRegion.w + 1U) / 2U,
+                                                  (chunkRegion.h + 1U) / 2U);
+                  levels.at(level + 1U).ifd->writeImage(reduced, reducedRegion.x, reducedRegion.y,
+                                                        reducedRegion.w, reducedRegion.h);
+                  accumulate(level + 1U, reduced, reducedRegion);
+                }
+            }
+      }
+
+      void
+      PyramidWriter::writeSubIFDs(std::shared_ptr<ome::files::tiff::TIFF>& output)
+      {
+        for (dimension_size_type l = 1; l < levels.size(); ++l)
+          {
+            Level& level(levels.at(l));
+
+            // Finish the temporary TIFF and reopen it for reading.
+            level.ifd.reset();
+            level.tiff->writeCurrentDirectory();
+            level.tiff->close();
+            level.tiff = ome::files::tiff::TIFF::open(level.file, "r");
+            std::shared_ptr<ome::files::tiff::IFD> source(level.tiff->getDirectoryByIndex(0));
+
+            std::shared_ptr<ome::files::tiff::IFD> dest(output->getCurrentDirectory());
+            setupIFD(*dest, l, true);
+
+            if (copyTiles)
+              {
+                dest->copyTiles(*source);
+              }
+            else
+              {
+                // Copy one row of tiles or strips at a time.
+                VariantPixelBuffer buf;
+                for (dimension_size_type y = 0; y < level.sizeY; y += tileHeight)
+                  {
+                    const dimension_size_type h = std::min(tileHeight, level.sizeY - y);
+                    source->readImage(buf, 0U, y, level.sizeX, h);
+                    dest->writeImage(buf, 0U, y, level.sizeX, h);
+                  }
+              }
+
+            output->writeCurrentDirectory();
+
+            level.tiff->close();
+            level.tiff.reset();
+            boost::system::error_code ec;
+            boost::filesystem::remove(level.file, ec);
+            level.file.clear();
+          }
+      }
+
+      void
+      PyramidWriter::setupIFD(ome::files::tiff::IFD& ifd,
+                              dimension_size_type    level,
+                              bool                   compress) const
+      {
+        const Level& current(levels.at(level));
+
+        ifd.setImageWidth(static_cast<uint32_t>(current.sizeX));
+        ifd.setImageHeight(static_cast<uint32_t>(current.sizeY));
+        ifd.setPixelType(pixelType);
+        ifd.setBitsPerSample(bits);
+        ifd.setSamplesPerPixel(samples);
+        ifd.setPlanarConfiguration(planarConfig);
+        ifd.setPhotometricInterpretation(photometric);
+
+        if (compress)
+          {
+            // Reduced resolution image.
+            ifd.getField(ome::files::tiff::SUBFILETYPE).set(1U);
+
+            ifd.setTileType(tileType);
+            if (tileType == ome::files::tiff::TILE)
+              ifd.setTileWidth(static_cast<uint32_t>(tileWidth));
+            else
+              ifd.setTileWidth(static_cast<uint32_t>(current.sizeX));
+            ifd.setTileHeight(static_cast<uint32_t>(tileHeight));
+
+            if (compression != ome::files::tiff::COMPRESSION_NONE)
+              ifd.setCompression(compression);
+            if (predictor != ome::files::tiff::NONE)
+              ifd.setPredictor(predictor);
+            if (compressionLevel)
+              ifd.setCompressionLevel(*compressionLevel);
+            ifd.setSparse(sparse);
+            if (sparse)
+              ifd.setFillValue(fillValue);
+          }
+        else
+          {
+            // Temporary image.
+            ifd.setTileType(ome::files::tiff::TILE);
+            ifd.setTileWidth(256U);
+            ifd.setTileHeight(256U);
+          }
+      }
+
+      void
+      PyramidWriter::cleanup()
+      {
+        for (auto& level : levels)
+          {
+            level.ifd.reset();
+            if (level.tiff)
+              {
+                try
+                  {
+                    level.tiff->close();
+                  }
+                catch (const std::exception&)
+                  {
+                  }
+                level.tiff.reset();
+              }
+            if (!level.file.empty())
+              {
+                boost::system::error_code ec;
+                boost::filesystem::remove(level.file, ec);
+                level.file.clear();
+              }
+          }
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
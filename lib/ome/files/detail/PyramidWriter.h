@@ -0,0 +1,283 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_DETAIL_PYRAMIDWRITER_H
+#define OME_FILES_DETAIL_PYRAMIDWRITER_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <ome/files/Downsample.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/tiff/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+      class IFD;
+      class TIFF;
+    }
+
+    namespace detail
+    {
+
+      /**
+       * Streaming pyramid writer.
+       *
+       * Generate reduced resolution images while a full resolution
+       * TIFF image is being written, and write them as SubIFDs of the
+       * full resolution IFD.
+       *
+       * Regions of the full resolution image are passed to write()
+       * as they are written.  They are accumulated into chunks
+       * aligned to the TIFF tile grid; as soon as a chunk is
+       * complete, it is downsampled by a factor of two and written to
+       * the next level, recursively.  Only incomplete chunks are held
+       * in memory, so when an image is written in tile or strip
+       * order, memory use is bounded by a few rows of tiles per
+       * level.
+       *
+       * All levels are downsampled and encoded on the calling
+       * thread, while the full resolution image is being written.
+       * Encoding them on other threads would not be faster: all
+       * libtiff calls, including tile encoding, are serialised by the
+       * global tiff::Sentry lock, and encoding outside the lock would
+       * need per-handle libtiff error handlers, which the minimum
+       * supported libtiff version does not provide.
+       *
+       * libtiff can only write one directory at once, so each
+       * reduced resolution level is streamed to a temporary TIFF file
+       * alongside the output file, compressed with the same codec and
+       * options as the full resolution image.  Once the full
+       * resolution IFD has been written, writeSubIFDs() copies the
+       * compressed tiles of each level into a SubIFD in level order,
+       * without compressing them again, and removes the temporary
+       * files.  The full resolution data is never re-read.  Codec
+       * parameters stored outside the tiles, such as JPEG tables,
+       * are copied with the tiles.
+       */
+      class PyramidWriter
+      {
+      public:
+        /**
+         * Constructor.
+         *
+         * The image size, tiling, pixel type, samples, planar
+         * configuration, photometric interpretation and compression
+         * options are copied from the full resolution IFD, which must
+         * be fully set up.
+         *
+         * @param file the output file; temporary files are created
+         * in the same directory.
+         * @param nlevels the number of reduced resolution levels.
+         * @param method the downsampling method.
+         * @param ifd the full resolution IFD.
+         */
+        PyramidWriter(const boost::filesystem::path& file,
+                      dimension_size_type            nlevels,
+                      DownsampleMethod               method,
+                      const ome::files::tiff::IFD&   ifd);
+
+        /// Destructor.  Removes any remaining temporary files.
+        ~PyramidWriter();
+
+        /// @cond SKIP
+        PyramidWriter (const PyramidWriter&) = delete;
+
+        PyramidWriter&
+        operator= (const PyramidWriter&) = delete;
+        /// @endcond SKIP
+
+        /**
+         * Get the number of reduced resolution levels.
+         *
+         * @returns the number of levels.
+         */
+        dimension_size_type
+        getLevels() const;
+
+        /**
+         * Write a region of the full resolution image.
+         *
+         * @param buf the pixel data.
+         * @param x the @c X coordinate of the region.
+         * @param y the @c Y coordinate of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         */
+        void
+        write(const VariantPixelBuffer& buf,
+              dimension_size_type       x,
+              dimension_size_type       y,
+              dimension_size_type       w,
+              dimension_size_type       h);
+
+        /**
+         * Write the reduced resolution levels as SubIFDs.
+         *
+         * The full resolution IFD must have been written with a
+         * SubIFD tag containing getLevels() placeholder offsets, so
+         * that libtiff writes the following directories as its
+         * SubIFDs.
+         *
+         * @param output the output TIFF.
+         */
+        void
+        writeSubIFDs(std::shared_ptr<ome::files::tiff::TIFF>& output);
+
+      private:
+        /// A partially written chunk of a level.
+        struct Chunk
+        {
+          /// Chunk pixel data.
+          VariantPixelBuffer buffer;
+          /// Area of the chunk written.
+          dimension_size_type covered;
+        };
+
+        /// State of a single resolution level.
+        struct Level
+        {
+          /// Image width.
+          dimension_size_type sizeX;
+          /// Image height.
+          dimension_size_type sizeY;
+          /// Temporary file (unused for the full resolution level).
+          boost::filesystem::path file;
+          /// Temporary TIFF.
+          std::shared_ptr<ome::files::tiff::TIFF> tiff;
+          /// Temporary TIFF IFD.
+          std::shared_ptr<ome::files::tiff::IFD> ifd;
+          /// Incomplete chunks, indexed by chunk number.
+          std::map<dimension_size_type, Chunk> chunks;
+        };
+
+        /**
+         * Accumulate a region of a level.
+         *
+         * The region is copied into the chunks it overlaps, and
+         * complete chunks are downsampled, written to the temporary
+         * TIFF for the next level and accumulated for it.
+         *
+         * @param level the level number.
+         * @param buf the pixel data.
+         * @param region the region of the level covered by @c buf.
+         */
+        void
+        accumulate(dimension_size_type       level,
+                   const VariantPixelBuffer& buf,
+                   const PlaneRegion&        region);
+
+        /**
+         * Set up an IFD for a reduced resolution level.
+         *
+         * @param ifd the IFD to set up.
+         * @param level the level number.
+         * @param compress @c true to use the full resolution tiling
+         * and compression options, or @c false for uncompressed
+         * tiles.
+         */
+        void
+        setupIFD(ome::files::tiff::IFD& ifd,
+                 dimension_size_type    level,
+                 bool                   compress) const;
+
+        /// Remove temporary files.
+        void
+        cleanup();
+
+        /// Downsampling method.
+        DownsampleMethod method;
+        /// Tile type.
+        ome::files::tiff::TileType tileType;
+        /// Tile width.
+        dimension_size_type tileWidth;
+        /// Tile height.
+        dimension_size_type tileHeight;
+        /// Chunk width.
+        dimension_size_type chunkWidth;
+        /// Chunk height.
+        dimension_size_type chunkHeight;
+        /// Pixel type.
+        ::ome::xml::model::enums::PixelType pixelType;
+        /// Bits per sample.
+        uint16_t bits;
+        /// Samples per pixel.
+        uint16_t samples;
+        /// Planar configuration.
+        ome::files::tiff::PlanarConfiguration planarConfig;
+        /// Photometric interpretation.
+        ome::files::tiff::PhotometricInterpretation photometric;
+        /// Compression scheme.
+        ome::files::tiff::Compression compression;
+        /// Predictor.
+        ome::files::tiff::Predictor predictor;
+        /// Compression level, if set.
+        boost::optional<int> compressionLevel;
+        /// Skip writing empty tiles.
+        bool sparse;
+        /// Fill value of empty tiles.
+        double fillValue;
+        /// Copy compressed tiles from the temporary files.
+        bool copyTiles;
+        /// Resolution levels (0 is full resolution).
+        std::vector<Level> levels;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_DETAIL_PYRAMIDWRITER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,170 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <ome/files/detail/ReadQueue.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace detail
+    {
+
+      ReadQueue::ReadQueue(read_type read):
+        read(read),
+        pending(),
+        last(0U, 0U, 0U),
+        outstanding(0U),
+        mutex(),
+        completed()
+      {
+      }
+
+      ReadQueue::~ReadQueue()
+      {
+        wait();
+      }
+
+      std::future<std::shared_ptr<VariantPixelBuffer>>
+      ReadQueue::submit(Executor&           executor,
+                        dimension_size_type series,
+                        dimension_size_type resolution,
+                        dimension_size_type plane,
+                        const PlaneRegion&  region)
+      {
+        std::shared_ptr<Request> request(std::make_shared<Request>());
+        request->region = region;
+        std::future<std::shared_ptr<VariantPixelBuffer>> result(request->promise.get_future());
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          pending.insert(std::make_pair(key_type(series, resolution, plane), request));
+          ++outstanding;
+        }
+
+        try
+          {
+            executor.execute([this]() { run(); });
+          }
+        catch (...)
+          {
+            // Tasks are not tied to requests, so a task queued by an
+            // earlier submission may already have taken this request.
+            // Look the request up by identity under the lock, rather
+            // than using an iterator which may have been invalidated.
+            bool removed = false;
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              auto range = pending.equal_range(key_type(series, resolution, plane));
+              for (auto i = range.first; i != range.second; ++i)
+                {
+                  if (i->second == request)
+                    {
+                      pending.erase(i);
+                      --outstanding;
+                      completed.notify_all();
+                      removed = true;
+                      break;
+                    }
+                }
+            }
+
+            if (removed)
+              throw;
+
+            // This request is already running, so one of the pending
+            // requests has no task to run it.  Run it here so that
+            // wait() does not block forever.
+            run();
+          }
+
+        return result;
+      }
+
+      void
+      ReadQueue::wait()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(lock, [this]() { return outstanding == 0U; });
+      }
+
+      void
+      ReadQueue::run()
+      {
+        key_type key;
+        std::shared_ptr<Request> request;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (pending.empty())
+            return;
+
+          // Continue from the last read, wrapping to the start.
+          auto next = pending.lower_bound(last);
+          if (next == pending.end())
+            next = pending.begin();
+
+          key = next->first;
+          request = next->second;
+          pending.erase(next);
+          last = key;
+        }
+
+        try
+          {
+            std::shared_ptr<VariantPixelBuffer> buf(std::make_shared<VariantPixelBuffer>());
+            read(std::get<0>(key), std::get<1>(key), std::get<2>(key), request->region, *buf);
+            request->promise.set_value(buf);
+          }
+        catch (...)
+          {
+            request->promise.set_exception(std::current_exception());
+          }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        --outstanding;
+        completed.notify_all();
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
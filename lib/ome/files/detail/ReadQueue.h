@@ -0,0 +1,175 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#ifndef OME_FILES_DETAIL_READQUEUE_H
+#define OME_FILES_DETAIL_READQUEUE_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include <ome/files/Executor.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace detail
+    {
+
+      /**
+       * Queue of asynchronous plane reads.
+       *
+       * Reads are run by an Executor.  Each submitted read queues a
+       * task with the executor, but the read run by each task is
+       * chosen from the reads pending when it starts: a pending read
+       * of the same series, resolution and plane as the last read is
+       * preferred, followed by the next plane in order.  Reads of
+       * the same IFD are therefore batched together, and the
+       * remaining reads sweep through the file in IFD order, rather
+       * than switching directory for every read.
+       */
+      class ReadQueue
+      {
+      public:
+        /**
+         * Read function.
+         *
+         * The arguments are the series, resolution, plane, region
+         * and destination buffer, as for FormatReader::openBytes().
+         */
+        typedef std::function<void (dimension_size_type,
+                                    dimension_size_type,
+                                    dimension_size_type,
+                                    const PlaneRegion&,
+                                    VariantPixelBuffer&)> read_type;
+
+        /**
+         * Constructor.
+         *
+         * @param read the function to read a plane.
+         */
+        explicit
+        ReadQueue(read_type read);
+
+        /// Destructor.  Waits for all submitted reads to complete.
+        ~ReadQueue();
+
+        /// @cond SKIP
+        ReadQueue (const ReadQueue&) = delete;
+
+        ReadQueue&
+        operator= (const ReadQueue&) = delete;
+        /// @endcond SKIP
+
+        /**
+         * Submit a read.
+         *
+         * @param executor the executor to run the read.
+         * @param series the series.
+         * @param resolution the resolution.
+         * @param plane the plane.
+         * @param region the region to read.
+         * @returns a future for the pixel data; exceptions thrown by
+         * the read are stored in the future.
+         * @throws the exception thrown by the executor if the read
+         * could not be queued and had not already been started by
+         * another task.  If it had been started, a pending read is
+         * run by the calling thread instead.
+         */
+        std::future<std::shared_ptr<VariantPixelBuffer>>
+        submit(Executor&           executor,
+               dimension_size_type series,
+               dimension_size_type resolution,
+               dimension_size_type plane,
+               const PlaneRegion&  region);
+
+        /// Wait for all submitted reads to complete.
+        void
+        wait();
+
+      private:
+        /// Queue ordering key (series, resolution, plane).
+        typedef std::tuple<dimension_size_type,
+                           dimension_size_type,
+                           dimension_size_type> key_type;
+
+        /// A pending read.
+        struct Request
+        {
+          /// Region to read.
+          PlaneRegion region;
+          /// Promise for the result.
+          std::promise<std::shared_ptr<VariantPixelBuffer>> promise;
+        };
+
+        /// Run the next pending read.
+        void
+        run();
+
+        /// Read function.
+        read_type read;
+        /// Pending reads, in IFD order, then submission order.
+        std::multimap<key_type, std::shared_ptr<Request>> pending;
+        /// Key of the last read started.
+        key_type last;
+        /// Number of submitted reads not yet complete.
+        dimension_size_type outstanding;
+        /// Lock for the queue state.
+        std::mutex mutex;
+        /// Signalled when a read completes.
+        std::condition_variable completed;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_DETAIL_READQUEUE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -40,6 +40,7 @@
 
 #define TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS 50838 /* ImageJMetaDataByteCounts */
 #define TIFFTAG_IMAGEJ_META_DATA             50839 /* ImageJMetaData */
+#define TIFFTAG_GDAL_NODATA                  42113 /* GDALNoDataValue */
 
 #endif // OME_FILES_DETAIL_TIFF_TAGS_H
 
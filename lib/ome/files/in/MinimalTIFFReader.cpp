@@ -35,6 +35,7 @@
  * #L%
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include <boost/format.hpp>
@@ -88,17 +89,25 @@ namespace ome
 
       MinimalTIFFReader::MinimalTIFFReader():
         ::ome::files::detail::FormatReader(props),
+        logger(ome::common::createLogger("MinimalTIFFReader")),
         tiff(),
-        seriesIFDRange()
+        seriesIFDRange(),
+        subResolutionIFDs()
       {
+        // Keep series indexes the same with and without SubIFDs.
+        flattenedResolutions = false;
         domains.push_back(getDomain(GRAPHICS_DOMAIN));
       }
 
       MinimalTIFFReader::MinimalTIFFReader(const ReaderProperties& readerProperties):
         ::ome::files::detail::FormatReader(readerProperties),
+        logger(ome::common::createLogger("MinimalTIFFReader")),
         tiff(),
-        seriesIFDRange()
+        seriesIFDRange(),
+        subResolutionIFDs()
       {
+        // Keep series indexes the same with and without SubIFDs.
+        flattenedResolutions = false;
         domains.push_back(getDomain(GRAPHICS_DOMAIN));
       }
 
@@ -113,6 +122,39 @@ namespace ome
           }
       }
 
+      std::shared_ptr<::ome::files::FormatReader>
+      MinimalTIFFReader::clone() const
+      {
+        std::shared_ptr<MinimalTIFFReader> reader(std::make_shared<MinimalTIFFReader>(readerProperties));
+
+        reader->cloneState(*this);
+
+        return reader;
+      }
+
+      void
+      MinimalTIFFReader::cloneState(const MinimalTIFFReader& source)
+      {
+        ::ome::files::detail::FormatReader::cloneState(source);
+
+        seriesIFDRange = source.seriesIFDRange;
+        subResolutionIFDs = source.subResolutionIFDs;
+        planeIFDs = source.planeIFDs;
+        tiff.reset();
+
+        if (currentId)
+          {
+            tiff = TIFF::open(*currentId, "r");
+
+            if (!tiff)
+              {
+                boost::format fmt("Failed to open ‘%1%’");
+                fmt % currentId->string();
+                throw FormatException(fmt.str());
+              }
+          }
+      }
+
       bool
       MinimalTIFFReader::isFilenameThisTypeImpl(const boost::filesystem::path& name) const
       {
@@ -122,7 +164,39 @@ namespace ome
       const std::shared_ptr<const tiff::IFD>
       MinimalTIFFReader::ifdAtIndex(dimension_size_type plane) const
       {
-        dimension_size_type ifdidx = tiff::ifdIndex(seriesIFDRange, getSeries(), plane);
+        return ifdAtIndex(getCoreIndex(), plane);
+      }
+
+      const std::shared_ptr<const tiff::IFD>
+      MinimalTIFFReader::ifdAtIndex(dimension_size_type coreIndex,
+                                    dimension_size_type plane) const
+      {
+        const auto sub = subResolutionIFDs.find(coreIndex);
+        if (sub != subResolutionIFDs.end())
+          {
+            if (plane >= sub->second.size())
+              {
+                boost::format fmt("Invalid plane number ‘%1%’ for core index ‘%2%’");
+                fmt % plane % coreIndex;
+                throw FormatException(fmt.str());
+              }
+            return tiff->getDirectoryByOffset(sub->second.at(plane));
+          }
+
+        dimension_size_type ifdidx;
+        const auto planes = planeIFDs.find(coreIndex);
+        if (planes != planeIFDs.end())
+          {
+            if (plane >= planes->second.size())
+              {
+                boost::format fmt("Invalid plane number ‘%1%’ for core index ‘%2%’");
+                fmt % plane % coreIndex;
+                throw FormatException(fmt.str());
+              }
+            ifdidx = planes->second.at(plane);
+          }
+        else
+          ifdidx = tiff::ifdIndex(seriesIFDRange, coreIndex, plane);
         const std::shared_ptr<const IFD>& ifd(tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(ifdidx)));
 
         return ifd;
@@ -131,6 +205,8 @@ namespace ome
       void
       MinimalTIFFReader::close(bool fileOnly)
       {
+        readQueue.wait();
+
         // Drop shared reference to open TIFF.
         tiff.reset();
 
@@ -173,22 +249,96 @@ namespace ome
                   lhs.getPhotometricInterpretation() == rhs.getPhotometricInterpretation());
         }
 
+        // Check if an IFD is a reduced resolution image
+        // (NewSubfileType bit 0).
+        bool
+        is_reduced(const tiff::IFD& ifd)
+        {
+          uint32_t subfiletype = 0U;
+          try
+            {
+              ifd.getField(tiff::SUBFILETYPE).get(subfiletype);
+            }
+          catch (const tiff::Exception&)
+            {
+              // Not set; full resolution.
+            }
+          return (subfiletype & 0x1U) != 0U;
+        }
+
+        // Check if an IFD is usable as the next reduced resolution of
+        // an image: the same pixel format, no larger than the
+        // preceding resolution, and smaller in at least one
+        // dimension.
+        bool
+        compare_reduced_ifd(const tiff::IFD& full,
+                            const tiff::IFD& previous,
+                            const tiff::IFD& reduced)
+        {
+          return (reduced.getImageWidth() <= previous.getImageWidth() &&
+                  reduced.getImageHeight() <= previous.getImageHeight() &&
+                  (reduced.getImageWidth() < previous.getImageWidth() ||
+                   reduced.getImageHeight() < previous.getImageHeight()) &&
+                  reduced.getPixelType() == full.getPixelType() &&
+                  reduced.getSamplesPerPixel() == full.getSamplesPerPixel() &&
+                  reduced.getPlanarConfiguration() == full.getPlanarConfiguration() &&
+                  reduced.getPhotometricInterpretation() == full.getPhotometricInterpretation());
+        }
+
+        // Get the SubIFD offsets of an IFD.
+        std::vector<tiff::offset_type>
+        sub_ifds(const tiff::IFD& ifd)
+        {
+          std::vector<uint64_t> subifds;
+          try
+            {
+              ifd.getField(tiff::SUBIFD).get(subifds);
+            }
+          catch (const tiff::Exception&)
+            {
+              // No SubIFDs.
+            }
+          return std::vector<tiff::offset_type>(subifds.begin(), subifds.end());
+        }
+
       }
 
       void
       MinimalTIFFReader::readIFDs()
       {
         core.clear();
+        seriesIFDRange.clear();
+        subResolutionIFDs.clear();
+        planeIFDs.clear();
 
         std::shared_ptr<const tiff::IFD> prev_ifd;
+        std::shared_ptr<const tiff::IFD> prev_reduced;
         std::shared_ptr<CoreMetadata> prev_core;
 
+        // IFD index of each plane of each series.  Reduced
+        // resolution IFDs may separate the planes.
+        std::vector<std::vector<dimension_size_type>> planes;
+
+        // Reduced resolution IFD offsets for each plane of each
+        // series.
+        std::vector<std::vector<std::vector<tiff::offset_type>>> levels;
+
         dimension_size_type current_ifd = 0U;
 
         for (TIFF::const_iterator i = tiff->begin();
              i != tiff->end();
              ++i, ++current_ifd)
           {
+            // A reduced resolution image following a full resolution
+            // image is an additional resolution of that image.
+            if (prev_ifd && is_reduced(**i) &&
+                compare_reduced_ifd(*prev_ifd, prev_reduced ? *prev_reduced : *prev_ifd, **i))
+              {
+                levels.back().back().push_back((*i)->getOffset());
+                prev_reduced = *i;
+                continue;
+              }
+
             // The minimal TIFF reader makes the assumption that if
             // the pixel data is of the same format as the pixel data
             // in the preceding IFD, then this is a following
@@ -198,7 +348,7 @@ namespace ome
               {
                 ++prev_core->sizeT;
                 prev_core->imageCount = prev_core->sizeT;
-                ++(seriesIFDRange.back().end);
+                seriesIFDRange.back().end = current_ifd + 1;
               }
             else
               {
@@ -211,9 +361,101 @@ namespace ome
                 range.end = current_ifd + 1;
 
                 seriesIFDRange.push_back(range);
+                planes.emplace_back();
+                levels.emplace_back();
               }
+            planes.back().push_back(current_ifd);
+            levels.back().push_back(sub_ifds(**i));
             prev_ifd = *i;
+            prev_reduced.reset();
           }
+
+        addSubResolutions(planes, levels);
+      }
+
+      void
+      MinimalTIFFReader::addSubResolutions(const std::vector<std::vector<dimension_size_type>>&            planeIndexes,
+                                           const std::vector<std::vector<std::vector<tiff::offset_type>>>& levels)
+      {
+        coremetadata_list_type newcore;
+        tiff::SeriesIFDRange newrange;
+
+        for (dimension_size_type series = 0; series < core.size(); ++series)
+          {
+            const std::shared_ptr<CoreMetadata>& seriesCore(core.at(series));
+            const std::vector<std::vector<tiff::offset_type>>& planes(levels.at(series));
+            const std::vector<dimension_size_type>& indexes(planeIndexes.at(series));
+            const tiff::IFDRange& seriesRange(seriesIFDRange.at(series));
+
+            // The IFD of each plane must be stored if the planes are
+            // not consecutive.
+            if (indexes.size() != seriesRange.end - seriesRange.begin)
+              planeIFDs[newcore.size()] = indexes;
+
+            newcore.push_back(seriesCore);
+            newrange.push_back(seriesRange);
+
+            // Only levels present for every plane are used.
+            dimension_size_type count = planes.empty() ? 0U : planes.front().size();
+            for (const auto& plane : planes)
+              count = std::min(count, static_cast<dimension_size_type>(plane.size()));
+
+            coremetadata_list_type levelCores;
+            try
+              {
+                // Only the first plane is checked, since opening
+                // every IFD would be expensive for large series.
+                const std::shared_ptr<const IFD> full(tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(seriesIFDRange.at(series).begin)));
+                std::shared_ptr<const IFD> previous(full);
+
+                for (dimension_size_type level = 0; level < count; ++level)
+                  {
+                    const std::shared_ptr<const IFD> reduced(tiff->getDirectoryByOffset(planes.front().at(level)));
+                    if (!compare_reduced_ifd(*full, *previous, *reduced))
+                      {
+                        BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                          << "Ignoring incompatible reduced resolution " << level + 1U
+                          << " and following resolutions for series " << series;
+                        break;
+                      }
+
+                    std::shared_ptr<CoreMetadata> levelCore(std::make_shared<CoreMetadata>(*seriesCore));
+                    levelCore->sizeX = reduced->getImageWidth();
+                    levelCore->sizeY = reduced->getImageHeight();
+                    levelCore->resolutionCount = 1U;
+                    levelCores.push_back(levelCore);
+
+                    previous = reduced;
+                  }
+              }
+            catch (const std::exception& e)
+              {
+                BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                  << "Failed to read reduced resolutions: " << e.what();
+                levelCores.clear();
+              }
+
+            seriesCore->resolutionCount = 1U + levelCores.size();
+
+            for (dimension_size_type level = 0; level < levelCores.size(); ++level)
+              {
+                std::vector<tiff::offset_type> offsets;
+                offsets.reserve(planes.size());
+                for (const auto& plane : planes)
+                  offsets.push_back(plane.at(level));
+                subResolutionIFDs[newcore.size()] = offsets;
+
+                newcore.push_back(levelCores.at(level));
+
+                tiff::IFDRange range;
+                range.filename = *currentId;
+                range.begin = range.end = 0U;
+                newrange.push_back(range);
+              }
+          }
+
+        core.swap(newcore);
+        seriesIFDRange.swap(newrange);
       }
 
       void
@@ -251,6 +493,73 @@ namespace ome
         ifd->readImage(buf, x, y, w, h);
       }
 
+      void
+      MinimalTIFFReader::openSampledBytesImpl(dimension_size_type plane,
+                                              VariantPixelBuffer& buf,
+                                              dimension_size_type x,
+                                              dimension_size_type y,
+                                              dimension_size_type w,
+                                              dimension_size_type h,
+                                              dimension_size_type stepX,
+                                              dimension_size_type stepY) const
+      {
+        assertId(currentId, true);
+
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
+
+        ifd->readImage(buf, x, y, w, h, stepX, stepY);
+      }
+
+      void
+      MinimalTIFFReader::openIndexBytesImpl(dimension_size_type coreIndex,
+                                            dimension_size_type plane,
+                                            VariantPixelBuffer& buf,
+                                            dimension_size_type x,
+                                            dimension_size_type y,
+                                            dimension_size_type w,
+                                            dimension_size_type h) const
+      {
+        assertId(currentId, true);
+
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(coreIndex, plane));
+
+        ifd->readImage(buf, x, y, w, h);
+      }
+
+// The samples are transferred directly into the typed buffer.
+#define OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL(maR, maProperty, maType) \
+      void                                                              \
+      MinimalTIFFReader::openTypedIndexBytesImpl(dimension_size_type coreIndex, \
+                                                 dimension_size_type plane, \
+                                                 PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                                 dimension_size_type x, \
+                                                 dimension_size_type y, \
+                                                 dimension_size_type w, \
+                                                 dimension_size_type h) const \
+      {                                                                 \
+        assertId(currentId, true);                                      \
+                                                                        \
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(coreIndex, plane)); \
+                                                                        \
+        ifd->readImage(buf, x, y, w, h);                                \
+      }
+
+      BOOST_PP_SEQ_FOR_EACH(OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL
+
+      bool
+      MinimalTIFFReader::getRecordedRange(dimension_size_type        coreIndex,
+                                          dimension_size_type        plane,
+                                          std::pair<double, double>& range) const
+      {
+        assertId(currentId, true);
+
+        // The range of the SMinSampleValue and SMaxSampleValue tags,
+        // if written with the plane.
+        return tiff::getSampleValueRange(*ifdAtIndex(coreIndex, plane), range);
+      }
+
       std::shared_ptr<ome::files::tiff::TIFF>
       MinimalTIFFReader::getTIFF()
       {
@@ -42,6 +42,9 @@
 
 #include <ome/files/tiff/Util.h>
 
+#include <ome/common/log.h>
+
+#include <map>
 #include <vector>
 
 namespace ome
@@ -63,18 +66,51 @@ namespace ome
       /**
        * Basic TIFF reader.
        *
+       * Reduced resolution images, stored in SubIFDs or in IFDs
+       * marked as reduced resolution following their full
+       * resolution IFD, are available as sub-resolutions of the
+       * series.  Resolutions are not flattened by default, so that
+       * series indexes do not depend upon the presence of reduced
+       * resolutions.
+       *
+       * The openBytes() method taking an explicit series, resolution
+       * and plane is thread-safe.  All access to libtiff is
+       * serialised, so concurrent reads are not decoded in
+       * parallel, but a single reader may be shared between
+       * threads.
+       *
        * @note Any derived reader which does not implement its own
-       * openBytesImpl() must fill @c seriesIFDRange.
+       * openBytesImpl() and openIndexBytesImpl() must fill @c
+       * seriesIFDRange.
        */
       class MinimalTIFFReader : public ::ome::files::detail::FormatReader
       {
       protected:
+        /// Message logger.
+        ome::common::Logger logger;
+
         /// Underlying TIFF file.
         std::shared_ptr<ome::files::tiff::TIFF> tiff;
 
-        /// Mapping between series index and start and end IFD as a half-open range.
+        /**
+         * Mapping between core index and start and end IFD as a
+         * half-open range.  Reduced resolutions have an empty range;
+         * their IFDs are in @c subResolutionIFDs.  If the planes of a
+         * series are not consecutive IFDs, the range ends after the
+         * last plane and the IFD of each plane is in @c planeIFDs.
+         */
         tiff::SeriesIFDRange seriesIFDRange;
 
+        /// IFD offsets of each plane of each reduced resolution, by core index.
+        std::map<dimension_size_type, std::vector<tiff::offset_type>> subResolutionIFDs;
+
+        /**
+         * IFD index of each plane of full resolution series whose
+         * planes are not consecutive IFDs, by core index.  This is
+         * the case if reduced resolution IFDs follow each plane.
+         */
+        std::map<dimension_size_type, std::vector<dimension_size_type>> planeIFDs;
+
       public:
         /// Constructor.
         MinimalTIFFReader();
@@ -90,18 +126,60 @@ namespace ome
         virtual
         ~MinimalTIFFReader();
 
+        /**
+         * @copydoc ome::files::FormatReader::clone()
+         *
+         * The new reader opens its own handle for the TIFF file.
+         * Derived readers with additional state must override this
+         * to create a reader of the derived type.
+         */
+        std::shared_ptr<::ome::files::FormatReader>
+        clone() const;
+
       protected:
+        /**
+         * Copy the parsed state of another reader.
+         *
+         * In addition to the state copied by the base class, the IFD
+         * ranges are copied and the TIFF file is opened.
+         *
+         * @param source the reader to copy.
+         * @throws FormatException if the TIFF file could not be
+         * opened.
+         */
+        void
+        cloneState(const MinimalTIFFReader& source);
+
         // Documented in superclass.
         void
         initFile(const boost::filesystem::path& id);
 
         /**
          * Read metadata from IFDs.
+         *
+         * Consecutive IFDs with the same dimensions and pixel format
+         * are planes of the same series.  Reduced resolution images,
+         * stored either as SubIFDs or as following IFDs with a
+         * NewSubfileType of 1, are added as resolutions of the series
+         * of the preceding full resolution IFD.  Reduced resolution
+         * IFDs may follow each plane, so the planes of a series need
+         * not be consecutive IFDs.
          */
         virtual
         void
         readIFDs();
 
+        /**
+         * Add reduced resolutions to the series found by readIFDs().
+         *
+         * @param planes the IFD index of each plane of each series.
+         * @param levels the reduced resolution IFD offsets for each
+         * plane of each series.
+         */
+        void
+        addSubResolutions(const std::vector<std::vector<dimension_size_type>>&            planes,
+                          const std::vector<std::vector<std::vector<tiff::offset_type>>>& levels);
+
         // Documented in superclass.
         bool
         isFilenameThisTypeImpl(const boost::filesystem::path& name) const;
@@ -116,6 +194,18 @@ namespace ome
         const std::shared_ptr<const tiff::IFD>
         ifdAtIndex(dimension_size_type plane) const;
 
+        /**
+         * Get the IFD index for a plane in the specified series.
+         *
+         * @param coreIndex the core index of the series.
+         * @param plane the plane index within the series.
+         * @returns the IFD index.
+         * @throws FormatException if out of range.
+         */
+        const std::shared_ptr<const tiff::IFD>
+        ifdAtIndex(dimension_size_type coreIndex,
+                   dimension_size_type plane) const;
+
       public:
         // Documented in superclass.
         void
@@ -136,6 +226,48 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const;
 
+        // Documented in superclass.
+        void
+        openSampledBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type stepX,
+                             dimension_size_type stepY) const;
+
+        // Documented in superclass.
+        void
+        openIndexBytesImpl(dimension_size_type coreIndex,
+                           dimension_size_type plane,
+                           VariantPixelBuffer& buf,
+                           dimension_size_type x,
+                           dimension_size_type y,
+                           dimension_size_type w,
+                           dimension_size_type h) const;
+
+#define OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL(maR, maProperty, maType) \
+        void                                                            \
+        openTypedIndexBytesImpl(dimension_size_type coreIndex,          \
+                                dimension_size_type plane,              \
+                                PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                dimension_size_type x,                  \
+                                dimension_size_type y,                  \
+                                dimension_size_type w,                  \
+                                dimension_size_type h) const;
+
+        // Documented in superclass.
+        BOOST_PP_SEQ_FOR_EACH(OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_IN_MINIMALTIFFREADER_OPENTYPEDINDEXBYTESIMPL
+
+        // Documented in superclass.
+        bool
+        getRecordedRange(dimension_size_type        coreIndex,
+                         dimension_size_type        plane,
+                         std::pair<double, double>& range) const;
+
       public:
         /**
          * Get open TIFF file.
@@ -55,6 +55,7 @@
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/Util.h>
 
 #include <ome/xml/meta/OMEXMLMetadata.h>
 #include <ome/xml/meta/BaseMetadata.h>
@@ -176,12 +177,35 @@ namespace ome
         files(),
         invalidFiles(),
         tiffs(),
+        tiffsMutex(),
         metadataFile(),
         usedFiles(),
         hasSPW(false),
         cachedMetadata(),
         cachedMetadataFile()
       {
+        this->flattenedResolutions = false;
+        this->suffixNecessary = false;
+        this->suffixSufficient = false;
+        this->domains = getDomainCollection(NON_GRAPHICS_DOMAINS);
+        this->companionFiles = true;
+        this->datasetDescription = "One or more .ome.tiff files";
+      }
+
+      OMETIFFReader::OMETIFFReader(const ome::files::detail::ReaderProperties& readerProperties):
+        detail::FormatReader(readerProperties),
+        logger(ome::common::createLogger("OMETIFFReader")),
+        files(),
+        invalidFiles(),
+        tiffs(),
+        tiffsMutex(),
+        metadataFile(),
+        usedFiles(),
+        hasSPW(false),
+        cachedMetadata(),
+        cachedMetadataFile()
+      {
+        this->flattenedResolutions = false;
         this->suffixNecessary = false;
         this->suffixSufficient = false;
         this->domains = getDomainCollection(NON_GRAPHICS_DOMAINS);
@@ -203,6 +227,8 @@ namespace ome
       void
       OMETIFFReader::close(bool fileOnly)
       {
+        readQueue.wait();
+
         if (!fileOnly)
           {
             files.clear();
@@ -218,6 +244,36 @@ namespace ome
         detail::FormatReader::close(fileOnly);
       }
 
+      std::shared_ptr<::ome::files::FormatReader>
+      OMETIFFReader::clone() const
+      {
+        std::shared_ptr<OMETIFFReader> reader(std::make_shared<OMETIFFReader>(readerProperties));
+
+        reader->cloneState(*this);
+
+        return reader;
+      }
+
+      void
+      OMETIFFReader::cloneState(const OMETIFFReader& source)
+      {
+        detail::FormatReader::cloneState(source);
+
+        files = source.files;
+        invalidFiles = source.invalidFiles;
+        tiffs.clear();
+        {
+          std::lock_guard<std::mutex> lock(source.tiffsMutex);
+          for (const auto& t : source.tiffs)
+            addTIFF(t.first);
+        }
+        metadataFile = source.metadataFile;
+        usedFiles = source.usedFiles;
+        hasSPW = source.hasSPW;
+        cachedMetadata = source.cachedMetadata;
+        cachedMetadataFile = source.cachedMetadataFile;
+      }
+
       bool
       OMETIFFReader::isSingleFile(const boost::filesystem::path& id) const
       {
@@ -326,17 +382,38 @@ namespace ome
 
       const std::shared_ptr<const tiff::IFD>
       OMETIFFReader::ifdAtIndex(dimension_size_type plane) const
+      {
+        return ifdAtIndex(getCoreIndex(), plane);
+      }
+
+      const std::shared_ptr<const tiff::IFD>
+      OMETIFFReader::ifdAtIndex(dimension_size_type coreIndex,
+                                dimension_size_type plane) const
       {
         std::shared_ptr<const IFD> ifd;
 
-        const OMETIFFMetadata& ometa(dynamic_cast<const OMETIFFMetadata&>(getCoreMetadata(getCoreIndex())));
+        const OMETIFFMetadata& ometa(dynamic_cast<const OMETIFFMetadata&>(getCoreMetadata(coreIndex)));
 
         if (plane < ometa.tiffPlanes.size())
           {
             const OMETIFFPlane& tiffplane(ometa.tiffPlanes.at(plane));
             const std::shared_ptr<const TIFF> tiff(getTIFF(tiffplane.id));
             if (tiff)
-              ifd = std::shared_ptr<const IFD>(tiff->getDirectoryByIndex(tiffplane.ifd));
+              {
+                ifd = std::shared_ptr<const IFD>(tiff->getDirectoryByIndex(tiffplane.ifd));
+
+                // Sub-resolutions are stored in the SubIFDs of the
+                // full resolution IFD.
+                if (tiffplane.resolution)
+                  {
+                    std::vector<uint64_t> subifds;
+                    ifd->getField(ome::files::tiff::SUBIFD).get(subifds);
+                    if (tiffplane.resolution <= subifds.size())
+                      ifd = std::shared_ptr<const IFD>(tiff->getDirectoryByOffset(subifds.at(tiffplane.resolution - 1)));
+                    else
+                      ifd.reset();
+                  }
+              }
           }
 
         if (!ifd)
@@ -349,6 +426,14 @@ namespace ome
         return ifd;
       }
 
+      const std::shared_ptr<const tiff::IFD>
+      OMETIFFReader::getIFD(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        return ifdAtIndex(plane);
+      }
+
       const std::vector<std::string>&
       OMETIFFReader::getDomains() const
       {
@@ -1051,6 +1136,99 @@ namespace ome
             // The metadata store doesn't support getImageCount so we
             // can't meaningfully set anything.
           }
+
+        // Add sub-resolutions last, since the metadata store only
+        // contains the full resolution images.
+        addSubResolutions();
+      }
+
+      void
+      OMETIFFReader::addSubResolutions()
+      {
+        coremetadata_list_type newcore;
+
+        for (dimension_size_type series = 0; series < core.size(); ++series)
+          {
+            newcore.push_back(core.at(series));
+
+            std::shared_ptr<OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<OMETIFFMetadata>(core.at(series)));
+            if (!coreMeta || coreMeta->tiffPlanes.empty())
+              continue;
+
+            coremetadata_list_type levels;
+
+            try
+              {
+                // Only the first plane is checked, since opening
+                // every IFD would be expensive for large series.
+                // Missing SubIFDs for other planes are reported by
+                // ifdAtIndex() when the plane is read.
+                const OMETIFFPlane& plane(coreMeta->tiffPlanes.at(0));
+                const std::shared_ptr<const tiff::TIFF> ptiff(getTIFF(plane.id));
+                const std::shared_ptr<const tiff::IFD> pifd(ptiff->getDirectoryByIndex(plane.ifd));
+
+                std::vector<uint64_t> subifds;
+                try
+                  {
+                    pifd->getField(tiff::SUBIFD).get(subifds);
+                  }
+                catch (const tiff::Exception&)
+                  {
+                    // No SubIFDs.
+                  }
+
+                dimension_size_type previousX = coreMeta->sizeX;
+                dimension_size_type previousY = coreMeta->sizeY;
+
+                for (dimension_size_type level = 1; level <= subifds.size(); ++level)
+                  {
+                    const std::shared_ptr<const tiff::IFD> sifd(ptiff->getDirectoryByOffset(subifds.at(level - 1)));
+
+                    const dimension_size_type sizeX = sifd->getImageWidth();
+                    const dimension_size_type sizeY = sifd->getImageHeight();
+
+                    if (sizeX > previousX || sizeY > previousY ||
+                        (sizeX == previousX && sizeY == previousY) ||
+                        sifd->getPixelType() != coreMeta->pixelType ||
+                        sifd->getSamplesPerPixel() != pifd->getSamplesPerPixel() ||
+                        sifd->getPlanarConfiguration() != pifd->getPlanarConfiguration())
+                      {
+                        BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                          << "Ignoring incompatible SubIFD " << level - 1
+                          << " and following SubIFDs for series " << series;
+                        break;
+                      }
+
+                    std::shared_ptr<OMETIFFMetadata> levelMeta(std::make_shared<OMETIFFMetadata>(*coreMeta));
+                    levelMeta->sizeX = sizeX;
+                    levelMeta->sizeY = sizeY;
+                    levelMeta->resolutionCount = 1U;
+
+                    const tiff::TileInfo tinfo(sifd->getTileInfo());
+                    levelMeta->tileWidth.assign(levelMeta->sizeC.size(), tinfo.tileWidth());
+                    levelMeta->tileHeight.assign(levelMeta->sizeC.size(), tinfo.tileHeight());
+
+                    for (auto& levelPlane : levelMeta->tiffPlanes)
+                      levelPlane.resolution = level;
+
+                    levels.push_back(levelMeta);
+
+                    previousX = sizeX;
+                    previousY = sizeY;
+                  }
+              }
+            catch (const std::exception& e)
+              {
+                BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                  << "Failed to read sub-resolutions: " << e.what();
+                levels.clear();
+              }
+
+            coreMeta->resolutionCount = 1U + levels.size();
+            newcore.insert(newcore.end(), levels.begin(), levels.end());
+          }
+
+        core.swap(newcore);
       }
 
       void
@@ -1401,6 +1579,73 @@ namespace ome
         ifd->readImage(buf, x, y, w, h);
       }
 
+      void
+      OMETIFFReader::openSampledBytesImpl(dimension_size_type plane,
+                                          VariantPixelBuffer& buf,
+                                          dimension_size_type x,
+                                          dimension_size_type y,
+                                          dimension_size_type w,
+                                          dimension_size_type h,
+                                          dimension_size_type stepX,
+                                          dimension_size_type stepY) const
+      {
+        assertId(currentId, true);
+
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
+
+        ifd->readImage(buf, x, y, w, h, stepX, stepY);
+      }
+
+      void
+      OMETIFFReader::openIndexBytesImpl(dimension_size_type coreIndex,
+                                        dimension_size_type plane,
+                                        VariantPixelBuffer& buf,
+                                        dimension_size_type x,
+                                        dimension_size_type y,
+                                        dimension_size_type w,
+                                        dimension_size_type h) const
+      {
+        assertId(currentId, true);
+
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(coreIndex, plane));
+
+        ifd->readImage(buf, x, y, w, h);
+      }
+
+// The samples are transferred directly into the typed buffer.
+#define OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL(maR, maProperty, maType) \
+      void                                                              \
+      OMETIFFReader::openTypedIndexBytesImpl(dimension_size_type coreIndex, \
+                                             dimension_size_type plane, \
+                                             PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                             dimension_size_type x, \
+                                             dimension_size_type y, \
+                                             dimension_size_type w, \
+                                             dimension_size_type h) const \
+      {                                                                 \
+        assertId(currentId, true);                                      \
+                                                                        \
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(coreIndex, plane)); \
+                                                                        \
+        ifd->readImage(buf, x, y, w, h);                                \
+      }
+
+      BOOST_PP_SEQ_FOR_EACH(OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL
+
+      bool
+      OMETIFFReader::getRecordedRange(dimension_size_type        coreIndex,
+                                      dimension_size_type        plane,
+                                      std::pair<double, double>& range) const
+      {
+        assertId(currentId, true);
+
+        // The range of the SMinSampleValue and SMaxSampleValue tags,
+        // if written with the plane.
+        return tiff::getSampleValueRange(*ifdAtIndex(coreIndex, plane), range);
+      }
+
       void
       OMETIFFReader::addTIFF(const boost::filesystem::path& tiff)
       {
@@ -1410,14 +1655,16 @@ namespace ome
       const std::shared_ptr<const ome::files::tiff::TIFF>
       OMETIFFReader::getTIFF(const boost::filesystem::path& tiff) const
       {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
+
         tiff_map::iterator i = tiffs.find(tiff);
 
         if (i == tiffs.end())
           {
             BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
-              << "Failed to find cached TIFF " << i->first.string();
+              << "Failed to find cached TIFF " << tiff.string();
             boost::format fmt("Failed to find cached TIFF ‘%1%’");
-            fmt % i->first.string();
+            fmt % tiff.string();
             throw FormatException(fmt.str());
           }
 
@@ -1458,8 +1705,10 @@ namespace ome
       void
       OMETIFFReader::closeTIFF(const boost::filesystem::path& tiff)
       {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
+
         tiff_map::iterator i = tiffs.find(tiff);
-        if (i->second)
+        if (i != tiffs.end() && i->second)
           {
             i->second->close();
             i->second = std::shared_ptr<ome::files::tiff::TIFF>();
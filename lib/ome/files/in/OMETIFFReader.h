@@ -38,6 +38,8 @@
 #ifndef OME_FILES_IN_OMETIFFREADER_H
 #define OME_FILES_IN_OMETIFFREADER_H
 
+#include <mutex>
+
 #include <ome/files/in/MinimalTIFFReader.h>
 #include <ome/files/tiff/TIFF.h>
 
@@ -63,6 +65,19 @@ namespace ome
 
       /**
        * TIFF reader with support for OME-XML metadata.
+       *
+       * Reduced resolution images stored in SubIFDs of each plane
+       * IFD are available as sub-resolutions of the series.
+       * Resolutions are not flattened by default, so that each
+       * series is the OME-XML Image of the same index whether or not
+       * the file contains reduced resolutions.  If resolutions are
+       * flattened, each resolution is presented as a separate series
+       * following the full resolution series.
+       *
+       * The openBytes() method taking an explicit series, resolution
+       * and plane is thread-safe.  TIFF files are opened on first
+       * use under a lock, and all access to libtiff is serialised,
+       * so a single reader may be shared between threads.
        */
       class OMETIFFReader : public ::ome::files::detail::FormatReader
       {
@@ -93,6 +108,9 @@ namespace ome
         /// Open TIFF files
         mutable tiff_map tiffs;
 
+        /// Lock for opening and closing @c tiffs.
+        mutable std::mutex tiffsMutex;
+
         /// Metadata file.
         boost::filesystem::path metadataFile;
 
@@ -115,6 +133,13 @@ namespace ome
         /// Constructor.
         OMETIFFReader();
 
+        /**
+         * Constructor with reader properties (for derived readers).
+         *
+         * @param readerProperties the derived reader properties.
+         */
+        OMETIFFReader(const ome::files::detail::ReaderProperties& readerProperties);
+
         /// Destructor.
         virtual
         ~OMETIFFReader();
@@ -128,7 +153,46 @@ namespace ome
         isThisType(const boost::filesystem::path& name,
                    bool                           open) const;
 
+        /**
+         * @copydoc ome::files::FormatReader::clone()
+         *
+         * The file mappings are copied.  The TIFF files are opened
+         * by the new reader on first use.  Derived readers with
+         * additional state must override this to create a reader of
+         * the derived type.
+         */
+        std::shared_ptr<::ome::files::FormatReader>
+        clone() const;
+
+        /**
+         * Get the IFD containing a plane of the current series.
+         *
+         * This permits direct access to the TIFF data, for example to
+         * copy the compressed tiles of a plane with
+         * tiff::IFD::copyTiles() without decoding them.  The IFD
+         * shares the TIFF file handle of this reader, so it must not
+         * be used concurrently with this reader.
+         *
+         * @param plane the plane index within the current series.
+         * @returns the IFD.
+         * @throws FormatException if out of range.
+         */
+        const std::shared_ptr<const tiff::IFD>
+        getIFD(dimension_size_type plane) const;
+
       protected:
+        /**
+         * Copy the parsed state of another reader.
+         *
+         * In addition to the state copied by the base class, the
+         * file mappings and cached metadata are copied.  The TIFF
+         * files are not opened until first use.
+         *
+         * @param source the reader to copy.
+         */
+        void
+        cloneState(const OMETIFFReader& source);
+
         // Documented in superclass.
         bool
         isFilenameThisTypeImpl(const boost::filesystem::path& name) const;
@@ -147,6 +211,48 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const;
 
+        // Documented in superclass.
+        void
+        openSampledBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type stepX,
+                             dimension_size_type stepY) const;
+
+        // Documented in superclass.
+        void
+        openIndexBytesImpl(dimension_size_type coreIndex,
+                           dimension_size_type plane,
+                           VariantPixelBuffer& buf,
+                           dimension_size_type x,
+                           dimension_size_type y,
+                           dimension_size_type w,
+                           dimension_size_type h) const;
+
+#define OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL(maR, maProperty, maType) \
+        void                                                            \
+        openTypedIndexBytesImpl(dimension_size_type coreIndex,          \
+                                dimension_size_type plane,              \
+                                PixelBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>& buf, \
+                                dimension_size_type x,                  \
+                                dimension_size_type y,                  \
+                                dimension_size_type w,                  \
+                                dimension_size_type h) const;
+
+        // Documented in superclass.
+        BOOST_PP_SEQ_FOR_EACH(OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_IN_OMETIFFREADER_OPENTYPEDINDEXBYTESIMPL
+
+        // Documented in superclass.
+        bool
+        getRecordedRange(dimension_size_type        coreIndex,
+                         dimension_size_type        plane,
+                         std::pair<double, double>& range) const;
+
         /**
          * Get the IFD index for a plane in the current series.
          *
@@ -157,6 +263,31 @@ namespace ome
         const std::shared_ptr<const tiff::IFD>
         ifdAtIndex(dimension_size_type plane) const;
 
+        /**
+         * Get the IFD index for a plane in the specified series.
+         *
+         * @param coreIndex the core index of the series.
+         * @param plane the plane index within the series.
+         * @returns the IFD index.
+         * @throws FormatException if out of range.
+         */
+        const std::shared_ptr<const tiff::IFD>
+        ifdAtIndex(dimension_size_type coreIndex,
+                   dimension_size_type plane) const;
+
+        /**
+         * Add sub-resolutions for each series.
+         *
+         * Sub-resolutions are discovered from the SubIFDs of the
+         * first plane of each series.  Each SubIFD must have the
+         * same pixel type and samples per pixel as the full
+         * resolution image, and must not be larger than the
+         * preceding resolution.  The other planes in the series are
+         * expected to have the same SubIFD layout.
+         */
+        void
+        addSubResolutions();
+
         /**
          * Add a TIFF file to the internal TIFF map.
          *
@@ -93,6 +93,24 @@ namespace ome
           }
       }
 
+      std::shared_ptr<::ome::files::FormatReader>
+      TIFFReader::clone() const
+      {
+        std::shared_ptr<TIFFReader> reader(std::make_shared<TIFFReader>());
+
+        reader->cloneState(*this);
+
+        return reader;
+      }
+
+      void
+      TIFFReader::cloneState(const TIFFReader& source)
+      {
+        MinimalTIFFReader::cloneState(source);
+
+        ijmeta = source.ijmeta;
+      }
+
       void
       TIFFReader::close(bool fileOnly)
       {
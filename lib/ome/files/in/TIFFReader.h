@@ -65,7 +65,29 @@ namespace ome
         virtual
         ~TIFFReader();
 
+        /**
+         * @copydoc ome::files::FormatReader::clone()
+         *
+         * The ImageJ metadata is copied in addition to the state
+         * copied by MinimalTIFFReader.
+         */
+        std::shared_ptr<::ome::files::FormatReader>
+        clone() const;
+
       protected:
+        /**
+         * Copy the parsed state of another reader.
+         *
+         * In addition to the state copied by MinimalTIFFReader, the
+         * ImageJ metadata is copied.
+         *
+         * @param source the reader to copy.
+         * @throws FormatException if the TIFF file could not be
+         * opened.
+         */
+        void
+        cloneState(const TIFFReader& source);
+
         // Documented in superclass.
         void
         readIFDs();
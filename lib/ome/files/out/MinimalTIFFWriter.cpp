@@ -90,6 +90,9 @@ namespace ome
               p.pixel_compression_types.insert(WriterProperties::pixel_compression_type_map::value_type(i->first, codecset));
             }
 
+          const std::vector<std::string>& predictors = tiff::getPredictorNames();
+          p.predictor_types.insert(predictors.begin(), predictors.end());
+
           return p;
         }
 
@@ -260,6 +263,10 @@ namespace ome
         ifd->setImageWidth(getSizeX());
         ifd->setImageHeight(getSizeY());
 
+        std::array<dimension_size_type, 3> coords = getZCTCoords(getPlane());
+
+        dimension_size_type channel = coords[1];
+
         // Default strip or tile size.  We base this upon a default
         // chunk size of 64KiB for greyscale images, which will
         // increase to 192KiB for 3 sample RGB images.  We use strips
@@ -304,6 +311,14 @@ namespace ome
                 ifd->setTileHeight(1U);
               }
           }
+        else if(this->tile_size_policy)
+          {
+            // Use the tile size policy.
+            const boost::optional<bool> interleaved(getInterleaved());
+            tiff::applyTileSizePolicy(*ifd, *this->tile_size_policy, getCompression(), getPixelType(),
+                                      (interleaved && *interleaved) ? getRGBChannelCount(channel) : 1U,
+                                      getSizeX(), getSizeY());
+          }
         else if(getSizeX() < 2048)
           {
             // Default to strips, mainly for compatibility with
@@ -323,10 +338,6 @@ namespace ome
             ifd->setTileHeight(256U);
           }
 
-        std::array<dimension_size_type, 3> coords = getZCTCoords(getPlane());
-
-        dimension_size_type channel = coords[1];
-
         ifd->setPixelType(getPixelType());
         ifd->setBitsPerSample(bitsPerPixel(getPixelType()));
         ifd->setSamplesPerPixel(getRGBChannelCount(channel));
@@ -345,9 +356,22 @@ namespace ome
         else
           ifd->setPhotometricInterpretation(tiff::MIN_IS_BLACK);
 
-        const boost::optional<std::string> compression(getCompression());
-        if(compression)
-          ifd->setCompression(tiff::getCodecScheme(*compression));
+        tiff::applyCodecSettings(*ifd, getPixelType(), getCompression(),
+                                 getPredictor(), getCompressionLevel());
+
+        // The fill value is only stored if sparse tiles may be
+        // written; other readers treat it as a no data value.
+        ifd->setSparse(getSparse());
+        if (getSparse())
+          {
+            if (!isRepresentable(getFillValue(), getPixelType()))
+              {
+                boost::format fmt("Fill value %1% can not be stored with pixel type %2%");
+                fmt % getFillValue() % getPixelType();
+                throw FormatException(fmt.str());
+              }
+            ifd->setFillValue(getFillValue());
+          }
       }
 
       void
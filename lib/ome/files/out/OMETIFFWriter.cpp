@@ -35,7 +35,12 @@
  * #L%
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 // Include first due to side effect of MPL vector limit setting which can change the default
 // and break multi_index with Boost 1.67
@@ -54,6 +59,8 @@
 #include <ome/files/FormatException.h>
 #include <ome/files/FormatTools.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/detail/PyramidWriter.h>
 #include <ome/files/out/OMETIFFWriter.h>
 #include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/Field.h>
@@ -114,6 +121,9 @@ namespace ome
               p.pixel_compression_types.insert(WriterProperties::pixel_compression_type_map::value_type(pixeltype.first, codecset));
             }
 
+          const std::vector<std::string>& predictors = tiff::getPredictorNames();
+          p.predictor_types.insert(predictors.begin(), predictors.end());
+
           return p;
         }
 
@@ -408,6 +418,10 @@ namespace ome
       OMETIFFWriter::TIFFState::TIFFState(std::shared_ptr<ome::files::tiff::TIFF>& tiff):
         uuid(boost::uuids::to_string(boost::uuids::random_generator()())),
         tiff(tiff),
+        ifd(tiff->getCurrentDirectory()),
+        pyramid(),
+        statistics(),
+        copied(false),
         ifdCount(0U)
       {
       }
@@ -426,7 +440,11 @@ namespace ome
         seriesState(),
         originalMetadataRetrieve(),
         omeMeta(),
-        bigTIFF(boost::none)
+        bigTIFF(boost::none),
+        pyramidLevels(0U),
+        pyramidMethod(DOWNSAMPLE_MEAN),
+        writeStatistics(false),
+        histogramBins(0U)
       {
       }
 
@@ -496,6 +514,7 @@ namespace ome
 
                 SeriesState& seriesMeta(seriesState.at(series));
                 seriesMeta.planes.resize(planeCount);
+                seriesMeta.statistics.resize(planeCount);
 
                 for (dimension_size_type plane = 0U; plane < planeCount; ++plane)
                   {
@@ -556,6 +575,8 @@ namespace ome
                 removeTiffData(*omeMeta);
                 // Create UUID and TiffData elements for each series.
                 fillMetadata();
+                // Add pixel statistics annotations.
+                fillStatistics();
 
                 for (auto& tiff : tiffs)
                   {
@@ -581,6 +602,10 @@ namespace ome
             originalMetadataRetrieve.reset();
             omeMeta.reset();
             bigTIFF = boost::none;
+            pyramidLevels = 0U;
+            pyramidMethod = DOWNSAMPLE_MEAN;
+            writeStatistics = false;
+            histogramBins = 0U;
 
             ome::files::detail::FormatWriter::close(fileOnly);
           }
@@ -626,8 +651,7 @@ namespace ome
         if (currentId && (!this->tile_size_x ||
                           (this->tile_size_x && *this->tile_size_x)))
           {
-            std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
-            return ifd->getTileWidth();
+            return currentTIFF->second.ifd->getTileWidth();
           }
         else // setId not called yet; fall back.
           return detail::FormatWriter::getTileSizeX();
@@ -641,8 +665,7 @@ namespace ome
         if (currentId && (!this->tile_size_y ||
                           (this->tile_size_y && *this->tile_size_y)))
           {
-            std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
-            return ifd->getTileWidth();
+            return currentTIFF->second.ifd->getTileHeight();
           }
         else // setId not called yet; fall back.
           return detail::FormatWriter::getTileSizeY();
@@ -651,19 +674,62 @@ namespace ome
       void
       OMETIFFWriter::nextIFD() const
       {
-        currentTIFF->second.tiff->writeCurrentDirectory();
-        ++currentTIFF->second.ifdCount;
+        TIFFState& state(currentTIFF->second);
+
+        if (state.pyramid)
+          {
+            // Reserve SubIFD offsets for the reduced resolutions; the
+            // next directories written will be linked as SubIFDs.
+            std::vector<uint64_t> subifds(state.pyramid->getLevels(), 0U);
+            state.ifd->getField(tiff::SUBIFD).set(subifds);
+          }
+
+        if (state.statistics && state.statistics->getCount())
+          {
+            std::vector<double> minimum;
+            std::vector<double> maximum;
+            bool valid = true;
+            for (dimension_size_type s = 0; s < state.statistics->getSamples(); ++s)
+              {
+                minimum.push_back(state.statistics->getMinimum(s));
+                maximum.push_back(state.statistics->getMaximum(s));
+                // No range if all values of the sample are NaN.
+                valid = valid && minimum.back() <= maximum.back();
+              }
+            // Not set unless every sample has a range.
+            if (valid)
+              {
+                state.ifd->getField(tiff::SMINSAMPLEVALUE).set(minimum);
+                state.ifd->getField(tiff::SMAXSAMPLEVALUE).set(maximum);
+              }
+          }
+        state.statistics.reset();
+
+        state.tiff->writeCurrentDirectory();
+
+        if (state.pyramid)
+          {
+            state.pyramid->writeSubIFDs(state.tiff);
+            state.pyramid.reset();
+          }
+
+        ++state.ifdCount;
+        state.ifd = state.tiff->getCurrentDirectory();
       }
 
       void
       OMETIFFWriter::setupIFD() const
       {
         // Get current IFD.
-        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
+        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.ifd);
 
         ifd->setImageWidth(getSizeX());
         ifd->setImageHeight(getSizeY());
 
+        std::array<dimension_size_type, 3> coords = getZCTCoords(getPlane());
+
+        dimension_size_type channel = coords[1];
+
         // Default strip or tile size.  We base this upon a default
         // chunk size of 64KiB for greyscale images, which will
         // increase to 192KiB for 3 sample RGB images.  We use strips
@@ -708,6 +774,14 @@ namespace ome
                 ifd->setTileHeight(1U);
               }
           }
+        else if(this->tile_size_policy)
+          {
+            // Use the tile size policy.
+            const boost::optional<bool> interleaved(getInterleaved());
+            tiff::applyTileSizePolicy(*ifd, *this->tile_size_policy, getCompression(), getPixelType(),
+                                      (interleaved && *interleaved) ? getRGBChannelCount(channel) : 1U,
+                                      getSizeX(), getSizeY());
+          }
         else if(getSizeX() < 2048)
           {
             // Default to strips, mainly for compatibility with
@@ -727,10 +801,6 @@ namespace ome
             ifd->setTileHeight(256U);
           }
 
-        std::array<dimension_size_type, 3> coords = getZCTCoords(getPlane());
-
-        dimension_size_type channel = coords[1];
-
         ifd->setPixelType(getPixelType());
         ifd->setBitsPerSample(bitsPerPixel(getPixelType()));
         ifd->setSamplesPerPixel(getRGBChannelCount(channel));
@@ -749,12 +819,51 @@ namespace ome
         else
           ifd->setPhotometricInterpretation(tiff::MIN_IS_BLACK);
 
-        const boost::optional<std::string> compression(getCompression());
-        if(compression)
-          ifd->setCompression(tiff::getCodecScheme(*compression));
+        tiff::applyCodecSettings(*ifd, getPixelType(), getCompression(),
+                                 getPredictor(), getCompressionLevel());
+
+        // The fill value is only stored if sparse tiles may be
+        // written; other readers treat it as a no data value.
+        ifd->setSparse(getSparse());
+        if (getSparse())
+          {
+            if (!isRepresentable(getFillValue(), getPixelType()))
+              {
+                boost::format fmt("Fill value %1% can not be stored with pixel type %2%");
+                fmt % getFillValue() % getPixelType();
+                throw FormatException(fmt.str());
+              }
+            ifd->setFillValue(getFillValue());
+          }
 
         if (currentTIFF->second.ifdCount == 0)
           ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).set(default_description);
+
+        if (pyramidLevels)
+          currentTIFF->second.pyramid =
+            std::make_shared<detail::PyramidWriter>(currentTIFF->first,
+                                                    pyramidLevels,
+                                                    pyramidMethod,
+                                                    *ifd);
+        else
+          currentTIFF->second.pyramid.reset();
+
+        currentTIFF->second.copied = false;
+
+        currentTIFF->second.statistics.reset();
+        if (writeStatistics)
+          {
+            if (PixelStatistics::isSupported(getPixelType(), histogramBins))
+              currentTIFF->second.statistics =
+                std::make_shared<PixelStatistics>(getPixelType(),
+                                                  getRGBChannelCount(channel),
+                                                  histogramBins);
+            else
+              BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                << "Pixel statistics with " << histogramBins
+                << " histogram bins are not supported for pixel type "
+                << getPixelType();
+          }
       }
 
       void
@@ -770,12 +879,49 @@ namespace ome
         setPlane(plane);
 
         // Get current IFD.
-        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
+        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.ifd);
 
         // Get plane metadata.
         detail::OMETIFFPlane& planeMeta(seriesState.at(getSeries()).planes.at(plane));
 
-        ifd->writeImage(buf, x, y, w, h);
+        // Copied tiles are not overwritten.
+        if (!currentTIFF->second.copied)
+          ifd->writeImage(buf, x, y, w, h);
+
+        // Accumulate reduced resolutions.
+        if (currentTIFF->second.pyramid)
+          currentTIFF->second.pyramid->write(buf, x, y, w, h);
+
+        // Accumulate pixel statistics.
+        if (currentTIFF->second.statistics)
+          {
+            currentTIFF->second.statistics->add(buf);
+            seriesState.at(getSeries()).statistics.at(plane) = currentTIFF->second.statistics;
+          }
+
+        // Set plane metadata.
+        planeMeta.id = currentTIFF->first;
+        planeMeta.ifd = currentTIFF->second.ifdCount;
+        planeMeta.certain = true;
+        planeMeta.status = detail::OMETIFFPlane::PRESENT; // Plane now written.
+      }
+
+      void
+      OMETIFFWriter::copyTiles(dimension_size_type plane,
+                               const tiff::IFD&    source)
+      {
+        assertId(currentId, true);
+
+        setPlane(plane);
+
+        // Get current IFD.
+        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.ifd);
+
+        // Get plane metadata.
+        detail::OMETIFFPlane& planeMeta(seriesState.at(getSeries()).planes.at(plane));
+
+        ifd->copyTiles(source);
+        currentTIFF->second.copied = true;
 
         // Set plane metadata.
         planeMeta.id = currentTIFF->first;
@@ -852,6 +998,73 @@ namespace ome
           }
       }
 
+      void
+      OMETIFFWriter::fillStatistics()
+      {
+        if (!omeMeta)
+          throw std::logic_error("OMEXMLMetadata null");
+
+        dimension_size_type annotation = omeMeta->getMapAnnotationCount();
+
+        for (dimension_size_type series = 0U; series < seriesState.size(); ++series)
+          {
+            const SeriesState& state(seriesState.at(series));
+
+            ome::xml::model::primitives::OrderedMultimap values;
+            for (dimension_size_type plane = 0U; plane < state.statistics.size(); ++plane)
+              {
+                const std::shared_ptr<const PixelStatistics>& stats(state.statistics.at(plane));
+                if (!stats)
+                  continue;
+
+                for (dimension_size_type s = 0; s < stats->getSamples(); ++s)
+                  {
+                    std::ostringstream key;
+                    key.imbue(std::locale::classic());
+                    key << plane << ':' << s << ':';
+
+                    std::ostringstream min;
+                    min.imbue(std::locale::classic());
+                    min << std::setprecision(std::numeric_limits<double>::max_digits10)
+                        << stats->getMinimum(s);
+                    values.push_back({key.str() + "min", min.str()});
+
+                    std::ostringstream max;
+                    max.imbue(std::locale::classic());
+                    max << std::setprecision(std::numeric_limits<double>::max_digits10)
+                        << stats->getMaximum(s);
+                    values.push_back({key.str() + "max", max.str()});
+
+                    if (stats->getBins())
+                      {
+                        std::ostringstream histogram;
+                        histogram.imbue(std::locale::classic());
+                        const std::vector<uint64_t>& bins(stats->getHistogram(s));
+                        for (auto b = bins.begin(); b != bins.end(); ++b)
+                          {
+                            if (b != bins.begin())
+                              histogram << ',';
+                            histogram << *b;
+                          }
+                        values.push_back({key.str() + "histogram", histogram.str()});
+                      }
+                  }
+              }
+
+            if (values.empty())
+              continue;
+
+            const std::string id(createID("Annotation:PixelStatistics", series));
+            omeMeta->setMapAnnotationID(id, annotation);
+            omeMeta->setMapAnnotationNamespace("openmicroscopy.org/ome-files/pixel-statistics", annotation);
+            omeMeta->setMapAnnotationValue(values, annotation);
+            omeMeta->setImageAnnotationRef(id, series, omeMeta->getImageAnnotationRefCount(series));
+            ++annotation;
+          }
+
+        omeMeta->resolveReferences();
+      }
+
       std::string
       OMETIFFWriter::getOMEXML(const boost::filesystem::path& id)
       {
@@ -993,6 +1206,54 @@ namespace ome
         return bigTIFF;
       }
 
+      void
+      OMETIFFWriter::setPyramidLevels(dimension_size_type levels)
+      {
+        pyramidLevels = levels;
+      }
+
+      dimension_size_type
+      OMETIFFWriter::getPyramidLevels() const
+      {
+        return pyramidLevels;
+      }
+
+      void
+      OMETIFFWriter::setPyramidDownsampling(DownsampleMethod method)
+      {
+        pyramidMethod = method;
+      }
+
+      DownsampleMethod
+      OMETIFFWriter::getPyramidDownsampling() const
+      {
+        return pyramidMethod;
+      }
+
+      void
+      OMETIFFWriter::setStatistics(bool statistics)
+      {
+        writeStatistics = statistics;
+      }
+
+      bool
+      OMETIFFWriter::getStatistics() const
+      {
+        return writeStatistics;
+      }
+
+      void
+      OMETIFFWriter::setHistogramBins(dimension_size_type bins)
+      {
+        histogramBins = bins;
+      }
+
+      dimension_size_type
+      OMETIFFWriter::getHistogramBins() const
+      {
+        return histogramBins;
+      }
+
     }
   }
 }
@@ -40,6 +40,7 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <ome/files/Downsample.h>
 #include <ome/files/detail/FormatWriter.h>
 #include <ome/files/detail/OMETIFF.h>
 
@@ -59,6 +60,15 @@ namespace ome
 
     }
 
+    namespace detail
+    {
+
+      class PyramidWriter;
+
+    }
+
+    class PixelStatistics;
+
     namespace out
     {
 
@@ -82,6 +92,14 @@ namespace ome
           std::string uuid;
           /// TIFF file handle.
           std::shared_ptr<ome::files::tiff::TIFF> tiff;
+          /// Current IFD.
+          std::shared_ptr<ome::files::tiff::IFD> ifd;
+          /// Pyramid writer for the current IFD.
+          std::shared_ptr<detail::PyramidWriter> pyramid;
+          /// Pixel statistics for the current IFD.
+          std::shared_ptr<PixelStatistics> statistics;
+          /// Compressed tiles of the current IFD have been copied.
+          bool copied;
           /// Number of IFDs written.
           dimension_size_type ifdCount;
 
@@ -105,6 +123,8 @@ namespace ome
         {
           /// Current state of each plane in an image series.
           std::vector<detail::OMETIFFPlane> planes;
+          /// Pixel statistics of each plane in an image series.
+          std::vector<std::shared_ptr<const PixelStatistics>> statistics;
         };
 
         /// Vector of SeriesState objects.
@@ -147,6 +167,18 @@ namespace ome
         /// Write a Big TIFF
         boost::optional<bool> bigTIFF;
 
+        /// Number of reduced resolution levels to write.
+        dimension_size_type pyramidLevels;
+
+        /// Downsampling method for reduced resolution levels.
+        DownsampleMethod pyramidMethod;
+
+        /// Compute pixel statistics.
+        bool writeStatistics;
+
+        /// Number of histogram bins for pixel statistics.
+        dimension_size_type histogramBins;
+
       public:
         /// Constructor.
         OMETIFFWriter();
@@ -200,6 +232,29 @@ namespace ome
                   dimension_size_type w,
                   dimension_size_type h);
 
+        /**
+         * Copy the compressed tiles of a plane from a TIFF IFD.
+         *
+         * The tiles are copied without decoding and re-encoding
+         * them, with tiff::IFD::copyTiles(), so the source IFD must
+         * have the same size, tiling, pixel format, compression and
+         * predictor as the plane will be written with.
+         *
+         * Once the tiles of a plane have been copied, saveBytes()
+         * for the plane no longer writes the pixel data; it only
+         * generates the reduced resolution levels and pixel
+         * statistics, if enabled.  If neither are enabled, there is
+         * no need to call saveBytes() for the plane.
+         *
+         * @param plane the plane index.
+         * @param source the IFD to copy.
+         * @throws tiff::Exception if the IFD layouts differ or the
+         * copy fails.
+         */
+        void
+        copyTiles(dimension_size_type          plane,
+                  const ome::files::tiff::IFD& source);
+
       private:
         /**
          * Fill MetadataStore with cached metadata.
@@ -209,6 +264,15 @@ namespace ome
         void
         fillMetadata();
 
+        /**
+         * Fill MetadataStore with pixel statistics.
+         *
+         * Add a MapAnnotation for each Image for which statistics
+         * were computed.
+         */
+        void
+        fillStatistics();
+
         /**
          * Get OME-XML for embedding into the specified TIFF file.
          *
@@ -247,6 +311,109 @@ namespace ome
          */
         boost::optional<bool>
         getBigTIFF() const;
+
+        /**
+         * Set the number of reduced resolution levels to write.
+         *
+         * If nonzero, each plane will be written with the specified
+         * number of reduced resolution images stored in SubIFDs.
+         * Each level is half the width and height of the preceding
+         * level, and uses the same tiling and compression settings as
+         * the full resolution image.  The levels are generated while
+         * the full resolution image is written; no additional pass
+         * over the full resolution data is required.  The levels are
+         * downsampled and compressed on the writing thread as the
+         * full resolution image is written, and their compressed
+         * tiles are copied into the output file once the plane is
+         * complete.
+         *
+         * Temporary files will be created alongside the output files
+         * while each plane is being written.
+         *
+         * @param levels the number of reduced resolution levels, or
+         * zero to disable.
+         */
+        void
+        setPyramidLevels(dimension_size_type levels);
+
+        /**
+         * Get the number of reduced resolution levels to write.
+         *
+         * @returns the number of reduced resolution levels.
+         */
+        dimension_size_type
+        getPyramidLevels() const;
+
+        /**
+         * Set the downsampling method for reduced resolution levels.
+         *
+         * @param method the downsampling method; mean by default.
+         */
+        void
+        setPyramidDownsampling(DownsampleMethod method);
+
+        /**
+         * Get the downsampling method for reduced resolution levels.
+         *
+         * @returns the downsampling method.
+         */
+        DownsampleMethod
+        getPyramidDownsampling() const;
+
+        /**
+         * Set whether to compute pixel statistics.
+         *
+         * If enabled, the minimum and maximum value (and optionally a
+         * histogram) of each subchannel of each plane are computed as
+         * the plane is written.  No additional pass over the pixel
+         * data is required.
+         *
+         * The minimum and maximum of each subchannel in each plane
+         * are stored in the SMinSampleValue and SMaxSampleValue TIFF
+         * tags, with one value per sample.  The statistics of each subchannel are stored in a
+         * MapAnnotation linked to each Image, with the namespace
+         * @c openmicroscopy.org/ome-files/pixel-statistics.  The keys
+         * are of the form @c plane:sample:min, @c plane:sample:max
+         * and @c plane:sample:histogram, where the histogram value is
+         * a comma-separated list of bin counts covering the full
+         * range of the pixel type.
+         *
+         * Statistics are not computed for complex pixel types.
+         *
+         * @param statistics @c true to compute statistics, @c false
+         * to disable.
+         */
+        void
+        setStatistics(bool statistics);
+
+        /**
+         * Get whether to compute pixel statistics.
+         *
+         * @returns @c true if statistics are computed, @c false
+         * otherwise.
+         */
+        bool
+        getStatistics() const;
+
+        /**
+         * Set the number of histogram bins for pixel statistics.
+         *
+         * Histograms are only computed for integer pixel types, and
+         * the number of bins must be a power of two no greater than
+         * the number of possible pixel values.
+         *
+         * @param bins the number of bins, or zero to disable.
+         */
+        void
+        setHistogramBins(dimension_size_type bins);
+
+        /**
+         * Get the number of histogram bins for pixel statistics.
+         *
+         * @returns the number of bins.
+         */
+        dimension_size_type
+        getHistogramBins() const;
       };
 
     }
@@ -133,10 +133,29 @@ namespace ome
                   case COMPRESSION_ADOBE_DEFLATE:
                   case COMPRESSION_DEFLATE:
                   case COMPRESSION_LZMA:
+                  case COMPRESSION_ZSTD:
                   case COMPRESSION_JP2000:
                     ptcodecs.push_back(i->name);
                     break;
 
+                    // LERC compression of integer and floating point
+                    // data of at least 8 bits (lossless by default).
+                  case COMPRESSION_LERC:
+                    if (pixeltype != PixelType::BIT &&
+                        pixeltype != PixelType::COMPLEXFLOAT &&
+                        pixeltype != PixelType::COMPLEXDOUBLE)
+                      ptcodecs.push_back(i->name);
+                    break;
+
+                    // WebP compression of 8-bit data (RGB or RGBA
+                    // only; this interface does not cater for
+                    // samples per pixel when querying, so writers
+                    // check isCodecLayoutSupported())
+                  case COMPRESSION_WEBP:
+                    if (pixeltype == PixelType::UINT8)
+                      ptcodecs.push_back(i->name);
+                    break;
+
                     // JPEG compression of 8-bit data (12-bit not
                     // supported by default, and this interface does
                     // not cater for samples per pixel or bits per
@@ -202,6 +221,140 @@ namespace ome
 
         return ret;
       }
+
+      boost::optional<CodecLevelRange>
+      getCodecLevelRange(Compression scheme)
+      {
+        boost::optional<CodecLevelRange> ret;
+
+        switch(scheme)
+          {
+          case COMPRESSION_ADOBE_DEFLATE:
+          case COMPRESSION_DEFLATE:
+            {
+              CodecLevelRange range;
+              range.minimum = 1;
+              range.maximum = 9;
+              ret = range;
+            }
+            break;
+          case COMPRESSION_LZMA:
+            {
+              CodecLevelRange range;
+              range.minimum = 0;
+              range.maximum = 9;
+              ret = range;
+            }
+            break;
+          case COMPRESSION_ZSTD:
+            {
+              CodecLevelRange range;
+              range.minimum = 1;
+              range.maximum = 22;
+              ret = range;
+            }
+            break;
+          case COMPRESSION_WEBP:
+            {
+              CodecLevelRange range;
+              range.minimum = 1;
+              range.maximum = 100;
+              ret = range;
+            }
+            break;
+          default:
+            break;
+          }
+
+        return ret;
+      }
+
+      const std::vector<std::string>&
+      getPredictorNames()
+      {
+        static const std::vector<std::string> ret{"None", "Horizontal", "FloatingPoint"};
+
+        return ret;
+      }
+
+      Predictor
+      getPredictorScheme(const std::string& name)
+      {
+        Predictor ret = NONE;
+
+        if (name == "Horizontal")
+          ret = HORIZONTAL;
+        else if (name == "FloatingPoint")
+          ret = FLOATING_POINT;
+
+        return ret;
+      }
+
+      bool
+      isPredictorSupported(Compression scheme,
+                           Predictor   predictor,
+                           PixelType   pixeltype)
+      {
+        if (predictor == NONE)
+          return true;
+
+        switch(scheme)
+          {
+            // Codecs which apply a predictor.
+          case COMPRESSION_LZW:
+          case COMPRESSION_ADOBE_DEFLATE:
+          case COMPRESSION_DEFLATE:
+          case COMPRESSION_LZMA:
+          case COMPRESSION_ZSTD:
+            break;
+          default:
+            return false;
+          }
+
+        bool ret = false;
+
+        switch(pixeltype)
+          {
+          case PixelType::INT8:
+          case PixelType::INT16:
+          case PixelType::INT32:
+          case PixelType::UINT8:
+          case PixelType::UINT16:
+          case PixelType::UINT32:
+            ret = (predictor == HORIZONTAL);
+            break;
+          case PixelType::FLOAT:
+          case PixelType::DOUBLE:
+            ret = (predictor == FLOATING_POINT);
+            break;
+          default:
+            break;
+          }
+
+        return ret;
+      }
+
+      bool
+      isCodecLayoutSupported(Compression         scheme,
+                             PixelType           pixeltype,
+                             uint16_t            samples,
+                             PlanarConfiguration planarconfig)
+      {
+        bool ret = true;
+
+        switch(scheme)
+          {
+          case COMPRESSION_WEBP:
+            ret = (pixeltype == PixelType::UINT8 &&
+                   (samples == 3U || samples == 4U) &&
+                   planarconfig == CONTIG);
+            break;
+          default:
+            break;
+          }
+
+        return ret;
+      }
     }
   }
 }
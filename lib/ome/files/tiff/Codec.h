@@ -38,9 +38,12 @@
 #ifndef OME_FILES_TIFF_CODEC_H
 #define OME_FILES_TIFF_CODEC_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include <ome/files/tiff/Types.h>
 
 #include <ome/xml/model/enums/PixelType.h>
@@ -63,6 +66,15 @@ namespace ome
         Compression scheme;
       };
 
+      /// Compression level limits for a codec.
+      struct CodecLevelRange
+      {
+        /// Minimum (fastest) compression level.
+        int minimum;
+        /// Maximum (best) compression level.
+        int maximum;
+      };
+
       /**
        * Get codecs registered with the TIFF library.
        *
@@ -98,6 +110,72 @@ namespace ome
        */
       Compression
       getCodecScheme(const std::string& name);
+
+      /**
+       * Get the compression level range for a codec.
+       *
+       * @param scheme the compression scheme.
+       * @returns the valid level range, or @c boost::none if the
+       * codec does not support compression levels.
+       */
+      boost::optional<CodecLevelRange>
+      getCodecLevelRange(Compression scheme);
+
+      /**
+       * Get predictor names.
+       *
+       * @returns a list of predictor names.
+       */
+      const std::vector<std::string>&
+      getPredictorNames();
+
+      /**
+       * Get the predictor enumeration for a predictor name.
+       *
+       * @param name the predictor name.
+       * @returns the predictor for the name, or NONE if invalid.
+       */
+      Predictor
+      getPredictorScheme(const std::string& name);
+
+      /**
+       * Check if a predictor may be used with a codec and pixel type.
+       *
+       * Predictors are only applied by the LZW, Deflate, LZMA and
+       * ZSTD codecs.  Horizontal differencing is only applicable to
+       * integer pixel types, and floating point prediction is only
+       * applicable to floating point pixel types.  No prediction is
+       * always supported.
+       *
+       * @param scheme the compression scheme.
+       * @param predictor the predictor.
+       * @param pixeltype the pixel type to compress.
+       * @returns @c true if supported, @c false otherwise.
+       */
+      bool
+      isPredictorSupported(Compression                       scheme,
+                           Predictor                         predictor,
+                           ome::xml::model::enums::PixelType pixeltype);
+
+      /**
+       * Check if a codec may be used with a sample layout.
+       *
+       * getCodecNames() only considers the pixel type.  Some codecs
+       * also restrict the number and arrangement of samples: WebP
+       * requires 8-bit data with 3 or 4 contiguous samples.  Other
+       * codecs are not restricted.
+       *
+       * @param scheme the compression scheme.
+       * @param pixeltype the pixel type to compress.
+       * @param samples the number of samples per pixel.
+       * @param planarconfig the planar configuration.
+       * @returns @c true if supported, @c false otherwise.
+       */
+      bool
+      isCodecLayoutSupported(Compression                       scheme,
+                             ome::xml::model::enums::PixelType pixeltype,
+                             uint16_t                          samples,
+                             PlanarConfiguration               planarconfig);
     }
   }
 }
@@ -1249,6 +1249,78 @@ namespace ome
         generic_set6(getIFD(), impl->tag, pc, wc, value);
       }
 
+      /// @copydoc Field::get()
+      template<>
+      void
+      Field<DoubleTagArray1>::get(value_type& value) const
+      {
+        bool pc = passCount();
+
+        // The sample value type depends upon the pixel type, but
+        // libtiff always converts it to double.
+        if (pc != false)
+          throw Exception("FieldInfo mismatch with Field handler");
+
+        std::shared_ptr<IFD> ifd(getIFD());
+
+        // libtiff merges the per-sample values into a single value
+        // unless PERSAMPLE is set for the duration of the call.  The
+        // setting applies to the whole TIFF, so the lock is held
+        // until it is restored.
+        Sentry sentry;
+
+        uint16_t spp;
+        ifd->getRawField(TIFFTAG_SAMPLESPERPIXEL, &spp);
+
+        double *values;
+        ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MULTI);
+        try
+          {
+            ifd->getRawField(impl->tag, &values);
+          }
+        catch (const std::exception&)
+          {
+            ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MERGED);
+            throw;
+          }
+        ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MERGED);
+
+        value.assign(values, values + spp);
+      }
+
+      /// @copydoc Field::set()
+      template<>
+      void
+      Field<DoubleTagArray1>::set(const value_type& value)
+      {
+        bool pc = passCount();
+
+        if (pc != false)
+          throw Exception("FieldInfo mismatch with Field handler");
+
+        std::shared_ptr<IFD> ifd(getIFD());
+
+        // As for get(), with one value for each sample.
+        Sentry sentry;
+
+        uint16_t spp;
+        ifd->getRawField(TIFFTAG_SAMPLESPERPIXEL, &spp);
+        if (value.size() != spp)
+          throw Exception("Field array size does not match the number of samples per pixel");
+
+        ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MULTI);
+        try
+          {
+            ifd->setRawField(impl->tag, value.data());
+          }
+        catch (const std::exception&)
+          {
+            ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MERGED);
+            throw;
+          }
+        ifd->setRawField(TIFFTAG_PERSAMPLE, PERSAMPLE_MERGED);
+      }
+
       /// @copydoc Field::get()
       template<>
       void
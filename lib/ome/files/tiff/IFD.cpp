@@ -36,12 +36,23 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <complex>
 #include <cstdarg>
 #include <cassert>
-
+#include <cstdlib>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
+#include <boost/preprocessor.hpp>
 
+#include <ome/files/PixelProperties.h>
 #include <ome/files/PlaneRegion.h>
 #include <ome/files/TileBuffer.h>
 #include <ome/files/TileCache.h>
@@ -51,6 +62,7 @@
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Sentry.h>
 #include <ome/files/tiff/Exception.h>
+#include <ome/files/detail/tiff/Tags.h>
 
 #include <ome/common/string.h>
 
@@ -117,6 +129,78 @@ namespace
   // std::copy (usually memmove(3) internally) of whole tiles or tile
   // chunks where the tile widths are compatible, or individual
   // scanlines where they are not compatible.
+  //
+  // When reading with a step in X or Y, only every step'th column
+  // and row of the region (starting at its upper-left corner) is
+  // copied, and tiles containing none of the sampled pixels are not
+  // decoded at all.
+
+  // First sampled coordinate at or after start, for samples at
+  // origin + n * step.
+  dimension_size_type
+  firstSample(dimension_size_type start,
+              dimension_size_type origin,
+              dimension_size_type step)
+  {
+    return origin + (((start - origin) + step - 1U) / step) * step;
+  }
+
+  // Number of samples from first (a sampled coordinate) to end.
+  dimension_size_type
+  sampleCount(dimension_size_type first,
+              dimension_size_type end,
+              dimension_size_type step)
+  {
+    return first < end ? ((end - first) + step - 1U) / step : 0U;
+  }
+
+  // Get a decoded sample from a tile buffer.
+  template<typename V>
+  inline V
+  tileSample(const TileBuffer&   tilebuf,
+             dimension_size_type offset)
+  {
+    return reinterpret_cast<const V *>(tilebuf.data())[offset];
+  }
+
+  // Special case for BIT: unpack the sample bit.
+  template<>
+  inline PixelProperties<PixelType::BIT>::std_type
+  tileSample<PixelProperties<PixelType::BIT>::std_type>(const TileBuffer&   tilebuf,
+                                                        dimension_size_type offset)
+  {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
+    const uint8_t mask = static_cast<uint8_t>(1U << (7U - (offset % 8U)));
+    return static_cast<PixelProperties<PixelType::BIT>::std_type>(src[offset / 8U] & mask);
+  }
+
+  // Check if a sample is the fill value.
+  template<typename V>
+  inline typename std::enable_if<!std::is_floating_point<V>::value, bool>::type
+  isFillValue(const V& sample,
+              const V& value)
+  {
+    return sample == value;
+  }
+
+  // NaN never compares equal, so a NaN fill value matches any NaN.
+  template<typename V>
+  inline typename std::enable_if<std::is_floating_point<V>::value, bool>::type
+  isFillValue(V sample,
+              V value)
+  {
+    return sample == value || (std::isnan(sample) && std::isnan(value));
+  }
+
+  // Complex samples match if both parts match.
+  template<typename V>
+  inline bool
+  isFillValue(const std::complex<V>& sample,
+              const std::complex<V>& value)
+  {
+    return (isFillValue(sample.real(), value.real()) &&
+            isFillValue(sample.imag(), value.imag()));
+  }
 
   struct ReadVisitor
   {
@@ -124,16 +208,22 @@ namespace
     const TileInfo&                         tileinfo;
     const PlaneRegion&                      region;
     const std::vector<dimension_size_type>& tiles;
+    dimension_size_type                     stepX;
+    dimension_size_type                     stepY;
     TileBuffer                              tilebuf;
 
     ReadVisitor(const IFD&                              ifd,
                 const TileInfo&                         tileinfo,
                 const PlaneRegion&                      region,
-                const std::vector<dimension_size_type>& tiles):
+                const std::vector<dimension_size_type>& tiles,
+                dimension_size_type                     stepX = 1U,
+                dimension_size_type                     stepY = 1U):
       ifd(ifd),
       tileinfo(tileinfo),
       region(region),
       tiles(tiles),
+      stepX(stepX),
+      stepY(stepY),
       tilebuf(tileinfo.bufferSize())
     {}
 
@@ -150,7 +240,11 @@ namespace
              PlaneRegion&              rclip,
              uint16_t                  copysamples)
     {
-      if (rclip.w == rfull.w &&
+      if (stepX != 1U || stepY != 1U)
+        {
+          transferSampled(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+        }
+      else if (rclip.w == rfull.w &&
           rclip.x == region.x &&
           rclip.w == region.w)
         {
@@ -204,32 +298,158 @@ namespace
 
       typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
 
-      dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+      const dimension_size_type x0 = firstSample(rclip.x, region.x, stepX);
+      const dimension_size_type y0 = firstSample(rclip.y, region.y, stepY);
+      const dimension_size_type count = sampleCount(x0, rclip.x + rclip.w, stepX);
+      dimension_size_type xoffset = (x0 - rfull.x) * copysamples;
 
-      for (dimension_size_type row = rclip.y;
-           row != rclip.y + rclip.h;
-           ++row)
+      for (dimension_size_type row = y0;
+           row < rclip.y + rclip.h;
+           row += stepY)
         {
           const dimension_size_type full_row_width = rfull.w * copysamples;
           dimension_size_type yoffset = (row - rfull.y) * full_row_width;
 
-          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
-          destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+          destidx[ome::files::DIM_SPATIAL_X] = (x0 - region.x) / stepX;
+          destidx[ome::files::DIM_SPATIAL_Y] = (row - region.y) / stepY;
 
           T::value_type *dest = &buffer->at(destidx);
           const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
 
-          for (dimension_size_type sampleoffset = 0U;
-               sampleoffset < (rclip.w * copysamples);
-               ++sampleoffset)
+          for (dimension_size_type pixel = 0U; pixel < count; ++pixel)
+            for (dimension_size_type sample = 0U; sample < copysamples; ++sample)
+              {
+                dimension_size_type src_bit = yoffset + xoffset +
+                  (pixel * stepX * copysamples) + sample;
+                const uint8_t *src_byte = src + (src_bit / 8U);
+                const uint8_t bit_offset = 7U - (src_bit % 8U);
+                const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
+                assert(src_byte >= src && src_byte < src + tilebuf.size());
+                *(dest + (pixel * copysamples) + sample) = static_cast<T::value_type>(*src_byte & mask);
+              }
+        }
+    }
+
+    template<typename T>
+    void
+    transferSampled(std::shared_ptr<T>&       buffer,
+                    typename T::indices_type& destidx,
+                    const TileBuffer&         tilebuf,
+                    PlaneRegion&              rfull,
+                    PlaneRegion&              rclip,
+                    uint16_t                  copysamples)
+    {
+      // Transfer the sampled pixels of each sampled row.
+
+      const dimension_size_type x0 = firstSample(rclip.x, region.x, stepX);
+      const dimension_size_type y0 = firstSample(rclip.y, region.y, stepY);
+      const dimension_size_type count = sampleCount(x0, rclip.x + rclip.w, stepX);
+      const dimension_size_type xoffset = (x0 - rfull.x) * copysamples;
+      const dimension_size_type srcstep = stepX * copysamples;
+
+      for (dimension_size_type row = y0;
+           row < rclip.y + rclip.h;
+           row += stepY)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
+
+          destidx[ome::files::DIM_SPATIAL_X] = (x0 - region.x) / stepX;
+          destidx[ome::files::DIM_SPATIAL_Y] = (row - region.y) / stepY;
+
+          typename T::value_type *dest = &buffer->at(destidx);
+          const typename T::value_type *src =
+            reinterpret_cast<const typename T::value_type *>(tilebuf.data()) + yoffset + xoffset;
+
+          if (copysamples == 1U)
             {
-              dimension_size_type src_bit = yoffset + xoffset + sampleoffset;
-              const uint8_t *src_byte = src + (src_bit / 8U);
-              const uint8_t bit_offset = 7U - (src_bit % 8U);
-              const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
-              assert(src_byte >= src && src_byte < src + tilebuf.size());
-              *(dest+sampleoffset) = static_cast<T::value_type>(*src_byte & mask);
+              for (dimension_size_type pixel = 0U; pixel < count; ++pixel)
+                dest[pixel] = src[pixel * srcstep];
             }
+          else
+            {
+              for (dimension_size_type pixel = 0U; pixel < count; ++pixel)
+                std::copy(src + (pixel * srcstep),
+                          src + (pixel * srcstep) + copysamples,
+                          dest + (pixel * copysamples));
+            }
+        }
+    }
+
+    template<typename T>
+    void
+    transferStrided(std::shared_ptr<T>&       buffer,
+                    typename T::indices_type& destidx,
+                    const TileBuffer&         tilebuf,
+                    PlaneRegion&              rfull,
+                    PlaneRegion&              rclip,
+                    uint16_t                  copysamples)
+    {
+      // Interleave or deinterleave the sampled pixels of each sampled
+      // row directly into the destination storage order.
+
+      const boost::multi_array_types::index *strides = buffer->strides();
+      const boost::multi_array_types::index xstride = strides[ome::files::DIM_SPATIAL_X];
+      const boost::multi_array_types::index sstride = strides[ome::files::DIM_SUBCHANNEL];
+
+      const dimension_size_type x0 = firstSample(rclip.x, region.x, stepX);
+      const dimension_size_type y0 = firstSample(rclip.y, region.y, stepY);
+      const dimension_size_type count = sampleCount(x0, rclip.x + rclip.w, stepX);
+      const dimension_size_type xoffset = (x0 - rfull.x) * copysamples;
+      const dimension_size_type srcstep = stepX * copysamples;
+
+      for (dimension_size_type row = y0;
+           row < rclip.y + rclip.h;
+           row += stepY)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
+
+          destidx[ome::files::DIM_SPATIAL_X] = (x0 - region.x) / stepX;
+          destidx[ome::files::DIM_SPATIAL_Y] = (row - region.y) / stepY;
+
+          typename T::value_type *dest = &buffer->at(destidx);
+
+          for (dimension_size_type pixel = 0U; pixel < count; ++pixel)
+            for (dimension_size_type sample = 0U; sample < copysamples; ++sample)
+              dest[static_cast<boost::multi_array_types::index>(pixel) * xstride +
+                   static_cast<boost::multi_array_types::index>(sample) * sstride] =
+                tileSample<typename T::value_type>(tilebuf, yoffset + xoffset + (pixel * srcstep) + sample);
+        }
+    }
+
+    template<typename T>
+    void
+    fill(std::shared_ptr<T>&       buffer,
+         typename T::indices_type& destidx,
+         PlaneRegion&              rclip,
+         uint16_t                  copysamples,
+         bool                      native)
+    {
+      // Fill sparse tile without decoding.
+
+      const typename T::value_type value =
+        static_cast<typename T::value_type>(ifd.getFillValue());
+
+      const boost::multi_array_types::index *strides = buffer->strides();
+
+      const dimension_size_type x0 = firstSample(rclip.x, region.x, stepX);
+      const dimension_size_type y0 = firstSample(rclip.y, region.y, stepY);
+      const dimension_size_type count = sampleCount(x0, rclip.x + rclip.w, stepX);
+
+      for (dimension_size_type row = y0;
+           row < rclip.y + rclip.h;
+           row += stepY)
+        {
+          destidx[ome::files::DIM_SPATIAL_X] = (x0 - region.x) / stepX;
+          destidx[ome::files::DIM_SPATIAL_Y] = (row - region.y) / stepY;
+
+          typename T::value_type *dest = &buffer->at(destidx);
+          if (native)
+            std::fill(dest, dest + (count * copysamples), value);
+          else
+            for (dimension_size_type pixel = 0U; pixel < count; ++pixel)
+              for (dimension_size_type sample = 0U; sample < copysamples; ++sample)
+                dest[static_cast<boost::multi_array_types::index>(pixel) * strides[ome::files::DIM_SPATIAL_X] +
+                     static_cast<boost::multi_array_types::index>(sample) * strides[ome::files::DIM_SUBCHANNEL]] = value;
         }
     }
 
@@ -269,8 +489,28 @@ namespace
       uint16_t samples = ifd.getSamplesPerPixel();
       PlanarConfiguration planarconfig = ifd.getPlanarConfiguration();
 
+      // The decoded samples may be copied a row at a time if the
+      // destination storage order matches the planar configuration;
+      // otherwise they are interleaved or deinterleaved per sample.
+      const boost::multi_array_types::index *strides = buffer->strides();
+      const boost::multi_array_types::index copystride = planarconfig == SEPARATE ? 1 : samples;
+      const bool native = strides[ome::files::DIM_SPATIAL_X] == copystride &&
+        strides[ome::files::DIM_SPATIAL_Y] ==
+        copystride * static_cast<boost::multi_array_types::index>(buffer->shape()[ome::files::DIM_SPATIAL_X]) &&
+        (copystride == 1 || strides[ome::files::DIM_SUBCHANNEL] == 1);
+
+      // Hold the lock for the whole read, so that other threads
+      // sharing the TIFF can't change the current directory (and
+      // invalidate the byte counts) between reads.  Decoding is done
+      // by libtiff under the same lock, so reads are serialised with
+      // all other libtiff calls in the process.
       Sentry sentry;
 
+      // Byte counts are used to detect sparse (unwritten) tiles.
+      uint64_t *bytecounts = nullptr;
+      ifd.getRawField(type == TILE ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS,
+                      &bytecounts);
+
       for(const auto i : tiles)
         {
           tstrile_t tile = static_cast<tstrile_t>(i);
@@ -286,6 +526,20 @@ namespace
               dest_subchannel = sample;
             }
 
+          typename T::indices_type destidx;
+          destidx[ome::files::DIM_SPATIAL_X] = 0;
+          destidx[ome::files::DIM_SPATIAL_Y] = 0;
+          destidx[ome::files::DIM_SUBCHANNEL] = dest_subchannel;
+          destidx[ome::files::DIM_SPATIAL_Z] = destidx[ome::files::DIM_TEMPORAL_T] =
+            destidx[ome::files::DIM_CHANNEL] = destidx[ome::files::DIM_MODULO_Z] =
+            destidx[ome::files::DIM_MODULO_T] = destidx[ome::files::DIM_MODULO_C] = 0;
+
+          if (bytecounts && bytecounts[tile] == 0)
+            {
+              fill(buffer, destidx, rclip, copysamples, native);
+              continue;
+            }
+
           if (type == TILE)
             {
               tmsize_t bytesread = TIFFReadEncodedTile(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
@@ -304,15 +558,10 @@ namespace
                 sentry.error("Failed to read encoded strip fully");
             }
 
-          typename T::indices_type destidx;
-          destidx[ome::files::DIM_SPATIAL_X] = 0;
-          destidx[ome::files::DIM_SPATIAL_Y] = 0;
-          destidx[ome::files::DIM_SUBCHANNEL] = dest_subchannel;
-          destidx[ome::files::DIM_SPATIAL_Z] = destidx[ome::files::DIM_TEMPORAL_T] =
-            destidx[ome::files::DIM_CHANNEL] = destidx[ome::files::DIM_MODULO_Z] =
-            destidx[ome::files::DIM_MODULO_T] = destidx[ome::files::DIM_MODULO_C] = 0;
-
-          transfer(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+          if (native)
+            transfer(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+          else
+            transferStrided(buffer, destidx, tilebuf, rfull, rclip, copysamples);
         }
     }
   };
@@ -340,16 +589,78 @@ namespace
       tiles(tiles)
     {}
 
+    // Check if the valid area of a tile contains only the fill value.
+    template<typename T>
+    bool
+    sparse(const std::shared_ptr<T>& /* buffer */,
+           const TileBuffer&         tilebuf,
+           const PlaneRegion&        rfull,
+           const PlaneRegion&        rvalid,
+           uint16_t                  copysamples) const
+    {
+      const typename T::value_type value =
+        static_cast<typename T::value_type>(ifd.getFillValue());
+      const typename T::value_type *src = reinterpret_cast<const typename T::value_type *>(tilebuf.data());
+
+      for (dimension_size_type row = 0;
+           row < rvalid.h;
+           ++row)
+        {
+          const typename T::value_type *begin = src + (row * rfull.w * copysamples);
+          const typename T::value_type *end = begin + (rvalid.w * copysamples);
+          for (const typename T::value_type *sample = begin; sample != end; ++sample)
+            if (!isFillValue(*sample, value))
+              return false;
+        }
+      return true;
+    }
+
+    // Special case for BIT
+    bool
+    sparse(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& /* buffer */,
+           const TileBuffer&                                                              tilebuf,
+           const PlaneRegion&                                                             rfull,
+           const PlaneRegion&                                                             rvalid,
+           uint16_t                                                                       copysamples) const
+    {
+      const bool value = static_cast<bool>(ifd.getFillValue());
+      const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
+
+      for (dimension_size_type row = 0;
+           row < rvalid.h;
+           ++row)
+        {
+          dimension_size_type yoffset = row * rfull.w * copysamples;
+
+          for (dimension_size_type sampleoffset = 0;
+               sampleoffset < (rvalid.w * copysamples);
+               ++sampleoffset)
+            {
+              dimension_size_type src_bit = yoffset + sampleoffset;
+              const uint8_t bit_offset = 7 - (src_bit % 8);
+              const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
+              if (static_cast<bool>(*(src + (src_bit / 8)) & mask) != value)
+                return false;
+            }
+        }
+      return true;
+    }
+
     // Flush covered tiles.
+    template<typename T>
     void
-    flush()
+    flush(const std::shared_ptr<T>& buffer)
     {
       std::shared_ptr<::ome::files::tiff::TIFF>& tiff(ifd.getTIFF());
       ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
       TileType type = tileinfo.tileType();
       PlaneRegion rimage(0, 0, ifd.getImageWidth(), ifd.getImageHeight());
       tstrile_t tile = static_cast<tstrile_t>(ifd.getCurrentTile());
+      uint16_t copysamples = ifd.getPlanarConfiguration() == SEPARATE ? 1 : ifd.getSamplesPerPixel();
+      bool sparsetiles = ifd.getSparse();
 
+      // Tiles are encoded by libtiff under the lock, so encoding is
+      // serialised with all other libtiff calls in the process.
       Sentry sentry;
       while(tile < tileinfo.tileCount())
         {
@@ -364,7 +675,13 @@ namespace
 
           assert(tilecache.find(tile));
           TileBuffer& tilebuf = *tilecache.find(tile);
-          if (type == TILE)
+          if (sparsetiles &&
+              sparse(buffer, tilebuf, tileinfo.tileRegion(tile), validarea, copysamples))
+            {
+              // Skip writing; the tile offset and byte count remain
+              // zero.
+            }
+          else if (type == TILE)
             {
               tsize_t byteswritten = TIFFWriteEncodedTile(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
               if (byteswritten < 0)
@@ -528,7 +845,7 @@ namespace
         }
 
       // Flush covered tiles
-      flush();
+      flush(buffer);
     }
   };
 
@@ -544,6 +861,101 @@ namespace ome
       namespace
       {
 
+        // Get the codec pseudo-tag used to set the compression level.
+        tag_type
+        compressionLevelTag(Compression compression)
+        {
+          tag_type tag = 0;
+
+          switch(compression)
+            {
+            case COMPRESSION_ADOBE_DEFLATE:
+            case COMPRESSION_DEFLATE:
+#ifdef TIFFTAG_ZIPQUALITY
+              tag = TIFFTAG_ZIPQUALITY;
+#endif
+              break;
+            case COMPRESSION_LZMA:
+#ifdef TIFFTAG_LZMAPRESET
+              tag = TIFFTAG_LZMAPRESET;
+#endif
+              break;
+            case COMPRESSION_ZSTD:
+#ifdef TIFFTAG_ZSTD_LEVEL
+              tag = TIFFTAG_ZSTD_LEVEL;
+#endif
+              break;
+            case COMPRESSION_WEBP:
+#ifdef TIFFTAG_WEBP_LEVEL
+              tag = TIFFTAG_WEBP_LEVEL;
+#endif
+              break;
+            default:
+              break;
+            }
+
+          return tag;
+        }
+
+        // Register the GDAL no data tag, used to store the fill
+        // value.  libtiff drops registered field information when
+        // changing directory, so this is needed before each use.
+        void
+        registerNoDataTag(::TIFF *tiffraw)
+        {
+          // Writable string to comply with the TIFFFieldInfo
+          // interface; it must outlive the registered field info.
+          static std::string nodata("GDALNoDataValue");
+          static const TIFFFieldInfo NoDataFieldInfo
+            {
+              TIFFTAG_GDAL_NODATA,
+              TIFF_VARIABLE, TIFF_VARIABLE, TIFF_ASCII, FIELD_CUSTOM,
+              true, false, const_cast<char *>(nodata.c_str())
+            };
+
+          if (!TIFFFindField(tiffraw, TIFFTAG_GDAL_NODATA, TIFF_ANY))
+            TIFFMergeFieldInfo(tiffraw, &NoDataFieldInfo, 1);
+        }
+
+        // Parse a GDAL no data value.  Numbers are parsed in the
+        // classic locale, as written by IFD::setFillValue().  NaN
+        // and infinities are spelt as by printf, which
+        // std::istream does not accept.
+        bool
+        parseNoData(const std::string& text,
+                    double&            value)
+        {
+          std::string number(text);
+          boost::trim(number);
+          std::string name(boost::to_lower_copy(number));
+          bool negative = false;
+          if (!name.empty() && (name[0] == '-' || name[0] == '+'))
+            {
+              negative = name[0] == '-';
+              name.erase(0, 1);
+            }
+          if (name == "nan")
+            {
+              value = std::numeric_limits<double>::quiet_NaN();
+              return true;
+            }
+          if (name == "inf" || name == "infinity")
+            {
+              value = negative ? -std::numeric_limits<double>::infinity() :
+                std::numeric_limits<double>::infinity();
+              return true;
+            }
+
+          std::istringstream is(number);
+          is.imbue(std::locale::classic());
+          double parsed;
+          is >> parsed;
+          if (!is || !(is >> std::ws).eof())
+            return false;
+          value = parsed;
+          return true;
+        }
+
         class IFDConcrete : public IFD
         {
         public:
@@ -602,6 +1014,12 @@ namespace ome
         boost::optional<PhotometricInterpretation> photometric;
         /// Compression scheme.
         boost::optional<Compression> compression;
+        /// Predictor.
+        boost::optional<Predictor> predictor;
+        /// Skip writing tiles containing only the fill value.
+        bool sparse;
+        /// Fill value for sparse tiles.
+        boost::optional<double> fillvalue;
         /// Current tile (for writing).
         tstrile_t ctile;
 
@@ -624,6 +1042,8 @@ namespace ome
           pixeltype(),
           samples(),
           planarconfig(),
+          sparse(false),
+          fillvalue(),
           ctile(0)
         {
         }
@@ -1215,6 +1635,163 @@ namespace ome
         impl->compression = compression;
       }
 
+      Predictor
+      IFD::getPredictor() const
+      {
+        if (!impl->predictor)
+          {
+            Predictor predictor;
+            try
+              {
+                getField(PREDICTOR).get(predictor);
+              }
+            catch(const Exception&)
+              {
+                // Not set, or not supported by the codec.
+                predictor = NONE;
+              }
+            impl->predictor = predictor;
+          }
+        return impl->predictor.get();
+      }
+
+      void
+      IFD::setPredictor(Predictor predictor)
+      {
+        getField(PREDICTOR).set(predictor);
+        impl->predictor = predictor;
+      }
+
+      int
+      IFD::getCompressionLevel() const
+      {
+        tag_type tag = compressionLevelTag(getCompression());
+        if (!tag)
+          {
+            boost::format fmt("Compression scheme %1% does not support compression levels");
+            fmt % getCompression();
+            throw Exception(fmt.str());
+          }
+
+        int level;
+        getRawField(tag, &level);
+        return level;
+      }
+
+      void
+      IFD::setCompressionLevel(int level)
+      {
+        tag_type tag = compressionLevelTag(getCompression());
+        if (!tag)
+          {
+            boost::format fmt("Compression scheme %1% does not support compression levels");
+            fmt % getCompression();
+            throw Exception(fmt.str());
+          }
+
+        setRawField(tag, level);
+      }
+
+      bool
+      IFD::getSparse() const
+      {
+        return impl->sparse;
+      }
+
+      void
+      IFD::setSparse(bool sparse)
+      {
+        impl->sparse = sparse;
+      }
+
+      double
+      IFD::getFillValue() const
+      {
+        if (!impl->fillvalue)
+          {
+            std::shared_ptr<TIFF>& tiff = getTIFF();
+            ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+            Sentry sentry;
+
+            makeCurrent();
+
+            double fillvalue = 0.0;
+
+            // The tag is unknown to libtiff unless registered before
+            // the directory was read, in which case libtiff stores
+            // it with an explicit count.
+            const TIFFField *field = TIFFFindField(tiffraw, TIFFTAG_GDAL_NODATA, TIFF_ANY);
+            if (field)
+              {
+                char *text = nullptr;
+                int found;
+                if (TIFFFieldPassCount(field))
+                  {
+                    uint32_t count = 0;
+                    if (TIFFFieldReadCount(field) == TIFF_VARIABLE2)
+                      found = TIFFGetField(tiffraw, TIFFTAG_GDAL_NODATA, &count, &text);
+                    else
+                      {
+                        uint16_t count16 = 0;
+                        found = TIFFGetField(tiffraw, TIFFTAG_GDAL_NODATA, &count16, &text);
+                        count = count16;
+                      }
+                    if (found && text && count)
+                      {
+                        // The count includes the terminating null.
+                        const std::string nodata(text, count);
+                        parseNoData(nodata.substr(0, nodata.find('\0')), fillvalue);
+                      }
+                  }
+                else
+                  {
+                    found = TIFFGetField(tiffraw, TIFFTAG_GDAL_NODATA, &text);
+                    if (found && text)
+                      parseNoData(text, fillvalue);
+                  }
+              }
+
+            // Values which the pixel type can not hold (for example,
+            // a negative value for an unsigned type) are ignored.
+            if (!ome::files::isRepresentable(fillvalue, getPixelType()))
+              fillvalue = 0.0;
+
+            impl->fillvalue = fillvalue;
+          }
+        return impl->fillvalue.get();
+      }
+
+      void
+      IFD::setFillValue(double fillvalue)
+      {
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        Sentry sentry;
+
+        makeCurrent();
+
+        // Zero is the default, so only other values are stored.
+        if (fillvalue != 0.0)
+          {
+            std::ostringstream os;
+            os.imbue(std::locale::classic());
+            os.precision(std::numeric_limits<double>::max_digits10);
+            os << fillvalue;
+
+            registerNoDataTag(tiffraw);
+            if (!TIFFSetField(tiffraw, TIFFTAG_GDAL_NODATA, os.str().c_str()))
+              sentry.error();
+          }
+        else if (TIFFFindField(tiffraw, TIFFTAG_GDAL_NODATA, TIFF_ANY))
+          {
+            TIFFUnsetField(tiffraw, TIFFTAG_GDAL_NODATA);
+          }
+
+        impl->fillvalue = fillvalue;
+      }
+
       void
       IFD::readImage(VariantPixelBuffer& buf) const
       {
@@ -1235,13 +1812,28 @@ namespace ome
                      dimension_size_type w,
                      dimension_size_type h) const
       {
+        readImage(dest, x, y, w, h, 1U, 1U);
+      }
+
+      void
+      IFD::readImage(VariantPixelBuffer& dest,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h,
+                     dimension_size_type stepX,
+                     dimension_size_type stepY) const
+      {
+        if (stepX == 0U || stepY == 0U)
+          throw Exception("Invalid zero step for sampled image read");
+
         PixelType type = getPixelType();
         PlanarConfiguration planarconfig = getPlanarConfiguration();
         uint16_t subC = getSamplesPerPixel();
 
         std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
-        shape[DIM_SPATIAL_X] = w;
-        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_SPATIAL_X] = (w + stepX - 1U) / stepX;
+        shape[DIM_SPATIAL_Y] = (h + stepY - 1U) / stepY;
         shape[DIM_SUBCHANNEL] = subC;
         shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
           shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
@@ -1252,9 +1844,11 @@ namespace ome
 
         PixelBufferBase::storage_order_type order(PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, planarconfig == SEPARATE ? false : true));
 
+        // A destination of the correct type and size is used in its
+        // existing storage order; the samples are interleaved or
+        // deinterleaved as they are transferred.
         if (type != dest.pixelType() ||
-            shape != dest_shape ||
-            !(order == dest.storage_order()))
+            shape != dest_shape)
           dest.setBuffer(shape, type, order);
 
         TileInfo info = getTileInfo();
@@ -1262,10 +1856,73 @@ namespace ome
         PlaneRegion region(x, y, w, h);
         std::vector<dimension_size_type> tiles(info.tileCoverage(region));
 
-        ReadVisitor v(*this, info, region, tiles);
+        // Skip tiles which do not contain any sampled pixels.
+        if (stepX != 1U || stepY != 1U)
+          {
+            std::vector<dimension_size_type> sampled;
+            for (const auto tile : tiles)
+              {
+                PlaneRegion rclip = info.tileRegion(tile, region);
+                if (sampleCount(firstSample(rclip.x, x, stepX), rclip.x + rclip.w, stepX) &&
+                    sampleCount(firstSample(rclip.y, y, stepY), rclip.y + rclip.h, stepY))
+                  sampled.push_back(tile);
+              }
+            tiles.swap(sampled);
+          }
+
+        ReadVisitor v(*this, info, region, tiles, stepX, stepY);
         ome::compat::visit(v, dest.vbuffer());
       }
 
+      template<typename T>
+      void
+      IFD::readImage(PixelBuffer<T>&     dest,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const
+      {
+        PixelType type = getPixelType();
+        if (type != dest.pixelType())
+          {
+            boost::format fmt("Pixel buffer type %1% does not match image pixel type %2%");
+            fmt % dest.pixelType() % type;
+            throw Exception(fmt.str());
+          }
+
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        shape[DIM_SPATIAL_X] = w;
+        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_SUBCHANNEL] = getSamplesPerPixel();
+        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+        if (!std::equal(shape.begin(), shape.end(), dest.shape()))
+          throw Exception("Pixel buffer extents do not match region");
+
+        TileInfo info = getTileInfo();
+
+        PlaneRegion region(x, y, w, h);
+        std::vector<dimension_size_type> tiles(info.tileCoverage(region));
+
+        // Refer to the caller's buffer without taking ownership.
+        std::shared_ptr<PixelBuffer<T>> buffer(std::shared_ptr<PixelBuffer<T>>(), &dest);
+
+        ReadVisitor v(*this, info, region, tiles);
+        v(buffer);
+      }
+
+#define OME_FILES_TIFF_IFD_READIMAGE_INSTANTIATE(maR, maProperty, maType) \
+      template void                                                     \
+      IFD::readImage(PixelBuffer<PixelProperties<PixelType::maType>::std_type>& dest, \
+                     dimension_size_type                                       x, \
+                     dimension_size_type                                       y, \
+                     dimension_size_type                                       w, \
+                     dimension_size_type                                       h) const;
+
+      BOOST_PP_SEQ_FOR_EACH(OME_FILES_TIFF_IFD_READIMAGE_INSTANTIATE, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES)
+
+#undef OME_FILES_TIFF_IFD_READIMAGE_INSTANTIATE
+
       void
       IFD::readImage(VariantPixelBuffer& dest,
                      dimension_size_type x,
@@ -1421,6 +2078,105 @@ namespace ome
         throw Exception("Writing subchannels separately is not yet implemented (requires TileCache and WriteVisitor to handle writing and caching of interleaved and non-interleaved subchannels; currently it handles writing all subchannels in one call only and can not combine separate subchannels from separate calls");
       }
 
+      void
+      IFD::copyTiles(const IFD& source)
+      {
+        if (source.getImageWidth() != getImageWidth() ||
+            source.getImageHeight() != getImageHeight() ||
+            source.getTileType() != getTileType() ||
+            source.getTileWidth() != getTileWidth() ||
+            source.getTileHeight() != getTileHeight() ||
+            source.getBitsPerSample() != getBitsPerSample() ||
+            source.getSamplesPerPixel() != getSamplesPerPixel() ||
+            source.getPlanarConfiguration() != getPlanarConfiguration() ||
+            source.getPixelType() != getPixelType() ||
+            source.getCompression() != getCompression() ||
+            source.getPredictor() != getPredictor())
+          throw Exception("Source IFD tiling or compression is incompatible with destination IFD");
+
+        const Compression compression = getCompression();
+        if (compression == COMPRESSION_OJPEG)
+          throw Exception("Copying old-style JPEG tiles is not supported");
+
+        // Sparse tiles are left unwritten, so the fill value must be
+        // the same for them to be read as the same values.
+        setFillValue(source.getFillValue());
+
+        TileInfo info = getTileInfo();
+        TileType type = info.tileType();
+
+        ::TIFF *sourceraw = reinterpret_cast<::TIFF *>(source.getTIFF()->getWrapped());
+        ::TIFF *destraw = reinterpret_cast<::TIFF *>(getTIFF()->getWrapped());
+
+        // The byte counts point into the directory of the source
+        // handle, so hold the lock while they are in use.
+        Sentry sentry;
+
+        // Byte counts are used to detect sparse (unwritten) tiles.
+        uint64_t *bytecounts = nullptr;
+        source.getRawField(type == TILE ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS,
+                           &bytecounts);
+        if (!bytecounts)
+          throw Exception("Source IFD has no tile or strip byte counts");
+
+        source.makeCurrent();
+        makeCurrent();
+
+        // Codec parameters stored in tags rather than in each tile
+        // are needed to decode the copied tiles.
+        if (compression == COMPRESSION_JPEG)
+          {
+            // Quantization and Huffman tables shared by all tiles.
+            uint32_t count = 0;
+            void *tables = nullptr;
+            if (TIFFGetField(sourceraw, TIFFTAG_JPEGTABLES, &count, &tables) && count && tables)
+              {
+                if (!TIFFSetField(destraw, TIFFTAG_JPEGTABLES, count, tables))
+                  sentry.error("Failed to set JPEG tables");
+              }
+          }
+#ifdef TIFFTAG_LERC_PARAMETERS
+        else if (compression == COMPRESSION_LERC &&
+                 TIFFFindField(sourceraw, TIFFTAG_LERC_PARAMETERS, TIFF_ANY))
+          {
+            // LERC version and additional (Deflate or Zstandard)
+            // compression of each tile.
+            uint32_t count = 0;
+            uint32_t *parameters = nullptr;
+            if (TIFFGetField(sourceraw, TIFFTAG_LERC_PARAMETERS, &count, &parameters) && count && parameters)
+              {
+                if (!TIFFSetField(destraw, TIFFTAG_LERC_PARAMETERS, count, parameters))
+                  sentry.error("Failed to set LERC parameters");
+              }
+          }
+#endif
+
+        std::vector<uint8_t> buf;
+        const tstrile_t count = static_cast<tstrile_t>(info.tileCount());
+        for (tstrile_t tile = 0; tile < count; ++tile)
+          {
+            if (bytecounts[tile] == 0)
+              continue;
+
+            buf.resize(static_cast<std::vector<uint8_t>::size_type>(bytecounts[tile]));
+            const tmsize_t size = static_cast<tmsize_t>(buf.size());
+
+            tmsize_t bytesread = type == TILE ?
+              TIFFReadRawTile(sourceraw, tile, buf.data(), size) :
+              TIFFReadRawStrip(sourceraw, tile, buf.data(), size);
+            if (bytesread != size)
+              sentry.error(type == TILE ? "Failed to read raw tile" : "Failed to read raw strip");
+
+            tmsize_t byteswritten = type == TILE ?
+              TIFFWriteRawTile(destraw, tile, buf.data(), size) :
+              TIFFWriteRawStrip(destraw, tile, buf.data(), size);
+            if (byteswritten != size)
+              sentry.error(type == TILE ? "Failed to write raw tile" : "Failed to write raw strip");
+          }
+
+        setCurrentTile(count);
+      }
+
       std::shared_ptr<IFD>
       IFD::next() const
       {
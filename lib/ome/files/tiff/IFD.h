@@ -473,6 +473,100 @@ namespace ome
         void
         setCompression(Compression compression);
 
+        /**
+         * Get predictor.
+         *
+         * @returns the prediction scheme applied before encoding.
+         */
+        Predictor
+        getPredictor() const;
+
+        /**
+         * Set predictor.
+         *
+         * @note The compression scheme must be set before the
+         * predictor.
+         *
+         * @param predictor the prediction scheme applied before
+         * encoding.
+         */
+        void
+        setPredictor(Predictor predictor);
+
+        /**
+         * Get compression level.
+         *
+         * @returns the compression level of the current codec.
+         * @throws an Exception if the current codec does not support
+         * compression levels.
+         */
+        int
+        getCompressionLevel() const;
+
+        /**
+         * Set compression level.
+         *
+         * The level is not stored in the TIFF file; it is only used
+         * by the codec when writing.
+         *
+         * @note The compression scheme must be set before the
+         * compression level.
+         *
+         * @param level the compression level of the current codec.
+         * @throws an Exception if the current codec does not support
+         * compression levels.
+         */
+        void
+        setCompressionLevel(int level);
+
+        /**
+         * Get sparse tile writing.
+         *
+         * @returns @c true if sparse tile writing is enabled, @c
+         * false otherwise.
+         */
+        bool
+        getSparse() const;
+
+        /**
+         * Set sparse tile writing.
+         *
+         * If enabled, tiles (or strips) consisting entirely of the
+         * fill value will not be written.  Their offset and byte
+         * count will be left as zero.  Such tiles are always
+         * recognised when reading, irrespective of this setting.
+         *
+         * @param sparse @c true to enable sparse tile writing, @c
+         * false to disable.
+         */
+        void
+        setSparse(bool sparse);
+
+        /**
+         * Get fill value.
+         *
+         * When reading, the value is taken from the GDAL_NODATA tag.
+         * A value which the pixel type can not hold (see
+         * isRepresentable()) is ignored, and zero is used instead.
+         *
+         * @returns the sample value used for sparse tiles.
+         */
+        double
+        getFillValue() const;
+
+        /**
+         * Set fill value.
+         *
+         * When writing, tiles consisting entirely of this value will
+         * be skipped if sparse tile writing is enabled.  When
+         * reading, tiles with a zero byte count will be filled with
+         * this value without decoding.  The default is zero.
+         *
+         * @param fillvalue the sample value used for sparse tiles.
+         */
+        void
+        setFillValue(double fillvalue);
+
         /**
          * Read a whole image plane into a pixel buffer.
          *
@@ -494,8 +588,17 @@ namespace ome
          *
          * If the destination pixel buffer is of a different size to
          * the region being read, or is of the incorrect pixel type,
-         * or has a different storage order, it will be resized using
-         * the correct pixel type and storage order.
+         * it will be resized using the correct pixel type, and a
+         * storage order with the samples interleaved if the planar
+         * configuration is contiguous.  Otherwise, the existing
+         * storage order of the destination is used, and the samples
+         * are interleaved or deinterleaved as they are transferred,
+         * which is slower than transferring whole rows but avoids a
+         * separate reordering pass.
+         *
+         * The tiles are read, decoded and transferred while holding
+         * the libtiff lock (see Sentry), so concurrent reads are
+         * serialised.
          *
          * @param dest the destination pixel buffer.
          * @param x the @c X coordinate of the upper-left corner of the sub-image.
@@ -522,6 +625,60 @@ namespace ome
                   dimension_size_type h,
                   dimension_size_type subC) const;
 
+        /**
+         * Read every @c stepX'th column and @c stepY'th row of a
+         * region of an image plane into a pixel buffer.
+         *
+         * The pixel at (@c x, @c y) is always read.  The destination
+         * will be of size ⌈w/stepX⌉ by ⌈h/stepY⌉, and will be resized
+         * as for the unstrided form.  Only the tiles or strips
+         * containing sampled pixels are read and decoded.
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param stepX the column step (1 to read every column).
+         * @param stepY the row step (1 to read every row).
+         * @throws Exception if either step is zero.
+         */
+        void
+        readImage(VariantPixelBuffer& dest,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h,
+                  dimension_size_type stepX,
+                  dimension_size_type stepY) const;
+
+        /**
+         * Read a region of an image plane into a typed pixel buffer.
+         *
+         * The buffer must have the pixel type of the image and the
+         * extents of the region, with the samples per pixel as the
+         * subchannel extent.  It is never reallocated, and is used
+         * in its existing storage order.  The samples are
+         * transferred by code specialised for the pixel type, with
+         * no variant dispatch, so repeated reads of the same size
+         * may reuse one buffer.
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @throws Exception if the pixel type or extents of the
+         * buffer do not match.
+         */
+        template<typename T>
+        void
+        readImage(PixelBuffer<T>&     dest,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h) const;
+
         /**
          * Read a lookup table into a pixel buffer.
          *
@@ -578,6 +735,26 @@ namespace ome
                    dimension_size_type       h,
                    dimension_size_type       subC);
 
+        /**
+         * Copy the compressed tiles or strips of another IFD.
+         *
+         * The tiles or strips are copied without decoding and
+         * re-encoding them, so the source IFD must have the same
+         * image size, tiling, pixel format, compression and predictor
+         * as this IFD.  Unwritten (sparse) tiles in the source are
+         * left unwritten, and the fill value of the source is set on
+         * this IFD.  Codec parameters stored outside the tiles (JPEG
+         * tables and LERC parameters) are also copied.
+         *
+         * @note Old-style JPEG is not supported.
+         *
+         * @param source the IFD to copy.
+         * @throws Exception if the IFD layouts differ or the copy
+         * fails.
+         */
+        void
+        copyTiles(const IFD& source);
+
         /**
          * Get next directory.
          *
@@ -65,25 +65,6 @@ namespace ome
         /// Sentry currently holding the tiff_lock mutex.
         Sentry *currentSentry = 0;
 
-        /**
-         * Set the libtiff error handler.
-         *
-         * @param sentry the current Sentry.
-         * @param handler the handler function to set.
-         * @returns the old handler to allow later restoration.
-         */
-        TIFFErrorHandler
-        setHandler(Sentry           *sentry,
-                   TIFFErrorHandler  handler)
-        {
-          if (sentry)
-            currentSentry = sentry;
-          TIFFErrorHandler old = TIFFSetErrorHandler(handler);
-          if (!sentry)
-            currentSentry = sentry;
-          return old;
-        }
-
       }
 
       std::recursive_mutex Sentry::tiff_mutex;
@@ -152,14 +133,21 @@ namespace ome
 
       Sentry::Sentry():
         lock(tiff_mutex),
-        message()
+        message(),
+        previous(currentSentry)
       {
-        oldErrorHandler = setHandler(this, &Sentry::errorHandler);
+        // Only the outermost Sentry (of nested Sentries in the thread
+        // holding the lock) saves and restores the handler.
+        if (!previous)
+          oldErrorHandler = TIFFSetErrorHandler(&Sentry::errorHandler);
+        currentSentry = this;
       }
 
       Sentry::~Sentry()
       {
-        setHandler(0, oldErrorHandler);
+        currentSentry = previous;
+        if (!previous)
+          TIFFSetErrorHandler(oldErrorHandler);
       }
 
       void
@@ -67,7 +67,8 @@ namespace ome
        * available using getMessage().
        *
        * This class should be used at block scope so that instances
-       * will only exist transiently until the block ends.
+       * will only exist transiently until the block ends.  Sentries
+       * may be nested; errors are captured by the innermost Sentry.
        */
       class Sentry
       {
@@ -134,6 +135,9 @@ namespace ome
         /// Last error message.
         std::string message;
 
+        /// Enclosing Sentry in the same thread, if nested.
+        Sentry *previous;
+
         /**
          * libtiff error handler.
          *
@@ -736,6 +736,27 @@ namespace ome
         return ret;
       }
 
+      tag_type
+      getWrappedTag(DoubleTagArray1 tag)
+      {
+        tag_type ret = 0;
+
+        switch(tag)
+          {
+          case SMINSAMPLEVALUE:
+#ifdef TIFFTAG_SMINSAMPLEVALUE
+            ret = TIFFTAG_SMINSAMPLEVALUE;
+#endif
+            break;
+          case SMAXSAMPLEVALUE:
+#ifdef TIFFTAG_SMAXSAMPLEVALUE
+            ret = TIFFTAG_SMAXSAMPLEVALUE;
+#endif
+            break;
+          };
+        return ret;
+      }
+
 #ifdef __GNUC__
 #  pragma GCC diagnostic pop
 #endif
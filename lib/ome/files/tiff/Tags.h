@@ -260,13 +260,18 @@ namespace ome
           REFERENCEBLACKWHITE    ///< Reference black and white pairs for RGB or YCbCr images.
         };
 
+      /// Double precision floating point (per-sample array) fields.
+      enum DoubleTagArray1
+        {
+          SMINSAMPLEVALUE, ///< Minimum value of each sample.
+          SMAXSAMPLEVALUE  ///< Maximum value of each sample.
+        };
+
       /*
        * Tags which are known but not currently wrapped.
        *
        * OSUBFILETYPE,                ///< Type of data in this subfile [old tag].
        * COLORRESPONSEUNIT,           ///<
-       * SMINSAMPLEVALUE,             ///<
-       * SMAXSAMPLEVALUE,             ///<
        * CLIPPATH,                    ///<
        * XCLIPPATHUNITS,              ///<
        * YCLIPPATHUNITS,              ///<
@@ -508,6 +513,10 @@ namespace ome
       tag_type
       getWrappedTag(FloatTag6 tag);
 
+      /// @copydoc getWrappedTag(StringTag1)
+      tag_type
+      getWrappedTag(DoubleTagArray1 tag);
+
     }
 
     namespace detail
@@ -725,6 +734,14 @@ namespace ome
           typedef std::array<float, 6> value_type;
         };
 
+        /// Properties of DoubleTagArray1 tags.
+        template<>
+        struct TagProperties<::ome::files::tiff::DoubleTagArray1>
+        {
+          /// double vector type.
+          typedef std::vector<double> value_type;
+        };
+
       }
     }
   }
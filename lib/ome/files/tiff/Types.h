@@ -123,7 +123,10 @@ namespace ome
           COMPRESSION_SGILOG = 34676,      ///< SGI Log Luminance RLE.
           COMPRESSION_SGILOG24 = 34677,    ///< SGI Log 24-bit packed.
           COMPRESSION_JP2000 = 34712,      ///< Leadtools JPEG2000.
-          COMPRESSION_LZMA = 34925         ///< LZMA2.
+          COMPRESSION_LERC = 34887,        ///< ESRI Lerc.
+          COMPRESSION_LZMA = 34925,        ///< LZMA2.
+          COMPRESSION_ZSTD = 50000,        ///< Zstandard.
+          COMPRESSION_WEBP = 50001         ///< WebP.
         };
 
       /// Extra components description.
@@ -35,8 +35,14 @@
  * #L%
  */
 
+#include <algorithm>
+#include <cmath>
+
+#include <boost/format.hpp>
+
 #include <ome/files/CoreMetadata.h>
 #include <ome/files/FormatException.h>
+#include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/Tags.h>
@@ -386,6 +392,41 @@ namespace ome
         return ifdidx;
       }
 
+      bool
+      getSampleValueRange(const IFD&                 ifd,
+                          std::pair<double, double>& range)
+      {
+        std::vector<double> minimum;
+        std::vector<double> maximum;
+        try
+          {
+            ifd.getField(SMINSAMPLEVALUE).get(minimum);
+            ifd.getField(SMAXSAMPLEVALUE).get(maximum);
+          }
+        catch (...)
+          {
+            return false;
+          }
+
+        if (minimum.empty() || maximum.empty())
+          return false;
+
+        range = std::make_pair(minimum.front(), maximum.front());
+        for (const auto& value : minimum)
+          {
+            if (!std::isfinite(value))
+              return false;
+            range.first = std::min(range.first, value);
+          }
+        for (const auto& value : maximum)
+          {
+            if (!std::isfinite(value))
+              return false;
+            range.second = std::max(range.second, value);
+          }
+        return true;
+      }
+
       bool
       enableBigTIFF(const boost::optional<bool>&   wantBig,
                     storage_size_type              pixelSize,
@@ -439,6 +480,77 @@ namespace ome
         return enable;
       }
 
+      void
+      applyCodecSettings(IFD&                                ifd,
+                         ome::xml::model::enums::PixelType   pixeltype,
+                         const boost::optional<std::string>& compression,
+                         const boost::optional<std::string>& predictor,
+                         const boost::optional<int>&         level)
+      {
+        Compression scheme = COMPRESSION_NONE;
+        if(compression)
+          {
+            scheme = getCodecScheme(*compression);
+            if (!isCodecLayoutSupported(scheme, pixeltype, ifd.getSamplesPerPixel(),
+                                        ifd.getPlanarConfiguration()))
+              {
+                boost::format fmt("%1% compression is not supported with %2% %3% samples of pixel type %4%");
+                fmt % *compression % ifd.getSamplesPerPixel()
+                  % (ifd.getPlanarConfiguration() == CONTIG ? "interleaved" : "planar")
+                  % pixeltype;
+                throw FormatException(fmt.str());
+              }
+            ifd.setCompression(scheme);
+          }
+
+        if(predictor)
+          {
+            Predictor predictorscheme = getPredictorScheme(*predictor);
+            if (!isPredictorSupported(scheme, predictorscheme, pixeltype))
+              {
+                boost::format fmt("Predictor %1% is not supported with %2% compression and %3% pixel type");
+                fmt % *predictor % (compression ? *compression : std::string("default")) % pixeltype;
+                throw FormatException(fmt.str());
+              }
+            if (predictorscheme != NONE)
+              ifd.setPredictor(predictorscheme);
+          }
+
+        if(level)
+          {
+            const boost::optional<CodecLevelRange> range(getCodecLevelRange(scheme));
+            if (!range || *level < range->minimum || *level > range->maximum)
+              {
+                boost::format fmt("Compression level %1% is not supported with %2% compression");
+                fmt % *level % (compression ? *compression : std::string("default"));
+                throw FormatException(fmt.str());
+              }
+            ifd.setCompressionLevel(*level);
+          }
+      }
+
+      void
+      applyTileSizePolicy(IFD&                                ifd,
+                          const TileSizePolicy&               policy,
+                          const boost::optional<std::string>& compression,
+                          ome::xml::model::enums::PixelType   pixeltype,
+                          dimension_size_type                 samples,
+                          dimension_size_type                 sizeX,
+                          dimension_size_type                 sizeY)
+      {
+        TileSizePolicy::Parameters params;
+        params.compression = compression;
+        params.pixelType = pixeltype;
+        params.samples = samples;
+        params.sizeX = sizeX;
+        params.sizeY = sizeY;
+
+        const TileSizePolicy::TileSize size(policy.getTileSize(params));
+        ifd.setTileType(size.tiled ? TILE : STRIP);
+        ifd.setTileWidth(static_cast<uint32_t>(size.width));
+        ifd.setTileHeight(static_cast<uint32_t>(size.height));
+      }
+
     }
   }
 }
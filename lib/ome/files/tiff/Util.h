@@ -40,12 +40,15 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include <ome/files/CoreMetadata.h>
 #include <ome/files/TileCoverage.h>
+#include <ome/files/TileSizePolicy.h>
 #include <ome/files/tiff/TileInfo.h>
 #include <ome/files/tiff/Types.h>
 #include <ome/files/VariantPixelBuffer.h>
@@ -115,6 +118,22 @@ namespace ome
                dimension_size_type   series,
                dimension_size_type   plane);
 
+      /**
+       * Get the range of sample values recorded in an IFD.
+       *
+       * The range is the lowest SMinSampleValue and the highest
+       * SMaxSampleValue of all samples, as written by OMETIFFWriter
+       * when statistics are enabled.
+       *
+       * @param ifd the IFD to use.
+       * @param range the minimum and maximum sample values.
+       * @returns @c true if both tags are set and all their values
+       * are finite, or @c false if there is no usable range.
+       */
+      bool
+      getSampleValueRange(const IFD&                 ifd,
+                          std::pair<double, double>& range);
+
       /**
        * Check if BigTIFF should be enabled.
        *
@@ -143,6 +162,50 @@ namespace ome
                     const boost::filesystem::path& filename,
                     ome::common::Logger&           logger);
 
+      /**
+       * Check and set the compression settings of an IFD.
+       *
+       * The codec is checked against the pixel type and the samples
+       * per pixel and planar configuration already set in the IFD,
+       * the predictor against the codec and pixel type, and the
+       * compression level against the range of the codec.  Settings
+       * which are not specified are not set.
+       *
+       * @param ifd the IFD to set up for writing.
+       * @param pixeltype the pixel type to compress.
+       * @param compression the codec name.
+       * @param predictor the predictor name.
+       * @param level the compression level.
+       * @throws FormatException if a setting is not supported.
+       */
+      void
+      applyCodecSettings(IFD&                                ifd,
+                         ome::xml::model::enums::PixelType   pixeltype,
+                         const boost::optional<std::string>& compression,
+                         const boost::optional<std::string>& predictor,
+                         const boost::optional<int>&         level);
+
+      /**
+       * Set the tile or strip size of an IFD using a tile size policy.
+       *
+       * @param ifd the IFD to set up for writing.
+       * @param policy the tile size policy to use.
+       * @param compression the codec name.
+       * @param pixeltype the pixel type to write.
+       * @param samples the number of samples per pixel stored in each
+       * tile (1 if planar).
+       * @param sizeX the image width.
+       * @param sizeY the image height.
+       */
+      void
+      applyTileSizePolicy(IFD&                                ifd,
+                          const TileSizePolicy&               policy,
+                          const boost::optional<std::string>& compression,
+                          ome::xml::model::enums::PixelType   pixeltype,
+                          dimension_size_type                 samples,
+                          dimension_size_type                 sizeX,
+                          dimension_size_type                 sizeY);
+
     }
   }
 }
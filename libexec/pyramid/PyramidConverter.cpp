@@ -0,0 +1,511 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/IFD.h>
+
+#include <ome/xml/meta/MetadataRetrieve.h>
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <pyramid/PyramidConverter.h>
+
+using ome::files::dimension_size_type;
+using ome::files::FormatReader;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+namespace tiff = ome::files::tiff;
+
+namespace
+{
+
+  // Tile size used when the source is not tiled.
+  const dimension_size_type default_tile_size = 256U;
+
+  // A band of whole output tile rows of a plane.
+  struct Band
+  {
+    dimension_size_type series;
+    dimension_size_type plane;
+    dimension_size_type y;
+    // Zero if the band is not read (a copied plane without reduced
+    // resolution levels).
+    dimension_size_type h;
+    // Copy the compressed tiles of the plane before writing the band.
+    bool                copy;
+  };
+
+  // Output settings for a series.
+  struct SeriesSettings
+  {
+    dimension_size_type tileX;
+    dimension_size_type tileY;
+    dimension_size_type levels;
+    bool                interleaved;
+    std::string         compression;
+    std::string         predictor;
+  };
+  // Bands handed from the reader threads to the writer.  Bands are
+  // claimed for reading in order, and at most limit bands may be
+  // claimed but not yet written.
+  class BandQueue
+  {
+  public:
+    BandQueue(dimension_size_type count,
+              dimension_size_type limit):
+      count(count),
+      limit(limit),
+      next(0U),
+      written(0U),
+      ready(),
+      error(),
+      mutex(),
+      cond()
+    {}
+
+    // Claim the next band to read, waiting until it is within the
+    // limit.  Returns false when there are no more bands or on
+    // failure.
+    bool
+    claim(dimension_size_type& index)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this]{ return error || next >= count || next - written < limit; });
+      if (error || next >= count)
+        return false;
+      index = next++;
+      return true;
+    }
+
+    // Add a band which has been read.
+    void
+    put(dimension_size_type                 index,
+        std::shared_ptr<VariantPixelBuffer> buf)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ready[index] = buf;
+      cond.notify_all();
+    }
+
+    // Wait for the next band to write.  Rethrows any failure.
+    std::shared_ptr<VariantPixelBuffer>
+    take()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this]{ return error || ready.count(written); });
+      if (error)
+        std::rethrow_exception(error);
+      std::shared_ptr<VariantPixelBuffer> buf(ready[written]);
+      ready.erase(written);
+      return buf;
+    }
+
+    // Mark the last band taken as written.
+    void
+    done()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++written;
+      cond.notify_all();
+    }
+
+    // Stop all threads; the first failure is kept.
+    void
+    fail(std::exception_ptr e)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = e;
+      cond.notify_all();
+    }
+
+  private:
+    dimension_size_type                                            count;
+    dimension_size_type                                            limit;
+    dimension_size_type                                            next;
+    dimension_size_type                                            written;
+    std::map<dimension_size_type, std::shared_ptr<VariantPixelBuffer>> ready;
+    std::exception_ptr                                             error;
+    std::mutex                                                     mutex;
+    std::condition_variable                                        cond;
+  };
+
+
+  void
+  readBands(std::shared_ptr<FormatReader> reader,
+            const std::vector<Band>&      bands,
+            BandQueue&                    queue)
+  {
+    try
+      {
+        dimension_size_type index;
+        while (queue.claim(index))
+          {
+            const Band& band(bands.at(index));
+            std::shared_ptr<VariantPixelBuffer> buf;
+            if (band.h)
+              {
+                if (reader->getSeries() != band.series)
+                  reader->setSeries(band.series);
+
+                buf = std::make_shared<VariantPixelBuffer>();
+                reader->openBytes(band.plane, *buf, 0U, band.y, reader->getSizeX(), band.h);
+              }
+            queue.put(index, buf);
+          }
+      }
+    catch (...)
+      {
+        queue.fail(std::current_exception());
+      }
+  }
+
+  // Get the writer name of a compression scheme, or an empty string
+  // if unknown.
+  std::string
+  codecName(tiff::Compression scheme)
+  {
+    if (scheme == tiff::COMPRESSION_NONE)
+      return "default";
+
+    for (const auto& codec : tiff::getCodecs())
+      if (codec.scheme == scheme)
+        return codec.name;
+
+    return std::string();
+  }
+
+  // Get the writer name of a predictor.
+  std::string
+  predictorName(tiff::Predictor predictor)
+  {
+    for (const auto& name : tiff::getPredictorNames())
+      if (tiff::getPredictorScheme(name) == predictor)
+        return name;
+
+    return "None";
+  }
+
+  SeriesSettings
+  seriesSettings(const OMETIFFReader&    reader,
+                 const OMETIFFWriter&    writer,
+                 const pyramid::options& opts,
+                 ome::common::Logger&    logger)
+  {
+    SeriesSettings settings;
+
+    const dimension_size_type sizeX = reader.getSizeX();
+    const dimension_size_type sizeY = reader.getSizeY();
+
+    if (opts.tilesize)
+      {
+        settings.tileX = settings.tileY = *opts.tilesize;
+      }
+    else
+      {
+        // Keep the source tiling if it is valid for output.
+        settings.tileX = reader.getOptimalTileWidth();
+        settings.tileY = reader.getOptimalTileHeight();
+        if (settings.tileX >= sizeX ||
+            settings.tileX % 16U || settings.tileY % 16U)
+          settings.tileX = settings.tileY = default_tile_size;
+      }
+
+    if (opts.levels)
+      {
+        settings.levels = *opts.levels;
+      }
+    else
+      {
+        // Reduce until the smallest level fits in a single tile.
+        settings.levels = 0U;
+        for (dimension_size_type x = sizeX, y = sizeY;
+             x > settings.tileX || y > settings.tileY;
+             x = (x + 1U) / 2U, y = (y + 1U) / 2U)
+          ++settings.levels;
+      }
+
+    settings.interleaved = reader.isInterleaved();
+
+    // The compression of the first plane is used for the series.
+    const std::shared_ptr<const tiff::IFD> ifd(reader.getIFD(0U));
+    const tiff::Compression scheme = ifd->getCompression();
+
+    if (opts.compression.empty())
+      {
+        // Keep the source compression if it can be written.
+        const std::string name(codecName(scheme));
+        if (writer.getCompressionTypes(reader.getPixelType()).count(name) &&
+            tiff::isCodecLayoutSupported(scheme, reader.getPixelType(),
+                                         ifd->getSamplesPerPixel(),
+                                         ifd->getPlanarConfiguration()))
+          {
+            settings.compression = name;
+          }
+        else
+          {
+            BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+              << "Source compression " << scheme
+              << " can not be written; writing uncompressed";
+            settings.compression = "default";
+          }
+      }
+    else
+      {
+        settings.compression = opts.compression;
+      }
+
+    // Keep the source predictor with the source compression.
+    if (tiff::getCodecScheme(settings.compression) == scheme)
+      settings.predictor = predictorName(ifd->getPredictor());
+    else
+      settings.predictor = "None";
+
+    return settings;
+  }
+
+  // Check if the compressed tiles of a plane can be copied to the
+  // output unchanged.
+  bool
+  canCopy(const tiff::IFD&      ifd,
+          const SeriesSettings& settings)
+  {
+    return ifd.getTileType() == tiff::TILE &&
+      ifd.getTileWidth() == settings.tileX &&
+      ifd.getTileHeight() == settings.tileY &&
+      (ifd.getPlanarConfiguration() == tiff::CONTIG) == settings.interleaved &&
+      ifd.getCompression() != tiff::COMPRESSION_OJPEG &&
+      ifd.getCompression() == tiff::getCodecScheme(settings.compression) &&
+      ifd.getPredictor() == tiff::getPredictorScheme(settings.predictor);
+  }
+
+  // Apply the settings for a series.  The settings are used for the
+  // IFDs set up by the following setId(), setSeries() or setPlane().
+  void
+  configure(OMETIFFWriter&        writer,
+            const SeriesSettings& settings)
+  {
+    writer.setInterleaved(settings.interleaved);
+    writer.setTileSizeX(settings.tileX);
+    writer.setTileSizeY(settings.tileY);
+    writer.setPyramidLevels(settings.levels);
+    writer.setCompression(settings.compression);
+    writer.setPredictor(settings.predictor);
+  }
+
+}
+
+namespace pyramid
+{
+
+  PyramidConverter::PyramidConverter (const options& opts):
+    logger(ome::common::createLogger("PyramidConverter")),
+    opts(opts)
+  {
+  }
+
+  PyramidConverter::~PyramidConverter ()
+  {
+  }
+
+  std::shared_ptr<OMETIFFReader>
+  PyramidConverter::openReader(std::shared_ptr<ome::xml::meta::MetadataStore> store) const
+  {
+    std::shared_ptr<OMETIFFReader> reader(std::make_shared<OMETIFFReader>());
+    if (store)
+      reader->setMetadataStore(store);
+    reader->setFlattenedResolutions(false);
+    reader->setId(opts.input);
+    return reader;
+  }
+
+  void
+  PyramidConverter::convert(std::ostream& stream)
+  {
+    std::shared_ptr<ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+    std::shared_ptr<ome::xml::meta::MetadataStore> store(std::static_pointer_cast<ome::xml::meta::MetadataStore>(meta));
+    std::shared_ptr<OMETIFFReader> reader(openReader(store));
+
+    OMETIFFWriter writer;
+
+    // Split every plane into bands of whole tile rows.  Planes which
+    // are copied are only read to generate the reduced resolutions.
+    std::vector<SeriesSettings> settings;
+    std::vector<Band> bands;
+    dimension_size_type bandBytes = 0U;
+    dimension_size_type copied = 0U;
+    for (dimension_size_type s = 0U; s < reader->getSeriesCount(); ++s)
+      {
+        reader->setSeries(s);
+        settings.push_back(seriesSettings(*reader, writer, opts, logger));
+        const SeriesSettings& series(settings.back());
+
+        dimension_size_type samples = 0U;
+        for (dimension_size_type c = 0U; c < reader->getEffectiveSizeC(); ++c)
+          samples = std::max(samples, reader->getRGBChannelCount(c));
+        bandBytes = std::max(bandBytes,
+                             reader->getSizeX() * series.tileY * samples *
+                             ome::files::bytesPerPixel(reader->getPixelType()));
+
+        BOOST_LOG_SEV(logger, ome::logging::trivial::info)
+          << "Series " << s << ": " << reader->getSizeX() << "×" << reader->getSizeY()
+          << ", " << series.tileX << "×" << series.tileY << " tiles, "
+          << series.compression << " compression, "
+          << series.levels << " reduced resolution levels";
+
+        for (dimension_size_type p = 0U; p < reader->getImageCount(); ++p)
+          {
+            const bool copy = canCopy(*reader->getIFD(p), series);
+            if (copy)
+              ++copied;
+
+            if (copy && !series.levels)
+              {
+                bands.push_back(Band{s, p, 0U, 0U, true});
+                continue;
+              }
+
+            for (dimension_size_type y = 0U; y < reader->getSizeY(); y += series.tileY)
+              bands.push_back(Band{s, p, y, std::min(series.tileY, reader->getSizeY() - y),
+                                   copy && y == 0U});
+          }
+      }
+    reader->setSeries(0U);
+
+    BOOST_LOG_SEV(logger, ome::logging::trivial::info)
+      << "Copying compressed tiles of " << copied << " planes";
+
+    const dimension_size_type limit =
+      std::max(dimension_size_type(1U),
+               (opts.memory * 1024U * 1024U) / std::max(bandBytes, dimension_size_type(1U)));
+    if (limit < opts.threads)
+      BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+        << "Memory limit allows only " << limit << " bands in flight; "
+        << "not all " << opts.threads << " threads will be used";
+
+    std::shared_ptr<ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<ome::xml::meta::MetadataRetrieve>(meta));
+    writer.setMetadataRetrieve(retrieve);
+    if (opts.bigtiff)
+      writer.setBigTIFF(*opts.bigtiff);
+    writer.setPyramidDownsampling(opts.method);
+    if (!settings.empty())
+      configure(writer, settings.front());
+    writer.setId(opts.output);
+
+    BandQueue queue(bands.size(), limit);
+
+    // Each thread reads with a clone of the reader; the reader itself
+    // is used by this thread to copy compressed tiles.
+    std::vector<std::thread> threads;
+    try
+      {
+        for (unsigned int t = 0U; t < opts.threads; ++t)
+          threads.emplace_back(readBands, reader->clone(), std::cref(bands), std::ref(queue));
+
+        int percent = -1;
+        for (dimension_size_type i = 0U; i < bands.size(); ++i)
+          {
+            const Band& band(bands.at(i));
+
+            if (i && band.series != bands.at(i - 1U).series)
+              {
+                configure(writer, settings.at(band.series));
+                writer.setSeries(band.series);
+              }
+
+            if (band.copy)
+              {
+                if (reader->getSeries() != band.series)
+                  reader->setSeries(band.series);
+                writer.copyTiles(band.plane, *reader->getIFD(band.plane));
+              }
+
+            std::shared_ptr<VariantPixelBuffer> buf(queue.take());
+            if (buf)
+              writer.saveBytes(band.plane, *buf,
+                               0U, band.y, buf->shape()[ome::files::DIM_SPATIAL_X], band.h);
+            queue.done();
+
+            const int current = static_cast<int>(((i + 1U) * 100U) / bands.size());
+            if (opts.verbosity != options::MSG_QUIET && current != percent)
+              {
+                percent = current;
+                stream << boost::format("\rSeries %1%/%2%, plane %3%: %4%%%")
+                  % (band.series + 1U) % settings.size() % band.plane % percent
+                       << std::flush;
+              }
+          }
+
+        writer.close();
+      }
+    catch (...)
+      {
+        queue.fail(std::current_exception());
+        for (auto& thread : threads)
+          thread.join();
+        throw;
+      }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    if (opts.verbosity != options::MSG_QUIET)
+      stream << '\n';
+  }
+
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,124 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef PYRAMID_PYRAMIDCONVERTER_H
+#define PYRAMID_PYRAMIDCONVERTER_H
+
+#include <memory>
+#include <ostream>
+
+#include <ome/common/log.h>
+
+#include <ome/files/Types.h>
+#include <ome/files/in/OMETIFFReader.h>
+
+#include <ome/xml/meta/MetadataStore.h>
+
+#include <pyramid/options.h>
+
+namespace pyramid
+{
+
+  /**
+   * Add reduced resolution levels to an OME-TIFF file.
+   *
+   * The input is read with OMETIFFReader and copied to a new
+   * OME-TIFF file with OMETIFFWriter, which generates the reduced
+   * resolution levels as SubIFDs while each full resolution plane
+   * is written.
+   *
+   * The output uses the compression and predictor of the source
+   * unless a compression is specified.  When the tiling and
+   * compression of a full resolution plane are unchanged, its
+   * compressed tiles are copied to the output without being
+   * re-encoded, and it is only decoded to generate the reduced
+   * resolution levels.
+   *
+   * Each plane is split into bands of whole output tile rows.  The
+   * bands are read and decoded concurrently by a pool of threads,
+   * each with its own clone of the reader, and are written in order
+   * by the calling thread.  The number of bands being read or
+   * waiting to be written is limited by the memory option.
+   */
+  class PyramidConverter
+  {
+  public:
+    /**
+     * Constructor.
+     *
+     * @param opts the command-line options.
+     */
+    explicit
+    PyramidConverter (const options& opts);
+
+    /// The destructor.
+    virtual ~PyramidConverter ();
+
+    /**
+     * Convert the input file.
+     *
+     * @param stream the stream to report progress to.
+     */
+    void
+    convert(std::ostream& stream);
+
+  private:
+    /**
+     * Open the input file.
+     *
+     * @param store the metadata store to fill, or null.
+     * @returns the reader.
+     */
+    std::shared_ptr<ome::files::in::OMETIFFReader>
+    openReader(std::shared_ptr<ome::xml::meta::MetadataStore> store) const;
+
+    /// Message logger.
+    ome::common::Logger logger;
+    /// Command-line options.
+    options opts;
+  };
+
+}
+
+#endif /* PYRAMID_PYRAMIDCONVERTER_H */
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,249 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include <pyramid/options.h>
+
+namespace opt = boost::program_options;
+
+namespace pyramid
+{
+
+  options::options ():
+    action(ACTION_CONVERT),
+    verbosity(MSG_NORMAL),
+    levels(),
+    method(ome::files::DOWNSAMPLE_MEAN),
+    threads(std::max(1U, std::thread::hardware_concurrency())),
+    memory(1024U),
+    tilesize(),
+    compression(),
+    bigtiff(),
+    input(),
+    output(),
+    actions("Actions"),
+    general("General options"),
+    conversion("Pyramid options"),
+    hidden("Hidden options"),
+    positional(),
+    visible(),
+    global(),
+    vm(),
+    methodName("mean"),
+    files()
+  {
+  }
+
+  options::~options ()
+  {
+  }
+
+  boost::program_options::options_description const&
+  options::get_visible_options() const
+  {
+    return this->visible;
+  }
+
+  void
+  options::parse (int   argc,
+                  char *argv[])
+  {
+    add_options();
+    add_option_groups();
+
+    opt::store(opt::command_line_parser(argc, argv).
+               options(global).positional(positional).run(), vm);
+    opt::notify(vm);
+
+    check_options();
+    check_actions();
+  }
+
+  void
+  options::add_options ()
+  {
+    actions.add_options()
+      ("usage,u",
+       "Show command usage")
+      ("help,h",
+       "Display manual for this command")
+      ("version,V",
+       "Print version information");
+
+    general.add_options()
+      ("debug",
+       "Show debug output")
+      ("quiet,q",
+       "Show less output")
+      ("verbose,v",
+       "Show more output");
+
+    conversion.add_options()
+      ("levels", opt::value<ome::files::dimension_size_type>(),
+       "Number of reduced resolution levels (default: until the smallest level fits in one tile)")
+      ("method", opt::value<std::string>(&this->methodName),
+       "Downsampling method: nearest, mean (default), min, max or mode")
+      ("threads,j", opt::value<unsigned int>(&this->threads),
+       "Number of reader threads (default: number of processors)")
+      ("memory", opt::value<ome::files::dimension_size_type>(&this->memory),
+       "Limit for pixel data being read or waiting to be written, in MiB (default: 1024)")
+      ("tile-size", opt::value<ome::files::dimension_size_type>(),
+       "Output tile width and height (default: source tile size)")
+      ("compression", opt::value<std::string>(&this->compression),
+       "Output compression (default: source compression)")
+      ("big-tiff", "Always write BigTIFF")
+      ("no-big-tiff", "Never write BigTIFF");
+
+    hidden.add_options()
+      ("files", opt::value<std::vector<std::string>>(&this->files),
+       "Input and output files");
+
+    positional.add("files", -1);
+  }
+
+  void
+  options::add_option_groups ()
+  {
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!actions.options().empty())
+#else
+      if (!actions.primary_keys().empty())
+#endif
+        {
+          global.add(actions);
+          visible.add(actions);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!general.options().empty())
+#else
+      if (!general.primary_keys().empty())
+#endif
+        {
+          global.add(general);
+          visible.add(general);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!conversion.options().empty())
+#else
+      if (!conversion.primary_keys().empty())
+#endif
+        {
+          global.add(conversion);
+          visible.add(conversion);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!hidden.options().empty())
+#else
+      if (!hidden.primary_keys().empty())
+#endif
+        global.add(hidden);
+  }
+
+  void
+  options::check_options ()
+  {
+    if (vm.count("usage"))
+      this->action = ACTION_USAGE;
+
+    if (vm.count("help"))
+      this->action = ACTION_HELP;
+
+    if (vm.count("version"))
+      this->action = ACTION_VERSION;
+
+    if (vm.count("quiet"))
+      this->verbosity = MSG_QUIET;
+    if (vm.count("verbose"))
+      this->verbosity = MSG_VERBOSE;
+    if (vm.count("debug"))
+      this->verbosity = MSG_DEBUG;
+
+    if (vm.count("levels"))
+      this->levels = vm["levels"].as<ome::files::dimension_size_type>();
+
+    if (this->methodName == "nearest")
+      this->method = ome::files::DOWNSAMPLE_NEAREST;
+    else if (this->methodName == "mean")
+      this->method = ome::files::DOWNSAMPLE_MEAN;
+    else if (this->methodName == "min")
+      this->method = ome::files::DOWNSAMPLE_MIN;
+    else if (this->methodName == "max")
+      this->method = ome::files::DOWNSAMPLE_MAX;
+    else if (this->methodName == "mode")
+      this->method = ome::files::DOWNSAMPLE_MODE;
+    else
+      throw std::runtime_error(std::string("Invalid downsampling method: ") + this->methodName);
+
+    if (this->threads == 0)
+      throw std::runtime_error("At least one thread is required");
+
+    if (vm.count("tile-size"))
+      {
+        this->tilesize = vm["tile-size"].as<ome::files::dimension_size_type>();
+        if (*this->tilesize == 0 || *this->tilesize % 16)
+          throw std::runtime_error("Tile size must be a nonzero multiple of 16");
+      }
+
+    if (vm.count("big-tiff"))
+      this->bigtiff = true;
+    if (vm.count("no-big-tiff"))
+      this->bigtiff = false;
+  }
+
+  void
+  options::check_actions ()
+  {
+    if (this->action == ACTION_CONVERT)
+      {
+        if (this->files.size() != 2)
+          throw std::runtime_error("An input and an output file must be specified");
+        this->input = this->files.at(0);
+        this->output = this->files.at(1);
+      }
+  }
+
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
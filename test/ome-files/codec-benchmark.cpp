@@ -0,0 +1,586 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+// Codec throughput benchmark.
+//
+// Synthetic microscopy planes (Gaussian spots on a noisy background)
+// are written and read back through IFD::writeImage and
+// IFD::readImage for every codec available for each pixel type, for
+// 1, 3 and 5 interleaved samples, for a range of tile sizes, and for
+// the strip or tile sizes chosen by the default TileSizePolicy for
+// each access pattern.  Results are written to stdout as CSV.
+//
+// The region column is the mean time to read a 256×256 region at a
+// random position, which includes decoding every tile or strip the
+// region overlaps.  The chunk sizes in TileSizePolicy.cpp are
+// heuristics; the compression ratio and region columns of this
+// output may be used to choose sizes for a specific system.
+//
+// The peak memory column is the largest increase in resident set
+// size over the start of each configuration, sampled while it runs
+// (Linux only; zero elsewhere).
+//
+// All libtiff calls, including compression and decompression, are
+// serialized by a process-wide lock (see tiff::Sentry), so threads
+// in one process can not compress in parallel.  The benchmark runs
+// each configuration on a single thread; to measure throughput with
+// several files, run several instances as separate processes.
+//
+// Usage: codec-benchmark [size [repeats]]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/TileSizePolicy.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/TIFF.h>
+
+#ifdef __linux__
+# include <unistd.h>
+#endif
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::TileSizePolicy;
+using ome::files::VariantPixelBuffer;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  typedef std::chrono::steady_clock clock_type;
+
+  // Current resident set size of this process (KiB), or zero if
+  // unavailable on this platform.
+  long
+  resident_memory()
+  {
+    long ret = 0;
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    if (statm >> pages >> resident)
+      ret = resident * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+    return ret;
+  }
+
+  // Sample the resident set size while a configuration runs, to
+  // report the peak memory used by that configuration rather than
+  // the lifetime peak of the process.
+  class MemorySampler
+  {
+  public:
+    MemorySampler():
+      baseline(resident_memory()),
+      peak(baseline),
+      done(false),
+      sampler([this]()
+              {
+                while (!done)
+                  {
+                    peak = std::max(peak.load(), resident_memory());
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                  }
+              })
+    {}
+
+    ~MemorySampler()
+    {
+      stop();
+    }
+
+    // Peak increase over the starting resident set size (KiB).
+    long
+    stop()
+    {
+      if (!done)
+        {
+          done = true;
+          sampler.join();
+          peak = std::max(peak.load(), resident_memory());
+        }
+      return peak - baseline;
+    }
+
+  private:
+    long baseline;
+    std::atomic<long> peak;
+    std::atomic<bool> done;
+    std::thread sampler;
+  };
+
+  // Typical signal range for each pixel type.
+  double
+  signal_max(PixelType pixeltype)
+  {
+    switch(pixeltype)
+      {
+      case PixelType::BIT:
+        return 1.0;
+      case PixelType::INT8:
+        return 127.0;
+      case PixelType::UINT8:
+        return 255.0;
+      case PixelType::INT16:
+      case PixelType::UINT16:
+        return 4095.0; // 12-bit camera
+      case PixelType::INT32:
+      case PixelType::UINT32:
+        return 65535.0;
+      default:
+        return 1.0; // floating point
+      }
+  }
+
+  // Convert a normalised intensity to a sample value.
+  template<typename T>
+  T
+  sample(double intensity,
+         double max)
+  {
+    return static_cast<T>(std::round(intensity * max));
+  }
+
+  template<>
+  float
+  sample<float>(double intensity,
+                double max)
+  {
+    return static_cast<float>(intensity * max);
+  }
+
+  template<>
+  double
+  sample<double>(double intensity,
+                 double max)
+  {
+    return intensity * max;
+  }
+
+  template<>
+  std::complex<float>
+  sample<std::complex<float>>(double intensity,
+                              double max)
+  {
+    return std::complex<float>(static_cast<float>(intensity * max), 0.0f);
+  }
+
+  template<>
+  std::complex<double>
+  sample<std::complex<double>>(double intensity,
+                               double max)
+  {
+    return std::complex<double>(intensity * max, 0.0);
+  }
+
+  template<>
+  bool
+  sample<bool>(double intensity,
+               double /* max */)
+  {
+    return intensity > 0.25;
+  }
+
+  // Fill a pixel buffer with a synthetic fluorescence image.
+  struct FillVisitor
+  {
+    double max;
+
+    FillVisitor(double max):
+      max(max)
+    {}
+
+    // Each sample is an independent image, so that interleaved
+    // samples are not trivially compressible.
+    template<typename T>
+    void
+    operator()(std::shared_ptr<T>& buffer)
+    {
+      const dimension_size_type width = buffer->shape()[ome::files::DIM_SPATIAL_X];
+      const dimension_size_type height = buffer->shape()[ome::files::DIM_SPATIAL_Y];
+      const dimension_size_type samples = buffer->shape()[ome::files::DIM_SUBCHANNEL];
+
+      typename T::indices_type idx;
+      std::fill(idx.begin(), idx.end(), 0);
+
+      for (dimension_size_type s = 0; s < samples; ++s)
+        {
+          idx[ome::files::DIM_SUBCHANNEL] = s;
+          fill(*buffer, idx, width, height, 42U + static_cast<unsigned int>(s));
+        }
+    }
+
+    // Fill one sample of a pixel buffer.
+    template<typename T>
+    void
+    fill(T&                        buffer,
+         typename T::indices_type& idx,
+         dimension_size_type       width,
+         dimension_size_type       height,
+         unsigned int              seed)
+    {
+      typedef typename T::value_type value_type;
+
+      std::mt19937 gen(seed);
+      std::uniform_real_distribution<double> position(0.0, 1.0);
+      std::normal_distribution<double> noise(0.0, 0.01);
+
+      struct Spot
+      {
+        double x, y, sigma, amplitude;
+      };
+
+      std::vector<Spot> spots((width * height) / 8192 + 1);
+      for (auto& s : spots)
+        {
+          s.x = position(gen) * static_cast<double>(width);
+          s.y = position(gen) * static_cast<double>(height);
+          s.sigma = 2.0 + position(gen) * 6.0;
+          s.amplitude = 0.2 + position(gen) * 0.7;
+        }
+
+      std::vector<double> plane(width * height, 0.05);
+      for (const auto& s : spots)
+        {
+          const double extent = s.sigma * 3.0;
+          const dimension_size_type x0 = static_cast<dimension_size_type>(std::max(0.0, s.x - extent));
+          const dimension_size_type x1 = static_cast<dimension_size_type>(std::min(static_cast<double>(width), s.x + extent));
+          const dimension_size_type y0 = static_cast<dimension_size_type>(std::max(0.0, s.y - extent));
+          const dimension_size_type y1 = static_cast<dimension_size_type>(std::min(static_cast<double>(height), s.y + extent));
+          for (dimension_size_type y = y0; y < y1; ++y)
+            for (dimension_size_type x = x0; x < x1; ++x)
+              {
+                const double dx = static_cast<double>(x) - s.x;
+                const double dy = static_cast<double>(y) - s.y;
+                plane[y * width + x] += s.amplitude * std::exp(-(dx * dx + dy * dy) / (2.0 * s.sigma * s.sigma));
+              }
+        }
+
+      for (dimension_size_type y = 0; y < height; ++y)
+        for (dimension_size_type x = 0; x < width; ++x)
+          {
+            idx[ome::files::DIM_SPATIAL_X] = x;
+            idx[ome::files::DIM_SPATIAL_Y] = y;
+            const double intensity = std::min(1.0, std::max(0.0, plane[y * width + x] + noise(gen)));
+            buffer.at(idx) = sample<value_type>(intensity, max);
+          }
+    }
+  };
+
+  // A single benchmark configuration.
+  struct Configuration
+  {
+    std::string codec;
+    PixelType pixeltype;
+    dimension_size_type samples;
+    ome::files::tiff::TileType tiletype;
+    dimension_size_type tilewidth;
+    dimension_size_type tileheight;
+    std::string source;
+  };
+
+  // Write a plane to a new TIFF.
+  void
+  write_plane(const boost::filesystem::path& filename,
+              const VariantPixelBuffer&      pixels,
+              const Configuration&           config)
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "w");
+    std::shared_ptr<IFD> ifd = tiff->getCurrentDirectory();
+
+    const VariantPixelBuffer::size_type *shape = pixels.shape();
+
+    ifd->setImageWidth(static_cast<uint32_t>(shape[ome::files::DIM_SPATIAL_X]));
+    ifd->setImageHeight(static_cast<uint32_t>(shape[ome::files::DIM_SPATIAL_Y]));
+    ifd->setTileType(config.tiletype);
+    ifd->setTileWidth(static_cast<uint32_t>(config.tilewidth));
+    ifd->setTileHeight(static_cast<uint32_t>(config.tileheight));
+    ifd->setPixelType(config.pixeltype);
+    ifd->setBitsPerSample(ome::files::significantBitsPerPixel(config.pixeltype));
+    ifd->setSamplesPerPixel(static_cast<uint16_t>(config.samples));
+    ifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    ifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    if (config.codec != "None")
+      ifd->setCompression(ome::files::tiff::getCodecScheme(config.codec));
+
+    ifd->writeImage(pixels);
+    tiff->writeCurrentDirectory();
+    tiff->close();
+  }
+
+  // Read a plane from a TIFF.
+  void
+  read_plane(const boost::filesystem::path& filename)
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+    std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+    VariantPixelBuffer pixels;
+    ifd->readImage(pixels);
+  }
+
+  // Read regions at random positions from a TIFF, and return the
+  // mean time per region in milliseconds.
+  double
+  read_regions(const boost::filesystem::path& filename,
+               dimension_size_type            size,
+               unsigned int                   count)
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+    std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+    const dimension_size_type width = ifd->getImageWidth();
+    const dimension_size_type height = ifd->getImageHeight();
+    const dimension_size_type w = std::min(size, width);
+    const dimension_size_type h = std::min(size, height);
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<dimension_size_type> xpos(0U, width - w);
+    std::uniform_int_distribution<dimension_size_type> ypos(0U, height - h);
+
+    VariantPixelBuffer pixels;
+    clock_type::time_point start = clock_type::now();
+    for (unsigned int i = 0; i < count; ++i)
+      ifd->readImage(pixels, xpos(gen), ypos(gen), w, h);
+    clock_type::time_point end = clock_type::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / count;
+  }
+
+  // Run a function, and return the elapsed time in seconds.
+  template<typename F>
+  double
+  run_timed(F func)
+  {
+    clock_type::time_point start = clock_type::now();
+    func();
+    clock_type::time_point end = clock_type::now();
+
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Escape a CSV field.
+  std::string
+  csv(const std::string& field)
+  {
+    std::string ret("\"");
+    for (const auto c : field)
+      {
+        if (c == '"')
+          ret += '"';
+        ret += c;
+      }
+    ret += '"';
+    return ret;
+  }
+
+}
+
+int
+main(int argc, char *argv[])
+{
+  dimension_size_type size = 2048U;
+  unsigned int repeats = 3U;
+
+  if (argc > 1)
+    size = static_cast<dimension_size_type>(std::strtoul(argv[1], nullptr, 10));
+  if (argc > 2)
+    repeats = static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10));
+  if (size == 0 || repeats == 0)
+    {
+      std::cerr << "Usage: " << argv[0] << " [size [repeats]]\n";
+      return 1;
+    }
+
+  const std::vector<dimension_size_type> tilesizes{64U, 128U, 256U, 512U, 1024U};
+  const std::vector<dimension_size_type> stripsizes{16U, 64U};
+
+  const boost::filesystem::path dir(boost::filesystem::temp_directory_path() /
+                                    boost::filesystem::unique_path("ome-files-codec-benchmark-%%%%-%%%%"));
+  boost::filesystem::create_directories(dir);
+
+  std::cout << "codec,pixeltype,samples,source,tiletype,tilewidth,tileheight,"
+            << "raw_bytes,compressed_bytes,ratio,"
+            << "write_mbps,read_mbps,region_ms,peak_memory_delta_kib,status\n";
+
+  for (const auto& pt : PixelType::values())
+    for (const dimension_size_type samples : {1U, 3U, 5U})
+      {
+        const PixelType pixeltype(pt.first);
+        if (pixeltype == PixelType::BIT && samples > 1U)
+          continue;
+
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        shape[ome::files::DIM_SPATIAL_X] = size;
+        shape[ome::files::DIM_SPATIAL_Y] = size;
+        shape[ome::files::DIM_SUBCHANNEL] = samples;
+        shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+          shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+        VariantPixelBuffer pixels(shape, pixeltype,
+                                  PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true));
+        FillVisitor fill(signal_max(pixeltype));
+        ome::compat::visit(fill, pixels.vbuffer());
+
+        // Size of the uncompressed pixel data.
+        dimension_size_type rawbytes = size * size * samples * ome::files::bytesPerPixel(pixeltype);
+        if (pixeltype == PixelType::BIT)
+          rawbytes = ((size + 7U) / 8U) * size;
+        const double rawmb = static_cast<double>(rawbytes) / (1024.0 * 1024.0);
+
+        std::vector<std::string> codecs(ome::files::tiff::getCodecNames(pixeltype));
+        codecs.insert(codecs.begin(), "None");
+
+        std::vector<Configuration> configs;
+        for (const auto& codec : codecs)
+          {
+            for (const auto tilesize : tilesizes)
+              if (tilesize <= size)
+                configs.push_back(Configuration{codec, pixeltype, samples, ome::files::tiff::TILE,
+                      tilesize, tilesize, "fixed"});
+            for (const auto stripsize : stripsizes)
+              if (stripsize <= size)
+                configs.push_back(Configuration{codec, pixeltype, samples, ome::files::tiff::STRIP,
+                      size, stripsize, "fixed"});
+
+            for (const auto access : {TileSizePolicy::FULL_PLANE, TileSizePolicy::RANDOM_REGION})
+              {
+                TileSizePolicy::Parameters params;
+                if (codec != "None")
+                  params.compression = codec;
+                params.pixelType = pixeltype;
+                params.samples = samples;
+                params.sizeX = size;
+                params.sizeY = size;
+
+                const TileSizePolicy policy(access);
+                const TileSizePolicy::TileSize policysize(policy.getTileSize(params));
+                configs.push_back(Configuration{codec, pixeltype, samples,
+                      policysize.tiled ? ome::files::tiff::TILE : ome::files::tiff::STRIP,
+                      policysize.width, policysize.height,
+                      access == TileSizePolicy::FULL_PLANE ? "policy-full" : "policy-region"});
+              }
+          }
+
+        for (const auto& config : configs)
+          {
+            boost::format fmt("%1%-%2%-%3%.tiff");
+            fmt % config.codec % pixeltype % samples;
+            const boost::filesystem::path file(dir / fmt.str());
+
+            std::string status("ok");
+            dimension_size_type compressed = 0U;
+            double writetime = 0.0;
+            double readtime = 0.0;
+            double regiontime = 0.0;
+
+            MemorySampler memory;
+            try
+              {
+                for (unsigned int r = 0; r < repeats; ++r)
+                  {
+                    writetime += run_timed([&]() { write_plane(file, pixels, config); });
+                    readtime += run_timed([&]() { read_plane(file); });
+                  }
+                compressed = static_cast<dimension_size_type>(boost::filesystem::file_size(file));
+                regiontime = read_regions(file, 256U, 16U);
+              }
+            catch (const std::exception& e)
+              {
+                status = e.what();
+              }
+
+            const long peakmemory = memory.stop();
+
+            boost::system::error_code ec;
+            boost::filesystem::remove(file, ec);
+
+            const double totalmb = rawmb * repeats;
+
+            std::cout << csv(config.codec) << ','
+                      << pixeltype << ','
+                      << config.samples << ','
+                      << config.source << ','
+                      << (config.tiletype == ome::files::tiff::TILE ? "tile" : "strip") << ','
+                      << config.tilewidth << ','
+                      << config.tileheight << ','
+                      << rawbytes << ','
+                      << compressed << ','
+                      << (compressed ? static_cast<double>(rawbytes) / static_cast<double>(compressed) : 0.0) << ','
+                      << (writetime > 0.0 ? totalmb / writetime : 0.0) << ','
+                      << (readtime > 0.0 ? totalmb / readtime : 0.0) << ','
+                      << regiontime << ','
+                      << peakmemory << ','
+                      << csv(status) << '\n' << std::flush;
+          }
+      }
+
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(dir, ec);
+
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
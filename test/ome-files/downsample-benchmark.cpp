@@ -0,0 +1,306 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+// Downsampling kernel benchmark.
+//
+// Random planes are downsampled with every method supported for each
+// pixel type, for planar and interleaved storage and a range of
+// reduction factors.  For comparison, a naive 2×2 mean using
+// element access is also timed.  Results are written to stdout as
+// CSV, in megapixels (source) per second.
+//
+// Usage: downsample-benchmark [size [repeats]]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ome/files/Downsample.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+using ome::files::dimension_size_type;
+using ome::files::DownsampleMethod;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  typedef std::chrono::steady_clock clock_type;
+
+  template<typename T>
+  T
+  random_value(std::mt19937& gen)
+  {
+    return static_cast<T>(gen() % 251U);
+  }
+
+  template<>
+  std::complex<float>
+  random_value<std::complex<float>>(std::mt19937& gen)
+  {
+    return std::complex<float>(static_cast<float>(gen() % 251U),
+                               static_cast<float>(gen() % 251U));
+  }
+
+  template<>
+  std::complex<double>
+  random_value<std::complex<double>>(std::mt19937& gen)
+  {
+    return std::complex<double>(static_cast<double>(gen() % 251U),
+                                static_cast<double>(gen() % 251U));
+  }
+
+  template<>
+  bool
+  random_value<bool>(std::mt19937& gen)
+  {
+    return (gen() % 2U) != 0U;
+  }
+
+  // Fill a pixel buffer with random values.
+  struct FillVisitor
+  {
+    template<typename T>
+    void
+    operator()(std::shared_ptr<T>& buffer)
+    {
+      typedef typename T::value_type value_type;
+
+      std::mt19937 gen(42);
+      value_type *data = buffer->data();
+      for (dimension_size_type i = 0; i < buffer->num_elements(); ++i)
+        data[i] = random_value<value_type>(gen);
+    }
+  };
+
+  // Naive 2×2 mean using element access, for comparison.
+  struct NaiveVisitor
+  {
+    VariantPixelBuffer& dest;
+
+    NaiveVisitor(VariantPixelBuffer& dest):
+      dest(dest)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source)
+    {
+      typedef typename T::value_type value_type;
+
+      std::shared_ptr<T>& d = ome::compat::get<std::shared_ptr<T>>(dest.vbuffer());
+      const VariantPixelBuffer::size_type *shape = d->shape();
+
+      typename T::indices_type sidx;
+      typename T::indices_type didx;
+      std::fill(sidx.begin(), sidx.end(), 0);
+      std::fill(didx.begin(), didx.end(), 0);
+
+      for (dimension_size_type s = 0; s < shape[ome::files::DIM_SUBCHANNEL]; ++s)
+        for (dimension_size_type y = 0; y < shape[ome::files::DIM_SPATIAL_Y]; ++y)
+          for (dimension_size_type x = 0; x < shape[ome::files::DIM_SPATIAL_X]; ++x)
+            {
+              std::complex<double> sum;
+              sidx[ome::files::DIM_SUBCHANNEL] = didx[ome::files::DIM_SUBCHANNEL] = s;
+              for (dimension_size_type by = 0; by < 2U; ++by)
+                for (dimension_size_type bx = 0; bx < 2U; ++bx)
+                  {
+                    sidx[ome::files::DIM_SPATIAL_X] = x * 2U + bx;
+                    sidx[ome::files::DIM_SPATIAL_Y] = y * 2U + by;
+                    sum += std::complex<double>(source->at(sidx));
+                  }
+              didx[ome::files::DIM_SPATIAL_X] = x;
+              didx[ome::files::DIM_SPATIAL_Y] = y;
+              d->at(didx) = static_cast<value_type>(std::real(sum) / 4.0);
+            }
+    }
+  };
+
+  const char *
+  method_name(DownsampleMethod method)
+  {
+    switch(method)
+      {
+      case ome::files::DOWNSAMPLE_NEAREST:
+        return "nearest";
+      case ome::files::DOWNSAMPLE_MEAN:
+        return "mean";
+      case ome::files::DOWNSAMPLE_MIN:
+        return "min";
+      case ome::files::DOWNSAMPLE_MAX:
+        return "max";
+      case ome::files::DOWNSAMPLE_MODE:
+      default:
+        return "mode";
+      }
+  }
+
+  template<typename F>
+  double
+  time(unsigned int repeats,
+       F            func)
+  {
+    clock_type::time_point start = clock_type::now();
+    for (unsigned int r = 0; r < repeats; ++r)
+      func();
+    clock_type::time_point end = clock_type::now();
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+}
+
+int
+main(int argc, char *argv[])
+{
+  dimension_size_type size = 2048U;
+  unsigned int repeats = 5U;
+
+  if (argc > 1)
+    size = static_cast<dimension_size_type>(std::strtoul(argv[1], nullptr, 10));
+  if (argc > 2)
+    repeats = static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10));
+  if (size < 2U || repeats == 0)
+    {
+      std::cerr << "Usage: " << argv[0] << " [size [repeats]]\n";
+      return 1;
+    }
+
+  const std::vector<DownsampleMethod> methods
+    {
+      ome::files::DOWNSAMPLE_NEAREST,
+      ome::files::DOWNSAMPLE_MEAN,
+      ome::files::DOWNSAMPLE_MIN,
+      ome::files::DOWNSAMPLE_MAX,
+      ome::files::DOWNSAMPLE_MODE
+    };
+  const std::vector<dimension_size_type> factors{2U, 4U};
+
+  std::cout << "pixeltype,samples,storage,method,factor,mpixels_per_second\n";
+
+  for (const auto& pt : PixelType::values())
+    {
+      const PixelType pixeltype(pt.first);
+
+      for (const dimension_size_type samples : {1U, 3U})
+        for (const bool interleaved : {false, true})
+          {
+            if (samples == 1U && interleaved)
+              continue;
+
+            std::array<VariantPixelBuffer::size_type, 9> shape;
+            shape[ome::files::DIM_SPATIAL_X] = size;
+            shape[ome::files::DIM_SPATIAL_Y] = size;
+            shape[ome::files::DIM_SUBCHANNEL] = samples;
+            shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+              shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+            const PixelBufferBase::storage_order_type order
+              (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, interleaved));
+
+            VariantPixelBuffer pixels(shape, pixeltype, order);
+            FillVisitor fill;
+            ome::compat::visit(fill, pixels.vbuffer());
+
+            const double mpixels = static_cast<double>(size * size) / 1.0e6;
+            const char *storage = interleaved ? "interleaved" : "planar";
+
+            for (const auto method : methods)
+              {
+                if (!ome::files::isDownsampleSupported(method, pixeltype))
+                  continue;
+
+                for (const auto factor : factors)
+                  {
+                    VariantPixelBuffer dest;
+                    const double elapsed = time(repeats, [&]()
+                                                {
+                                                  ome::files::downsample(pixels, dest, factor, factor, method);
+                                                });
+
+                    std::cout << pixeltype << ','
+                              << samples << ','
+                              << storage << ','
+                              << method_name(method) << ','
+                              << factor << ','
+                              << (elapsed > 0.0 ? mpixels * repeats / elapsed : 0.0) << '\n' << std::flush;
+                  }
+              }
+
+            // Naive baseline (even sizes only).
+            if (size % 2U == 0U)
+              {
+                std::array<VariantPixelBuffer::size_type, 9> halfshape(shape);
+                halfshape[ome::files::DIM_SPATIAL_X] = size / 2U;
+                halfshape[ome::files::DIM_SPATIAL_Y] = size / 2U;
+                VariantPixelBuffer dest(halfshape, pixeltype, order);
+
+                const double elapsed = time(repeats, [&]()
+                                            {
+                                              NaiveVisitor naive(dest);
+                                              ome::compat::visit(naive, pixels.vbuffer());
+                                            });
+
+                std::cout << pixeltype << ','
+                          << samples << ','
+                          << storage << ','
+                          << "naive-mean" << ','
+                          << 2U << ','
+                          << (elapsed > 0.0 ? mpixels * repeats / elapsed : 0.0) << '\n' << std::flush;
+              }
+          }
+    }
+
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,566 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+
+#include <ome/files/Downsample.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+#include "pixel.h"
+
+using ome::files::dimension_size_type;
+using ome::files::DownsampleMethod;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+
+class DownsampleTestParameters
+{
+public:
+  PT                  type;
+  DownsampleMethod    method;
+  dimension_size_type factorX;
+  dimension_size_type factorY;
+  bool                interleaved;
+
+  DownsampleTestParameters(PT                  type,
+                           DownsampleMethod    method,
+                           dimension_size_type factorX,
+                           dimension_size_type factorY,
+                           bool                interleaved):
+    type(type),
+    method(method),
+    factorX(factorX),
+    factorY(factorY),
+    interleaved(interleaved)
+  {}
+};
+
+template<class charT, class traits>
+inline std::basic_ostream<charT,traits>&
+operator<< (std::basic_ostream<charT,traits>& os,
+            const DownsampleTestParameters& params)
+{
+  return os << PT(params.type) << '/' << params.method << '/'
+            << params.factorX << 'x' << params.factorY << '/'
+            << (params.interleaved ? "interleaved" : "planar");
+}
+
+namespace
+{
+
+  const dimension_size_type width = 13U;
+  const dimension_size_type height = 7U;
+  const dimension_size_type samples = 3U;
+  const dimension_size_type planes = 2U;
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape(dimension_size_type x,
+            dimension_size_type y)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = x;
+    shape[ome::files::DIM_SPATIAL_Y] = y;
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    shape[ome::files::DIM_SPATIAL_Z] = planes;
+    shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+    return shape;
+  }
+
+  PixelBufferBase::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y,
+            dimension_size_type s,
+            dimension_size_type z)
+  {
+    PixelBufferBase::indices_type idx;
+    std::fill(idx.begin(), idx.end(), 0);
+    idx[ome::files::DIM_SPATIAL_X] = x;
+    idx[ome::files::DIM_SPATIAL_Y] = y;
+    idx[ome::files::DIM_SUBCHANNEL] = s;
+    idx[ome::files::DIM_SPATIAL_Z] = z;
+    return idx;
+  }
+
+  // Small integer values with repeats, so that means of floating
+  // point types are exact and modes are meaningful.
+  struct FillVisitor
+  {
+    template<typename T>
+    void
+    operator()(std::shared_ptr<PixelBuffer<T>>& buf)
+    {
+      const VariantPixelBuffer::size_type *shape = buf->shape();
+      for (dimension_size_type z = 0; z < shape[ome::files::DIM_SPATIAL_Z]; ++z)
+        for (dimension_size_type s = 0; s < shape[ome::files::DIM_SUBCHANNEL]; ++s)
+          for (dimension_size_type y = 0; y < shape[ome::files::DIM_SPATIAL_Y]; ++y)
+            for (dimension_size_type x = 0; x < shape[ome::files::DIM_SPATIAL_X]; ++x)
+              buf->at(makeIndex(x, y, s, z)) =
+                pixel_value<T>(static_cast<uint32_t>((x * 7U + y * 3U + s * 5U + z) % 5U));
+    }
+  };
+
+  // Reference reduction using element access, one block at a time.
+  template<typename T>
+  T
+  referenceBlock(const std::vector<T>& block,
+                 DownsampleMethod      method);
+
+  template<typename T>
+  T
+  referenceMode(const std::vector<T>& block)
+  {
+    T best = block.front();
+    dimension_size_type bestCount = 0U;
+    for (dimension_size_type i = 0; i < block.size(); ++i)
+      {
+        const dimension_size_type count =
+          static_cast<dimension_size_type>(std::count(block.begin(), block.end(), block[i]));
+        if (count > bestCount)
+          {
+            best = block[i];
+            bestCount = count;
+          }
+      }
+    return best;
+  }
+
+  template<typename T>
+  T
+  referenceBlock(const std::vector<T>& block,
+                 DownsampleMethod      method)
+  {
+    switch(method)
+      {
+      case ome::files::DOWNSAMPLE_NEAREST:
+        return block.front();
+      case ome::files::DOWNSAMPLE_MEAN:
+        {
+          double sum = 0.0;
+          for (const auto& v : block)
+            sum += static_cast<double>(v);
+          return static_cast<T>(std::round(sum / static_cast<double>(block.size())));
+        }
+      case ome::files::DOWNSAMPLE_MIN:
+        return *std::min_element(block.begin(), block.end());
+      case ome::files::DOWNSAMPLE_MAX:
+        return *std::max_element(block.begin(), block.end());
+      case ome::files::DOWNSAMPLE_MODE:
+      default:
+        return referenceMode(block);
+      }
+  }
+
+  template<>
+  bool
+  referenceBlock<bool>(const std::vector<bool>& block,
+                       DownsampleMethod         method)
+  {
+    if (method == ome::files::DOWNSAMPLE_MEAN)
+      {
+        const dimension_size_type set =
+          static_cast<dimension_size_type>(std::count(block.begin(), block.end(), true));
+        return set * 2U >= block.size();
+      }
+    if (method == ome::files::DOWNSAMPLE_MIN)
+      return std::find(block.begin(), block.end(), false) == block.end();
+    if (method == ome::files::DOWNSAMPLE_MAX)
+      return std::find(block.begin(), block.end(), true) != block.end();
+    if (method == ome::files::DOWNSAMPLE_NEAREST)
+      return block.front();
+    return referenceMode(block);
+  }
+
+  template<typename T>
+  std::complex<T>
+  referenceComplex(const std::vector<std::complex<T>>& block,
+                   DownsampleMethod                    method)
+  {
+    if (method == ome::files::DOWNSAMPLE_MEAN)
+      {
+        std::complex<double> sum;
+        for (const auto& v : block)
+          sum += std::complex<double>(v);
+        return std::complex<T>(sum / static_cast<double>(block.size()));
+      }
+    if (method == ome::files::DOWNSAMPLE_NEAREST)
+      return block.front();
+    return referenceMode(block);
+  }
+
+  template<>
+  float
+  referenceBlock<float>(const std::vector<float>& block,
+                        DownsampleMethod          method)
+  {
+    if (method == ome::files::DOWNSAMPLE_MEAN)
+      {
+        double sum = 0.0;
+        for (const auto& v : block)
+          sum += v;
+        return static_cast<float>(sum / static_cast<double>(block.size()));
+      }
+    if (method == ome::files::DOWNSAMPLE_MIN)
+      return *std::min_element(block.begin(), block.end());
+    if (method == ome::files::DOWNSAMPLE_MAX)
+      return *std::max_element(block.begin(), block.end());
+    if (method == ome::files::DOWNSAMPLE_NEAREST)
+      return block.front();
+    return referenceMode(block);
+  }
+
+  template<>
+  double
+  referenceBlock<double>(const std::vector<double>& block,
+                         DownsampleMethod           method)
+  {
+    if (method == ome::files::DOWNSAMPLE_MEAN)
+      {
+        double sum = 0.0;
+        for (const auto& v : block)
+          sum += v;
+        return sum / static_cast<double>(block.size());
+      }
+    if (method == ome::files::DOWNSAMPLE_MIN)
+      return *std::min_element(block.begin(), block.end());
+    if (method == ome::files::DOWNSAMPLE_MAX)
+      return *std::max_element(block.begin(), block.end());
+    if (method == ome::files::DOWNSAMPLE_NEAREST)
+      return block.front();
+    return referenceMode(block);
+  }
+
+  template<>
+  std::complex<float>
+  referenceBlock<std::complex<float>>(const std::vector<std::complex<float>>& block,
+                                      DownsampleMethod                        method)
+  {
+    return referenceComplex(block, method);
+  }
+
+  template<>
+  std::complex<double>
+  referenceBlock<std::complex<double>>(const std::vector<std::complex<double>>& block,
+                                       DownsampleMethod                         method)
+  {
+    return referenceComplex(block, method);
+  }
+
+  struct CheckVisitor
+  {
+    const VariantPixelBuffer& result;
+    const DownsampleTestParameters& params;
+
+    CheckVisitor(const VariantPixelBuffer&       result,
+                 const DownsampleTestParameters& params):
+      result(result),
+      params(params)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<T>>& source)
+    {
+      const std::shared_ptr<PixelBuffer<T>>& dest =
+        ome::compat::get<std::shared_ptr<PixelBuffer<T>>>(result.vbuffer());
+
+      const dimension_size_type dw = (width + params.factorX - 1U) / params.factorX;
+      const dimension_size_type dh = (height + params.factorY - 1U) / params.factorY;
+      ASSERT_EQ(dw, dest->shape()[ome::files::DIM_SPATIAL_X]);
+      ASSERT_EQ(dh, dest->shape()[ome::files::DIM_SPATIAL_Y]);
+
+      for (dimension_size_type z = 0; z < planes; ++z)
+        for (dimension_size_type s = 0; s < samples; ++s)
+          for (dimension_size_type dy = 0; dy < dh; ++dy)
+            for (dimension_size_type dx = 0; dx < dw; ++dx)
+              {
+                std::vector<T> block;
+                for (dimension_size_type y = dy * params.factorY;
+                     y < std::min(height, (dy + 1U) * params.factorY);
+                     ++y)
+                  for (dimension_size_type x = dx * params.factorX;
+                       x < std::min(width, (dx + 1U) * params.factorX);
+                       ++x)
+                    block.push_back(source->at(makeIndex(x, y, s, z)));
+
+                ASSERT_EQ(referenceBlock(block, params.method),
+                          dest->at(makeIndex(dx, dy, s, z)))
+                  << "at " << dx << ',' << dy << ',' << s << ',' << z;
+              }
+    }
+  };
+
+}
+
+class DownsampleTest : public ::testing::TestWithParam<DownsampleTestParameters>
+{
+};
+
+TEST_P(DownsampleTest, Reference)
+{
+  const DownsampleTestParameters& params = GetParam();
+
+  VariantPixelBuffer source(makeShape(width, height), params.type,
+                            PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                params.interleaved));
+  FillVisitor fill;
+  ome::compat::visit(fill, source.vbuffer());
+
+  VariantPixelBuffer dest;
+  if (!ome::files::isDownsampleSupported(params.method, params.type))
+    {
+      EXPECT_THROW(ome::files::downsample(source, dest, params.factorX, params.factorY, params.method),
+                   std::logic_error);
+      return;
+    }
+
+  ASSERT_NO_THROW(ome::files::downsample(source, dest, params.factorX, params.factorY, params.method));
+  EXPECT_EQ(params.type, dest.pixelType());
+
+  CheckVisitor check(dest, params);
+  ome::compat::visit(check, source.vbuffer());
+}
+
+TEST(Downsample, DefaultFactor)
+{
+  VariantPixelBuffer source(makeShape(width, height), PT::UINT16);
+  FillVisitor fill;
+  ome::compat::visit(fill, source.vbuffer());
+
+  VariantPixelBuffer half;
+  VariantPixelBuffer reference;
+  ome::files::downsample(source, half);
+  ome::files::downsample(source, reference, 2U, 2U, ome::files::DOWNSAMPLE_MEAN);
+  EXPECT_TRUE(half == reference);
+}
+
+TEST(Downsample, InvalidFactor)
+{
+  VariantPixelBuffer source(makeShape(width, height), PT::UINT8);
+  VariantPixelBuffer dest;
+  EXPECT_THROW(ome::files::downsample(source, dest, 0U, 2U), std::logic_error);
+  EXPECT_THROW(ome::files::downsample(source, dest, 2U, 0U), std::logic_error);
+}
+
+TEST(Downsample, TypedDestinationExtents)
+{
+  PixelBuffer<uint8_t> source(makeShape(width, height), PT::UINT8);
+  PixelBuffer<uint8_t> dest(makeShape(7U, 4U), PT::UINT8);
+  PixelBuffer<uint8_t> wrong(makeShape(6U, 4U), PT::UINT8);
+
+  EXPECT_NO_THROW(ome::files::downsample(source, dest, 2U, 2U, ome::files::DOWNSAMPLE_MAX));
+  EXPECT_THROW(ome::files::downsample(source, wrong, 2U, 2U, ome::files::DOWNSAMPLE_MAX), std::logic_error);
+}
+
+namespace
+{
+
+  // Reduce planar rows of values over the full range of the type by
+  // 2×2 blocks, and check every pixel against the reference.  The
+  // rows are wide enough to use several whole vectors of the single
+  // pass kernels as well as the remainder and the odd last column.
+  template<typename T>
+  void
+  checkPairs(PT type)
+  {
+    const dimension_size_type w = 75U;
+    const dimension_size_type h = 5U;
+    const PixelBufferBase::storage_order_type order
+      (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+
+    PixelBuffer<T> source(makeShape(w, h), type, ome::files::ENDIAN_NATIVE, order);
+    for (dimension_size_type z = 0; z < planes; ++z)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        for (dimension_size_type y = 0; y < h; ++y)
+          for (dimension_size_type x = 0; x < w; ++x)
+            source.at(makeIndex(x, y, s, z)) = (x + y) % 9U == 0U ?
+              std::numeric_limits<T>::max() :
+              static_cast<T>((x * 2654435761U + y * 40503U + s * 977U + z * 131U) >> 7);
+
+    const std::vector<DownsampleMethod> methods
+      {
+        ome::files::DOWNSAMPLE_MEAN,
+        ome::files::DOWNSAMPLE_MIN,
+        ome::files::DOWNSAMPLE_MAX
+      };
+    for (const auto method : methods)
+      {
+        PixelBuffer<T> dest(makeShape((w + 1U) / 2U, (h + 1U) / 2U), type, ome::files::ENDIAN_NATIVE, order);
+        ASSERT_NO_THROW(ome::files::downsample(source, dest, 2U, 2U, method));
+
+        for (dimension_size_type z = 0; z < planes; ++z)
+          for (dimension_size_type s = 0; s < samples; ++s)
+            for (dimension_size_type dy = 0; dy < (h + 1U) / 2U; ++dy)
+              for (dimension_size_type dx = 0; dx < (w + 1U) / 2U; ++dx)
+                {
+                  std::vector<T> block;
+                  for (dimension_size_type y = dy * 2U; y < std::min(h, dy * 2U + 2U); ++y)
+                    for (dimension_size_type x = dx * 2U; x < std::min(w, dx * 2U + 2U); ++x)
+                      block.push_back(source.at(makeIndex(x, y, s, z)));
+
+                  ASSERT_EQ(referenceBlock(block, method), dest.at(makeIndex(dx, dy, s, z)))
+                    << method << " at " << dx << ',' << dy << ',' << s << ',' << z;
+                }
+      }
+  }
+
+}
+
+TEST(Downsample, Pairs)
+{
+  checkPairs<uint8_t>(PT::UINT8);
+  checkPairs<uint16_t>(PT::UINT16);
+  checkPairs<int16_t>(PT::INT16);
+}
+
+TEST(Downsample, AreaAverage)
+{
+  VariantPixelBuffer source(makeShape(width, height), PT::UINT16);
+  FillVisitor fill;
+  ome::compat::visit(fill, source.vbuffer());
+  const std::shared_ptr<PixelBuffer<uint16_t>>& src =
+    ome::compat::get<std::shared_ptr<PixelBuffer<uint16_t>>>(source.vbuffer());
+
+  // Widths which do not divide the source width, and which do.
+  const dimension_size_type widths[] = {5U, 1U, width};
+  const dimension_size_type dh = 3U;
+  for (const dimension_size_type dw : widths)
+    {
+      VariantPixelBuffer dest(makeShape(dw, dh), PT::UINT16,
+                              PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+
+      // Add in bands of two rows.
+      ome::files::AreaAverage average(width, height, dest);
+      for (dimension_size_type y = 0; y < height; y += 2U)
+        {
+          const dimension_size_type h = std::min(dimension_size_type(2U), height - y);
+          VariantPixelBuffer band(makeShape(width, h), PT::UINT16);
+          const std::shared_ptr<PixelBuffer<uint16_t>>& b =
+            ome::compat::get<std::shared_ptr<PixelBuffer<uint16_t>>>(band.vbuffer());
+          for (dimension_size_type z = 0; z < planes; ++z)
+            for (dimension_size_type s = 0; s < samples; ++s)
+              for (dimension_size_type r = 0; r < h; ++r)
+                for (dimension_size_type x = 0; x < width; ++x)
+                  b->at(makeIndex(x, r, s, z)) = src->at(makeIndex(x, y + r, s, z));
+          average.add(band, y);
+        }
+      average.finish();
+
+      const std::shared_ptr<PixelBuffer<uint16_t>>& d =
+        ome::compat::get<std::shared_ptr<PixelBuffer<uint16_t>>>(dest.vbuffer());
+      for (dimension_size_type z = 0; z < planes; ++z)
+        for (dimension_size_type s = 0; s < samples; ++s)
+          for (dimension_size_type dy = 0; dy < dh; ++dy)
+            for (dimension_size_type dx = 0; dx < dw; ++dx)
+              {
+                std::vector<uint16_t> block;
+                for (dimension_size_type y = 0; y < height; ++y)
+                  for (dimension_size_type x = 0; x < width; ++x)
+                    if ((x * dw) / width == dx && (y * dh) / height == dy)
+                      block.push_back(src->at(makeIndex(x, y, s, z)));
+                ASSERT_EQ(referenceBlock(block, ome::files::DOWNSAMPLE_MEAN),
+                          d->at(makeIndex(dx, dy, s, z)));
+              }
+
+      // Incompatible bands are rejected.
+      VariantPixelBuffer narrow(makeShape(width - 1U, 1U), PT::UINT16);
+      EXPECT_THROW(average.add(narrow, 0U), std::logic_error);
+      VariantPixelBuffer wrongtype(makeShape(width, 1U), PT::UINT8);
+      EXPECT_THROW(average.add(wrongtype, 0U), std::logic_error);
+    }
+}
+
+namespace
+{
+
+  std::vector<DownsampleTestParameters>
+  makeParams()
+  {
+    const std::vector<PT> types
+      {
+        PT::INT8, PT::INT16, PT::INT32,
+        PT::UINT8, PT::UINT16, PT::UINT32,
+        PT::FLOAT, PT::DOUBLE, PT::BIT,
+        PT::COMPLEXFLOAT, PT::COMPLEXDOUBLE
+      };
+    const std::vector<DownsampleMethod> methods
+      {
+        ome::files::DOWNSAMPLE_NEAREST,
+        ome::files::DOWNSAMPLE_MEAN,
+        ome::files::DOWNSAMPLE_MIN,
+        ome::files::DOWNSAMPLE_MAX,
+        ome::files::DOWNSAMPLE_MODE
+      };
+    const std::vector<std::array<dimension_size_type, 2>> factors
+      {
+        {{1U, 1U}}, {{2U, 2U}}, {{3U, 2U}}, {{4U, 4U}}, {{5U, 3U}}
+      };
+
+    std::vector<DownsampleTestParameters> ret;
+    for (const auto& type : types)
+      for (const auto& method : methods)
+        for (const auto& factor : factors)
+          for (const bool interleaved : {false, true})
+            ret.push_back(DownsampleTestParameters(type, method, factor[0], factor[1], interleaved));
+    return ret;
+  }
+
+}
+
+std::vector<DownsampleTestParameters> params(makeParams());
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(DownsampleVariants, DownsampleTest, ::testing::ValuesIn(params));
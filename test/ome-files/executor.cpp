@@ -0,0 +1,130 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <ome/files/Executor.h>
+
+#include <ome/test/test.h>
+
+using ome::files::Executor;
+using ome::files::ThreadPoolExecutor;
+using ome::files::dimension_size_type;
+
+TEST(ThreadPoolExecutor, ThreadCount)
+{
+  ThreadPoolExecutor e(3);
+  EXPECT_EQ(3U, e.getThreadCount());
+
+  ThreadPoolExecutor d;
+  EXPECT_LE(1U, d.getThreadCount());
+}
+
+TEST(ThreadPoolExecutor, RunAll)
+{
+  std::atomic<dimension_size_type> count(0U);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+
+  {
+    ThreadPoolExecutor e(4);
+    for (dimension_size_type i = 0; i < 1000; ++i)
+      e.execute([&count, &mutex, &threads]()
+                {
+                  ++count;
+                  std::lock_guard<std::mutex> lock(mutex);
+                  threads.insert(std::this_thread::get_id());
+                });
+    // The destructor waits for all queued tasks.
+  }
+
+  EXPECT_EQ(1000U, count);
+  EXPECT_GE(4U, threads.size());
+  EXPECT_EQ(0U, threads.count(std::this_thread::get_id()));
+}
+
+TEST(ThreadPoolExecutor, SingleThreadOrder)
+{
+  std::vector<dimension_size_type> order;
+
+  {
+    ThreadPoolExecutor e(1);
+    for (dimension_size_type i = 0; i < 100; ++i)
+      e.execute([&order, i]() { order.push_back(i); });
+  }
+
+  ASSERT_EQ(100U, order.size());
+  for (dimension_size_type i = 0; i < order.size(); ++i)
+    EXPECT_EQ(i, order[i]);
+}
+
+TEST(ThreadPoolExecutor, Throw)
+{
+  std::vector<dimension_size_type> order;
+
+  {
+    ThreadPoolExecutor e(1);
+    e.execute([]() { throw std::runtime_error("task failed"); });
+    e.execute([&order]() { order.push_back(1U); });
+    e.execute([]() { throw 42; });
+    e.execute([&order]() { order.push_back(2U); });
+  }
+
+  // The worker survives tasks which throw.
+  ASSERT_EQ(2U, order.size());
+  EXPECT_EQ(1U, order[0]);
+  EXPECT_EQ(2U, order[1]);
+}
+
+TEST(ThreadPoolExecutor, Default)
+{
+  std::shared_ptr<Executor> e(ome::files::getDefaultExecutor());
+  ASSERT_TRUE(static_cast<bool>(e));
+  EXPECT_EQ(e, ome::files::getDefaultExecutor());
+
+  std::promise<int> p;
+  std::future<int> f(p.get_future());
+  e->execute([&p]() { p.set_value(42); });
+  EXPECT_EQ(42, f.get());
+}
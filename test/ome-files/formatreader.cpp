@@ -36,11 +36,18 @@
  * #L%
  */
 
+#include <array>
+#include <chrono>
+#include <deque>
+#include <future>
 #include <stdexcept>
+#include <vector>
 
 #include <ome/common/module.h>
 
+#include <ome/files/Executor.h>
 #include <ome/files/FormatReader.h>
+#include <ome/files/PlaneRegion.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/PixelProperties.h>
 #include <ome/files/detail/FormatReader.h>
@@ -113,6 +120,33 @@ namespace
 
   const ReaderProperties props(test_properties());
 
+  // Executor which runs tasks only when requested.
+  class DeferredExecutor : public ome::files::Executor
+  {
+  public:
+    std::deque<task_type> tasks;
+
+    void
+    execute(task_type task)
+    {
+      tasks.push_back(task);
+    }
+
+    void
+    runOne()
+    {
+      task_type task(tasks.front());
+      tasks.pop_front();
+      task();
+    }
+  };
+
+  bool
+  ready(const std::future<std::shared_ptr<VariantPixelBuffer>>& f)
+  {
+    return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
 }
 
 class FormatReaderCustom : public ::ome::files::detail::FormatReader
@@ -178,15 +212,23 @@ protected:
 
 protected:
   void
-  openBytesImpl(dimension_size_type /* no */,
-                VariantPixelBuffer& /* buf */,
+  openBytesImpl(dimension_size_type no,
+                VariantPixelBuffer& buf,
                 dimension_size_type /* x */,
                 dimension_size_type /* y */,
-                dimension_size_type /* w */,
-                dimension_size_type /* h */) const
+                dimension_size_type w,
+                dimension_size_type h) const
   {
     assertId(currentId, true);
-    return;
+
+    // Zero-filled pixel data of the requested size.
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[::ome::files::DIM_SPATIAL_X] = w;
+    shape[::ome::files::DIM_SPATIAL_Y] = h;
+    shape[::ome::files::DIM_SUBCHANNEL] = getRGBChannelCount(getZCTCoords(no)[1]);
+    shape[::ome::files::DIM_SPATIAL_Z] = shape[::ome::files::DIM_TEMPORAL_T] = shape[::ome::files::DIM_CHANNEL] =
+      shape[::ome::files::DIM_MODULO_Z] = shape[::ome::files::DIM_MODULO_T] = shape[::ome::files::DIM_MODULO_C] = 1;
+    buf.setBuffer(shape, getPixelType());
   }
 
   void
@@ -345,6 +387,94 @@ TEST_P(FormatReaderTest, IsThisType)
   EXPECT_TRUE(r.isThisType(vstr));
 }
 
+TEST_P(FormatReaderTest, Clone)
+{
+  EXPECT_THROW(r.clone(), std::logic_error);
+}
+
+TEST_P(FormatReaderTest, OpenBytesAsync)
+{
+  std::shared_ptr<DeferredExecutor> executor(std::make_shared<DeferredExecutor>());
+
+  EXPECT_EQ(ome::files::getDefaultExecutor(), r.getExecutor());
+  r.setExecutor(executor);
+  EXPECT_EQ(executor, r.getExecutor());
+
+  r.setId("test");
+  r.setSeries(1);
+
+  std::vector<std::future<std::shared_ptr<VariantPixelBuffer>>> futures;
+  futures.push_back(r.openBytesAsync(3, ome::files::PlaneRegion(0, 0, 1, 1)));
+  futures.push_back(r.openBytesAsync(1, ome::files::PlaneRegion(0, 0, 2, 2)));
+  futures.push_back(r.openBytesAsync(3, ome::files::PlaneRegion(0, 0, 3, 3)));
+  futures.push_back(r.openBytesAsync(0, 0, 2, ome::files::PlaneRegion()));
+  futures.push_back(r.openBytesAsync(1, 0, 1000, ome::files::PlaneRegion()));
+  r.setSeries(0);
+  ASSERT_EQ(futures.size(), executor->tasks.size());
+
+  // Reads of the same plane are batched, and the remainder run in
+  // plane order.
+  const std::array<dimension_size_type, 5> order{{3, 1, 0, 2, 4}};
+  for (dimension_size_type i = 0; i < order.size(); ++i)
+    {
+      executor->runOne();
+      for (dimension_size_type j = 0; j < order.size(); ++j)
+        EXPECT_EQ(j <= i, ready(futures.at(order.at(j))));
+    }
+
+  std::shared_ptr<VariantPixelBuffer> buf;
+  ASSERT_NO_THROW(buf = futures.at(0).get());
+  EXPECT_EQ(1U, buf->shape()[ome::files::DIM_SPATIAL_X]);
+  ASSERT_NO_THROW(buf = futures.at(1).get());
+  EXPECT_EQ(2U, buf->shape()[ome::files::DIM_SPATIAL_X]);
+  ASSERT_NO_THROW(buf = futures.at(2).get());
+  EXPECT_EQ(3U, buf->shape()[ome::files::DIM_SPATIAL_X]);
+  ASSERT_NO_THROW(buf = futures.at(3).get());
+  EXPECT_EQ(512U, buf->shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(1024U, buf->shape()[ome::files::DIM_SPATIAL_Y]);
+  EXPECT_THROW(futures.at(4).get(), std::logic_error);
+  EXPECT_EQ(0U, r.getSeries());
+}
+
+TEST_P(FormatReaderTest, OpenBlock)
+{
+  r.setId("test");
+
+  VariantPixelBuffer buf;
+  ASSERT_NO_THROW(r.openBytes(ome::files::DimensionRange(2, 5),
+                              ome::files::DimensionRange(1, 3),
+                              ome::files::DimensionRange(1, 2),
+                              ome::files::PlaneRegion(4, 8, 16, 32), buf));
+  EXPECT_EQ(16U, buf.shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(32U, buf.shape()[ome::files::DIM_SPATIAL_Y]);
+  EXPECT_EQ(3U, buf.shape()[ome::files::DIM_SUBCHANNEL]);
+  EXPECT_EQ(3U, buf.shape()[ome::files::DIM_SPATIAL_Z]);
+  EXPECT_EQ(2U, buf.shape()[ome::files::DIM_TEMPORAL_T]);
+  EXPECT_EQ(1U, buf.shape()[ome::files::DIM_CHANNEL]);
+  EXPECT_EQ(GetParam().type, buf.pixelType());
+  EXPECT_EQ(0U, r.getPlane());
+
+  // Channels 0 and 1 have different numbers of subchannels.
+  EXPECT_THROW(r.openBytes(ome::files::DimensionRange(0, 1),
+                           ome::files::DimensionRange(0, 1),
+                           ome::files::DimensionRange(0, 2),
+                           ome::files::PlaneRegion(), buf), std::logic_error);
+  EXPECT_THROW(r.openBytes(ome::files::DimensionRange(0, 1),
+                           ome::files::DimensionRange(0, 6),
+                           ome::files::DimensionRange(0, 1),
+                           ome::files::PlaneRegion(), buf), std::logic_error);
+}
+
+TEST_P(FormatReaderTest, DefaultOpenBytesAsync)
+{
+  r.setId("test");
+
+  std::shared_ptr<VariantPixelBuffer> buf;
+  ASSERT_NO_THROW(buf = r.openBytesAsync(2, ome::files::PlaneRegion(1, 2, 3, 4)).get());
+  EXPECT_EQ(3U, buf->shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(4U, buf->shape()[ome::files::DIM_SPATIAL_Y]);
+}
+
 TEST_P(FormatReaderTest, DefaultClose)
 {
   EXPECT_NO_THROW(r.close());
@@ -1015,6 +1145,8 @@ TEST_P(FormatReaderTest, DefaultPixels)
 
   EXPECT_THROW(r.openBytes(0, buf), std::logic_error);
   EXPECT_THROW(r.openBytes(0, buf, 0, 0, 512, 512), std::logic_error);
+  EXPECT_THROW(r.openBytes(0, buf, 0, 0, 512, 512, 4, 4), std::logic_error);
+  EXPECT_THROW(r.openRegionAtScale(0, buf, 0, 0, 512, 512, 64, 64), std::logic_error);
   EXPECT_THROW(r.openThumbBytes(0, buf), std::logic_error);
 }
 
@@ -1069,9 +1201,32 @@ namespace
       for (uint32_t i = 0; i < expected.size(); ++i)
         ASSERT_EQ(expected.at(i), *(buf.data<value_type>()+i));
 
-      EXPECT_NO_THROW(reader.openBytes(0, buf));
-      EXPECT_NO_THROW(reader.openBytes(0, buf, 0, 0, 512, 512));
-      EXPECT_THROW(reader.openThumbBytes(0, buf), std::runtime_error);
+      VariantPixelBuffer pixels;
+      EXPECT_NO_THROW(reader.openBytes(0, pixels));
+      EXPECT_NO_THROW(reader.openBytes(0, pixels, 0, 0, 512, 512));
+
+      VariantPixelBuffer sampled;
+      EXPECT_NO_THROW(reader.openBytes(0, sampled, 3, 5, 500, 300, 8, 7));
+      EXPECT_EQ(63U, sampled.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(43U, sampled.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_EQ(reader.getPixelType(), sampled.pixelType());
+      EXPECT_THROW(reader.openBytes(0, sampled, 0, 0, 512, 512, 0, 1), std::logic_error);
+
+      VariantPixelBuffer scaled;
+      EXPECT_NO_THROW(reader.openRegionAtScale(0, scaled, 16, 32, 300, 200, 45, 30));
+      EXPECT_EQ(45U, scaled.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(30U, scaled.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_EQ(reader.getPixelType(), scaled.pixelType());
+      EXPECT_NO_THROW(reader.openRegionAtScale(0, scaled, 16, 32, 30, 20, 45, 30));
+      EXPECT_EQ(45U, scaled.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(30U, scaled.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_THROW(reader.openRegionAtScale(0, scaled, 0, 0, 512, 512, 0, 30), std::logic_error);
+
+      VariantPixelBuffer thumb;
+      EXPECT_NO_THROW(reader.openThumbBytes(0, thumb));
+      EXPECT_EQ(reader.getThumbSizeX(), thumb.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(reader.getThumbSizeY(), thumb.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_EQ(reader.getPixelType(), thumb.pixelType());
     }
   };
 
@@ -36,17 +36,31 @@
  * #L%
  */
 
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/MinimalTIFFReader.h>
+#include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/TIFF.h>
+#include <ome/files/tiff/Tags.h>
 
 #include <ome/test/test.h>
 
 using ome::files::dimension_size_type;
 using ome::files::VariantPixelBuffer;
 using ome::files::in::MinimalTIFFReader;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+
+using namespace boost::filesystem;
 
 class TIFFTestParameters
 {
@@ -147,6 +161,136 @@ TEST_P(TIFFTest, openBytes)
     }
 }
 
+TEST(MinimalTIFFReader, InterleavedReducedPages)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+    throw std::runtime_error("Image directory unavailable and could not be created");
+  const path filename(dir / "minimaltiffreader-interleaved-reduced.tiff");
+
+  // Each full resolution plane is followed by its reduced
+  // resolution, with a distinct value in each page.
+  const dimension_size_type planes = 3U;
+  auto page = [](dimension_size_type size, uint8_t value)
+    {
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = size;
+      shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] =
+        shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+        shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1U;
+      VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT8);
+      uint8_t *data = buf.data<uint8_t>();
+      std::fill(data, data + buf.num_elements(), value);
+      return buf;
+    };
+
+  {
+    std::shared_ptr<TIFF> wtiff = TIFF::open(filename, "w");
+    for (dimension_size_type p = 0; p < planes; ++p)
+      {
+        for (const bool reduced : {false, true})
+          {
+            const dimension_size_type size = reduced ? 16U : 32U;
+            std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+            wifd->setImageWidth(size);
+            wifd->setImageHeight(size);
+            wifd->setTileType(ome::files::tiff::STRIP);
+            wifd->setTileWidth(size);
+            wifd->setTileHeight(8U);
+            wifd->setPixelType(ome::xml::model::enums::PixelType::UINT8);
+            wifd->setBitsPerSample(8U);
+            wifd->setSamplesPerPixel(1U);
+            wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+            wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+            if (reduced)
+              wifd->getField(ome::files::tiff::SUBFILETYPE).set(1U);
+            ASSERT_NO_THROW(wifd->writeImage(page(size, static_cast<uint8_t>(reduced ? 100U + p : p))));
+            wtiff->writeCurrentDirectory();
+          }
+      }
+    wtiff->close();
+  }
+
+  MinimalTIFFReader reader;
+  reader.setFlattenedResolutions(false);
+  ASSERT_NO_THROW(reader.setId(filename));
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  ASSERT_EQ(2U, reader.getResolutionCount());
+  ASSERT_EQ(planes, reader.getImageCount());
+
+  for (dimension_size_type r = 0; r < reader.getResolutionCount(); ++r)
+    {
+      reader.setResolution(r);
+      EXPECT_EQ(r ? 16U : 32U, reader.getSizeX());
+      for (dimension_size_type p = 0; p < planes; ++p)
+        {
+          VariantPixelBuffer vb;
+          ASSERT_NO_THROW(reader.openBytes(p, vb));
+          EXPECT_TRUE(page(r ? 16U : 32U, static_cast<uint8_t>(r ? 100U + p : p)) == vb)
+            << "resolution " << r << " plane " << p;
+        }
+    }
+
+  // Clones use the same plane mapping.
+  reader.setResolution(0);
+  std::shared_ptr<ome::files::FormatReader> copy(reader.clone());
+  for (dimension_size_type p = 0; p < planes; ++p)
+    {
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(copy->openBytes(p, vb));
+      EXPECT_TRUE(page(32U, static_cast<uint8_t>(p)) == vb) << "plane " << p;
+    }
+}
+
+TEST(MinimalTIFFReader, SameSizeReducedPages)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+    throw std::runtime_error("Image directory unavailable and could not be created");
+  const path filename(dir / "minimaltiffreader-same-size-reduced.tiff");
+
+  // Pages marked as reduced resolution but not smaller than the
+  // preceding page are not resolutions.
+  const dimension_size_type pages = 4U;
+  {
+    std::shared_ptr<TIFF> wtiff = TIFF::open(filename, "w");
+    for (dimension_size_type p = 0; p < pages; ++p)
+      {
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = 16U;
+        shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] =
+          shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+          shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1U;
+        VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT8);
+        uint8_t *data = buf.data<uint8_t>();
+        std::fill(data, data + buf.num_elements(), static_cast<uint8_t>(p));
+
+        std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+        wifd->setImageWidth(16U);
+        wifd->setImageHeight(16U);
+        wifd->setTileType(ome::files::tiff::STRIP);
+        wifd->setTileWidth(16U);
+        wifd->setTileHeight(8U);
+        wifd->setPixelType(ome::xml::model::enums::PixelType::UINT8);
+        wifd->setBitsPerSample(8U);
+        wifd->setSamplesPerPixel(1U);
+        wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+        wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+        if (p % 2U)
+          wifd->getField(ome::files::tiff::SUBFILETYPE).set(1U);
+        ASSERT_NO_THROW(wifd->writeImage(buf));
+        wtiff->writeCurrentDirectory();
+      }
+    wtiff->close();
+  }
+
+  MinimalTIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(filename));
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  EXPECT_EQ(1U, reader.getResolutionCount());
+  EXPECT_EQ(pages, reader.getImageCount());
+}
+
 namespace
 {
 
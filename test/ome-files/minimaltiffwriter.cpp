@@ -36,12 +36,17 @@
  * #L%
  */
 
+#include <algorithm>
+#include <set>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <ome/files/CoreMetadata.h>
+#include <ome/files/FormatException.h>
 #include <ome/files/MetadataTools.h>
 #include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/MinimalTIFFReader.h>
 #include <ome/files/out/MinimalTIFFWriter.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
@@ -58,6 +63,7 @@
 using ome::files::dimension_size_type;
 using ome::files::CoreMetadata;
 using ome::files::VariantPixelBuffer;
+using ome::files::in::MinimalTIFFReader;
 using ome::files::out::MinimalTIFFWriter;
 using ome::files::tiff::IFD;
 using ome::files::tiff::TIFF;
@@ -145,6 +151,102 @@ TEST(TIFFWriter, SupportedCompressionTypes)
   EXPECT_FALSE(w.isSupportedType(ome::xml::model::enums::PixelType::INT16, "invalid"));
 }
 
+TEST(TIFFWriter, WebPLayout)
+{
+  MinimalTIFFWriter writer;
+
+  // Skip if WebP is not provided by libtiff.
+  const std::set<std::string>& available(writer.getCompressionTypes(PixelType::UINT8));
+  if (available.find("WEBP") == available.end())
+    return;
+
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+  seriesList.push_back(std::make_shared<CoreMetadata>());
+  seriesList.back()->sizeX = 64U;
+  seriesList.back()->sizeY = 64U;
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+  // WebP can't compress greyscale data.
+  writer.setMetadataRetrieve(retrieve);
+  writer.setCompression("WEBP");
+  EXPECT_THROW(writer.setId(PROJECT_BINARY_DIR "/test/ome-files/data/minimaltiffwriter-webp.tiff"),
+               ome::files::FormatException);
+}
+
+TEST(TIFFWriter, SparseFillValue)
+{
+  path filename(PROJECT_BINARY_DIR "/test/ome-files/data/minimaltiffwriter-sparse.tiff");
+
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+  seriesList.push_back(std::make_shared<CoreMetadata>());
+  seriesList.back()->sizeX = 64U;
+  seriesList.back()->sizeY = 64U;
+  seriesList.back()->pixelType = PixelType::UINT16;
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+  // Only the first tile contains data other than the fill value.
+  VariantPixelBuffer pixels(boost::extents[64][64][1][1][1][1][1][1][1], PixelType::UINT16);
+  uint16_t *data = pixels.data<uint16_t>();
+  std::fill(data, data + pixels.num_elements(), static_cast<uint16_t>(7U));
+  for (dimension_size_type y = 0; y < 8; ++y)
+    for (dimension_size_type x = 0; x < 8; ++x)
+      data[(y * 64U) + x] = static_cast<uint16_t>(x + y + 1000U);
+
+  {
+    MinimalTIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setTileSizeX(16U);
+    writer.setTileSizeY(16U);
+    writer.setSparse(true);
+    writer.setFillValue(7.0);
+    ASSERT_NO_THROW(writer.setId(filename));
+    ASSERT_NO_THROW(writer.saveBytes(0, pixels));
+    writer.close();
+  }
+
+  // The fill value is stored in the file, so the sparse tiles are
+  // restored without any reader configuration.
+  {
+    MinimalTIFFReader reader;
+    ASSERT_NO_THROW(reader.setId(filename));
+    VariantPixelBuffer vb;
+    ASSERT_NO_THROW(reader.openBytes(0, vb));
+    EXPECT_TRUE(pixels == vb);
+    reader.close();
+  }
+
+  // The fill value is not stored unless sparse tiles are written,
+  // since other readers treat it as a no data value.
+  {
+    MinimalTIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setFillValue(7.0);
+    ASSERT_NO_THROW(writer.setId(filename));
+    ASSERT_NO_THROW(writer.saveBytes(0, pixels));
+    writer.close();
+
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+    EXPECT_EQ(0.0, tiff->getDirectoryByIndex(0)->getFillValue());
+  }
+
+  // Values which the pixel type can not hold are rejected.
+  {
+    MinimalTIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    EXPECT_THROW(writer.setFillValue(-9999.0), std::logic_error);
+    EXPECT_THROW(writer.setFillValue(0.5), std::logic_error);
+    EXPECT_EQ(0.0, writer.getFillValue());
+  }
+
+  boost::filesystem::remove(filename);
+}
+
 TEST_P(TIFFWriterTest, setId)
 {
   const TIFFTestParameters& params = GetParam();
@@ -0,0 +1,839 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <ome/files/ChunkIterator.h>
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/Executor.h>
+#include <ome/files/FormatReader.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/MinimalTIFFReader.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+#include "ometifftest.h"
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::DimensionRange;
+using ome::files::FormatReader;
+using ome::files::PlaneRegion;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::MinimalTIFFReader;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+
+class OMETIFFReaderTest : public OMETIFFTest
+{
+public:
+  boost::filesystem::path pyramidfile;
+
+  // Expected content of each resolution of pyramidfile.
+  std::vector<VariantPixelBuffer> levels;
+
+  boost::filesystem::path blockfile;
+  dimension_size_type sizeX;
+  dimension_size_type sizeY;
+  dimension_size_type sizeZ;
+
+  // Whole plane and partial regions of blockfile planes.
+  std::array<PlaneRegion, 2> regions;
+
+  OMETIFFReaderTest():
+    OMETIFFTest("ometiffreader-"),
+    sizeX(0U),
+    sizeY(0U),
+    sizeZ(0U)
+  {}
+
+  // Write the source image with two reduced resolutions.  Each
+  // level is the mean of the level above.
+  void
+  writePyramid()
+  {
+    pyramidfile = outputFile("pyramid");
+    ASSERT_NO_FATAL_FAILURE(writeFile(pyramidfile,
+                                      [](OMETIFFWriter& writer)
+                                      {
+                                        writer.setCompression("Deflate");
+                                        writer.setPyramidLevels(2);
+                                      },
+                                      7U));
+
+    levels.assign(1U, source);
+    for (dimension_size_type r = 1; r < 3U; ++r)
+      {
+        levels.emplace_back();
+        ome::files::downsample(levels[r - 1], levels[r]);
+      }
+  }
+
+  // Write four Z planes, each a different quarter of the source
+  // image.
+  void
+  writeBlock()
+  {
+    blockfile = outputFile("block");
+    sizeX = ifd->getImageWidth() / 2U;
+    sizeY = ifd->getImageHeight() / 2U;
+    sizeZ = 4U;
+    regions = {{PlaneRegion(), PlaneRegion(3, 5, sizeX - 7, sizeY - 6)}};
+
+    std::vector<std::shared_ptr<CoreMetadata>> series;
+    series.push_back(ome::files::tiff::makeCoreMetadata(*ifd));
+    series.back()->sizeX = sizeX;
+    series.back()->sizeY = sizeY;
+    series.back()->sizeZ = sizeZ;
+    series.back()->imageCount = sizeZ;
+
+    OMETIFFWriter writer;
+    setupWriter(writer, series);
+    ASSERT_NO_THROW(writer.setId(blockfile));
+
+    for (dimension_size_type z = 0; z < sizeZ; ++z)
+      {
+        VariantPixelBuffer planebuf;
+        ifd->readImage(planebuf, (z % 2U) * sizeX, (z / 2U) * sizeY, sizeX, sizeY);
+        ASSERT_NO_THROW(writer.saveBytes(z, planebuf));
+      }
+    writer.close();
+  }
+
+  // Open pyramidfile with or without flattened resolutions.
+  void
+  openPyramid(FormatReader& reader,
+              bool          flattened)
+  {
+    std::shared_ptr<ome::xml::meta::MetadataStore> store(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+    ASSERT_NO_THROW(reader.setMetadataStore(store));
+    reader.setFlattenedResolutions(flattened);
+    ASSERT_NO_THROW(reader.setId(pyramidfile));
+  }
+
+  // Read every resolution from several threads sharing the reader,
+  // using reads with an explicit resolution.
+  void
+  checkConcurrentReads(const FormatReader& reader)
+  {
+    std::vector<int> matched(levels.size() * 4U, 0);
+    std::vector<std::thread> threads;
+    for (dimension_size_type t = 0; t < matched.size(); ++t)
+      threads.emplace_back([this, &reader, &matched, t]()
+                           {
+                             const dimension_size_type r = t % levels.size();
+                             VariantPixelBuffer vb;
+                             try
+                               {
+                                 reader.openBytes(0, r, 0, PlaneRegion(), vb);
+                                 matched[t] = levels[r] == vb;
+                               }
+                             catch (const std::exception&)
+                               {
+                               }
+                           });
+    for (auto& thread : threads)
+      thread.join();
+    for (dimension_size_type t = 0; t < matched.size(); ++t)
+      EXPECT_TRUE(matched[t]) << "thread " << t;
+  }
+};
+
+TEST_P(OMETIFFReaderTest, defaultResolutions)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  // By default, reduced resolutions do not add series, so series
+  // indexes are the same as for a file without them.
+  OMETIFFReader reader;
+  EXPECT_FALSE(reader.hasFlattenedResolutions());
+  ASSERT_NO_THROW(reader.setId(pyramidfile));
+  EXPECT_EQ(1U, reader.getSeriesCount());
+  EXPECT_EQ(levels.size(), reader.getResolutionCount());
+
+  MinimalTIFFReader minimal;
+  EXPECT_FALSE(minimal.hasFlattenedResolutions());
+  ASSERT_NO_THROW(minimal.setId(pyramidfile));
+  EXPECT_EQ(1U, minimal.getSeriesCount());
+  EXPECT_EQ(levels.size(), minimal.getResolutionCount());
+}
+
+TEST_P(OMETIFFReaderTest, thumbnail)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  OMETIFFReader reader;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(reader, false));
+  ASSERT_EQ(levels.size(), reader.getResolutionCount());
+
+  // Thumbnails are reduced from the smallest sufficient resolution.
+  const dimension_size_type thumbX = reader.getThumbSizeX();
+  const dimension_size_type thumbY = reader.getThumbSizeY();
+  dimension_size_type level = 0;
+  for (dimension_size_type r = 1; r < levels.size(); ++r)
+    if (levels[r].shape()[ome::files::DIM_SPATIAL_X] >= thumbX &&
+        levels[r].shape()[ome::files::DIM_SPATIAL_Y] >= thumbY)
+      level = r;
+
+  std::array<VariantPixelBuffer::size_type, 9> thumbshape;
+  std::copy(source.shape(), source.shape() + thumbshape.size(), thumbshape.begin());
+  thumbshape[ome::files::DIM_SPATIAL_X] = thumbX;
+  thumbshape[ome::files::DIM_SPATIAL_Y] = thumbY;
+  VariantPixelBuffer reference(thumbshape, source.pixelType(), storageOrder());
+  ome::files::AreaAverage average(levels[level].shape()[ome::files::DIM_SPATIAL_X],
+                                  levels[level].shape()[ome::files::DIM_SPATIAL_Y],
+                                  reference);
+  average.add(levels[level], 0);
+  average.finish();
+
+  VariantPixelBuffer thumb;
+  ASSERT_NO_THROW(reader.openThumbBytes(0, thumb));
+  EXPECT_TRUE(reference == thumb);
+  EXPECT_EQ(0U, reader.getResolution());
+
+  // Thumbnails are reduced from the same level with flattened
+  // resolutions.
+  OMETIFFReader flat;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(flat, true));
+  ASSERT_EQ(thumbX, flat.getThumbSizeX());
+  ASSERT_EQ(thumbY, flat.getThumbSizeY());
+  VariantPixelBuffer flatthumb;
+  ASSERT_NO_THROW(flat.openThumbBytes(0, flatthumb));
+  EXPECT_TRUE(reference == flatthumb);
+  EXPECT_EQ(0U, flat.getSeries());
+}
+
+TEST_P(OMETIFFReaderTest, openRegionAtScale)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  // Scaled reads at the size of a resolution level read that level.
+  OMETIFFReader reader;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(reader, false));
+  ASSERT_EQ(levels.size(), reader.getResolutionCount());
+
+  for (dimension_size_type r = 0; r < levels.size(); ++r)
+    {
+      VariantPixelBuffer scaled;
+      ASSERT_NO_THROW(reader.openRegionAtScale(0, scaled, 0, 0, reader.getSizeX(), reader.getSizeY(),
+                                               levels[r].shape()[ome::files::DIM_SPATIAL_X],
+                                               levels[r].shape()[ome::files::DIM_SPATIAL_Y]));
+      EXPECT_TRUE(levels[r] == scaled);
+    }
+  EXPECT_EQ(0U, reader.getResolution());
+
+  // With flattened resolutions, where each level is a series,
+  // scaled reads also use the reduced resolutions.
+  OMETIFFReader flat;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(flat, true));
+  ASSERT_EQ(levels.size(), flat.getSeriesCount());
+  ASSERT_EQ(1U, flat.getResolutionCount());
+
+  for (dimension_size_type r = 0; r < levels.size(); ++r)
+    {
+      VariantPixelBuffer scaled;
+      ASSERT_NO_THROW(flat.openRegionAtScale(0, scaled, 0, 0, flat.getSizeX(), flat.getSizeY(),
+                                             levels[r].shape()[ome::files::DIM_SPATIAL_X],
+                                             levels[r].shape()[ome::files::DIM_SPATIAL_Y]));
+      EXPECT_TRUE(levels[r] == scaled);
+    }
+  EXPECT_EQ(0U, flat.getSeries());
+  EXPECT_EQ(0U, flat.getCoreIndex());
+
+  // A reduced resolution series only reads from itself and the
+  // smaller levels.
+  flat.setSeries(1);
+  VariantPixelBuffer scaled;
+  ASSERT_NO_THROW(flat.openRegionAtScale(0, scaled, 0, 0, flat.getSizeX(), flat.getSizeY(),
+                                         levels[2].shape()[ome::files::DIM_SPATIAL_X],
+                                         levels[2].shape()[ome::files::DIM_SPATIAL_Y]));
+  EXPECT_TRUE(levels[2] == scaled);
+  EXPECT_EQ(1U, flat.getSeries());
+}
+
+TEST_P(OMETIFFReaderTest, statelessRead)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  OMETIFFReader reader;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(reader, false));
+  ASSERT_EQ(levels.size(), reader.getResolutionCount());
+
+  // Reads with an explicit resolution do not use or change the
+  // current resolution.
+  reader.setResolution(1);
+  checkConcurrentReads(reader);
+  EXPECT_EQ(1U, reader.getResolution());
+
+  VariantPixelBuffer region;
+  ASSERT_NO_THROW(reader.openBytes(0, 0, 0, PlaneRegion(1, 2, 3, 4), region));
+  EXPECT_EQ(3U, region.shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(4U, region.shape()[ome::files::DIM_SPATIAL_Y]);
+
+  VariantPixelBuffer vb;
+  EXPECT_THROW(reader.openBytes(0, levels.size(), 0, PlaneRegion(), vb), std::logic_error);
+  EXPECT_THROW(reader.openBytes(0, 0, 1, PlaneRegion(), vb), std::logic_error);
+}
+
+TEST_P(OMETIFFReaderTest, clone)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  OMETIFFReader reader;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(reader, false));
+
+  // Clones share the parsed metadata but not the current state.
+  reader.setResolution(2);
+  std::shared_ptr<FormatReader> copy;
+  ASSERT_NO_THROW(copy = reader.clone());
+  ASSERT_TRUE(static_cast<bool>(copy));
+  EXPECT_EQ(0U, copy->getResolution());
+  EXPECT_EQ(reader.getSeriesCount(), copy->getSeriesCount());
+  EXPECT_EQ(reader.getResolutionCount(), copy->getResolutionCount());
+  EXPECT_EQ(reader.getMetadataStore(), copy->getMetadataStore());
+  EXPECT_EQ(2U, reader.getResolution());
+  reader.setResolution(0);
+
+  for (dimension_size_type r = 0; r < copy->getResolutionCount(); ++r)
+    {
+      copy->setResolution(r);
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(copy->openBytes(0, vb));
+      EXPECT_TRUE(levels[r] == vb);
+    }
+  EXPECT_EQ(0U, reader.getResolution());
+
+  // Clones keep the reader options.
+  OMETIFFReader flat;
+  flat.setNormalized(true);
+  ASSERT_NO_FATAL_FAILURE(openPyramid(flat, true));
+  std::shared_ptr<FormatReader> flatcopy;
+  ASSERT_NO_THROW(flatcopy = flat.clone());
+  EXPECT_TRUE(flatcopy->hasFlattenedResolutions());
+  EXPECT_TRUE(flatcopy->isNormalized());
+  EXPECT_EQ(flat.getFormat(), flatcopy->getFormat());
+  EXPECT_EQ(flat.getSeriesCount(), flatcopy->getSeriesCount());
+  EXPECT_EQ(1U, flatcopy->getResolutionCount());
+}
+
+TEST_P(OMETIFFReaderTest, asyncRead)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  OMETIFFReader reader;
+  ASSERT_NO_FATAL_FAILURE(openPyramid(reader, false));
+
+  // Asynchronous reads on a pool shared by a reader and its clone.
+  std::shared_ptr<ome::files::Executor> executor(std::make_shared<ome::files::ThreadPoolExecutor>(3));
+  reader.setExecutor(executor);
+  std::shared_ptr<FormatReader> copy(reader.clone());
+  EXPECT_EQ(executor, copy->getExecutor());
+
+  std::vector<std::future<std::shared_ptr<VariantPixelBuffer>>> futures;
+  for (dimension_size_type t = 0; t < levels.size() * 4U; ++t)
+    {
+      const FormatReader& from(t % 2 ? *copy : static_cast<const FormatReader&>(reader));
+      futures.push_back(from.openBytesAsync(0, t % levels.size(), 0, PlaneRegion()));
+    }
+  for (dimension_size_type t = 0; t < futures.size(); ++t)
+    {
+      std::shared_ptr<VariantPixelBuffer> vb;
+      ASSERT_NO_THROW(vb = futures[t].get());
+      EXPECT_TRUE(levels[t % levels.size()] == *vb);
+    }
+
+  EXPECT_THROW(reader.openBytesAsync(0, levels.size(), 0, PlaneRegion()).get(), std::logic_error);
+}
+
+TEST_P(OMETIFFReaderTest, minimalSubResolutions)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  // The SubIFDs are also resolutions when read as a plain TIFF.
+  MinimalTIFFReader minimal;
+  minimal.setFlattenedResolutions(false);
+  ASSERT_NO_THROW(minimal.setId(pyramidfile));
+
+  ASSERT_EQ(1U, minimal.getSeriesCount());
+  ASSERT_EQ(levels.size(), minimal.getResolutionCount());
+
+  for (dimension_size_type r = 0; r < minimal.getResolutionCount(); ++r)
+    {
+      minimal.setResolution(r);
+
+      EXPECT_EQ(levels[r].shape()[ome::files::DIM_SPATIAL_X], minimal.getSizeX());
+      EXPECT_EQ(levels[r].shape()[ome::files::DIM_SPATIAL_Y], minimal.getSizeY());
+
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(minimal.openBytes(0, vb));
+      EXPECT_TRUE(levels[r] == vb);
+    }
+
+  checkConcurrentReads(minimal);
+}
+
+TEST_P(OMETIFFReaderTest, minimalClone)
+{
+  ASSERT_NO_FATAL_FAILURE(writePyramid());
+
+  MinimalTIFFReader minimal;
+  minimal.setFlattenedResolutions(false);
+  ASSERT_NO_THROW(minimal.setId(pyramidfile));
+
+  std::shared_ptr<FormatReader> copy;
+  ASSERT_NO_THROW(copy = minimal.clone());
+  ASSERT_TRUE(static_cast<bool>(copy));
+  EXPECT_EQ(0U, copy->getResolution());
+  EXPECT_EQ(minimal.getResolutionCount(), copy->getResolutionCount());
+
+  // The clone remains usable after the original is closed.
+  std::shared_ptr<FormatReader> orphan;
+  {
+    MinimalTIFFReader closed;
+    closed.setFlattenedResolutions(false);
+    ASSERT_NO_THROW(closed.setId(pyramidfile));
+    ASSERT_NO_THROW(orphan = closed.clone());
+    closed.close();
+  }
+
+  for (dimension_size_type r = 0; r < copy->getResolutionCount(); ++r)
+    {
+      copy->setResolution(r);
+      orphan->setResolution(r);
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(copy->openBytes(0, vb));
+      EXPECT_TRUE(levels[r] == vb);
+      ASSERT_NO_THROW(orphan->openBytes(0, vb));
+      EXPECT_TRUE(levels[r] == vb);
+    }
+}
+
+namespace
+{
+
+  // Check a typed plane read in both sample layouts matches the
+  // variant read, and does not reallocate the buffer.
+  template<int P>
+  void
+  checkTypedRead(const OMETIFFReader&      reader,
+                 dimension_size_type       plane,
+                 const PlaneRegion&        region,
+                 const VariantPixelBuffer& expected)
+  {
+    typedef ome::files::PixelBuffer<typename ome::files::PixelProperties<P>::std_type> buffer_type;
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    std::copy(expected.shape(), expected.shape() + shape.size(), shape.begin());
+
+    for (const bool interleaved : {true, false})
+      {
+        buffer_type buf(shape, P, ome::files::ENDIAN_NATIVE,
+                        ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                        interleaved));
+        const typename buffer_type::value_type *data = buf.data();
+        ASSERT_NO_THROW(reader.openTypedBytes<P>(plane, region, buf));
+        EXPECT_EQ(data, buf.data());
+        EXPECT_TRUE(buf == *ome::compat::get<std::shared_ptr<buffer_type>>(expected.vbuffer()));
+      }
+
+    shape[ome::files::DIM_SPATIAL_Y] += 1U;
+    buffer_type wrong(shape, P);
+    EXPECT_THROW(reader.openTypedBytes<P>(plane, region, wrong), std::logic_error);
+  }
+
+}
+
+TEST_P(OMETIFFReaderTest, blockRead)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+  ASSERT_EQ(sizeZ, reader.getSizeZ());
+
+  const dimension_size_type pixelBytes = ome::files::bytesPerPixel(reader.getPixelType());
+  for (const auto& region : regions)
+    {
+      VariantPixelBuffer block;
+      ASSERT_NO_THROW(reader.openBytes(DimensionRange(1, sizeZ),
+                                       DimensionRange(0, 1),
+                                       DimensionRange(0, 1),
+                                       region, block));
+
+      const dimension_size_type w = region.valid() ? region.w : sizeX;
+      const dimension_size_type h = region.valid() ? region.h : sizeY;
+      EXPECT_EQ(w, block.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(h, block.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_EQ(sizeZ - 1U, block.shape()[ome::files::DIM_SPATIAL_Z]);
+      EXPECT_EQ(1U, block.shape()[ome::files::DIM_TEMPORAL_T]);
+      EXPECT_EQ(1U, block.shape()[ome::files::DIM_CHANNEL]);
+
+      // Each plane is stored contiguously in its slot.
+      const VariantPixelBuffer::raw_type *data = block.data();
+      for (dimension_size_type z = 1; z < sizeZ; ++z)
+        {
+          VariantPixelBuffer vb;
+          ASSERT_NO_THROW(reader.openBytes(0, 0, z, region, vb));
+          ASSERT_TRUE(vb.storage_order() == block.storage_order());
+          const dimension_size_type bytes = vb.num_elements() * pixelBytes;
+          EXPECT_TRUE(std::equal(data, data + bytes, vb.data())) << "plane " << z;
+          data += bytes;
+        }
+
+      // A block of the same shape is reused.
+      const VariantPixelBuffer::raw_type *first = block.data();
+      ASSERT_NO_THROW(reader.openBytes(DimensionRange(1, sizeZ),
+                                       DimensionRange(0, 1),
+                                       DimensionRange(0, 1),
+                                       region, block));
+      EXPECT_EQ(first, block.data());
+    }
+
+  VariantPixelBuffer block;
+  EXPECT_THROW(reader.openBytes(DimensionRange(0, sizeZ + 1U),
+                                DimensionRange(0, 1),
+                                DimensionRange(0, 1),
+                                PlaneRegion(), block), std::logic_error);
+  EXPECT_THROW(reader.openBytes(DimensionRange(2, 2),
+                                DimensionRange(0, 1),
+                                DimensionRange(0, 1),
+                                PlaneRegion(), block), std::logic_error);
+}
+
+TEST_P(OMETIFFReaderTest, chunkIterator)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+
+  // Chunks cover each plane in tile order, with and without read-ahead.
+  for (const bool readAhead : {false, true})
+    {
+      ome::files::ChunkIterator chunks(reader, 2U, readAhead);
+      const std::vector<PlaneRegion>& chunkRegions(chunks.getRegions());
+      ASSERT_FALSE(chunkRegions.empty());
+
+      dimension_size_type area = 0U;
+      for (const auto& r : chunkRegions)
+        {
+          EXPECT_EQ(0U, r.x % reader.getOptimalTileWidth(0));
+          EXPECT_EQ(0U, r.y % reader.getOptimalTileHeight(0));
+          area += r.area();
+        }
+      EXPECT_EQ(sizeX * sizeY, area);
+
+      PlaneRegion region;
+      std::shared_ptr<VariantPixelBuffer> chunk;
+      dimension_size_type count = 0U;
+      while (chunks.next(region, chunk))
+        {
+          ASSERT_TRUE(static_cast<bool>(chunk));
+          EXPECT_EQ(chunkRegions.at(count).x, region.x);
+          EXPECT_EQ(chunkRegions.at(count).y, region.y);
+          VariantPixelBuffer vb;
+          ASSERT_NO_THROW(reader.openBytes(0, 0, 2U, region, vb));
+          EXPECT_TRUE(vb == *chunk);
+          ++count;
+        }
+      EXPECT_EQ(chunkRegions.size(), count);
+      EXPECT_FALSE(chunks.next(region, chunk));
+    }
+
+  // Chunks of a block of planes.
+  ome::files::ChunkIterator chunks(reader,
+                                   DimensionRange(0, sizeZ),
+                                   DimensionRange(0, 1),
+                                   DimensionRange(0, 1),
+                                   true);
+  PlaneRegion region;
+  std::shared_ptr<VariantPixelBuffer> chunk;
+  dimension_size_type count = 0U;
+  while (chunks.next(region, chunk))
+    {
+      EXPECT_EQ(sizeZ, chunk->shape()[ome::files::DIM_SPATIAL_Z]);
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, 0, DimensionRange(0, sizeZ),
+                                       DimensionRange(0, 1),
+                                       DimensionRange(0, 1),
+                                       region, vb));
+      EXPECT_TRUE(vb == *chunk);
+      ++count;
+    }
+  EXPECT_EQ(chunks.getRegions().size(), count);
+
+  EXPECT_THROW(ome::files::ChunkIterator(reader, sizeZ), std::logic_error);
+}
+
+TEST_P(OMETIFFReaderTest, callerMemory)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+
+  // Planes read into caller-owned memory, contiguous (decoded in
+  // place) and with padded rows (copied).
+  const dimension_size_type pixelBytes = ome::files::bytesPerPixel(reader.getPixelType());
+  const dimension_size_type samples = reader.getRGBChannelCount(0);
+  const bool interleaved = reader.isInterleaved();
+  const dimension_size_type pixelStride = interleaved ? samples * pixelBytes : pixelBytes;
+
+  for (const auto& region : regions)
+    {
+      const dimension_size_type w = region.valid() ? region.w : sizeX;
+      const dimension_size_type h = region.valid() ? region.h : sizeY;
+      const dimension_size_type rowBytes = w * pixelStride;
+
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, 0, 3U, region, vb));
+
+      for (const dimension_size_type padding : {dimension_size_type(0U), dimension_size_type(16U)})
+        {
+          const dimension_size_type rowStride = rowBytes + padding;
+          const dimension_size_type sampleStride = interleaved ? pixelBytes : rowStride * h;
+          std::vector<uint8_t> dest(interleaved ? rowStride * h : sampleStride * samples);
+
+          ASSERT_NO_THROW(reader.openBytes(3U, region, dest.data(), rowStride, sampleStride,
+                                           reader.getPixelType()));
+
+          const VariantPixelBuffer::raw_type *expected = vb.data();
+          for (dimension_size_type s = 0; s < (interleaved ? 1U : samples); ++s)
+            for (dimension_size_type y = 0; y < h; ++y)
+              {
+                const uint8_t *row = dest.data() + (s * sampleStride) + (y * rowStride);
+                EXPECT_TRUE(std::equal(row, row + rowBytes, expected))
+                  << "padding " << padding << " sample " << s << " row " << y;
+                expected += rowBytes;
+              }
+        }
+    }
+
+  std::vector<uint8_t> dest(sizeX * sizeY * samples * pixelBytes);
+  const ome::xml::model::enums::PixelType other =
+    reader.getPixelType() == ome::xml::model::enums::PixelType::UINT8 ?
+    ome::xml::model::enums::PixelType::UINT16 : ome::xml::model::enums::PixelType::UINT8;
+  EXPECT_THROW(reader.openBytes(0U, PlaneRegion(), dest.data(),
+                                sizeX * pixelStride, interleaved ? pixelBytes : sizeX * sizeY * pixelBytes,
+                                other), std::logic_error);
+  EXPECT_THROW(reader.openBytes(0U, PlaneRegion(), dest.data(),
+                                sizeX * pixelStride - 1U, pixelBytes,
+                                reader.getPixelType()), std::logic_error);
+  EXPECT_THROW(reader.openBytes(sizeZ, PlaneRegion(), dest.data(),
+                                sizeX * pixelStride, pixelBytes,
+                                reader.getPixelType()), std::logic_error);
+}
+
+TEST_P(OMETIFFReaderTest, typedRead)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+
+  for (const auto& region : regions)
+    {
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, 0, 3U, region, vb));
+
+      if (reader.getPixelType() == ome::xml::model::enums::PixelType::UINT8)
+        checkTypedRead<ome::xml::model::enums::PixelType::UINT8>(reader, 3U, region, vb);
+      else if (reader.getPixelType() == ome::xml::model::enums::PixelType::UINT16)
+        checkTypedRead<ome::xml::model::enums::PixelType::UINT16>(reader, 3U, region, vb);
+      else if (reader.getPixelType() == ome::xml::model::enums::PixelType::FLOAT)
+        checkTypedRead<ome::xml::model::enums::PixelType::FLOAT>(reader, 3U, region, vb);
+    }
+}
+
+TEST_P(OMETIFFReaderTest, normalized)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+
+  if (reader.getPixelType() != ome::xml::model::enums::PixelType::FLOAT)
+    return;
+
+  // Normalized reads rescale floating point planes to [0, 1] using
+  // the range of the whole plane, so regions and strided reads agree
+  // with the whole plane.
+  OMETIFFReader nreader;
+  nreader.setNormalized(true);
+  ASSERT_NO_THROW(nreader.setId(blockfile));
+
+  VariantPixelBuffer whole;
+  ASSERT_NO_THROW(reader.openBytes(0, 0, 3U, PlaneRegion(), whole));
+  const float *wholedata = whole.data<float>();
+  const auto range = std::minmax_element(wholedata, wholedata + whole.num_elements());
+  const double scale = 1.0 / (*range.second - *range.first);
+
+  const dimension_size_type pixelBytes = ome::files::bytesPerPixel(reader.getPixelType());
+  const dimension_size_type samples = nreader.getRGBChannelCount(0);
+  const bool interleaved = nreader.isInterleaved();
+  const dimension_size_type pixelStride = interleaved ? samples * pixelBytes : pixelBytes;
+
+  for (const auto& region : regions)
+    {
+      VariantPixelBuffer expected;
+      ASSERT_NO_THROW(reader.openBytes(0, 0, 3U, region, expected));
+      ome::files::convertPixelType(expected, expected, expected.pixelType(),
+                                   scale, -*range.first * scale, false);
+
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(nreader.openBytes(0, 0, 3U, region, vb));
+      EXPECT_TRUE(vb == expected);
+
+      // Padded rows are read in bands.
+      const dimension_size_type w = region.valid() ? region.w : sizeX;
+      const dimension_size_type h = region.valid() ? region.h : sizeY;
+      const dimension_size_type rowBytes = w * pixelStride;
+      const dimension_size_type rowStride = rowBytes + 16U;
+      const dimension_size_type sampleStride = interleaved ? pixelBytes : rowStride * h;
+      std::vector<uint8_t> dest(interleaved ? rowStride * h : sampleStride * samples);
+      ASSERT_NO_THROW(nreader.openBytes(3U, region, dest.data(), rowStride, sampleStride,
+                                        nreader.getPixelType()));
+
+      const VariantPixelBuffer::raw_type *data = expected.data();
+      for (dimension_size_type s = 0; s < (interleaved ? 1U : samples); ++s)
+        for (dimension_size_type y = 0; y < h; ++y)
+          {
+            const uint8_t *row = dest.data() + (s * sampleStride) + (y * rowStride);
+            EXPECT_TRUE(std::equal(row, row + rowBytes, data))
+              << "sample " << s << " row " << y;
+            data += rowBytes;
+          }
+    }
+}
+
+TEST_P(OMETIFFReaderTest, normalizedConcurrent)
+{
+  ASSERT_NO_FATAL_FAILURE(writeBlock());
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(blockfile));
+
+  if (reader.getPixelType() != ome::xml::model::enums::PixelType::FLOAT)
+    return;
+
+  // Each plane is rescaled using its own range.
+  std::vector<VariantPixelBuffer> expected(sizeZ);
+  for (dimension_size_type z = 0; z < sizeZ; ++z)
+    {
+      ASSERT_NO_THROW(reader.openBytes(0, 0, z, PlaneRegion(), expected[z]));
+      const float *data = expected[z].data<float>();
+      const auto range = std::minmax_element(data, data + expected[z].num_elements());
+      const double scale = 1.0 / (*range.second - *range.first);
+      ome::files::convertPixelType(expected[z], expected[z], expected[z].pixelType(),
+                                   scale, -*range.first * scale, false);
+    }
+
+  // The range of each plane is found by whichever read uses it
+  // first, while other threads read the same planes with an
+  // explicit series and as a block.
+  OMETIFFReader nreader;
+  nreader.setNormalized(true);
+  ASSERT_NO_THROW(nreader.setId(blockfile));
+
+  const dimension_size_type pixelBytes = ome::files::bytesPerPixel(nreader.getPixelType());
+  std::vector<int> matched(sizeZ * 4U, 0);
+  std::vector<std::thread> threads;
+  for (dimension_size_type t = 0; t < matched.size(); ++t)
+    threads.emplace_back([this, &nreader, &expected, &matched, pixelBytes, t]()
+                         {
+                           try
+                             {
+                               if (t % 2U)
+                                 {
+                                   VariantPixelBuffer block;
+                                   nreader.openBytes(DimensionRange(0, sizeZ),
+                                                     DimensionRange(0, 1),
+                                                     DimensionRange(0, 1),
+                                                     PlaneRegion(), block);
+                                   bool equal = true;
+                                   const VariantPixelBuffer::raw_type *data = block.data();
+                                   for (dimension_size_type z = 0; z < sizeZ; ++z)
+                                     {
+                                       const dimension_size_type bytes = expected[z].num_elements() * pixelBytes;
+                                       equal = equal && std::equal(data, data + bytes, expected[z].data());
+                                       data += bytes;
+                                     }
+                                   matched[t] = equal;
+                                 }
+                               else
+                                 {
+                                   VariantPixelBuffer vb;
+                                   nreader.openBytes(0, 0, (t / 2U) % sizeZ, PlaneRegion(), vb);
+                                   matched[t] = vb == expected[(t / 2U) % sizeZ];
+                                 }
+                             }
+                           catch (const std::exception&)
+                             {
+                             }
+                         });
+  for (auto& thread : threads)
+    thread.join();
+  for (dimension_size_type t = 0; t < matched.size(); ++t)
+    EXPECT_TRUE(matched[t]) << "thread " << t;
+}
+
+std::vector<TIFFTestParameters> params(find_tiff_tests());
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(OMETIFFReaderVariants, OMETIFFReaderTest, ::testing::ValuesIn(params));
@@ -0,0 +1,223 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef TEST_OMETIFFTEST_H
+#define TEST_OMETIFFTEST_H
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/Tags.h>
+#include <ome/files/tiff/TIFF.h>
+#include <ome/files/tiff/Util.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+#include "tiffsamples.h"
+
+/**
+ * Fixture for tests which write the TIFF samples as OME-TIFF.
+ *
+ * The first image of each sample is read as the source image, and
+ * helpers set up writers and write the source image to a file named
+ * for the test.
+ */
+class OMETIFFTest : public ::testing::TestWithParam<TIFFTestParameters>
+{
+public:
+  typedef std::function<void (ome::files::out::OMETIFFWriter&)> configure_type;
+
+  std::shared_ptr<ome::files::tiff::TIFF> tiff;
+  uint32_t iwidth;
+  uint32_t iheight;
+  ome::files::tiff::PlanarConfiguration planarconfig;
+  uint16_t samples;
+
+  boost::filesystem::path testfile;
+
+  // The first image of the sample file, in the storage order used
+  // by the writer, and its core metadata.
+  std::shared_ptr<ome::files::tiff::IFD> ifd;
+  ome::files::VariantPixelBuffer source;
+  std::vector<std::shared_ptr<ome::files::CoreMetadata>> sourceSeries;
+
+  OMETIFFTest(const std::string& prefix):
+    prefix(prefix)
+  {}
+
+  void
+  SetUp()
+  {
+    const TIFFTestParameters& params = GetParam();
+
+    boost::filesystem::path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+    testfile = dir / (prefix + boost::filesystem::path(params.file).filename().string());
+    testfile.replace_extension(".ome.tiff");
+
+    ASSERT_NO_THROW(tiff = ome::files::tiff::TIFF::open(params.file, "r"));
+    ASSERT_TRUE(static_cast<bool>(tiff));
+    ASSERT_NO_THROW(ifd = tiff->getDirectoryByIndex(0));
+    ASSERT_TRUE(static_cast<bool>(ifd));
+
+    ASSERT_NO_THROW(ifd->getField(ome::files::tiff::IMAGEWIDTH).get(iwidth));
+    ASSERT_NO_THROW(ifd->getField(ome::files::tiff::IMAGELENGTH).get(iheight));
+    ASSERT_NO_THROW(ifd->getField(ome::files::tiff::PLANARCONFIG).get(planarconfig));
+    ASSERT_NO_THROW(ifd->getField(ome::files::tiff::SAMPLESPERPIXEL).get(samples));
+
+    sourceSeries.push_back(ome::files::tiff::makeCoreMetadata(*ifd));
+
+    ome::files::VariantPixelBuffer buf;
+    ifd->readImage(buf);
+
+    // Make a second buffer to ensure correct ordering for saveBytes.
+    std::array<ome::files::VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = ifd->getImageWidth();
+    shape[ome::files::DIM_SPATIAL_Y] = ifd->getImageHeight();
+    shape[ome::files::DIM_SUBCHANNEL] = ifd->getSamplesPerPixel();
+    shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+    source.setBuffer(shape, ifd->getPixelType(), storageOrder());
+    source = buf;
+  }
+
+  void
+  TearDown()
+  {
+    // Delete file (if any)
+    // if (boost::filesystem::exists(testfile))
+    //   boost::filesystem::remove(testfile);
+  }
+
+  // Storage order used by the writer.
+  ome::files::PixelBufferBase::storage_order_type
+  storageOrder() const
+  {
+    return ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                           !GetParam().imageplanar);
+  }
+
+  // Output file for the named test.
+  boost::filesystem::path
+  outputFile(const std::string& name) const
+  {
+    boost::filesystem::path file(testfile.parent_path() /
+                                 (prefix + name + "-" + boost::filesystem::path(GetParam().file).filename().string()));
+    file.replace_extension(".ome.tiff");
+    return file;
+  }
+
+  // Set the metadata, storage order and tile size of a writer, and
+  // then any other options set by configure.
+  void
+  setupWriter(ome::files::out::OMETIFFWriter&                               writer,
+              const std::vector<std::shared_ptr<ome::files::CoreMetadata>>& series,
+              const configure_type&                                         configure = configure_type())
+  {
+    const TIFFTestParameters& params = GetParam();
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, series);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    writer.setMetadataRetrieve(retrieve);
+    writer.setInterleaved(!params.imageplanar);
+    writer.setTileSizeX(params.tilewidth);
+    writer.setTileSizeY(params.tilelength);
+    if (configure)
+      configure(writer);
+  }
+
+  // Write the first image of the sample file, as a whole plane, or
+  // in bands of the specified height if nonzero.
+  void
+  writeFile(const boost::filesystem::path&  file,
+            const configure_type&           configure = configure_type(),
+            ome::files::dimension_size_type band = 0U)
+  {
+    ome::files::out::OMETIFFWriter writer;
+    setupWriter(writer, sourceSeries, configure);
+    ASSERT_NO_THROW(writer.setId(file));
+
+    if (band)
+      {
+        const ome::files::dimension_size_type width = ifd->getImageWidth();
+        const ome::files::dimension_size_type height = ifd->getImageHeight();
+        for (ome::files::dimension_size_type y = 0; y < height; y += band)
+          {
+            const ome::files::dimension_size_type h = std::min(band, height - y);
+
+            ome::files::VariantPixelBuffer bandbuf;
+            ifd->readImage(bandbuf, 0, y, width, h);
+
+            ASSERT_NO_THROW(writer.saveBytes(0, bandbuf, 0, y, width, h));
+          }
+      }
+    else
+      {
+        ASSERT_NO_THROW(writer.saveBytes(0, source));
+      }
+    writer.close();
+  }
+
+private:
+  // Prefix for output file names.
+  std::string prefix;
+};
+
+#endif // TEST_OMETIFFTEST_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
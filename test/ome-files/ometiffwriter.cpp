@@ -36,14 +36,23 @@
  * #L%
  */
 
+#include <algorithm>
+#include <functional>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include <ome/files/CoreMetadata.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/FormatException.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/OMETIFFReader.h>
 #include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/Tags.h>
@@ -54,6 +63,7 @@
 
 #include <ome/test/test.h>
 
+#include "ometifftest.h"
 #include "tiffsamples.h"
 
 using ome::files::dimension_size_type;
@@ -201,6 +211,257 @@ TEST_P(TIFFWriterTest, setId)
 
 }
 
+class OMETIFFWriterTest : public OMETIFFTest
+{
+public:
+  OMETIFFWriterTest():
+    OMETIFFTest("ometiffwriter-")
+  {}
+};
+
+TEST_P(OMETIFFWriterTest, predictor)
+{
+  // Codec, predictor and compression level (zero for the default).
+  const std::vector<std::tuple<std::string, std::string, int>> settings
+    {
+      std::make_tuple("Deflate", "Horizontal", 9),
+      std::make_tuple("Deflate", "None", 1),
+      std::make_tuple("LZW", "Horizontal", 0)
+    };
+  for (const auto& setting : settings)
+    {
+      const std::string& codec(std::get<0>(setting));
+      const std::string& predictor(std::get<1>(setting));
+      const int level(std::get<2>(setting));
+
+      const path predictorfile(outputFile(codec + "-" + predictor));
+      ASSERT_NO_FATAL_FAILURE(writeFile(predictorfile,
+                                        [&](OMETIFFWriter& writer)
+                                        {
+                                          writer.setCompression(codec);
+                                          writer.setPredictor(predictor);
+                                          if (level)
+                                            writer.setCompressionLevel(level);
+                                        }));
+
+      {
+        std::shared_ptr<TIFF> ptiff;
+        ASSERT_NO_THROW(ptiff = TIFF::open(predictorfile, "r"));
+        std::shared_ptr<IFD> pifd = ptiff->getDirectoryByIndex(0);
+        EXPECT_EQ(ome::files::tiff::getCodecScheme(codec), pifd->getCompression());
+        EXPECT_EQ(ome::files::tiff::getPredictorScheme(predictor), pifd->getPredictor());
+      }
+
+      OMETIFFReader reader;
+      ASSERT_NO_THROW(reader.setId(predictorfile));
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, vb));
+      EXPECT_TRUE(source == vb) << codec << '/' << predictor << '/' << level;
+    }
+
+  // Compression levels out of range, and predictors the codec can
+  // not use, are rejected when the IFD is set up.
+  const std::vector<std::tuple<std::string, std::string, int>> invalid
+    {
+      std::make_tuple("Deflate", "None", 10),
+      std::make_tuple("LZW", "None", 5),
+      std::make_tuple("Deflate", "FloatingPoint", 0)
+    };
+  for (const auto& setting : invalid)
+    {
+      OMETIFFWriter writer;
+      setupWriter(writer, sourceSeries,
+                  [&](OMETIFFWriter& w)
+                  {
+                    w.setCompression(std::get<0>(setting));
+                    w.setPredictor(std::get<1>(setting));
+                    if (std::get<2>(setting))
+                      w.setCompressionLevel(std::get<2>(setting));
+                  });
+      EXPECT_THROW(writer.setId(outputFile("invalid")), ome::files::FormatException);
+    }
+}
+
+TEST_P(OMETIFFWriterTest, codecs)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  const std::set<std::string> available(OMETIFFWriter().getCompressionTypes(ifd->getPixelType()));
+
+  const std::vector<std::string> codecs{"ZSTD", "LERC", "WEBP"};
+  for (const auto& codec : codecs)
+    {
+      // Skip codecs not provided by libtiff.
+      if (available.find(codec) == available.end())
+        continue;
+
+      const path codecfile(outputFile(codec));
+      const configure_type configure
+        ([&codec](OMETIFFWriter& writer) { writer.setCompression(codec); });
+
+      // WebP requires interleaved samples.
+      if (codec == "WEBP" && params.imageplanar)
+        {
+          OMETIFFWriter writer;
+          setupWriter(writer, sourceSeries, configure);
+          EXPECT_THROW(writer.setId(codecfile), ome::files::FormatException);
+          continue;
+        }
+
+      ASSERT_NO_FATAL_FAILURE(writeFile(codecfile, configure));
+
+      {
+        std::shared_ptr<TIFF> ctiff;
+        ASSERT_NO_THROW(ctiff = TIFF::open(codecfile, "r"));
+        std::shared_ptr<IFD> cifd = ctiff->getDirectoryByIndex(0);
+        EXPECT_EQ(ome::files::tiff::getCodecScheme(codec), cifd->getCompression());
+      }
+
+      OMETIFFReader reader;
+      std::shared_ptr<ome::xml::meta::MetadataStore> store(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+      ASSERT_NO_THROW(reader.setMetadataStore(store));
+      ASSERT_NO_THROW(reader.setId(codecfile));
+
+      EXPECT_EQ(source.shape()[ome::files::DIM_SPATIAL_X], reader.getSizeX());
+      EXPECT_EQ(source.shape()[ome::files::DIM_SPATIAL_Y], reader.getSizeY());
+
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, vb));
+
+      // WebP is lossy by default.
+      if (codec != "WEBP")
+        EXPECT_TRUE(source == vb);
+    }
+}
+
+TEST_P(OMETIFFWriterTest, pyramid)
+{
+  // Write in bands to exercise incremental downsampling.
+  const path pyramidfile(outputFile("pyramid"));
+  ASSERT_NO_FATAL_FAILURE(writeFile(pyramidfile,
+                                    [](OMETIFFWriter& writer)
+                                    {
+                                      writer.setCompression("Deflate");
+                                      writer.setPyramidLevels(2);
+                                      EXPECT_EQ(2U, writer.getPyramidLevels());
+                                    },
+                                    7U));
+
+  // Reduced resolutions are stored in SubIFDs.
+  {
+    std::shared_ptr<TIFF> ptiff;
+    ASSERT_NO_THROW(ptiff = TIFF::open(pyramidfile, "r"));
+    std::shared_ptr<IFD> pifd = ptiff->getDirectoryByIndex(0);
+    std::vector<uint64_t> subifds;
+    ASSERT_NO_THROW(pifd->getField(ome::files::tiff::SUBIFD).get(subifds));
+    EXPECT_EQ(2U, subifds.size());
+  }
+
+  OMETIFFReader reader;
+  std::shared_ptr<ome::xml::meta::MetadataStore> store(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+  ASSERT_NO_THROW(reader.setMetadataStore(store));
+  reader.setFlattenedResolutions(false);
+  ASSERT_NO_THROW(reader.setId(pyramidfile));
+
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  ASSERT_EQ(3U, reader.getResolutionCount());
+
+  // Each level is the mean of the level above.
+  std::vector<VariantPixelBuffer> expected;
+  expected.reserve(reader.getResolutionCount());
+  expected.push_back(source);
+  for (dimension_size_type r = 1; r < reader.getResolutionCount(); ++r)
+    {
+      expected.emplace_back();
+      ome::files::downsample(expected[r - 1], expected[r]);
+    }
+
+  for (dimension_size_type r = 0; r < reader.getResolutionCount(); ++r)
+    {
+      reader.setResolution(r);
+
+      EXPECT_EQ(expected[r].shape()[ome::files::DIM_SPATIAL_X], reader.getSizeX());
+      EXPECT_EQ(expected[r].shape()[ome::files::DIM_SPATIAL_Y], reader.getSizeY());
+
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(reader.openBytes(0, vb));
+      EXPECT_TRUE(expected[r] == vb);
+    }
+}
+
+TEST_P(OMETIFFWriterTest, statistics)
+{
+  // Histograms are not supported for all pixel types.
+  const dimension_size_type bins =
+    ome::files::PixelStatistics::isSupported(ifd->getPixelType(), 16U) ? 16U : 0U;
+  ome::files::PixelStatistics expected(ifd->getPixelType(), ifd->getSamplesPerPixel(), bins);
+  expected.add(source);
+
+  // Write in bands; the statistics cover the whole plane.
+  const path statsfile(outputFile("statistics"));
+  ASSERT_NO_FATAL_FAILURE(writeFile(statsfile,
+                                    [bins](OMETIFFWriter& writer)
+                                    {
+                                      writer.setStatistics(true);
+                                      writer.setHistogramBins(bins);
+                                      EXPECT_TRUE(writer.getStatistics());
+                                      EXPECT_EQ(bins, writer.getHistogramBins());
+                                    },
+                                    7U));
+
+  {
+    std::shared_ptr<TIFF> stiff;
+    ASSERT_NO_THROW(stiff = TIFF::open(statsfile, "r"));
+    std::shared_ptr<IFD> sifd = stiff->getDirectoryByIndex(0);
+    std::vector<double> minimum;
+    std::vector<double> maximum;
+    ASSERT_NO_THROW(sifd->getField(ome::files::tiff::SMINSAMPLEVALUE).get(minimum));
+    ASSERT_NO_THROW(sifd->getField(ome::files::tiff::SMAXSAMPLEVALUE).get(maximum));
+    ASSERT_EQ(expected.getSamples(), minimum.size());
+    ASSERT_EQ(expected.getSamples(), maximum.size());
+    for (dimension_size_type s = 0; s < expected.getSamples(); ++s)
+      {
+        EXPECT_EQ(expected.getMinimum(s), minimum[s]);
+        EXPECT_EQ(expected.getMaximum(s), maximum[s]);
+      }
+
+    // The recorded range spans all samples, and is used for
+    // normalization.
+    std::pair<double, double> range;
+    ASSERT_TRUE(ome::files::tiff::getSampleValueRange(*sifd, range));
+    EXPECT_EQ(*std::min_element(minimum.begin(), minimum.end()), range.first);
+    EXPECT_EQ(*std::max_element(maximum.begin(), maximum.end()), range.second);
+  }
+
+  OMETIFFReader reader;
+  std::shared_ptr<ome::xml::meta::OMEXMLMetadata> store(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+  ASSERT_NO_THROW(reader.setMetadataStore(store));
+  ASSERT_NO_THROW(reader.setId(statsfile));
+
+  ASSERT_EQ(1U, store->getMapAnnotationCount());
+  EXPECT_EQ(std::string("openmicroscopy.org/ome-files/pixel-statistics"), store->getMapAnnotationNamespace(0));
+  ASSERT_EQ(1U, store->getImageAnnotationRefCount(0));
+  EXPECT_EQ(store->getMapAnnotationID(0), store->getImageAnnotationRef(0, 0));
+
+  const ome::xml::model::primitives::OrderedMultimap values(store->getMapAnnotationValue(0));
+  EXPECT_EQ(expected.getSamples() * (bins ? 3U : 2U), values.size());
+  for (const auto& value : values)
+    {
+      if (value.first == "0:0:histogram")
+        {
+          const std::vector<uint64_t>& bins(expected.getHistogram(0U));
+          std::string histogram;
+          for (const auto& b : bins)
+            {
+              if (!histogram.empty())
+                histogram += ',';
+              histogram += std::to_string(b);
+            }
+          EXPECT_EQ(histogram, value.second);
+        }
+    }
+}
+
 std::vector<TIFFTestParameters> params(find_tiff_tests());
 
 // Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
@@ -213,3 +474,4 @@ std::vector<TIFFTestParameters> params(find_tiff_tests());
 #endif
 
 INSTANTIATE_TEST_CASE_P(TIFFWriterVariants, TIFFWriterTest, ::testing::ValuesIn(params));
+INSTANTIATE_TEST_CASE_P(OMETIFFWriterVariants, OMETIFFWriterTest, ::testing::ValuesIn(params));
@@ -0,0 +1,435 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+// Pixel kernel benchmark.
+//
+// Random planes are converted between planar and interleaved storage
+// order, converted to other pixel types, and scanned for pixel
+// statistics.  For comparison, each operation is also timed using
+// element access, which is the generic path the specialised kernels
+// replace, and storage order conversion is also timed using
+// multi_array assignment.  Results are written to stdout as CSV, in megapixels per
+// second.  Downsampling is measured separately by
+// downsample-benchmark.
+//
+// Usage: pixel-benchmark [size [repeats]]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/StorageOrder.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::PixelStatistics;
+using ome::files::VariantPixelBuffer;
+using ome::xml::model::enums::DimensionOrder;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  typedef std::chrono::steady_clock clock_type;
+
+  template<typename T>
+  T
+  random_value(std::mt19937& gen)
+  {
+    return static_cast<T>(gen() % 251U);
+  }
+
+  template<>
+  std::complex<float>
+  random_value<std::complex<float>>(std::mt19937& gen)
+  {
+    return std::complex<float>(static_cast<float>(gen() % 251U),
+                               static_cast<float>(gen() % 251U));
+  }
+
+  template<>
+  std::complex<double>
+  random_value<std::complex<double>>(std::mt19937& gen)
+  {
+    return std::complex<double>(static_cast<double>(gen() % 251U),
+                                static_cast<double>(gen() % 251U));
+  }
+
+  template<>
+  bool
+  random_value<bool>(std::mt19937& gen)
+  {
+    return (gen() % 2U) != 0U;
+  }
+
+  // Fill a pixel buffer with random values.
+  struct FillVisitor
+  {
+    template<typename T>
+    void
+    operator()(std::shared_ptr<T>& buffer)
+    {
+      typedef typename T::value_type value_type;
+
+      std::mt19937 gen(42);
+      value_type *data = buffer->data();
+      for (dimension_size_type i = 0; i < buffer->num_elements(); ++i)
+        data[i] = random_value<value_type>(gen);
+    }
+  };
+
+  // Call func(idx) for each pixel of a plane, in logical order.
+  template<typename F>
+  void
+  for_each_index(const VariantPixelBuffer::size_type *shape,
+                 F                                    func)
+  {
+    PixelBufferBase::indices_type idx;
+    std::fill(idx.begin(), idx.end(), 0);
+
+    for (dimension_size_type s = 0; s < shape[ome::files::DIM_SUBCHANNEL]; ++s)
+      for (dimension_size_type y = 0; y < shape[ome::files::DIM_SPATIAL_Y]; ++y)
+        for (dimension_size_type x = 0; x < shape[ome::files::DIM_SPATIAL_X]; ++x)
+          {
+            idx[ome::files::DIM_SUBCHANNEL] = s;
+            idx[ome::files::DIM_SPATIAL_Y] = y;
+            idx[ome::files::DIM_SPATIAL_X] = x;
+            func(idx);
+          }
+  }
+
+  // Naive storage order conversion using element access.
+  struct NaiveStorageOrderVisitor
+  {
+    VariantPixelBuffer& dest;
+
+    NaiveStorageOrderVisitor(VariantPixelBuffer& dest):
+      dest(dest)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source)
+    {
+      std::shared_ptr<T>& d = ome::compat::get<std::shared_ptr<T>>(dest.vbuffer());
+      for_each_index(source->shape(), [&](const PixelBufferBase::indices_type& idx)
+                     {
+                       d->at(idx) = source->at(idx);
+                     });
+    }
+  };
+
+  // Storage order conversion by multi_array assignment.
+  struct AssignStorageOrderVisitor
+  {
+    VariantPixelBuffer& dest;
+
+    AssignStorageOrderVisitor(VariantPixelBuffer& dest):
+      dest(dest)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source)
+    {
+      std::shared_ptr<T>& d = ome::compat::get<std::shared_ptr<T>>(dest.vbuffer());
+      d->array() = source->array();
+    }
+  };
+
+  // Naive conversion to float using element access.
+  struct NaivePixelTypeVisitor
+  {
+    PixelBuffer<float>& dest;
+    double scale;
+    double offset;
+
+    NaivePixelTypeVisitor(PixelBuffer<float>& dest,
+                          double              scale,
+                          double              offset):
+      dest(dest),
+      scale(scale),
+      offset(offset)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source)
+    {
+      for_each_index(source->shape(), [&](const PixelBufferBase::indices_type& idx)
+                     {
+                       double v = (static_cast<double>(source->at(idx)) * scale) + offset;
+                       v = std::min(v, static_cast<double>(std::numeric_limits<float>::max()));
+                       v = std::max(v, static_cast<double>(std::numeric_limits<float>::lowest()));
+                       dest.at(idx) = static_cast<float>(v);
+                     });
+    }
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<std::complex<T>>>&)
+    {
+    }
+  };
+
+  // Naive minimum and maximum using element access.
+  struct NaiveStatisticsVisitor
+  {
+    std::vector<double> minimum;
+    std::vector<double> maximum;
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<T>& source)
+    {
+      const dimension_size_type samples = source->shape()[ome::files::DIM_SUBCHANNEL];
+      minimum.assign(samples, std::numeric_limits<double>::max());
+      maximum.assign(samples, std::numeric_limits<double>::lowest());
+      for_each_index(source->shape(), [&](const PixelBufferBase::indices_type& idx)
+                     {
+                       const dimension_size_type s = idx[ome::files::DIM_SUBCHANNEL];
+                       const double v = static_cast<double>(source->at(idx));
+                       minimum[s] = std::min(minimum[s], v);
+                       maximum[s] = std::max(maximum[s], v);
+                     });
+    }
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<std::complex<T>>>&)
+    {
+    }
+  };
+
+  bool
+  is_complex(PixelType pixeltype)
+  {
+    return pixeltype == PixelType::COMPLEXFLOAT ||
+      pixeltype == PixelType::COMPLEXDOUBLE;
+  }
+
+  template<typename F>
+  double
+  time(unsigned int repeats,
+       F            func)
+  {
+    clock_type::time_point start = clock_type::now();
+    for (unsigned int r = 0; r < repeats; ++r)
+      func();
+    clock_type::time_point end = clock_type::now();
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  void
+  report(const char        *operation,
+         PixelType          pixeltype,
+         dimension_size_type samples,
+         const char        *source,
+         const char        *dest,
+         const char        *method,
+         double             mpixels,
+         unsigned int       repeats,
+         double             elapsed)
+  {
+    std::cout << operation << ','
+              << pixeltype << ','
+              << samples << ','
+              << source << ','
+              << dest << ','
+              << method << ','
+              << (elapsed > 0.0 ? mpixels * repeats / elapsed : 0.0) << '\n' << std::flush;
+  }
+
+}
+
+int
+main(int argc, char *argv[])
+{
+  dimension_size_type size = 2048U;
+  unsigned int repeats = 5U;
+
+  if (argc > 1)
+    size = static_cast<dimension_size_type>(std::strtoul(argv[1], nullptr, 10));
+  if (argc > 2)
+    repeats = static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10));
+  if (size == 0U || repeats == 0)
+    {
+      std::cerr << "Usage: " << argv[0] << " [size [repeats]]\n";
+      return 1;
+    }
+
+  const std::vector<PixelType> desttypes
+    {
+      PixelType::UINT8,
+      PixelType::UINT16,
+      PixelType::FLOAT
+    };
+
+  std::cout << "operation,pixeltype,samples,source,dest,method,mpixels_per_second\n";
+
+  for (const auto& pt : PixelType::values())
+    {
+      const PixelType pixeltype(pt.first);
+
+      for (const dimension_size_type samples : {1U, 3U})
+        {
+          std::array<VariantPixelBuffer::size_type, 9> shape;
+          shape[ome::files::DIM_SPATIAL_X] = size;
+          shape[ome::files::DIM_SPATIAL_Y] = size;
+          shape[ome::files::DIM_SUBCHANNEL] = samples;
+          shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+            shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+          const double mpixels = static_cast<double>(size * size) / 1.0e6;
+
+          for (const bool interleaved : {false, true})
+            {
+              if (samples == 1U && interleaved)
+                continue;
+
+              const char *storage = interleaved ? "interleaved" : "planar";
+              const char *other = interleaved ? "planar" : "interleaved";
+
+              VariantPixelBuffer pixels(shape, pixeltype,
+                                        PixelBufferBase::make_storage_order(DimensionOrder::XYZTC, interleaved));
+              FillVisitor fill;
+              ome::compat::visit(fill, pixels.vbuffer());
+
+              // Storage order conversion.
+              if (samples > 1U)
+                {
+                  VariantPixelBuffer dest(shape, pixeltype,
+                                          PixelBufferBase::make_storage_order(DimensionOrder::XYZTC, !interleaved));
+
+                  double elapsed = time(repeats, [&]()
+                                        {
+                                          ome::files::convertStorageOrder(pixels, dest);
+                                        });
+                  report("storage-order", pixeltype, samples, storage, other, "kernel",
+                         mpixels, repeats, elapsed);
+
+                  elapsed = time(repeats, [&]()
+                                 {
+                                   NaiveStorageOrderVisitor naive(dest);
+                                   ome::compat::visit(naive, pixels.vbuffer());
+                                 });
+                  report("storage-order", pixeltype, samples, storage, other, "naive",
+                         mpixels, repeats, elapsed);
+
+                  elapsed = time(repeats, [&]()
+                                 {
+                                   AssignStorageOrderVisitor assign(dest);
+                                   ome::compat::visit(assign, pixels.vbuffer());
+                                 });
+                  report("storage-order", pixeltype, samples, storage, other, "assign",
+                         mpixels, repeats, elapsed);
+                }
+
+              // Pixel type conversion.
+              for (const auto desttype : desttypes)
+                {
+                  if (!ome::files::isPixelConversionSupported(pixeltype, desttype))
+                    continue;
+
+                  std::ostringstream destname;
+                  destname << desttype;
+
+                  VariantPixelBuffer dest;
+                  double elapsed = time(repeats, [&]()
+                                        {
+                                          ome::files::convertPixelType(pixels, dest, desttype, 0.5, 1.0);
+                                        });
+                  report("pixel-type", pixeltype, samples, storage, destname.str().c_str(), "kernel",
+                         mpixels, repeats, elapsed);
+
+                  if (desttype == PixelType::FLOAT && !is_complex(pixeltype))
+                    {
+                      PixelBuffer<float> naivedest(shape, PixelType::FLOAT, ome::files::ENDIAN_NATIVE,
+                                                   PixelBufferBase::make_storage_order(DimensionOrder::XYZTC, interleaved));
+                      elapsed = time(repeats, [&]()
+                                     {
+                                       NaivePixelTypeVisitor naive(naivedest, 0.5, 1.0);
+                                       ome::compat::visit(naive, pixels.vbuffer());
+                                     });
+                      report("pixel-type", pixeltype, samples, storage, destname.str().c_str(), "naive",
+                             mpixels, repeats, elapsed);
+                    }
+                }
+
+              // Pixel statistics.
+              if (PixelStatistics::isSupported(pixeltype))
+                {
+                  double elapsed = time(repeats, [&]()
+                                        {
+                                          PixelStatistics stats(pixeltype, samples);
+                                          stats.add(pixels);
+                                        });
+                  report("statistics", pixeltype, samples, storage, "", "kernel",
+                         mpixels, repeats, elapsed);
+
+                  elapsed = time(repeats, [&]()
+                                 {
+                                   NaiveStatisticsVisitor naive;
+                                   ome::compat::visit(naive, pixels.vbuffer());
+                                 });
+                  report("statistics", pixeltype, samples, storage, "", "naive",
+                         mpixels, repeats, elapsed);
+                }
+            }
+        }
+    }
+
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
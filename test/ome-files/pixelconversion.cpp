@@ -0,0 +1,347 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+#include "pixel.h"
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+
+class PixelConversionTestParameters
+{
+public:
+  PT     source;
+  PT     dest;
+  double scale;
+  double offset;
+
+  PixelConversionTestParameters(PT     source,
+                                PT     dest,
+                                double scale,
+                                double offset):
+    source(source),
+    dest(dest),
+    scale(scale),
+    offset(offset)
+  {}
+};
+
+template<class charT, class traits>
+inline std::basic_ostream<charT,traits>&
+operator<< (std::basic_ostream<charT,traits>& os,
+            const PixelConversionTestParameters& params)
+{
+  return os << PT(params.source) << '/' << PT(params.dest) << '/'
+            << params.scale << '/' << params.offset;
+}
+
+namespace
+{
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape()
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = 11U;
+    shape[ome::files::DIM_SPATIAL_Y] = 5U;
+    shape[ome::files::DIM_SUBCHANNEL] = 3U;
+    shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+    return shape;
+  }
+
+  struct FillVisitor
+  {
+    template<typename T>
+    void
+    operator()(std::shared_ptr<PixelBuffer<T>>& buf)
+    {
+      T *data = buf->data();
+      for (dimension_size_type i = 0; i < buf->num_elements(); ++i)
+        data[i] = pixel_value<T>(static_cast<uint32_t>((i * 37U) % 256U));
+    }
+  };
+
+  template<typename T>
+  double
+  realPart(const T& value)
+  {
+    return static_cast<double>(value);
+  }
+
+  template<typename T>
+  double
+  realPart(const std::complex<T>& value)
+  {
+    return static_cast<double>(value.real());
+  }
+
+  template<typename T>
+  double
+  imagPart(const T& /* value */)
+  {
+    return 0.0;
+  }
+
+  template<typename T>
+  double
+  imagPart(const std::complex<T>& value)
+  {
+    return static_cast<double>(value.imag());
+  }
+
+  // Reference conversion of a single value.
+  template<typename D, class Enable = void>
+  struct Expected
+  {
+    static D
+    value(double re,
+          double /* im */,
+          double scale,
+          double offset)
+    {
+      double v = (re * scale) + offset;
+      if (std::is_integral<D>::value)
+        {
+          v = std::min(std::max(v, static_cast<double>(std::numeric_limits<D>::min())),
+                       static_cast<double>(std::numeric_limits<D>::max()));
+          v = std::round(v);
+        }
+      return static_cast<D>(v);
+    }
+  };
+
+  template<>
+  struct Expected<bool>
+  {
+    static bool
+    value(double re,
+          double /* im */,
+          double scale,
+          double offset)
+    {
+      return std::round(std::min(std::max((re * scale) + offset, 0.0), 1.0)) != 0.0;
+    }
+  };
+
+  template<typename U>
+  struct Expected<std::complex<U>>
+  {
+    static std::complex<U>
+    value(double re,
+          double im,
+          double scale,
+          double offset)
+    {
+      return std::complex<U>(static_cast<U>((re * scale) + offset), static_cast<U>(im * scale));
+    }
+  };
+
+  template<typename S>
+  struct CompareDestVisitor
+  {
+    const PixelBuffer<S>& source;
+    double                scale;
+    double                offset;
+
+    CompareDestVisitor(const PixelBuffer<S>& source,
+                       double                scale,
+                       double                offset):
+      source(source),
+      scale(scale),
+      offset(offset)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<T>>& dest) const
+    {
+      ASSERT_EQ(source.num_elements(), dest->num_elements());
+      const S *src = source.data();
+      const T *dst = dest->data();
+      for (dimension_size_type i = 0; i < source.num_elements(); ++i)
+        ASSERT_EQ(Expected<T>::value(realPart(src[i]), imagPart(src[i]), scale, offset), dst[i])
+          << "element " << i;
+    }
+  };
+
+  struct CompareSourceVisitor
+  {
+    const VariantPixelBuffer& dest;
+    double                    scale;
+    double                    offset;
+
+    CompareSourceVisitor(const VariantPixelBuffer& dest,
+                         double                    scale,
+                         double                    offset):
+      dest(dest),
+      scale(scale),
+      offset(offset)
+    {}
+
+    template<typename T>
+    void
+    operator()(const std::shared_ptr<PixelBuffer<T>>& source) const
+    {
+      CompareDestVisitor<T> v(*source, scale, offset);
+      ome::compat::visit(v, dest.vbuffer());
+    }
+  };
+
+  bool
+  complexType(PT type)
+  {
+    return type == PT::COMPLEXFLOAT || type == PT::COMPLEXDOUBLE;
+  }
+
+}
+
+class PixelConversionTest : public ::testing::TestWithParam<PixelConversionTestParameters>
+{
+};
+
+TEST_P(PixelConversionTest, Convert)
+{
+  const PixelConversionTestParameters& params = GetParam();
+
+  for (const bool interleaved : {true, false})
+    {
+      VariantPixelBuffer source(makeShape(), params.source,
+                                PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                    interleaved));
+      FillVisitor fill;
+      ome::compat::visit(fill, source.vbuffer());
+
+      VariantPixelBuffer dest;
+      if (complexType(params.source) && !complexType(params.dest))
+        {
+          EXPECT_FALSE(ome::files::isPixelConversionSupported(params.source, params.dest));
+          EXPECT_THROW(ome::files::convertPixelType(source, dest, params.dest, params.scale, params.offset),
+                       std::logic_error);
+          continue;
+        }
+
+      EXPECT_TRUE(ome::files::isPixelConversionSupported(params.source, params.dest));
+      ASSERT_NO_THROW(ome::files::convertPixelType(source, dest, params.dest, params.scale, params.offset));
+      EXPECT_EQ(params.dest, dest.pixelType());
+      EXPECT_TRUE(source.storage_order() == dest.storage_order());
+
+      CompareSourceVisitor v(dest, params.scale, params.offset);
+      ome::compat::visit(v, source.vbuffer());
+
+      // A destination of the correct type and shape is reused.
+      const VariantPixelBuffer::raw_type *data = dest.data();
+      ASSERT_NO_THROW(ome::files::convertPixelType(source, dest, params.dest, params.scale, params.offset));
+      EXPECT_EQ(data, dest.data());
+
+      // Conversion in place.
+      VariantPixelBuffer inplace(makeShape(), params.source, source.storage_order());
+      inplace = source;
+      ASSERT_NO_THROW(ome::files::convertPixelType(inplace, inplace, params.dest, params.scale, params.offset));
+      EXPECT_TRUE(dest == inplace);
+    }
+}
+
+TEST(PixelConversion, Unclamped)
+{
+  VariantPixelBuffer source(makeShape(), PT::UINT16);
+  FillVisitor fill;
+  ome::compat::visit(fill, source.vbuffer());
+
+  // Normalisation to [0, 1] does not need clamping.
+  VariantPixelBuffer dest;
+  ASSERT_NO_THROW(ome::files::convertPixelType(source, dest, PT::FLOAT, 1.0 / 256.0, 0.0, false));
+  CompareSourceVisitor v(dest, 1.0 / 256.0, 0.0);
+  ome::compat::visit(v, source.vbuffer());
+}
+
+namespace
+{
+
+  std::vector<PixelConversionTestParameters>
+  makeParams()
+  {
+    const std::vector<PT> types
+      {
+        PT::INT8, PT::INT16, PT::INT32,
+        PT::UINT8, PT::UINT16, PT::UINT32,
+        PT::FLOAT, PT::DOUBLE, PT::BIT,
+        PT::COMPLEXFLOAT, PT::COMPLEXDOUBLE
+      };
+    const std::vector<std::array<double, 2>> transforms
+      {
+        {{1.0, 0.0}}, {{0.5, -1.5}}, {{-1.0, 0.0}}, {{4.0, 3.0}}
+      };
+
+    std::vector<PixelConversionTestParameters> ret;
+    for (const auto& source : types)
+      for (const auto& dest : types)
+        for (const auto& transform : transforms)
+          ret.push_back(PixelConversionTestParameters(source, dest, transform[0], transform[1]));
+    return ret;
+  }
+
+}
+
+std::vector<PixelConversionTestParameters> params(makeParams());
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(PixelConversionVariants, PixelConversionTest, ::testing::ValuesIn(params));
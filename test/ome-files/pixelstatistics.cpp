@@ -0,0 +1,245 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::PixelStatistics;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  const dimension_size_type width = 11U;
+  const dimension_size_type height = 5U;
+  const dimension_size_type samples = 3U;
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape(dimension_size_type s)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = width;
+    shape[ome::files::DIM_SPATIAL_Y] = height;
+    shape[ome::files::DIM_SUBCHANNEL] = s;
+    shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+    return shape;
+  }
+
+  PixelBufferBase::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y,
+            dimension_size_type s)
+  {
+    PixelBufferBase::indices_type idx;
+    std::fill(idx.begin(), idx.end(), 0);
+    idx[ome::files::DIM_SPATIAL_X] = x;
+    idx[ome::files::DIM_SPATIAL_Y] = y;
+    idx[ome::files::DIM_SUBCHANNEL] = s;
+    return idx;
+  }
+
+  // Each subchannel s takes values 10s … 10s+9, plus an offset.
+  template<typename T>
+  void
+  fill(PixelBuffer<T>& buf,
+       int             offset)
+  {
+    const dimension_size_type s = buf.shape()[ome::files::DIM_SUBCHANNEL];
+    for (dimension_size_type c = 0; c < s; ++c)
+      for (dimension_size_type y = 0; y < height; ++y)
+        for (dimension_size_type x = 0; x < width; ++x)
+          buf.at(makeIndex(x, y, c)) =
+            static_cast<T>(static_cast<int>(c * 10U + (x + y * width) % 10U) + offset);
+  }
+
+}
+
+class PixelStatisticsTest : public ::testing::TestWithParam<bool>
+{
+};
+
+TEST_P(PixelStatisticsTest, MinMax)
+{
+  VariantPixelBuffer source(makeShape(samples), PT::UINT8,
+                            PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                GetParam()));
+  fill(*ome::compat::get<std::shared_ptr<PixelBuffer<uint8_t>>>(source.vbuffer()), 2);
+
+  PixelStatistics stats(PT::UINT8, samples);
+  EXPECT_EQ(0U, stats.getCount());
+  stats.add(source);
+  EXPECT_EQ(width * height, stats.getCount());
+
+  for (dimension_size_type s = 0; s < samples; ++s)
+    {
+      EXPECT_EQ(static_cast<double>(s * 10U + 2U), stats.getMinimum(s));
+      EXPECT_EQ(static_cast<double>(s * 10U + 11U), stats.getMaximum(s));
+      EXPECT_TRUE(stats.getHistogram(s).empty());
+    }
+
+  // A second buffer extends the range.
+  fill(*ome::compat::get<std::shared_ptr<PixelBuffer<uint8_t>>>(source.vbuffer()), 0);
+  stats.add(source);
+  EXPECT_EQ(width * height * 2U, stats.getCount());
+  for (dimension_size_type s = 0; s < samples; ++s)
+    {
+      EXPECT_EQ(static_cast<double>(s * 10U), stats.getMinimum(s));
+      EXPECT_EQ(static_cast<double>(s * 10U + 11U), stats.getMaximum(s));
+    }
+}
+
+TEST_P(PixelStatisticsTest, Histogram)
+{
+  VariantPixelBuffer source(makeShape(samples), PT::UINT8,
+                            PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                GetParam()));
+  fill(*ome::compat::get<std::shared_ptr<PixelBuffer<uint8_t>>>(source.vbuffer()), 0);
+
+  PixelStatistics full(PT::UINT8, samples, 256U);
+  PixelStatistics coarse(PT::UINT8, samples, 16U);
+  full.add(source);
+  coarse.add(source);
+
+  EXPECT_EQ(0.0, full.getHistogramMinimum());
+  EXPECT_EQ(255.0, full.getHistogramMaximum());
+
+  for (dimension_size_type s = 0; s < samples; ++s)
+    {
+      std::vector<uint64_t> expectedFull(256U, 0U);
+      std::vector<uint64_t> expectedCoarse(16U, 0U);
+      for (dimension_size_type i = 0; i < width * height; ++i)
+        {
+          const dimension_size_type v = s * 10U + i % 10U;
+          ++expectedFull[v];
+          ++expectedCoarse[v / 16U];
+        }
+      EXPECT_EQ(expectedFull, full.getHistogram(s));
+      EXPECT_EQ(expectedCoarse, coarse.getHistogram(s));
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(PixelStatisticsVariants, PixelStatisticsTest, ::testing::Values(false, true));
+
+TEST(PixelStatistics, Signed)
+{
+  VariantPixelBuffer source(makeShape(1U), PT::INT16);
+  fill(*ome::compat::get<std::shared_ptr<PixelBuffer<int16_t>>>(source.vbuffer()), -300);
+
+  PixelStatistics stats(PT::INT16, 1U, 4U);
+  stats.add(source);
+  EXPECT_EQ(-300.0, stats.getMinimum(0U));
+  EXPECT_EQ(-291.0, stats.getMaximum(0U));
+  EXPECT_EQ(-32768.0, stats.getHistogramMinimum());
+  EXPECT_EQ(32767.0, stats.getHistogramMaximum());
+
+  // All values are in the second quarter of the range.
+  const std::vector<uint64_t> expected{0U, width * height, 0U, 0U};
+  EXPECT_EQ(expected, stats.getHistogram(0U));
+}
+
+TEST(PixelStatistics, FloatNaN)
+{
+  VariantPixelBuffer source(makeShape(1U), PT::FLOAT);
+  PixelBuffer<float>& buf = *ome::compat::get<std::shared_ptr<PixelBuffer<float>>>(source.vbuffer());
+  fill(buf, -4);
+  buf.at(makeIndex(3U, 2U, 0U)) = std::numeric_limits<float>::quiet_NaN();
+
+  PixelStatistics stats(PT::FLOAT, 1U);
+  stats.add(source);
+  EXPECT_EQ(-4.0, stats.getMinimum(0U));
+  EXPECT_EQ(5.0, stats.getMaximum(0U));
+
+  // No values other than NaN.
+  std::fill(buf.data(), buf.data() + buf.num_elements(), std::numeric_limits<float>::quiet_NaN());
+  PixelStatistics empty(PT::FLOAT, 1U);
+  empty.add(source);
+  EXPECT_EQ(width * height, empty.getCount());
+  EXPECT_TRUE(std::isinf(empty.getMinimum(0U)) && empty.getMinimum(0U) > 0.0);
+  EXPECT_TRUE(std::isinf(empty.getMaximum(0U)) && empty.getMaximum(0U) < 0.0);
+}
+
+TEST(PixelStatistics, Bit)
+{
+  VariantPixelBuffer source(makeShape(1U), PT::BIT);
+  PixelBuffer<bool>& buf = *ome::compat::get<std::shared_ptr<PixelBuffer<bool>>>(source.vbuffer());
+  std::fill(buf.data(), buf.data() + buf.num_elements(), false);
+  buf.at(makeIndex(1U, 1U, 0U)) = true;
+
+  PixelStatistics stats(PT::BIT, 1U, 2U);
+  stats.add(source);
+  EXPECT_EQ(0.0, stats.getMinimum(0U));
+  EXPECT_EQ(1.0, stats.getMaximum(0U));
+  const std::vector<uint64_t> expected{width * height - 1U, 1U};
+  EXPECT_EQ(expected, stats.getHistogram(0U));
+}
+
+TEST(PixelStatistics, Supported)
+{
+  EXPECT_TRUE(PixelStatistics::isSupported(PT::UINT16));
+  EXPECT_TRUE(PixelStatistics::isSupported(PT::DOUBLE));
+  EXPECT_TRUE(PixelStatistics::isSupported(PT::UINT16, 1024U));
+  EXPECT_FALSE(PixelStatistics::isSupported(PT::COMPLEXFLOAT));
+  EXPECT_FALSE(PixelStatistics::isSupported(PT::FLOAT, 256U));
+  EXPECT_FALSE(PixelStatistics::isSupported(PT::UINT8, 100U));
+  EXPECT_FALSE(PixelStatistics::isSupported(PT::UINT8, 512U));
+
+  EXPECT_THROW(PixelStatistics(PT::COMPLEXDOUBLE, 1U), std::logic_error);
+  EXPECT_THROW(PixelStatistics(PT::UINT8, 0U), std::logic_error);
+}
+
+TEST(PixelStatistics, Mismatch)
+{
+  VariantPixelBuffer source(makeShape(samples), PT::UINT8);
+
+  PixelStatistics type(PT::UINT16, samples);
+  EXPECT_THROW(type.add(source), std::logic_error);
+  PixelStatistics count(PT::UINT8, 1U);
+  EXPECT_THROW(count.add(source), std::logic_error);
+}
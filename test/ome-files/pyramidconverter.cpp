@@ -0,0 +1,275 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/Tags.h>
+#include <ome/files/tiff/TIFF.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+#include <pyramid/PyramidConverter.h>
+#include <pyramid/options.h>
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+
+using namespace boost::filesystem;
+
+namespace
+{
+
+  const dimension_size_type sizeX = 160U;
+  const dimension_size_type sizeY = 96U;
+  const dimension_size_type planes = 2U;
+  const dimension_size_type tileSize = 32U;
+
+  // A smooth gradient, differing for each plane.
+  VariantPixelBuffer
+  makePlane(dimension_size_type plane)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = sizeX;
+    shape[ome::files::DIM_SPATIAL_Y] = sizeY;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] =
+      shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1U;
+
+    VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT8);
+    uint8_t *data = buf.data<uint8_t>();
+    for (dimension_size_type y = 0; y < sizeY; ++y)
+      for (dimension_size_type x = 0; x < sizeX; ++x)
+        data[y * sizeX + x] = static_cast<uint8_t>(x + y + plane * 40U);
+    return buf;
+  }
+
+  path
+  testPath(const std::string& name)
+  {
+    path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+    if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+      throw std::runtime_error("Image directory unavailable and could not be created");
+    return dir / name;
+  }
+
+  // Write a tiled OME-TIFF without reduced resolutions.
+  void
+  writeSource(const path&        file,
+              const std::string& compression)
+  {
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+    std::shared_ptr<CoreMetadata> core(std::make_shared<CoreMetadata>());
+    core->sizeX = sizeX;
+    core->sizeY = sizeY;
+    core->sizeZ = planes;
+    core->imageCount = planes;
+    seriesList.push_back(core);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setInterleaved(false);
+    writer.setCompression(compression);
+    writer.setTileSizeX(tileSize);
+    writer.setTileSizeY(tileSize);
+    writer.setId(file);
+    for (dimension_size_type p = 0; p < planes; ++p)
+      {
+        VariantPixelBuffer buf(makePlane(p));
+        writer.saveBytes(p, buf);
+      }
+    writer.close();
+  }
+
+  pyramid::options
+  makeOptions(const path& input,
+              const path& output)
+  {
+    pyramid::options opts;
+    opts.verbosity = pyramid::options::MSG_QUIET;
+    opts.threads = 2U;
+    opts.input = input.string();
+    opts.output = output.string();
+    return opts;
+  }
+
+  void
+  convert(const pyramid::options& opts)
+  {
+    if (exists(opts.output))
+      remove(opts.output);
+    std::ostringstream progress;
+    pyramid::PyramidConverter(opts).convert(progress);
+  }
+
+  std::vector<uint64_t>
+  tileByteCounts(const path&         file,
+                 dimension_size_type index)
+  {
+    std::shared_ptr<TIFF> tiff(TIFF::open(file, "r"));
+    std::vector<uint64_t> counts;
+    tiff->getDirectoryByIndex(index)->getField(ome::files::tiff::TILEBYTECOUNTS).get(counts);
+    return counts;
+  }
+
+  // Check the full resolution matches the source, and each reduced
+  // resolution matches the mean downsampling of the preceding
+  // resolution.
+  void
+  checkPyramid(const path&         source,
+               const path&         output,
+               dimension_size_type levels)
+  {
+    OMETIFFReader sreader;
+    sreader.setId(source);
+
+    OMETIFFReader reader;
+    reader.setFlattenedResolutions(false);
+    reader.setId(output);
+    ASSERT_EQ(1U, reader.getSeriesCount());
+    ASSERT_EQ(planes, reader.getImageCount());
+    ASSERT_EQ(levels + 1U, reader.getResolutionCount());
+
+    for (dimension_size_type p = 0; p < planes; ++p)
+      {
+        std::vector<VariantPixelBuffer> expected(reader.getResolutionCount());
+        sreader.openBytes(p, expected.front());
+        for (dimension_size_type r = 1; r < expected.size(); ++r)
+          ome::files::downsample(expected[r - 1], expected[r]);
+
+        for (dimension_size_type r = 0; r < expected.size(); ++r)
+          {
+            reader.setResolution(r);
+            VariantPixelBuffer vb;
+            ASSERT_NO_THROW(reader.openBytes(p, vb));
+            EXPECT_TRUE(expected[r] == vb) << "plane " << p << " resolution " << r;
+          }
+      }
+  }
+
+}
+
+TEST(PyramidConverter, CopySourceCompression)
+{
+  const path source(testPath("pyramidconverter-deflate.ome.tiff"));
+  const path output(testPath("pyramidconverter-deflate-pyramid.ome.tiff"));
+  writeSource(source, "Deflate");
+
+  // Levels are added until the smallest fits in a single tile.
+  ASSERT_NO_THROW(convert(makeOptions(source, output)));
+  checkPyramid(source, output, 3U);
+
+  // The source compression is kept, and the full resolution tiles
+  // are copied unchanged.
+  std::shared_ptr<TIFF> tiff(TIFF::open(output, "r"));
+  for (dimension_size_type p = 0; p < planes; ++p)
+    {
+      std::shared_ptr<IFD> ifd(tiff->getDirectoryByIndex(p));
+      EXPECT_EQ(ome::files::tiff::COMPRESSION_DEFLATE, ifd->getCompression());
+      EXPECT_EQ(ome::files::tiff::TILE, ifd->getTileType());
+      EXPECT_EQ(tileSize, ifd->getTileWidth());
+      EXPECT_EQ(tileByteCounts(source, p), tileByteCounts(output, p));
+    }
+}
+
+TEST(PyramidConverter, CopyJPEG)
+{
+  const std::vector<std::string>& codecs(ome::files::tiff::getCodecNames(ome::xml::model::enums::PixelType::UINT8));
+  if (std::find(codecs.begin(), codecs.end(), "JPEG") == codecs.end())
+    return;
+
+  const path source(testPath("pyramidconverter-jpeg.ome.tiff"));
+  const path output(testPath("pyramidconverter-jpeg-copy.ome.tiff"));
+  writeSource(source, "JPEG");
+
+  // Without reduced resolutions the planes are copied without being
+  // decoded.  Lossy tiles which were re-encoded would not read back
+  // identically.
+  pyramid::options opts(makeOptions(source, output));
+  opts.levels = 0U;
+  ASSERT_NO_THROW(convert(opts));
+  checkPyramid(source, output, 0U);
+
+  for (dimension_size_type p = 0; p < planes; ++p)
+    EXPECT_EQ(tileByteCounts(source, p), tileByteCounts(output, p));
+}
+
+TEST(PyramidConverter, Recompress)
+{
+  const path source(testPath("pyramidconverter-deflate.ome.tiff"));
+  const path output(testPath("pyramidconverter-lzw-pyramid.ome.tiff"));
+  writeSource(source, "Deflate");
+
+  // Changing the compression and tiling re-encodes the planes.
+  pyramid::options opts(makeOptions(source, output));
+  opts.compression = "LZW";
+  opts.tilesize = 16U;
+  opts.levels = 2U;
+  ASSERT_NO_THROW(convert(opts));
+  checkPyramid(source, output, 2U);
+
+  std::shared_ptr<TIFF> tiff(TIFF::open(output, "r"));
+  std::shared_ptr<IFD> ifd(tiff->getDirectoryByIndex(0));
+  EXPECT_EQ(ome::files::tiff::COMPRESSION_LZW, ifd->getCompression());
+  EXPECT_EQ(16U, ifd->getTileWidth());
+  EXPECT_EQ(16U, ifd->getTileHeight());
+}
@@ -0,0 +1,211 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/StorageOrder.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+#include "pixel.h"
+
+using ome::files::dimension_size_type;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+typedef ome::xml::model::enums::DimensionOrder DO;
+
+class StorageOrderTestParameters
+{
+public:
+  PT                  type;
+  dimension_size_type samples;
+  bool                sourceInterleaved;
+  DO                  destOrder;
+  bool                destInterleaved;
+
+  StorageOrderTestParameters(PT                  type,
+                             dimension_size_type samples,
+                             bool                sourceInterleaved,
+                             DO                  destOrder,
+                             bool                destInterleaved):
+    type(type),
+    samples(samples),
+    sourceInterleaved(sourceInterleaved),
+    destOrder(destOrder),
+    destInterleaved(destInterleaved)
+  {}
+};
+
+template<class charT, class traits>
+inline std::basic_ostream<charT,traits>&
+operator<< (std::basic_ostream<charT,traits>& os,
+            const StorageOrderTestParameters& params)
+{
+  return os << PT(params.type) << '/' << params.samples << '/'
+            << (params.sourceInterleaved ? "interleaved" : "planar") << '/'
+            << DO(params.destOrder) << '/'
+            << (params.destInterleaved ? "interleaved" : "planar");
+}
+
+namespace
+{
+
+  // Wide enough for several whole vectors of the 8- and 16-bit
+  // interleaving kernels, and a remainder.
+  const dimension_size_type width = 37U;
+  const dimension_size_type height = 7U;
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape(dimension_size_type samples)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = width;
+    shape[ome::files::DIM_SPATIAL_Y] = height;
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    shape[ome::files::DIM_SPATIAL_Z] = 2U;
+    shape[ome::files::DIM_CHANNEL] = 2U;
+    shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_MODULO_Z] =
+      shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+    return shape;
+  }
+
+  struct FillVisitor
+  {
+    template<typename T>
+    void
+    operator()(std::shared_ptr<PixelBuffer<T>>& buf)
+    {
+      T *data = buf->data();
+      for (dimension_size_type i = 0; i < buf->num_elements(); ++i)
+        data[i] = pixel_value<T>(static_cast<uint32_t>((i * 7U) % 251U));
+    }
+  };
+
+}
+
+class StorageOrderTest : public ::testing::TestWithParam<StorageOrderTestParameters>
+{
+};
+
+TEST_P(StorageOrderTest, Convert)
+{
+  const StorageOrderTestParameters& params = GetParam();
+
+  VariantPixelBuffer source(makeShape(params.samples), params.type,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, params.sourceInterleaved));
+  FillVisitor fill;
+  ome::compat::visit(fill, source.vbuffer());
+
+  // Preallocated destination.
+  VariantPixelBuffer dest(makeShape(params.samples), params.type,
+                          PixelBufferBase::make_storage_order(params.destOrder, params.destInterleaved));
+  ASSERT_NO_THROW(ome::files::convertStorageOrder(source, dest));
+  EXPECT_TRUE(source == dest);
+
+  // Resized destination.
+  VariantPixelBuffer resized;
+  ASSERT_NO_THROW(ome::files::convertStorageOrder(source, resized, params.destOrder, params.destInterleaved));
+  EXPECT_TRUE(PixelBufferBase::make_storage_order(params.destOrder, params.destInterleaved) ==
+              resized.storage_order());
+  EXPECT_TRUE(source == resized);
+}
+
+TEST(StorageOrder, Incompatible)
+{
+  VariantPixelBuffer source(makeShape(3U), PT::UINT8);
+
+  VariantPixelBuffer wrongtype(makeShape(3U), PT::UINT16);
+  EXPECT_THROW(ome::files::convertStorageOrder(source, wrongtype), std::logic_error);
+
+  PixelBuffer<uint8_t> typed(makeShape(3U), PT::UINT8);
+  PixelBuffer<uint8_t> wrongshape(makeShape(4U), PT::UINT8);
+  EXPECT_THROW(ome::files::convertStorageOrder(typed, wrongshape), std::logic_error);
+}
+
+namespace
+{
+
+  std::vector<StorageOrderTestParameters>
+  makeParams()
+  {
+    const std::vector<PT> types
+      {
+        PT::INT8, PT::INT16, PT::INT32,
+        PT::UINT8, PT::UINT16, PT::UINT32,
+        PT::FLOAT, PT::DOUBLE, PT::BIT,
+        PT::COMPLEXFLOAT, PT::COMPLEXDOUBLE
+      };
+    const std::vector<dimension_size_type> samples
+      {
+        1U, 2U, 3U, 4U, 8U, 9U
+      };
+    const std::vector<DO> orders
+      {
+        DO::XYZTC, DO::XYCZT
+      };
+
+    std::vector<StorageOrderTestParameters> ret;
+    for (const auto& type : types)
+      for (const auto& sample : samples)
+        for (const bool sourceInterleaved : {false, true})
+          for (const auto& order : orders)
+            for (const bool destInterleaved : {false, true})
+              ret.push_back(StorageOrderTestParameters(type, sample, sourceInterleaved,
+                                                       order, destInterleaved));
+    return ret;
+  }
+
+}
+
+std::vector<StorageOrderTestParameters> params(makeParams());
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(StorageOrderVariants, StorageOrderTest, ::testing::ValuesIn(params));
@@ -36,16 +36,21 @@
  * #L%
  */
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdio>
+#include <limits>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
+#include <ome/files/Downsample.h>
 #include <ome/files/PixelProperties.h>
 #include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/TileInfo.h>
@@ -634,6 +639,22 @@ TEST_F(TIFFTest, FieldWrapFloat6)
   ASSERT_THROW(ifd->getField(ome::files::tiff::REFERENCEBLACKWHITE).get(value), ome::files::tiff::Exception);
 }
 
+TEST_F(TIFFTest, FieldWrapDouble)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  std::vector<double> value;
+
+  ASSERT_THROW(ifd->getField(ome::files::tiff::SMINSAMPLEVALUE).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::SMAXSAMPLEVALUE).get(value), ome::files::tiff::Exception);
+}
+
 TEST_F(TIFFTest, FieldWrapUInt16ExtraSamplesArray)
 {
   std::shared_ptr<TIFF> t;
@@ -832,6 +853,65 @@ TEST(TIFFCodec, ListCodecs)
     }
 }
 
+TEST(TIFFCodec, PredictorSupport)
+{
+  using namespace ome::files::tiff;
+
+  EXPECT_TRUE(isPredictorSupported(COMPRESSION_NONE, NONE, PT::UINT16));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_NONE, HORIZONTAL, PT::UINT16));
+  EXPECT_TRUE(isPredictorSupported(COMPRESSION_LZW, HORIZONTAL, PT::UINT16));
+  EXPECT_TRUE(isPredictorSupported(COMPRESSION_ADOBE_DEFLATE, HORIZONTAL, PT::INT8));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_ADOBE_DEFLATE, HORIZONTAL, PT::FLOAT));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_ADOBE_DEFLATE, HORIZONTAL, PT::BIT));
+  EXPECT_TRUE(isPredictorSupported(COMPRESSION_LZMA, FLOATING_POINT, PT::DOUBLE));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_LZMA, FLOATING_POINT, PT::UINT32));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_DEFLATE, FLOATING_POINT, PT::COMPLEXFLOAT));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_JPEG, HORIZONTAL, PT::UINT8));
+  EXPECT_TRUE(isPredictorSupported(COMPRESSION_ZSTD, HORIZONTAL, PT::UINT16));
+  EXPECT_FALSE(isPredictorSupported(COMPRESSION_LERC, HORIZONTAL, PT::UINT16));
+
+  EXPECT_EQ(HORIZONTAL, getPredictorScheme("Horizontal"));
+  EXPECT_EQ(FLOATING_POINT, getPredictorScheme("FloatingPoint"));
+  EXPECT_EQ(NONE, getPredictorScheme("None"));
+  EXPECT_EQ(NONE, getPredictorScheme("Invalid"));
+}
+
+TEST(TIFFCodec, LayoutSupport)
+{
+  using namespace ome::files::tiff;
+
+  EXPECT_TRUE(isCodecLayoutSupported(COMPRESSION_WEBP, PT::UINT8, 3U, CONTIG));
+  EXPECT_TRUE(isCodecLayoutSupported(COMPRESSION_WEBP, PT::UINT8, 4U, CONTIG));
+  EXPECT_FALSE(isCodecLayoutSupported(COMPRESSION_WEBP, PT::UINT8, 1U, CONTIG));
+  EXPECT_FALSE(isCodecLayoutSupported(COMPRESSION_WEBP, PT::UINT8, 3U, SEPARATE));
+  EXPECT_FALSE(isCodecLayoutSupported(COMPRESSION_WEBP, PT::UINT16, 3U, CONTIG));
+  EXPECT_TRUE(isCodecLayoutSupported(COMPRESSION_ZSTD, PT::UINT16, 1U, SEPARATE));
+  EXPECT_TRUE(isCodecLayoutSupported(COMPRESSION_ADOBE_DEFLATE, PT::UINT8, 3U, SEPARATE));
+}
+
+TEST(TIFFCodec, LevelRange)
+{
+  using namespace ome::files::tiff;
+
+  boost::optional<CodecLevelRange> deflate(getCodecLevelRange(COMPRESSION_ADOBE_DEFLATE));
+  ASSERT_TRUE(static_cast<bool>(deflate));
+  EXPECT_EQ(1, deflate->minimum);
+  EXPECT_EQ(9, deflate->maximum);
+
+  boost::optional<CodecLevelRange> lzma(getCodecLevelRange(COMPRESSION_LZMA));
+  ASSERT_TRUE(static_cast<bool>(lzma));
+  EXPECT_EQ(0, lzma->minimum);
+  EXPECT_EQ(9, lzma->maximum);
+
+  boost::optional<CodecLevelRange> zstd(getCodecLevelRange(COMPRESSION_ZSTD));
+  ASSERT_TRUE(static_cast<bool>(zstd));
+  EXPECT_EQ(1, zstd->minimum);
+  EXPECT_EQ(22, zstd->maximum);
+
+  EXPECT_FALSE(static_cast<bool>(getCodecLevelRange(COMPRESSION_NONE)));
+  EXPECT_FALSE(static_cast<bool>(getCodecLevelRange(COMPRESSION_LZW)));
+}
+
 typedef std::tuple<uint32_t,uint32_t,PT,ome::files::tiff::PlanarConfiguration> plane_configuration;
 
 struct compare_tuple
@@ -1354,6 +1434,80 @@ TEST_P(TIFFVariantTest, PlaneReadUnalignedTileRandom)
     }
 }
 
+TEST_P(TIFFVariantTest, PlaneReadSampled)
+{
+  PlaneRegion full(0, 0, ifd->getImageWidth(), ifd->getImageHeight());
+
+  const std::vector<PlaneRegion> regions
+    {
+      full,
+      PlaneRegion(3, 5, full.w - 9, full.h - 11)
+    };
+  const std::vector<std::pair<dimension_size_type, dimension_size_type>> steps
+    {
+      {1, 1}, {2, 2}, {3, 7}, {8, 1}, {16, 16}, {full.w, full.h}
+    };
+
+  for (const auto& r : regions)
+    for (const auto& step : steps)
+      {
+        VariantPixelBuffer region;
+        ifd->readImage(region, r.x, r.y, r.w, r.h);
+        VariantPixelBuffer expected;
+        ome::files::downsample(region, expected, step.first, step.second,
+                               ome::files::DOWNSAMPLE_NEAREST);
+
+        VariantPixelBuffer vb;
+        ASSERT_NO_THROW(ifd->readImage(vb, r.x, r.y, r.w, r.h, step.first, step.second));
+        EXPECT_EQ((r.w + step.first - 1) / step.first, vb.shape()[ome::files::DIM_SPATIAL_X]);
+        EXPECT_EQ((r.h + step.second - 1) / step.second, vb.shape()[ome::files::DIM_SPATIAL_Y]);
+        EXPECT_TRUE(expected == vb);
+      }
+
+  VariantPixelBuffer vb;
+  EXPECT_THROW(ifd->readImage(vb, 0, 0, full.w, full.h, 0, 1), ome::files::tiff::Exception);
+}
+
+TEST_P(TIFFVariantTest, PlaneReadStorageOrder)
+{
+  PlaneRegion full(0, 0, ifd->getImageWidth(), ifd->getImageHeight());
+
+  const std::vector<PlaneRegion> regions
+    {
+      full,
+      PlaneRegion(3, 5, full.w - 9, full.h - 11)
+    };
+  const std::vector<std::pair<dimension_size_type, dimension_size_type>> steps
+    {
+      {1, 1}, {3, 7}
+    };
+
+  for (const auto& r : regions)
+    for (const auto& step : steps)
+      {
+        VariantPixelBuffer expected;
+        ifd->readImage(expected, r.x, r.y, r.w, r.h, step.first, step.second);
+
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        std::copy(expected.shape(), expected.shape() + shape.size(), shape.begin());
+
+        // Both sample layouts are read without reallocation.
+        for (const bool interleaved : {true, false})
+          {
+            const ::ome::files::PixelBufferBase::storage_order_type order
+              (::ome::files::PixelBufferBase::make_storage_order(::ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                 interleaved));
+            VariantPixelBuffer vb(shape, expected.pixelType(), order);
+            const VariantPixelBuffer::raw_type *data = vb.data();
+
+            ASSERT_NO_THROW(ifd->readImage(vb, r.x, r.y, r.w, r.h, step.first, step.second));
+            EXPECT_EQ(data, vb.data());
+            EXPECT_TRUE(order == vb.storage_order());
+            EXPECT_TRUE(expected == vb);
+          }
+      }
+}
+
 class PixelTestParameters
 {
 public:
@@ -1632,6 +1786,325 @@ TEST_P(PixelTest, WriteTIFF)
 
 }
 
+namespace
+{
+
+  // Compare a fill value, where NaN matches NaN.
+  void
+  expect_fill_value(double expected,
+                    double actual)
+  {
+    if (std::isnan(expected))
+      EXPECT_TRUE(std::isnan(actual));
+    else
+      EXPECT_EQ(expected, actual);
+  }
+
+  // Compare single subchannel pixel data, where NaN matches NaN.
+  // With one subchannel, the data are in the same order whether or
+  // not the buffers are interleaved.
+  template<typename T>
+  bool
+  equal_pixels(const VariantPixelBuffer& expected,
+               const VariantPixelBuffer& actual)
+  {
+    if (expected.pixelType() != actual.pixelType() ||
+        expected.num_elements() != actual.num_elements())
+      return false;
+
+    const T *e = expected.data<T>();
+    return std::equal(e, e + expected.num_elements(), actual.data<T>(),
+                      [](T a, T b) { return a == b || (std::isnan(a) && std::isnan(b)); });
+  }
+
+  template<int P>
+  void
+  sparse_write_read(ome::files::tiff::TileType tiletype,
+                    double                     fillvalue)
+  {
+    typedef typename PixelProperties<P>::std_type value_type;
+
+    path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+    if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+      throw std::runtime_error("Image directory unavailable and could not be created");
+    std::ostringstream f;
+    f << "sparse-" << (tiletype == ome::files::tiff::TILE ? "tile" : "strip")
+      << '-' << PT(P) << '-' << fillvalue << ".tiff";
+    dir /= f.str();
+    const std::string filename(dir.string());
+
+    // 64×64 image with 16×16 tiles or 16 row strips.  Only the
+    // first tile or strip contains non-fill pixel data.
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[::ome::files::DIM_SPATIAL_X] = 64U;
+    shape[::ome::files::DIM_SPATIAL_Y] = 64U;
+    shape[::ome::files::DIM_SUBCHANNEL] = 1U;
+    shape[::ome::files::DIM_SPATIAL_Z] = shape[::ome::files::DIM_TEMPORAL_T] = shape[::ome::files::DIM_CHANNEL] =
+      shape[::ome::files::DIM_MODULO_Z] = shape[::ome::files::DIM_MODULO_T] = shape[::ome::files::DIM_MODULO_C] = 1;
+
+    ::ome::files::PixelBufferBase::storage_order_type order
+        (::ome::files::PixelBufferBase::make_storage_order(::ome::xml::model::enums::DimensionOrder::XYZTC, true));
+
+    VariantPixelBuffer pixels(shape, P, order);
+    value_type *data = pixels.data<value_type>();
+    std::fill(data, data + pixels.num_elements(), static_cast<value_type>(fillvalue));
+    for (dimension_size_type y = 0; y < 8; ++y)
+      for (dimension_size_type x = 0; x < 8; ++x)
+        data[(y * 64U) + x] = static_cast<value_type>(x + y + 1000U);
+
+    {
+      std::shared_ptr<TIFF> wtiff = TIFF::open(filename, "w");
+      std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+      wifd->setImageWidth(64U);
+      wifd->setImageHeight(64U);
+      wifd->setTileType(tiletype);
+      wifd->setTileWidth(16U);
+      wifd->setTileHeight(16U);
+      wifd->setPixelType(P);
+      wifd->setBitsPerSample(ome::files::bitsPerPixel(P));
+      wifd->setSamplesPerPixel(1U);
+      wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+      wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+      wifd->setCompression(ome::files::tiff::COMPRESSION_ADOBE_DEFLATE);
+      wifd->setSparse(true);
+      wifd->setFillValue(fillvalue);
+      EXPECT_TRUE(wifd->getSparse());
+      expect_fill_value(fillvalue, wifd->getFillValue());
+
+      ASSERT_NO_THROW(wifd->writeImage(pixels));
+      wtiff->writeCurrentDirectory();
+      wtiff->close();
+    }
+
+    {
+      std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+      std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+      std::vector<uint64_t> bytecounts;
+      ifd->getField(tiletype == ome::files::tiff::TILE ?
+                    ome::files::tiff::TILEBYTECOUNTS :
+                    ome::files::tiff::STRIPBYTECOUNTS).get(bytecounts);
+      ASSERT_EQ(tiletype == ome::files::tiff::TILE ? 16U : 4U, bytecounts.size());
+      EXPECT_NE(0U, bytecounts.at(0));
+      for (std::vector<uint64_t>::size_type i = 1; i < bytecounts.size(); ++i)
+        EXPECT_EQ(0U, bytecounts.at(i));
+
+      // The fill value is read back from the file.
+      expect_fill_value(fillvalue, ifd->getFillValue());
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(ifd->readImage(vb));
+      EXPECT_TRUE(equal_pixels<value_type>(pixels, vb));
+    }
+
+    // Copy the compressed tiles; unwritten tiles remain unwritten.
+    const std::string copyname(filename + "-copy.tiff");
+    {
+      std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+      std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+      std::shared_ptr<TIFF> wtiff = TIFF::open(copyname, "w");
+      std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+      wifd->setImageWidth(64U);
+      wifd->setImageHeight(64U);
+      wifd->setTileType(tiletype);
+      wifd->setTileWidth(16U);
+      wifd->setTileHeight(16U);
+      wifd->setPixelType(P);
+      wifd->setBitsPerSample(ome::files::bitsPerPixel(P));
+      wifd->setSamplesPerPixel(1U);
+      wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+      wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+      wifd->setCompression(ome::files::tiff::COMPRESSION_ADOBE_DEFLATE);
+
+      ASSERT_NO_THROW(wifd->copyTiles(*ifd));
+      wtiff->writeCurrentDirectory();
+      wtiff->close();
+    }
+
+    {
+      std::shared_ptr<TIFF> tiff = TIFF::open(copyname, "r");
+      std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+      std::vector<uint64_t> bytecounts;
+      ifd->getField(tiletype == ome::files::tiff::TILE ?
+                    ome::files::tiff::TILEBYTECOUNTS :
+                    ome::files::tiff::STRIPBYTECOUNTS).get(bytecounts);
+      EXPECT_NE(0U, bytecounts.at(0));
+      for (std::vector<uint64_t>::size_type i = 1; i < bytecounts.size(); ++i)
+        EXPECT_EQ(0U, bytecounts.at(i));
+
+      // The fill value is copied with the tiles.
+      expect_fill_value(fillvalue, ifd->getFillValue());
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(ifd->readImage(vb));
+      EXPECT_TRUE(equal_pixels<value_type>(pixels, vb));
+    }
+
+    boost::filesystem::remove(filename);
+    boost::filesystem::remove(copyname);
+  }
+
+}
+
+TEST(TIFFSparse, WriteReadTileZero)
+{
+  sparse_write_read<PT::UINT16>(ome::files::tiff::TILE, 0.0);
+}
+
+TEST(TIFFSparse, WriteReadTileFill)
+{
+  sparse_write_read<PT::UINT16>(ome::files::tiff::TILE, 255.0);
+}
+
+TEST(TIFFSparse, WriteReadStripZero)
+{
+  sparse_write_read<PT::UINT16>(ome::files::tiff::STRIP, 0.0);
+}
+
+TEST(TIFFSparse, WriteReadStripFill)
+{
+  sparse_write_read<PT::UINT16>(ome::files::tiff::STRIP, 255.0);
+}
+
+TEST(TIFFSparse, WriteReadTileFloatNaN)
+{
+  // NaN never compares equal, so the fill value must be matched
+  // specially for the tiles to be left unwritten.
+  sparse_write_read<PT::FLOAT>(ome::files::tiff::TILE, std::numeric_limits<double>::quiet_NaN());
+}
+
+TEST(TIFFSparse, WriteReadStripFloatNaN)
+{
+  sparse_write_read<PT::FLOAT>(ome::files::tiff::STRIP, std::numeric_limits<double>::quiet_NaN());
+}
+
+TEST(TIFFSparse, FillValueOutOfRange)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+    throw std::runtime_error("Image directory unavailable and could not be created");
+  dir /= "sparse-fill-out-of-range.tiff";
+  const std::string filename(dir.string());
+
+  VariantPixelBuffer pixels(boost::extents[16][16][1][1][1][1][1][1][1], PT::UINT16);
+  uint16_t *data = pixels.data<uint16_t>();
+  std::fill(data, data + pixels.num_elements(), static_cast<uint16_t>(3U));
+
+  // GDAL writes no data values which the pixel type can not hold,
+  // such as -9999 for unsigned data.
+  {
+    std::shared_ptr<TIFF> wtiff = TIFF::open(filename, "w");
+    std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+    wifd->setImageWidth(16U);
+    wifd->setImageHeight(16U);
+    wifd->setTileType(ome::files::tiff::STRIP);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT16);
+    wifd->setBitsPerSample(16U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    wifd->setFillValue(-9999.0);
+
+    ASSERT_NO_THROW(wifd->writeImage(pixels));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+    std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+
+    EXPECT_EQ(0.0, ifd->getFillValue());
+    VariantPixelBuffer vb;
+    ASSERT_NO_THROW(ifd->readImage(vb));
+    EXPECT_TRUE(pixels == vb);
+  }
+
+  boost::filesystem::remove(filename);
+}
+
+TEST(TIFFCopyTiles, JPEGTables)
+{
+  // JPEG tiles can only be decoded with the tables stored in the
+  // JPEGTables tag, which must be copied with the tiles.
+  std::vector<Codec> codecs = ome::files::tiff::getCodecs();
+  if (std::find_if(codecs.begin(), codecs.end(),
+                   [](const Codec& c) { return c.scheme == ome::files::tiff::COMPRESSION_JPEG; }) == codecs.end())
+    return;
+
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  if (!exists(dir) && !is_directory(dir) && !create_directories(dir))
+    throw std::runtime_error("Image directory unavailable and could not be created");
+  const std::string filename((dir / "copytiles-jpeg.tiff").string());
+  const std::string copyname((dir / "copytiles-jpeg-copy.tiff").string());
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[::ome::files::DIM_SPATIAL_X] = 64U;
+  shape[::ome::files::DIM_SPATIAL_Y] = 64U;
+  shape[::ome::files::DIM_SUBCHANNEL] = 3U;
+  shape[::ome::files::DIM_SPATIAL_Z] = shape[::ome::files::DIM_TEMPORAL_T] = shape[::ome::files::DIM_CHANNEL] =
+    shape[::ome::files::DIM_MODULO_Z] = shape[::ome::files::DIM_MODULO_T] = shape[::ome::files::DIM_MODULO_C] = 1;
+
+  ::ome::files::PixelBufferBase::storage_order_type order
+      (::ome::files::PixelBufferBase::make_storage_order(::ome::xml::model::enums::DimensionOrder::XYZTC, true));
+
+  VariantPixelBuffer pixels(shape, PT::UINT8, order);
+  uint8_t *data = pixels.data<uint8_t>();
+  for (dimension_size_type i = 0; i < pixels.num_elements(); ++i)
+    data[i] = static_cast<uint8_t>((i * 7U) % 251U);
+
+  auto setup = [](IFD& ifd)
+    {
+      ifd.setImageWidth(64U);
+      ifd.setImageHeight(64U);
+      ifd.setTileType(ome::files::tiff::TILE);
+      ifd.setTileWidth(16U);
+      ifd.setTileHeight(16U);
+      ifd.setPixelType(PT::UINT8);
+      ifd.setBitsPerSample(8U);
+      ifd.setSamplesPerPixel(3U);
+      ifd.setPlanarConfiguration(ome::files::tiff::CONTIG);
+      ifd.setPhotometricInterpretation(ome::files::tiff::RGB);
+      ifd.setCompression(ome::files::tiff::COMPRESSION_JPEG);
+    };
+
+  {
+    std::shared_ptr<TIFF> wtiff = TIFF::open(filename, "w");
+    std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+    setup(*wifd);
+    ASSERT_NO_THROW(wifd->writeImage(pixels));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(filename, "r");
+    std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+    ASSERT_NO_THROW(ifd->readImage(expected));
+
+    std::shared_ptr<TIFF> wtiff = TIFF::open(copyname, "w");
+    std::shared_ptr<IFD> wifd = wtiff->getCurrentDirectory();
+    setup(*wifd);
+    ASSERT_NO_THROW(wifd->copyTiles(*ifd));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  {
+    std::shared_ptr<TIFF> tiff = TIFF::open(copyname, "r");
+    std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(0);
+    VariantPixelBuffer vb;
+    ASSERT_NO_THROW(ifd->readImage(vb));
+    EXPECT_TRUE(expected == vb);
+  }
+
+  boost::filesystem::remove(filename);
+  boost::filesystem::remove(copyname);
+}
+
 namespace
 {
 
@@ -1692,6 +2165,8 @@ namespace
     compression_types.push_back(boost::optional<std::string>("Deflate"));
     compression_types.push_back(boost::optional<std::string>("LZW"));
     compression_types.push_back(boost::optional<std::string>("None"));
+    compression_types.push_back(boost::optional<std::string>("ZSTD"));
+    compression_types.push_back(boost::optional<std::string>("LERC"));
 
     const PT::value_map_type& pixeltypemap = PT::values();
     std::vector<PT> pixeltypes;
@@ -1704,6 +2179,15 @@ namespace
             for (auto pi : photometricinterps)
               for (const auto& comp: compression_types)
                 {
+                  // Skip optional codecs if unavailable for this
+                  // pixel type.
+                  if (comp && (*comp == "ZSTD" || *comp == "LERC"))
+                    {
+                      const std::vector<std::string>& names(ome::files::tiff::getCodecNames(pt));
+                      if (std::find(names.begin(), names.end(), *comp) == names.end())
+                        continue;
+                    }
+
                   for(auto wid : tilesizes)
                     for(auto ht : tilesizes)
                       {
@@ -36,6 +36,7 @@
  * #L%
  */
 
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -147,6 +148,33 @@ TEST_P(TIFFTest, openBytes)
     }
 }
 
+TEST_P(TIFFTest, clone)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  std::shared_ptr<ome::files::FormatReader> copy;
+  ASSERT_NO_THROW(copy = tiff.clone());
+  ASSERT_TRUE(static_cast<bool>(copy));
+
+  // The clone is a TIFFReader, not a sliced MinimalTIFFReader.
+  EXPECT_TRUE(static_cast<bool>(std::dynamic_pointer_cast<TIFFReader>(copy)));
+  EXPECT_EQ(tiff.getFormat(), copy->getFormat());
+  EXPECT_EQ(tiff.getSeriesCount(), copy->getSeriesCount());
+  EXPECT_EQ(tiff.getImageCount(), copy->getImageCount());
+  EXPECT_EQ(tiff.getSizeT(), copy->getSizeT());
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      VariantPixelBuffer expected;
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(tiff.openBytes(p, expected));
+      ASSERT_NO_THROW(copy->openBytes(p, buf));
+      EXPECT_TRUE(expected == buf);
+    }
+}
+
 namespace
 {
 
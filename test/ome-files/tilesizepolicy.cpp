@@ -0,0 +1,166 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2018 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <ome/files/TileSizePolicy.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::TileSizePolicy;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  TileSizePolicy::Parameters
+  params(const std::string&  compression,
+         PixelType           pixeltype,
+         dimension_size_type samples,
+         dimension_size_type sizex,
+         dimension_size_type sizey)
+  {
+    TileSizePolicy::Parameters p;
+    if (compression != "None")
+      p.compression = compression;
+    p.pixelType = pixeltype;
+    p.samples = samples;
+    p.sizeX = sizex;
+    p.sizeY = sizey;
+    return p;
+  }
+
+}
+
+TEST(TileSizePolicy, AccessPattern)
+{
+  TileSizePolicy p;
+  ASSERT_EQ(TileSizePolicy::FULL_PLANE, p.getAccessPattern());
+  p.setAccessPattern(TileSizePolicy::RANDOM_REGION);
+  ASSERT_EQ(TileSizePolicy::RANDOM_REGION, p.getAccessPattern());
+}
+
+TEST(TileSizePolicy, ChunkSize)
+{
+  TileSizePolicy full(TileSizePolicy::FULL_PLANE);
+  TileSizePolicy region(TileSizePolicy::RANDOM_REGION);
+
+  ASSERT_EQ(65536U, full.getChunkSize(boost::none));
+  ASSERT_EQ(65536U, full.getChunkSize(std::string("LZW")));
+  ASSERT_EQ(131072U, full.getChunkSize(std::string("Deflate")));
+  ASSERT_EQ(524288U, full.getChunkSize(std::string("ZSTD")));
+  ASSERT_EQ(524288U, full.getChunkSize(std::string("LZMA")));
+  ASSERT_EQ(65536U, full.getChunkSize(std::string("JPEG")));
+  ASSERT_EQ(65536U, full.getChunkSize(std::string("LERC")));
+
+  ASSERT_EQ(32768U, region.getChunkSize(boost::none));
+  ASSERT_EQ(32768U, region.getChunkSize(std::string("LZW")));
+  ASSERT_EQ(32768U, region.getChunkSize(std::string("Deflate")));
+  ASSERT_EQ(32768U, region.getChunkSize(std::string("ZSTD")));
+}
+
+TEST(TileSizePolicy, UncompressedStrips)
+{
+  TileSizePolicy p;
+  TileSizePolicy::TileSize s(p.getTileSize(params("None", PixelType::UINT8, 1U, 1024U, 1024U)));
+  ASSERT_FALSE(s.tiled);
+  ASSERT_EQ(1024U, s.width);
+  ASSERT_EQ(64U, s.height);
+}
+
+TEST(TileSizePolicy, CompressedStrips)
+{
+  TileSizePolicy p;
+  TileSizePolicy::TileSize s(p.getTileSize(params("Deflate", PixelType::UINT8, 1U, 1000U, 2000U)));
+  ASSERT_FALSE(s.tiled);
+  ASSERT_EQ(1000U, s.width);
+  ASSERT_EQ(128U, s.height);
+
+  // Strips are limited to the image height.
+  s = p.getTileSize(params("Deflate", PixelType::UINT8, 1U, 1000U, 100U));
+  ASSERT_FALSE(s.tiled);
+  ASSERT_EQ(100U, s.height);
+}
+
+TEST(TileSizePolicy, CompressedTiles)
+{
+  TileSizePolicy p;
+
+  TileSizePolicy::TileSize s(p.getTileSize(params("ZSTD", PixelType::UINT16, 1U, 4096U, 4096U)));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(512U, s.width);
+  ASSERT_EQ(512U, s.height);
+
+  // Interleaved samples do not reduce the tile size.
+  s = p.getTileSize(params("ZSTD", PixelType::UINT16, 5U, 4096U, 4096U));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(512U, s.width);
+  ASSERT_EQ(512U, s.height);
+
+  s = p.getTileSize(params("Deflate", PixelType::UINT16, 1U, 4096U, 4096U));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(256U, s.width);
+  ASSERT_EQ(256U, s.height);
+
+  // Tile size is limited to 1024.
+  s = p.getTileSize(params("ZSTD", PixelType::UINT8, 1U, 4096U, 4096U));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(1024U, s.width);
+  ASSERT_EQ(1024U, s.height);
+}
+
+TEST(TileSizePolicy, RandomRegionTiles)
+{
+  TileSizePolicy p(TileSizePolicy::RANDOM_REGION);
+
+  TileSizePolicy::TileSize s(p.getTileSize(params("ZSTD", PixelType::UINT16, 1U, 1024U, 1024U)));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(128U, s.width);
+  ASSERT_EQ(128U, s.height);
+
+  // Interleaved samples reduce the tile size, to the minimum of 64.
+  s = p.getTileSize(params("ZSTD", PixelType::UINT16, 5U, 1024U, 1024U));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(64U, s.width);
+  ASSERT_EQ(64U, s.height);
+
+  // Tiles are no larger than the image, rounded up to a multiple of 16.
+  s = p.getTileSize(params("None", PixelType::UINT8, 1U, 100U, 50U));
+  ASSERT_TRUE(s.tiled);
+  ASSERT_EQ(112U, s.width);
+  ASSERT_EQ(64U, s.height);
+}